@@ -1,37 +1,114 @@
 #include "AnimationManager.h"
+#include "Metrics.h"
+#include "PixelSpan.h"
+#include "Trace.h"
+
+AnimationManager::AnimationManager() {
+    _animations.reserve(MAX_ANIMATIONS);
+    _segments.reserve(MAX_SEGMENTS);
+}
 
 void AnimationManager::addAnimation(IAnimation* anim) {
     _animations.push_back(anim);
 }
 
-void AnimationManager::setActive(const String& name, const AppState& state) {
+void AnimationManager::setActive(const char* name, const AppState& state) {
     for (size_t i = 0; i < _animations.size(); i++) {
-        if (name.equalsIgnoreCase(_animations[i]->name())) {
+        if (strcasecmp(name, _animations[i]->name()) == 0) {
             if (_activeIndex >= 0 && _activeIndex < (int)_animations.size()) {
                 _animations[_activeIndex]->onExit();
             }
             _activeIndex = (int)i;
             _animations[_activeIndex]->onEnter(state);
+            _cacheStale = true;
             return;
         }
     }
 }
 
-void AnimationManager::nextAnimation(const AppState& state) {
-    if (_animations.empty()) return;
-    if (_activeIndex >= 0 && _activeIndex < (int)_animations.size()) {
-        _animations[_activeIndex]->onExit();
+void AnimationManager::prepareCache(IAnimation* base, const AppState& state, uint32_t stateVersion,
+                                    uint16_t numPixels) {
+    if (!_cacheStale && stateVersion == _cacheVersion) {
+        return;
+    }
+    _cacheStale = false;
+    _cacheVersion = stateVersion;
+    _cachedStep = UINT32_MAX;
+    uint32_t stepMs, frames;
+    if (base && base->period(state, numPixels, stepMs, frames)) {
+        _frameCache.begin(numPixels, stepMs, frames);
+    } else {
+        _frameCache.reset();
     }
-    _activeIndex = (_activeIndex + 1) % (int)_animations.size();
-    _animations[_activeIndex]->onEnter(state);
 }
 
-void AnimationManager::update(uint32_t nowMs, const AppState& state, LedRing& ring) {
-    if (_activeIndex >= 0 && _activeIndex < (int)_animations.size()) {
-        _animations[_activeIndex]->update(nowMs, state, ring);
+void AnimationManager::update(uint32_t nowMs, const AppState& state, uint32_t stateVersion, LedRing& ring) {
+    TRACE_SCOPE("AnimationManager::update");
+    IAnimation* base = (_activeIndex >= 0 && _activeIndex < (int)_animations.size())
+        ? _animations[_activeIndex] : nullptr;
+    prepareCache(base, state, stateVersion, ring.numPixels());
+
+    // A cached animation is due when its step moves; its own isDue() only
+    // tracks the frames it rendered itself
+    const bool cached = _frameCache.active();
+    const uint32_t step = cached ? _frameCache.stepAt(nowMs) : 0;
+    const bool baseDue = base && (cached ? step != _cachedStep : base->isDue(nowMs, state));
+
+    // A base redraw overwrites the segments' pixels, so they redraw with it
+    const bool redrawAll = _forceRedraw || baseDue;
+    bool drew = false;
+    if (redrawAll) {
+        PixelSpan full(ring, 0, ring.numPixels());
+        if (!base) {
+            full.clear();
+        } else if (!cached) {
+            base->render(nowMs, state, full);
+        } else if (const uint16_t* frame = _frameCache.frame(step)) {
+            ring.loadFrame(frame);
+            Metrics::frameCacheHits++;
+        } else {
+            base->render(nowMs, state, full);
+            _frameCache.store(step, ring.frameData());
+            Metrics::frameCacheFills++;
+        }
+        _cachedStep = step;
+        drew = true;
+    }
+    for (Segment& seg : _segments) {
+        if (!seg.animation) continue;
+        if (redrawAll || seg.animation->isDue(nowMs, seg.params)) {
+            PixelSpan span(ring, seg.start, seg.length, seg.reverse, seg.mirror, seg.brightness);
+            seg.animation->render(nowMs, seg.params, span);
+            drew = true;
+        }
+    }
+    _forceRedraw = false;
+
+    if (drew) {
+        ring.show();
+        Metrics::framesRendered++;
+    } else {
+        Metrics::framesSkipped++;
     }
 }
 
+uint32_t AnimationManager::msUntilDue(uint32_t nowMs, const AppState& state) const {
+    if (_forceRedraw) return 0;
+    uint32_t wait = IdleControl::FOREVER;
+    if (_frameCache.active() && !_cacheStale) {
+        const uint32_t stepMs = _frameCache.stepMs();
+        wait = _frameCache.stepAt(nowMs) != _cachedStep ? 0 : stepMs - nowMs % stepMs;
+    } else if (_activeIndex >= 0 && _activeIndex < (int)_animations.size()) {
+        wait = _animations[_activeIndex]->msUntilDue(nowMs, state);
+    }
+    for (const Segment& seg : _segments) {
+        if (!seg.animation) continue;
+        const uint32_t segWait = seg.animation->msUntilDue(nowMs, seg.params);
+        if (segWait < wait) wait = segWait;
+    }
+    return wait;
+}
+
 const char* AnimationManager::currentName() const {
     if (_activeIndex >= 0 && _activeIndex < (int)_animations.size()) {
         return _animations[_activeIndex]->name();
@@ -39,10 +116,54 @@ const char* AnimationManager::currentName() const {
     return "";
 }
 
-std::vector<const char*> AnimationManager::listNames() const {
-    std::vector<const char*> names;
+Segment* AnimationManager::upsertSegment(const char* name, const AppState& defaults) {
+    if (Segment* existing = findSegment(name)) {
+        return existing;
+    }
+    if (_segments.size() >= MAX_SEGMENTS || name[0] == '\0') {
+        return nullptr;
+    }
+    _segments.emplace_back();
+    Segment& seg = _segments.back();
+    strlcpy(seg.name, name, sizeof(seg.name));
+    seg.params = defaults;
+    _forceRedraw = true;
+    return &seg;
+}
+
+Segment* AnimationManager::findSegment(const char* name) {
+    for (Segment& seg : _segments) {
+        if (strcmp(seg.name, name) == 0) return &seg;
+    }
+    return nullptr;
+}
+
+bool AnimationManager::removeSegment(const char* name) {
+    for (auto it = _segments.begin(); it != _segments.end(); ++it) {
+        if (strcmp(it->name, name) == 0) {
+            if (it->animation) it->animation->onExit();
+            _segments.erase(it);
+            _forceRedraw = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AnimationManager::setSegmentAnimation(Segment& segment, const char* name) {
+    IAnimation* proto = findAnimation(name);
+    if (!proto) return false;
+    if (segment.animation) segment.animation->onExit();
+    segment.animation.reset(proto->clone());
+    segment.params.setAnimation(proto->name());
+    segment.animation->onEnter(segment.params);
+    _forceRedraw = true;
+    return true;
+}
+
+IAnimation* AnimationManager::findAnimation(const char* name) const {
     for (auto* a : _animations) {
-        names.push_back(a->name());
+        if (strcasecmp(name, a->name()) == 0) return a;
     }
-    return names;
+    return nullptr;
 }
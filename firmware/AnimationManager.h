@@ -1,22 +1,80 @@
 #pragma once
 
 #include <Arduino.h>
+#include <memory>
 #include <vector>
 #include "AppState.h"
 #include "LedRing.h"
+#include "FrameCache.h"
 #include "animations/IAnimation.h"
 
+// A named pixel range with its own animation instance and parameters, drawn
+// on top of the base animation
+struct Segment {
+    static constexpr size_t NAME_LEN = 16;
+
+    char name[NAME_LEN] = {0};
+    uint16_t start = 0;
+    uint16_t length = 0;
+    bool reverse = false;
+    bool mirror = false;
+    uint8_t brightness = 255;
+    AppState params;    // Color, speed, tail, strobe period and pixel colors for this segment
+    std::unique_ptr<IAnimation> animation;
+};
+
 class AnimationManager {
 public:
+    static constexpr size_t MAX_SEGMENTS = 8;
+    static constexpr size_t MAX_ANIMATIONS = 16;
+
+    // Reserves the animation and segment tables up front, so adding to them never allocates
+    AnimationManager();
+
     void addAnimation(IAnimation* anim);
-    void setActive(const String& name, const AppState& state);
-    void nextAnimation(const AppState& state);
-    void update(uint32_t nowMs, const AppState& state, LedRing& ring);
+    void setActive(const char* name, const AppState& state);
+
+    // Renders the base animation and every segment into the ring's frame
+    // buffer, then shows it once if anything changed. `stateVersion` is the
+    // store sequence `state` was read at; a periodic base animation's cached
+    // frames are replayed until it moves.
+    void update(uint32_t nowMs, const AppState& state, uint32_t stateVersion, LedRing& ring);
+
+    // Milliseconds until update() would draw something (IdleControl::FOREVER if
+    // nothing is animating)
+    uint32_t msUntilDue(uint32_t nowMs, const AppState& state) const;
 
     const char* currentName() const;
-    std::vector<const char*> listNames() const;
+    size_t animationCount() const { return _animations.size(); }
+    const char* animationName(size_t index) const { return _animations[index]->name(); }
+    bool hasAnimation(const char* name) const { return findAnimation(name) != nullptr; }
+
+    // Returns the named segment, creating it with `defaults` as its parameters
+    // if needed; nullptr when the segment table is full
+    Segment* upsertSegment(const char* name, const AppState& defaults);
+    Segment* findSegment(const char* name);
+    bool removeSegment(const char* name);
+    // Gives the segment its own instance of the named animation
+    bool setSegmentAnimation(Segment& segment, const char* name);
+    const std::vector<Segment>& segments() const { return _segments; }
+
+    // Forces a full redraw on the next update, e.g. after editing a segment
+    void invalidate() { _forceRedraw = true; }
 
 private:
     std::vector<IAnimation*> _animations;
+    std::vector<Segment> _segments;
     int _activeIndex = -1;
+    bool _forceRedraw = true;
+
+    // Base animation frames, keyed by the state version and active animation
+    FrameCache _frameCache;
+    uint32_t _cacheVersion = 0;
+    bool _cacheStale = true;
+    uint32_t _cachedStep = UINT32_MAX;     // Step last drawn from the cache
+
+    // Sets up (or drops) the cache for the current base animation and state
+    void prepareCache(IAnimation* base, const AppState& state, uint32_t stateVersion, uint16_t numPixels);
+
+    IAnimation* findAnimation(const char* name) const;
 };
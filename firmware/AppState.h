@@ -3,12 +3,16 @@
 #include <Arduino.h>
 #include "Config.h"
 
+// Plain, trivially copyable state shared by animations and commands. The live
+// instance is owned by AppStateStore; everything else works on snapshots.
 struct AppState {
+    static constexpr size_t ANIMATION_NAME_LEN = 16;
+
     bool powerOn = true;
     uint8_t brightness = 128;
     uint32_t primaryColor = 0x0000FF;   // Blue
     uint32_t secondaryColor = 0x000000; // Off
-    String currentAnimationName = "fade";
+    char animation[ANIMATION_NAME_LEN] = "fade";
     uint16_t speedMs = 50;              // Base step interval in ms
     
     // Animation-specific params
@@ -17,4 +21,6 @@ struct AppState {
 
     uint32_t pixelColors[Config::NUM_PIXELS] = {0};
     uint32_t pixelVersion = 1;
+
+    void setAnimation(const char* name) { strlcpy(animation, name, sizeof(animation)); }
 };
@@ -0,0 +1,84 @@
+#include "AppStateStore.h"
+
+// The published copy is only touched as atomic words. Release stores after
+// the odd sequence and acquire loads before the re-check order the data
+// against the counter without standalone fences, and no plain (racy) access
+// ever touches shared memory.
+static void loadWords(uint32_t* dst, const uint32_t* src, size_t words) {
+    for (size_t i = 0; i < words; i++) {
+        dst[i] = __atomic_load_n(&src[i], __ATOMIC_ACQUIRE);
+    }
+}
+
+static void storeWords(uint32_t* dst, const uint32_t* src, size_t words) {
+    for (size_t i = 0; i < words; i++) {
+        __atomic_store_n(&dst[i], src[i], __ATOMIC_RELEASE);
+    }
+}
+
+AppStateStore::AppStateStore() {
+    for (auto& seq : _fieldSequence) {
+        seq.store(0, std::memory_order_relaxed);
+    }
+    storeWords(reinterpret_cast<uint32_t*>(&_published), reinterpret_cast<const uint32_t*>(&_working), WORDS);
+}
+
+AppState AppStateStore::snapshot() const {
+    uint32_t sequence;
+    return snapshot(sequence);
+}
+
+AppState AppStateStore::snapshot(uint32_t& sequence) const {
+    AppState out;
+    for (;;) {
+        const uint32_t before = _sequence.load(std::memory_order_acquire);
+        if (before & 1) continue;
+        loadWords(reinterpret_cast<uint32_t*>(&out), reinterpret_cast<const uint32_t*>(&_published), WORDS);
+        if (_sequence.load(std::memory_order_relaxed) == before) {
+            sequence = before;
+            return out;
+        }
+    }
+}
+
+uint32_t AppStateStore::changesSince(uint32_t sequence) const {
+    uint32_t changed = 0;
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        // Wrap-safe "newer than"
+        if ((int32_t)(_fieldSequence[i].load(std::memory_order_relaxed) - sequence) > 0) {
+            changed |= 1u << i;
+        }
+    }
+    return changed;
+}
+
+void AppStateStore::publish(uint32_t changed) {
+    const uint32_t seq = _sequence.load(std::memory_order_relaxed);
+    _sequence.store(seq + 1, std::memory_order_relaxed);
+    storeWords(reinterpret_cast<uint32_t*>(&_published), reinterpret_cast<const uint32_t*>(&_working), WORDS);
+    // Field sequences go out before the closing release, so a reader that sees
+    // the new sequence also sees its change bits
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        if (changed & (1u << i)) {
+            _fieldSequence[i].store(seq + 2, std::memory_order_relaxed);
+        }
+    }
+    _sequence.store(seq + 2, std::memory_order_release);
+}
+
+uint32_t AppStateStore::diff(const AppState& a, const AppState& b) {
+    uint32_t changed = 0;
+    if (a.powerOn != b.powerOn) changed |= POWER;
+    if (a.brightness != b.brightness) changed |= BRIGHTNESS;
+    if (a.primaryColor != b.primaryColor) changed |= PRIMARY_COLOR;
+    if (a.secondaryColor != b.secondaryColor) changed |= SECONDARY_COLOR;
+    if (strncmp(a.animation, b.animation, sizeof(a.animation)) != 0) changed |= ANIMATION;
+    if (a.speedMs != b.speedMs) changed |= SPEED;
+    if (a.tailLength != b.tailLength) changed |= TAIL;
+    if (a.strobePeriodMs != b.strobePeriodMs) changed |= STROBE;
+    if (a.pixelVersion != b.pixelVersion ||
+        memcmp(a.pixelColors, b.pixelColors, sizeof(a.pixelColors)) != 0) {
+        changed |= PIXELS;
+    }
+    return changed;
+}
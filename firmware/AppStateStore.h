@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+#include <freertos/FreeRTOS.h>
+#include "AppState.h"
+
+// Owns the live AppState. Writers serialize on a spinlock and publish through
+// a sequence lock; readers copy a consistent snapshot without locking, so the
+// render loop never blocks on (or tears against) writers on the other core.
+// Every publish records which fields changed, so readers can react to just those.
+class AppStateStore {
+public:
+    enum Field : uint32_t {
+        POWER           = 1u << 0,
+        BRIGHTNESS      = 1u << 1,
+        PRIMARY_COLOR   = 1u << 2,
+        SECONDARY_COLOR = 1u << 3,
+        ANIMATION       = 1u << 4,
+        SPEED           = 1u << 5,
+        TAIL            = 1u << 6,
+        STROBE          = 1u << 7,
+        PIXELS          = 1u << 8,
+    };
+    static constexpr size_t FIELD_COUNT = 9;
+
+    AppStateStore();
+
+    // Latest published state; retries while a write is in flight
+    AppState snapshot() const;
+    // As above, also returning the sequence the snapshot was taken at
+    AppState snapshot(uint32_t& sequence) const;
+
+    // Bitmask of fields published after `sequence`
+    uint32_t changesSince(uint32_t sequence) const;
+
+    // Applies `fn` to the state and publishes the result. `fn` runs inside a
+    // critical section, so it must be short and must not block or log.
+    // Returns the changed fields (0 if `fn` left the state untouched).
+    template <typename Fn>
+    uint32_t update(Fn&& fn) {
+        portENTER_CRITICAL(&_writeLock);
+        AppState next = _working;
+        fn(next);
+        const uint32_t changed = diff(_working, next);
+        if (changed) {
+            _working = next;
+            publish(changed);
+        }
+        portEXIT_CRITICAL(&_writeLock);
+        return changed;
+    }
+
+private:
+    static_assert(std::is_trivially_copyable<AppState>::value, "AppState is copied word by word");
+    static_assert(sizeof(AppState) % sizeof(uint32_t) == 0, "AppState must be a whole number of words");
+    static constexpr size_t WORDS = sizeof(AppState) / sizeof(uint32_t);
+
+    AppState _working;                  // Writer copy, guarded by _writeLock
+    AppState _published;                // Read through the sequence lock
+    std::atomic<uint32_t> _sequence{0}; // Odd while a publish is in progress
+    std::atomic<uint32_t> _fieldSequence[FIELD_COUNT];
+    portMUX_TYPE _writeLock = portMUX_INITIALIZER_UNLOCKED;
+
+    void publish(uint32_t changed);
+    static uint32_t diff(const AppState& a, const AppState& b);
+};
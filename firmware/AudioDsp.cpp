@@ -0,0 +1,184 @@
+#include "AudioDsp.h"
+#include <math.h>
+#include <string.h>
+
+static constexpr float PI_F = 3.14159265f;
+
+static int16_t toQ15(float v) {
+    const float scaled = roundf(v * 32767.0f);
+    return (int16_t)(scaled > 32767.0f ? 32767.0f : scaled < -32767.0f ? -32767.0f : scaled);
+}
+
+AudioDsp::AudioDsp(uint32_t sampleRate) : _sampleRate(sampleRate) {
+    for (size_t i = 0; i < FFT_SIZE; i++) {
+        _window[i] = toQ15(0.5f - 0.5f * cosf(2.0f * PI_F * i / FFT_SIZE));
+    }
+    for (size_t k = 0; k < FFT_SIZE / 2; k++) {
+        _cos[k] = toQ15(cosf(2.0f * PI_F * k / FFT_SIZE));
+        _sin[k] = toQ15(-sinf(2.0f * PI_F * k / FFT_SIZE));
+    }
+
+    // Bands spaced evenly in log frequency from 40 Hz up to 8 kHz (or Nyquist),
+    // each at least one bin wide
+    const float binHz = (float)sampleRate / FFT_SIZE;
+    const float lowHz = 40.0f;
+    const float highHz = sampleRate / 2 < 8000 ? sampleRate / 2.0f : 8000.0f;
+    uint16_t prev = 0;
+    for (size_t b = 0; b <= AudioFeatures::BANDS; b++) {
+        const float hz = lowHz * powf(highHz / lowHz, (float)b / AudioFeatures::BANDS);
+        uint16_t bin = (uint16_t)lroundf(hz / binHz);
+        if (bin < 1) bin = 1;
+        if (b > 0 && bin <= prev) bin = prev + 1;
+        if (bin > BINS) bin = BINS;
+        _bandEdges[b] = bin;
+        prev = bin;
+    }
+
+    // Kick drums sit below ~150 Hz
+    _bassBins = (uint16_t)(150.0f / binHz) + 1;
+    if (_bassBins < 2) _bassBins = 2;
+
+    reset();
+}
+
+void AudioDsp::reset() {
+    memset(_samples, 0, sizeof(_samples));
+    _bandPeakDb = BAND_FLOOR_DB + GAIN_LIMIT_DB;
+    _levelPeakDb = LEVEL_FLOOR_DB + GAIN_LIMIT_DB;
+    memset(_bassHistory, 0, sizeof(_bassHistory));
+    _bassIndex = 0;
+    _bassCount = 0;
+    _hopsSinceBeat = UINT32_MAX / 2;
+    _beatCount = 0;
+    _beatStrength = 0;
+}
+
+// In-place radix-2 FFT on _re/_im. Inputs are at most 15 bits and grow by at
+// most one bit per stage, so 9 stages fit int32 without per-stage scaling.
+void AudioDsp::fft() {
+    for (size_t i = 1, j = 0; i < FFT_SIZE; i++) {
+        size_t bit = FFT_SIZE >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j |= bit;
+        if (i < j) {
+            int32_t t = _re[i]; _re[i] = _re[j]; _re[j] = t;
+            t = _im[i]; _im[i] = _im[j]; _im[j] = t;
+        }
+    }
+
+    for (size_t len = 2; len <= FFT_SIZE; len <<= 1) {
+        const size_t half = len >> 1;
+        const size_t step = FFT_SIZE / len;
+        for (size_t start = 0; start < FFT_SIZE; start += len) {
+            for (size_t k = 0; k < half; k++) {
+                const int32_t wr = _cos[k * step];
+                const int32_t wi = _sin[k * step];
+                const size_t a = start + k;
+                const size_t b = a + half;
+                const int32_t tr = (int32_t)(((int64_t)_re[b] * wr - (int64_t)_im[b] * wi) >> 15);
+                const int32_t ti = (int32_t)(((int64_t)_re[b] * wi + (int64_t)_im[b] * wr) >> 15);
+                _re[b] = _re[a] - tr;
+                _im[b] = _im[a] - ti;
+                _re[a] += tr;
+                _im[a] += ti;
+            }
+        }
+    }
+}
+
+uint8_t AudioDsp::scale(float db, float peakDb, float floorDb) {
+    const float bottom = peakDb - RANGE_DB > floorDb ? peakDb - RANGE_DB : floorDb;
+    const float v = (db - bottom) / (peakDb - bottom);
+    if (v <= 0.0f) return 0;
+    if (v >= 1.0f) return 255;
+    return (uint8_t)(v * 255.0f);
+}
+
+bool AudioDsp::detectBeat(float bassDb) {
+    // Statistics in dB: a kick jumps well clear of the spread, while noise
+    // (whose energy spread grows with its level) keeps a constant spread in dB
+    float average = 0.0f;
+    float variance = 0.0f;
+    if (_bassCount) {
+        for (size_t i = 0; i < _bassCount; i++) average += _bassHistory[i];
+        average /= _bassCount;
+        for (size_t i = 0; i < _bassCount; i++) {
+            const float d = _bassHistory[i] - average;
+            variance += d * d;
+        }
+        variance /= _bassCount;
+    }
+
+    _bassHistory[_bassIndex] = bassDb;
+    _bassIndex = (_bassIndex + 1) % BEAT_HISTORY;
+    if (_bassCount < BEAT_HISTORY) _bassCount++;
+    _hopsSinceBeat++;
+
+    // Needs half a second of history, a clear jump over it and some absolute energy
+    const uint32_t refractoryHops = BEAT_REFRACTORY_MS * _sampleRate / 1000 / HOP;
+    const float deviation = BEAT_DEVIATIONS * sqrtf(variance);
+    const float jump = bassDb - average;
+    if (_bassCount < BEAT_HISTORY / 2 || _hopsSinceBeat < refractoryHops || bassDb < BAND_FLOOR_DB + GAIN_LIMIT_DB ||
+        jump < deviation || jump < BEAT_MIN_JUMP_DB) {
+        return false;
+    }
+
+    const float strength = jump * (255.0f / 24.0f);     // 24 dB over the average is full strength
+    _beatStrength = strength >= 255.0f ? 255 : (uint8_t)strength;
+    _hopsSinceBeat = 0;
+    _beatCount++;
+    return true;
+}
+
+void AudioDsp::process(const int16_t* samples, AudioFeatures& out) {
+    memmove(_samples, _samples + HOP, (FFT_SIZE - HOP) * sizeof(int16_t));
+    memcpy(_samples + FFT_SIZE - HOP, samples, HOP * sizeof(int16_t));
+
+    // Loudness of the new samples in dBFS
+    int64_t sumSquares = 0;
+    for (size_t i = 0; i < HOP; i++) {
+        sumSquares += (int32_t)samples[i] * samples[i];
+    }
+    const float rms = sqrtf((float)sumSquares / HOP);
+    const float levelDb = 20.0f * log10f(rms / 32768.0f + 1e-9f);
+
+    for (size_t i = 0; i < FFT_SIZE; i++) {
+        _re[i] = ((int32_t)_samples[i] * _window[i]) >> 15;
+        _im[i] = 0;
+    }
+    fft();
+    for (size_t i = 0; i < BINS; i++) {
+        const float re = (float)_re[i];
+        const float im = (float)_im[i];
+        _power[i] = re * re + im * im;
+    }
+
+    // One gain peak across all bands keeps the spectrum's shape; it follows
+    // loud input at once and relaxes slowly
+    float bandDb[AudioFeatures::BANDS];
+    float loudestDb = 0.0f;
+    for (size_t b = 0; b < AudioFeatures::BANDS; b++) {
+        float energy = 0.0f;
+        for (uint16_t i = _bandEdges[b]; i < _bandEdges[b + 1]; i++) energy += _power[i];
+        energy /= (float)(_bandEdges[b + 1] - _bandEdges[b]);
+        bandDb[b] = 10.0f * log10f(energy + 1.0f);
+        if (bandDb[b] > loudestDb) loudestDb = bandDb[b];
+    }
+    _bandPeakDb -= PEAK_DECAY_DB;
+    if (loudestDb > _bandPeakDb) _bandPeakDb = loudestDb;
+    if (_bandPeakDb < BAND_FLOOR_DB + GAIN_LIMIT_DB) _bandPeakDb = BAND_FLOOR_DB + GAIN_LIMIT_DB;
+    for (size_t b = 0; b < AudioFeatures::BANDS; b++) {
+        out.bands[b] = scale(bandDb[b], _bandPeakDb, BAND_FLOOR_DB);
+    }
+
+    _levelPeakDb -= PEAK_DECAY_DB;
+    if (levelDb > _levelPeakDb) _levelPeakDb = levelDb;
+    if (_levelPeakDb < LEVEL_FLOOR_DB + GAIN_LIMIT_DB) _levelPeakDb = LEVEL_FLOOR_DB + GAIN_LIMIT_DB;
+    out.level = scale(levelDb, _levelPeakDb, LEVEL_FLOOR_DB);
+
+    float bass = 0.0f;
+    for (uint16_t i = 1; i < _bassBins; i++) bass += _power[i];
+    out.beat = detectBeat(10.0f * log10f(bass + 1.0f));
+    out.beatCount = _beatCount;
+    out.beatStrength = _beatStrength;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Per-hop features published by the audio task to the audio animations
+struct AudioFeatures {
+    static constexpr size_t BANDS = 16;
+
+    uint32_t sequence = 0;          // Increments every hop; 0 until audio runs
+    uint32_t beatCount = 0;         // Beats detected so far, so a slow reader doesn't miss one
+    uint8_t level = 0;              // Loudness 0-255, auto-gained
+    uint8_t bands[BANDS] = {0};     // Log-spaced band energy 0-255, low to high
+    uint8_t beatStrength = 0;       // Of the most recent beat
+    bool beat = false;              // A beat started in this hop
+};
+
+// Microphone DSP: Hann-windowed fixed-point FFT over a sliding window, log
+// band energies with automatic gain, and bass-energy beat detection.
+// Deliberately free of Arduino and ESP-IDF headers, so the same code can be
+// run on a desktop over recorded WAV files.
+class AudioDsp {
+public:
+    static constexpr size_t FFT_SIZE = 512;
+    static constexpr size_t HOP = 256;     // New samples per process(); the window overlaps 50%
+    static constexpr size_t BINS = FFT_SIZE / 2;
+
+    explicit AudioDsp(uint32_t sampleRate);
+
+    // Clears the window and the gain/beat history, e.g. after the input was stopped
+    void reset();
+
+    // Takes HOP new samples and fills every field of `out` except `sequence`
+    void process(const int16_t* samples, AudioFeatures& out);
+
+private:
+    static constexpr size_t BEAT_HISTORY = 64;          // Hops of bass level the threshold averages over
+    static constexpr float BEAT_DEVIATIONS = 1.5f;      // Bass level this many deviations over its recent average
+    static constexpr float BEAT_MIN_JUMP_DB = 8.0f;     // and at least this far over it
+    static constexpr uint32_t BEAT_REFRACTORY_MS = 250;
+    static constexpr float RANGE_DB = 45.0f;            // Shown dynamic range below the gain peak
+    static constexpr float PEAK_DECAY_DB = 0.04f;       // Per hop; the gain recovers ~2.5 dB/s
+    // Noise floors (band power in FFT units, level in dBFS); anything below shows as 0, and
+    // the gain never goes past a peak GAIN_LIMIT_DB above them, so silence isn't gained up to noise
+    static constexpr float BAND_FLOOR_DB = 55.0f;
+    static constexpr float LEVEL_FLOOR_DB = -60.0f;
+    static constexpr float GAIN_LIMIT_DB = 25.0f;
+
+    uint32_t _sampleRate;
+    uint16_t _bandEdges[AudioFeatures::BANDS + 1];      // FFT bins; band b is [edge b, edge b+1)
+    uint16_t _bassBins;
+
+    int16_t _window[FFT_SIZE];      // Hann, Q15
+    int16_t _cos[FFT_SIZE / 2];     // Twiddles, Q15
+    int16_t _sin[FFT_SIZE / 2];
+    int16_t _samples[FFT_SIZE];     // Sliding input window
+    int32_t _re[FFT_SIZE];
+    int32_t _im[FFT_SIZE];
+    float _power[BINS];
+
+    float _bandPeakDb;
+    float _levelPeakDb;
+    float _bassHistory[BEAT_HISTORY];   // dB
+    size_t _bassIndex;
+    size_t _bassCount;
+    uint32_t _hopsSinceBeat;
+    uint32_t _beatCount;
+    uint8_t _beatStrength;
+
+    void fft();
+    bool detectBeat(float bassDb);
+    static uint8_t scale(float db, float peakDb, float floorDb);
+};
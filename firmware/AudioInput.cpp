@@ -0,0 +1,116 @@
+#include "AudioInput.h"
+#include <driver/i2s.h>
+#include "Config.h"
+#include "IdleControl.h"
+#include "Metrics.h"
+
+static constexpr i2s_port_t PORT = I2S_NUM_0;
+
+void AudioInput::start() {
+    i2s_config_t config = {};
+    config.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX);
+    config.sample_rate = Config::AUDIO_SAMPLE_RATE;
+    config.bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT;
+    config.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;     // L/R pin tied low
+    config.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+    config.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+    config.dma_buf_count = 4;
+    config.dma_buf_len = AudioDsp::HOP;
+    config.use_apll = false;
+
+    i2s_pin_config_t pins = {};
+    pins.mck_io_num = I2S_PIN_NO_CHANGE;
+    pins.bck_io_num = Config::MIC_SCK_PIN;
+    pins.ws_io_num = Config::MIC_WS_PIN;
+    pins.data_out_num = I2S_PIN_NO_CHANGE;
+    pins.data_in_num = Config::MIC_SD_PIN;
+
+    esp_err_t err = i2s_driver_install(PORT, &config, 0, nullptr);
+    if (err == ESP_OK) err = i2s_set_pin(PORT, &pins);
+    if (err != ESP_OK) {
+        Serial.printf("[Audio] I2S init failed: %s\n", esp_err_to_name(err));
+        return;
+    }
+    i2s_stop(PORT);
+
+    // Core 0 with the network tasks, one priority above them so hops aren't
+    // dropped during a TLS handshake; the render loop keeps core 1
+    xTaskCreatePinnedToCore(taskEntry, "audio", TASK_STACK_BYTES, this, 2, &_task, 0);
+    Serial.printf("[Audio] Mic on SCK %u WS %u SD %u, %lu Hz, %u-sample hops\n",
+                  Config::MIC_SCK_PIN, Config::MIC_WS_PIN, Config::MIC_SD_PIN,
+                  (unsigned long)Config::AUDIO_SAMPLE_RATE, (unsigned)AudioDsp::HOP);
+}
+
+void AudioInput::latest(AudioFeatures& out) const {
+    portENTER_CRITICAL(&_lock);
+    out = _features;
+    portEXIT_CRITICAL(&_lock);
+}
+
+void AudioInput::acquire() {
+    if (_users.fetch_add(1) == 0 && _task) {
+        xTaskNotifyGive(_task);
+    }
+}
+
+void AudioInput::release() {
+    _users.fetch_sub(1);
+}
+
+void AudioInput::taskEntry(void* arg) {
+    static_cast<AudioInput*>(arg)->run();
+}
+
+void AudioInput::run() {
+    AudioFeatures features;
+    for (;;) {
+        if (_users.load() <= 0) {
+            if (_running) {
+                i2s_stop(PORT);
+                _running = false;
+                Serial.println("[Audio] Idle");
+            }
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        if (!_running) {
+            i2s_zero_dma_buffer(PORT);
+            i2s_start(PORT);
+            _dsp.reset();
+            _running = true;
+            Serial.println("[Audio] Listening");
+        }
+
+        if (!readHop()) continue;
+
+        const uint32_t startUs = micros();
+        _dsp.process(_samples, features);
+        Metrics::audioDspDuration.observe(micros() - startUs);
+        Metrics::audioHops++;
+        if (features.beat) Metrics::audioBeats++;
+        publish(features);
+    }
+}
+
+bool AudioInput::readHop() {
+    size_t bytes = 0;
+    if (i2s_read(PORT, _raw, sizeof(_raw), &bytes, pdMS_TO_TICKS(100)) != ESP_OK || bytes != sizeof(_raw)) {
+        return false;
+    }
+    // 24-bit samples sit in the top of each 32-bit slot; the shift sets the gain
+    for (size_t i = 0; i < AudioDsp::HOP; i++) {
+        const int32_t s = _raw[i] >> Config::MIC_SAMPLE_SHIFT;
+        _samples[i] = (int16_t)(s > INT16_MAX ? INT16_MAX : s < -INT16_MAX ? -INT16_MAX : s);
+    }
+    return true;
+}
+
+void AudioInput::publish(const AudioFeatures& features) {
+    portENTER_CRITICAL(&_lock);
+    const uint32_t sequence = _features.sequence + 1;
+    _features = features;
+    _features.sequence = sequence;
+    portEXIT_CRITICAL(&_lock);
+    _sequence.store(sequence);
+    IdleControl::notify();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "AudioDsp.h"
+#include "Config.h"
+
+// I2S microphone (INMP441-style, 24 bits in a 32-bit slot) read on its own
+// task, run through AudioDsp and published as AudioFeatures for the audio
+// animations. Each hop wakes the render loop. The task only reads the mic
+// while at least one audio animation is shown; otherwise I2S is stopped.
+class AudioInput {
+public:
+    void start();
+
+    // Copies the most recent features; safe from any task
+    void latest(AudioFeatures& out) const;
+    uint32_t sequence() const { return _sequence.load(); }
+
+    // Audio animations hold the input between onEnter() and onExit()
+    void acquire();
+    void release();
+
+private:
+    static constexpr uint32_t TASK_STACK_BYTES = 4096;
+
+    AudioDsp _dsp{Config::AUDIO_SAMPLE_RATE};
+    int32_t _raw[AudioDsp::HOP];
+    int16_t _samples[AudioDsp::HOP];
+
+    mutable portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+    AudioFeatures _features;
+    std::atomic<uint32_t> _sequence{0};
+    std::atomic<int> _users{0};
+    TaskHandle_t _task = nullptr;
+    bool _running = false;
+
+    static void taskEntry(void* arg);
+    void run();
+    bool readHop();
+    void publish(const AudioFeatures& features);
+};
@@ -0,0 +1,27 @@
+#include "BootTimings.h"
+#include <atomic>
+
+namespace BootTimings {
+
+static std::atomic<uint32_t> s_firstFrameMs{0};
+static std::atomic<uint32_t> s_wifiConnectedMs{0};
+static std::atomic<uint32_t> s_firstPresenceMs{0};
+
+static void markOnce(std::atomic<uint32_t>& slot, uint32_t nowMs, const char* label) {
+    uint32_t expected = 0;
+    // millis() can legitimately be 0 on the first frame; store 1 instead
+    const uint32_t value = nowMs > 0 ? nowMs : 1;
+    if (slot.compare_exchange_strong(expected, value)) {
+        Serial.printf("[Boot] %s after %lu ms\n", label, (unsigned long)value);
+    }
+}
+
+void markFirstFrame(uint32_t nowMs) { markOnce(s_firstFrameMs, nowMs, "First frame"); }
+void markWifiConnected(uint32_t nowMs) { markOnce(s_wifiConnectedMs, nowMs, "WiFi connected"); }
+void markFirstPresence(uint32_t nowMs) { markOnce(s_firstPresenceMs, nowMs, "First presence"); }
+
+uint32_t firstFrameMs() { return s_firstFrameMs.load(); }
+uint32_t wifiConnectedMs() { return s_wifiConnectedMs.load(); }
+uint32_t firstPresenceMs() { return s_firstPresenceMs.load(); }
+
+}
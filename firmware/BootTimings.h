@@ -0,0 +1,17 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Milliseconds from boot to key milestones; 0 until the milestone is reached.
+// Safe to mark from any task.
+namespace BootTimings {
+
+void markFirstFrame(uint32_t nowMs);
+void markWifiConnected(uint32_t nowMs);
+void markFirstPresence(uint32_t nowMs);
+
+uint32_t firstFrameMs();
+uint32_t wifiConnectedMs();
+uint32_t firstPresenceMs();
+
+}
@@ -1,10 +1,17 @@
 #include "ButtonInput.h"
+#include "IdleControl.h"
 
 ButtonInput::ButtonInput(uint8_t pin, bool activeLow)
     : _pin(pin), _activeLow(activeLow) {}
 
 void ButtonInput::begin() {
     pinMode(_pin, _activeLow ? INPUT_PULLUP : INPUT_PULLDOWN);
+    attachInterruptArg(_pin, onEdge, this, CHANGE);
+}
+
+void IRAM_ATTR ButtonInput::onEdge(void* arg) {
+    (void)arg;
+    IdleControl::notifyFromIsr();
 }
 
 bool ButtonInput::readRaw() {
@@ -12,6 +19,26 @@ bool ButtonInput::readRaw() {
     return _activeLow ? !raw : raw;
 }
 
+static uint32_t remaining(uint32_t elapsed, uint32_t interval) {
+    return elapsed >= interval ? 0 : interval - elapsed;
+}
+
+uint32_t ButtonInput::msUntilDue(uint32_t nowMs) const {
+    uint32_t wait = IdleControl::FOREVER;
+    if (_lastRawState != _stableState) {
+        wait = remaining(nowMs - _lastDebounceMs, DEBOUNCE_MS);
+    }
+    if (_stableState && !_holdFired) {
+        const uint32_t hold = remaining(nowMs - _pressStartMs, HOLD_THRESHOLD_MS);
+        if (hold < wait) wait = hold;
+    }
+    if (!_stableState && _clickCount > 0) {
+        const uint32_t window = remaining(nowMs - _lastReleaseMs, MULTI_CLICK_WINDOW_MS);
+        if (window < wait) wait = window;
+    }
+    return wait;
+}
+
 ButtonEvent ButtonInput::update(uint32_t nowMs) {
     bool raw = readRaw();
     ButtonEvent event = ButtonEvent::None;
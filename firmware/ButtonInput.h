@@ -17,6 +17,10 @@ public:
     void begin();
     ButtonEvent update(uint32_t nowMs);
 
+    // Milliseconds until update() needs to run again without a new edge on the
+    // pin (IdleControl::FOREVER when idle); edges wake the loop by interrupt
+    uint32_t msUntilDue(uint32_t nowMs) const;
+
 private:
     uint8_t _pin;
     bool _activeLow;
@@ -38,4 +42,5 @@ private:
     static constexpr uint32_t HOLD_THRESHOLD_MS = 800;
 
     bool readRaw();
+    static void IRAM_ATTR onEdge(void* arg);
 };
@@ -0,0 +1,42 @@
+#include "CalendarSchedule.h"
+
+void CalendarSchedule::setEvents(const CalendarEvent* events, size_t count, uint32_t nowUnix) {
+    _count = 0;
+    for (size_t i = 0; i < count && _count < MAX_EVENTS; i++) {
+        const CalendarEvent& e = events[i];
+        if (e.end <= e.start || e.end <= nowUnix) continue;
+        // Insertion sort; Graph already orders by start, so this rarely moves anything
+        size_t at = _count++;
+        while (at > 0 && _events[at - 1].start > e.start) {
+            _events[at] = _events[at - 1];
+            at--;
+        }
+        _events[at] = e;
+    }
+}
+
+bool CalendarSchedule::busyAt(uint32_t seconds) const {
+    for (size_t i = 0; i < _count; i++) {
+        if (_events[i].start > seconds) break;
+        if (seconds < _events[i].end) return true;
+    }
+    return false;
+}
+
+bool CalendarSchedule::takeTransition(uint32_t nowUnix, bool& busy) {
+    const bool now = busyAt(nowUnix);
+    if (now == _busy) return false;
+    _busy = now;
+    busy = now;
+    return true;
+}
+
+uint32_t CalendarSchedule::nextTransition(uint32_t nowUnix) const {
+    uint32_t next = 0;
+    for (size_t i = 0; i < _count; i++) {
+        const CalendarEvent& e = _events[i];
+        const uint32_t t = e.start > nowUnix ? e.start : e.end > nowUnix ? e.end : 0;
+        if (t && (next == 0 || t < next)) next = t;
+    }
+    return next;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Arduino.h>
+
+// A busy block from the signed-in user's calendar, in Unix seconds (UTC)
+struct CalendarEvent {
+    uint32_t start = 0;
+    uint32_t end = 0;
+};
+
+// The next few busy blocks, refreshed from Graph every few minutes, so the
+// light can switch at the instant a meeting starts or ends instead of after
+// Teams updates presence and the next poll sees it. Pure bookkeeping: the
+// caller supplies the clock, so it can be driven by a virtual one.
+class CalendarSchedule {
+public:
+    static constexpr size_t MAX_EVENTS = 8;
+
+    // Replaces the cached events, dropping any that ended by `nowUnix`. The
+    // busy state is left alone, so an edge crossed while the fetch was in
+    // flight (or a block added that has already started) is still reported
+    // by the next takeTransition().
+    void setEvents(const CalendarEvent* events, size_t count, uint32_t nowUnix);
+
+    bool busyAt(uint32_t seconds) const;
+
+    // True once each time `nowUnix` crosses into or out of a busy block;
+    // `busy` says which
+    bool takeTransition(uint32_t nowUnix, bool& busy);
+
+    // The next start or end after `nowUnix`, 0 when none is cached
+    uint32_t nextTransition(uint32_t nowUnix) const;
+
+    size_t count() const { return _count; }
+    const CalendarEvent& event(size_t i) const { return _events[i]; }
+
+private:
+    CalendarEvent _events[MAX_EVENTS];  // Sorted by start
+    size_t _count = 0;
+    bool _busy = false;
+};
@@ -0,0 +1,367 @@
+#include "ColorCodec.h"
+#include "FixedString.h"
+
+namespace ColorCodec {
+
+namespace {
+
+struct NamedColor {
+    const char* name;
+    uint32_t rgb;
+};
+
+// Hex digit value per byte, -1 for anything else
+static const int8_t NIBBLE[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+// Generated hash-and-displace table: slot = fnv1a(name, DISPLACE[fnv1a(name) % NAMED_BUCKETS]) % NAMED_COUNT
+static constexpr size_t NAMED_BUCKETS = 64;
+static const uint16_t DISPLACE[NAMED_BUCKETS] = {
+    0, 0, 0, 7, 29, 14, 7, 0, 1, 15, 2, 0, 7, 9, 1, 32,
+    6, 4, 23, 28, 34, 5, 6, 2, 7, 2, 2, 0, 10, 11, 42, 12,
+    15, 0, 5, 0, 40, 0, 7, 3, 25, 15, 21, 1, 72, 44, 1, 1,
+    17, 5, 4, 240, 31, 37, 6, 2, 0, 63, 1, 59, 2, 44, 157, 403,
+};
+
+static const NamedColor NAMED[] = {
+    {"palegoldenrod", 0xEEE8AA},
+    {"aqua", 0x00FFFF},
+    {"antiquewhite", 0xFAEBD7},
+    {"slateblue", 0x6A5ACD},
+    {"darkslategrey", 0x2F4F4F},
+    {"darkblue", 0x00008B},
+    {"bisque", 0xFFE4C4},
+    {"indigo", 0x4B0082},
+    {"deeppink", 0xFF1493},
+    {"mediumturquoise", 0x48D1CC},
+    {"cornsilk", 0xFFF8DC},
+    {"khaki", 0xF0E68C},
+    {"dimgray", 0x696969},
+    {"maroon", 0x800000},
+    {"teal", 0x008080},
+    {"chartreuse", 0x7FFF00},
+    {"darkmagenta", 0x8B008B},
+    {"lightgray", 0xD3D3D3},
+    {"lemonchiffon", 0xFFFACD},
+    {"snow", 0xFFFAFA},
+    {"lightskyblue", 0x87CEFA},
+    {"greenyellow", 0xADFF2F},
+    {"olive", 0x808000},
+    {"orangered", 0xFF4500},
+    {"lightsalmon", 0xFFA07A},
+    {"green", 0x008000},
+    {"darkcyan", 0x008B8B},
+    {"firebrick", 0xB22222},
+    {"mediumvioletred", 0xC71585},
+    {"lightslategray", 0x778899},
+    {"lightcoral", 0xF08080},
+    {"brown", 0xA52A2A},
+    {"navajowhite", 0xFFDEAD},
+    {"lightseagreen", 0x20B2AA},
+    {"honeydew", 0xF0FFF0},
+    {"darkorange", 0xFF8C00},
+    {"rosybrown", 0xBC8F8F},
+    {"darkslategray", 0x2F4F4F},
+    {"skyblue", 0x87CEEB},
+    {"lightyellow", 0xFFFFE0},
+    {"pink", 0xFFC0CB},
+    {"mediumslateblue", 0x7B68EE},
+    {"orchid", 0xDA70D6},
+    {"saddlebrown", 0x8B4513},
+    {"darkolivegreen", 0x556B2F},
+    {"mintcream", 0xF5FFFA},
+    {"palegreen", 0x98FB98},
+    {"sienna", 0xA0522D},
+    {"burlywood", 0xDEB887},
+    {"tomato", 0xFF6347},
+    {"lightslategrey", 0x778899},
+    {"lawngreen", 0x7CFC00},
+    {"seagreen", 0x2E8B57},
+    {"lightcyan", 0xE0FFFF},
+    {"mediumblue", 0x0000CD},
+    {"paleturquoise", 0xAFEEEE},
+    {"lightgrey", 0xD3D3D3},
+    {"thistle", 0xD8BFD8},
+    {"lightpink", 0xFFB6C1},
+    {"mediumseagreen", 0x3CB371},
+    {"chocolate", 0xD2691E},
+    {"seashell", 0xFFF5EE},
+    {"gold", 0xFFD700},
+    {"powderblue", 0xB0E0E6},
+    {"navy", 0x000080},
+    {"gray", 0x808080},
+    {"dodgerblue", 0x1E90FF},
+    {"violet", 0xEE82EE},
+    {"yellowgreen", 0x9ACD32},
+    {"aliceblue", 0xF0F8FF},
+    {"darkorchid", 0x9932CC},
+    {"goldenrod", 0xDAA520},
+    {"darkseagreen", 0x8FBC8F},
+    {"indianred", 0xCD5C5C},
+    {"crimson", 0xDC143C},
+    {"darkslateblue", 0x483D8B},
+    {"darkgrey", 0xA9A9A9},
+    {"limegreen", 0x32CD32},
+    {"sandybrown", 0xF4A460},
+    {"papayawhip", 0xFFEFD5},
+    {"deepskyblue", 0x00BFFF},
+    {"lightgoldenrodyellow", 0xFAFAD2},
+    {"springgreen", 0x00FF7F},
+    {"darkviolet", 0x9400D3},
+    {"slategrey", 0x708090},
+    {"purple", 0x800080},
+    {"lavender", 0xE6E6FA},
+    {"darkkhaki", 0xBDB76B},
+    {"steelblue", 0x4682B4},
+    {"darkred", 0x8B0000},
+    {"fuchsia", 0xFF00FF},
+    {"cadetblue", 0x5F9EA0},
+    {"ghostwhite", 0xF8F8FF},
+    {"mediumpurple", 0x9370DB},
+    {"tan", 0xD2B48C},
+    {"ivory", 0xFFFFF0},
+    {"rebeccapurple", 0x663399},
+    {"wheat", 0xF5DEB3},
+    {"hotpink", 0xFF69B4},
+    {"darkgoldenrod", 0xB8860B},
+    {"moccasin", 0xFFE4B5},
+    {"mistyrose", 0xFFE4E1},
+    {"lightsteelblue", 0xB0C4DE},
+    {"peachpuff", 0xFFDAB9},
+    {"midnightblue", 0x191970},
+    {"blue", 0x0000FF},
+    {"silver", 0xC0C0C0},
+    {"royalblue", 0x4169E1},
+    {"lightgreen", 0x90EE90},
+    {"red", 0xFF0000},
+    {"lavenderblush", 0xFFF0F5},
+    {"linen", 0xFAF0E6},
+    {"coral", 0xFF7F50},
+    {"darkgray", 0xA9A9A9},
+    {"palevioletred", 0xDB7093},
+    {"darkturquoise", 0x00CED1},
+    {"grey", 0x808080},
+    {"darkgreen", 0x006400},
+    {"whitesmoke", 0xF5F5F5},
+    {"dimgrey", 0x696969},
+    {"cornflowerblue", 0x6495ED},
+    {"slategray", 0x708090},
+    {"floralwhite", 0xFFFAF0},
+    {"yellow", 0xFFFF00},
+    {"magenta", 0xFF00FF},
+    {"peru", 0xCD853F},
+    {"cyan", 0x00FFFF},
+    {"mediumaquamarine", 0x66CDAA},
+    {"beige", 0xF5F5DC},
+    {"lightblue", 0xADD8E6},
+    {"mediumspringgreen", 0x00FA9A},
+    {"turquoise", 0x40E0D0},
+    {"forestgreen", 0x228B22},
+    {"gainsboro", 0xDCDCDC},
+    {"darksalmon", 0xE9967A},
+    {"orange", 0xFFA500},
+    {"aquamarine", 0x7FFFD4},
+    {"blanchedalmond", 0xFFEBCD},
+    {"salmon", 0xFA8072},
+    {"black", 0x000000},
+    {"white", 0xFFFFFF},
+    {"blueviolet", 0x8A2BE2},
+    {"azure", 0xF0FFFF},
+    {"plum", 0xDDA0DD},
+    {"mediumorchid", 0xBA55D3},
+    {"oldlace", 0xFDF5E6},
+    {"olivedrab", 0x6B8E23},
+    {"lime", 0x00FF00},
+};
+
+static constexpr size_t NAMED_COUNT = sizeof(NAMED) / sizeof(NAMED[0]);
+static constexpr size_t NAME_MAX_LEN = 20;    // "lightgoldenrodyellow"
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+inline int32_t nibble(char c) {
+    return NIBBLE[(uint8_t)c];
+}
+
+// Six or three hex digits; the digits are combined without branching and
+// validity is checked once, from the OR of every table value
+Error parseHex(const char* s, size_t len, uint32_t& out) {
+    if (len == 6) {
+        const int32_t n0 = nibble(s[0]), n1 = nibble(s[1]), n2 = nibble(s[2]);
+        const int32_t n3 = nibble(s[3]), n4 = nibble(s[4]), n5 = nibble(s[5]);
+        if ((n0 | n1 | n2 | n3 | n4 | n5) < 0) return Error::BadHex;
+        out = (uint32_t)(n0 << 20 | n1 << 16 | n2 << 12 | n3 << 8 | n4 << 4 | n5);
+        return Error::None;
+    }
+    if (len == 3) {
+        const int32_t r = nibble(s[0]), g = nibble(s[1]), b = nibble(s[2]);
+        if ((r | g | b) < 0) return Error::BadHex;
+        out = (uint32_t)(r * 0x11) << 16 | (uint32_t)(g * 0x11) << 8 | (uint32_t)(b * 0x11);
+        return Error::None;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (nibble(s[i]) < 0) return Error::BadHex;
+    }
+    return Error::BadLength;
+}
+
+bool isHex(const char* s, size_t len) {
+    int32_t bad = 0;
+    for (size_t i = 0; i < len; i++) bad |= nibble(s[i]);
+    return bad >= 0;
+}
+
+bool startsWithFunction(const char* s, const char* name) {
+    return strncasecmp(s, name, 3) == 0 && s[3] == '(';
+}
+
+// "a, b, c)" with each value in 0..max[i]; only spaces may follow
+Error parseComponents(const char* p, const uint16_t* max, uint16_t* values) {
+    for (uint8_t i = 0; i < 3; i++) {
+        while (*p == ' ') p++;
+        if (*p < '0' || *p > '9') return Error::BadSyntax;
+        uint32_t v = 0;
+        while (*p >= '0' && *p <= '9') {
+            v = v * 10 + (uint32_t)(*p++ - '0');
+            if (v > 0xFFFF) return Error::OutOfRange;
+        }
+        if (v > max[i]) return Error::OutOfRange;
+        values[i] = (uint16_t)v;
+        while (*p == ' ') p++;
+        if (*p++ != (i < 2 ? ',' : ')')) return Error::BadSyntax;
+    }
+    while (*p == ' ') p++;
+    return *p ? Error::BadSyntax : Error::None;
+}
+
+Error parseName(const char* s, size_t len, uint32_t& out) {
+    if (len > NAME_MAX_LEN) return Error::UnknownName;
+    char lower[NAME_MAX_LEN + 1];
+    for (size_t i = 0; i < len; i++) {
+        const char c = s[i];
+        lower[i] = (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+    }
+    lower[len] = '\0';
+
+    const uint32_t bucket = fnv1a(lower) % NAMED_BUCKETS;
+    const NamedColor& entry = NAMED[fnv1a(lower, DISPLACE[bucket]) % NAMED_COUNT];
+    if (strcmp(entry.name, lower) != 0) return Error::UnknownName;
+    out = entry.rgb;
+    return Error::None;
+}
+
+}
+
+const char* errorString(Error error) {
+    switch (error) {
+        case Error::None: return "OK";
+        case Error::Empty: return "Empty color";
+        case Error::BadHex: return "Invalid hex digit in color";
+        case Error::BadLength: return "Hex color must have 3 or 6 digits";
+        case Error::BadSyntax: return "Malformed rgb()/hsv() color";
+        case Error::OutOfRange: return "Color component out of range";
+        case Error::UnknownName: return "Unknown color name";
+        default: return "Invalid color";
+    }
+}
+
+Error parse(const char* str, uint32_t& out) {
+    while (*str == ' ') str++;
+    size_t len = strlen(str);
+    while (len > 0 && str[len - 1] == ' ') len--;
+    if (len == 0) return Error::Empty;
+
+    if (str[0] == '#') {
+        return parseHex(str + 1, len - 1, out);
+    }
+    if ((len == 6 || len == 3) && isHex(str, len)) {
+        return parseHex(str, len, out);
+    }
+
+    if (startsWithFunction(str, "rgb")) {
+        static const uint16_t MAX[3] = {255, 255, 255};
+        uint16_t c[3];
+        const Error error = parseComponents(str + 4, MAX, c);
+        if (error != Error::None) return error;
+        out = (uint32_t)c[0] << 16 | (uint32_t)c[1] << 8 | c[2];
+        return Error::None;
+    }
+    if (startsWithFunction(str, "hsv")) {
+        static const uint16_t MAX[3] = {360, 100, 100};
+        uint16_t c[3];
+        const Error error = parseComponents(str + 4, MAX, c);
+        if (error != Error::None) return error;
+        out = hsvToRgb(c[0], (uint8_t)((c[1] * 255 + 50) / 100), (uint8_t)((c[2] * 255 + 50) / 100));
+        return Error::None;
+    }
+
+    return parseName(str, len, out);
+}
+
+size_t parseBatch(const char* const* strs, size_t count, uint32_t* out, Error& error) {
+    for (size_t i = 0; i < count; i++) {
+        const char* s = strs[i];
+        // Fast path for the common "#RRGGBB" payload entry
+        if (s[0] == '#' && s[1] && s[2] && s[3] && s[4] && s[5] && s[6] && s[7] == '\0') {
+            error = parseHex(s + 1, 6, out[i]);
+        } else {
+            error = parse(s, out[i]);
+        }
+        if (error != Error::None) return i;
+    }
+    error = Error::None;
+    return count;
+}
+
+void formatHex(uint32_t color, char out[8]) {
+    out[0] = '#';
+    out[1] = HEX_DIGITS[(color >> 20) & 0xF];
+    out[2] = HEX_DIGITS[(color >> 16) & 0xF];
+    out[3] = HEX_DIGITS[(color >> 12) & 0xF];
+    out[4] = HEX_DIGITS[(color >> 8) & 0xF];
+    out[5] = HEX_DIGITS[(color >> 4) & 0xF];
+    out[6] = HEX_DIGITS[color & 0xF];
+    out[7] = '\0';
+}
+
+uint32_t hsvToRgb(uint16_t hue, uint8_t saturation, uint8_t value) {
+    if (saturation == 0) {
+        return (uint32_t)value << 16 | (uint32_t)value << 8 | value;
+    }
+    hue %= 360;
+    const uint8_t region = hue / 60;
+    const uint32_t rem = (uint32_t)(hue - region * 60) * 255 / 60;
+    const uint32_t v = value, s = saturation;
+    const uint32_t p = v * (255 - s) / 255;
+    const uint32_t q = v * (255 - s * rem / 255) / 255;
+    const uint32_t t = v * (255 - s * (255 - rem) / 255) / 255;
+
+    uint32_t r, g, b;
+    switch (region) {
+        case 0: r = v; g = t; b = p; break;
+        case 1: r = q; g = v; b = p; break;
+        case 2: r = p; g = v; b = t; break;
+        case 3: r = p; g = q; b = v; break;
+        case 4: r = t; g = p; b = v; break;
+        default: r = v; g = p; b = q; break;
+    }
+    return r << 16 | g << 8 | b;
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Parses and formats 0xRRGGBB colors for the HTTP, MQTT and rules inputs.
+// Accepted forms:
+//   "#RRGGBB", "RRGGBB", "#RGB"       hex, any case
+//   "rgb(r, g, b)"                     0-255 each
+//   "hsv(h, s, v)"                     h 0-360, s and v 0-100
+//   "orange", "RebeccaPurple", ...     the 148 CSS named colors
+// Malformed input is reported instead of silently becoming black.
+namespace ColorCodec {
+
+enum class Error : uint8_t {
+    None,
+    Empty,
+    BadHex,         // Non-hex character
+    BadLength,      // Hex that isn't 3 or 6 digits
+    BadSyntax,      // Malformed rgb()/hsv()
+    OutOfRange,     // rgb()/hsv() component out of range
+    UnknownName
+};
+
+const char* errorString(Error error);
+
+Error parse(const char* str, uint32_t& out);
+
+// Parses `count` colors; stops at the first bad one and returns its index
+// (`count` when all parsed). Hex entries take the table-driven fast path.
+size_t parseBatch(const char* const* strs, size_t count, uint32_t* out, Error& error);
+
+// Writes "#RRGGBB" plus terminator
+void formatHex(uint32_t color, char out[8]);
+
+uint32_t hsvToRgb(uint16_t hue, uint8_t saturation, uint8_t value);
+
+}
@@ -0,0 +1,187 @@
+#include "CommandQueue.h"
+#include "IdleControl.h"
+#include "Metrics.h"
+#include "Trace.h"
+
+void CommandQueue::begin() {
+    _queue = xQueueCreate(DEPTH, sizeof(Command));
+}
+
+bool CommandQueue::push(const Command& cmd) {
+    if (_queue && xQueueSend(_queue, &cmd, 0) == pdTRUE) {
+        IdleControl::notify();
+        return true;
+    }
+    Metrics::commandsDropped++;
+    return false;
+}
+
+bool CommandQueue::postFrame(const uint32_t* pixels, uint16_t first, uint16_t count) {
+    if (first >= Config::NUM_PIXELS) return false;
+    if (count > Config::NUM_PIXELS - first) count = Config::NUM_PIXELS - first;
+
+    // One marker per drain is enough; later frames merge into the staged one.
+    // The marker goes in first, so a full queue drops the frame whole rather
+    // than leaving it half-merged. A drain that takes the marker before the
+    // pixels below are staged applies them on its next pass instead.
+    if (!_framePending) {
+        Command cmd;
+        cmd.type = Command::Type::SetFrame;
+        if (!push(cmd)) return false;
+    }
+
+    portENTER_CRITICAL(&_frameLock);
+    StagedFrame& frame = _frames[_staging];
+    memcpy(&frame.pixels[first], &pixels[first], count * sizeof(uint32_t));
+    for (uint16_t i = first; i < first + count; i++) {
+        frame.dirty[i / 32] |= 1u << (i % 32);
+    }
+    _framePending = true;
+    portEXIT_CRITICAL(&_frameLock);
+    return true;
+}
+
+CommandQueue::StagedFrame* CommandQueue::takeFrame() {
+    StagedFrame* taken = nullptr;
+    portENTER_CRITICAL(&_frameLock);
+    if (_framePending) {
+        taken = &_frames[_staging];
+        _staging ^= 1;
+        _framePending = false;
+    }
+    portEXIT_CRITICAL(&_frameLock);
+    return taken;
+}
+
+void CommandQueue::applyFrame(AppState& s, StagedFrame& frame) {
+    for (size_t w = 0; w < FRAME_WORDS; w++) {
+        uint32_t bits = frame.dirty[w];
+        frame.dirty[w] = 0;
+        while (bits) {
+            const uint32_t bit = __builtin_ctz(bits);
+            bits &= bits - 1;
+            const size_t i = w * 32 + bit;
+            s.pixelColors[i] = frame.pixels[i];
+        }
+    }
+    s.pixelVersion++;
+}
+
+void CommandQueue::drain(AppStateStore& store) {
+    if (!_queue) return;
+    TRACE_SCOPE("CommandQueue::drain");
+
+    const UBaseType_t waiting = uxQueueMessagesWaiting(_queue);
+    Metrics::commandQueueDepth = waiting;
+    if (waiting == 0 && !_framePending) return;
+    if (waiting > Metrics::commandQueueHighWater) {
+        Metrics::commandQueueHighWater = waiting;
+    }
+
+    Command batch[DEPTH];
+    size_t count = 0;
+    while (count < DEPTH && xQueueReceive(_queue, &batch[count], 0) == pdTRUE) {
+        count++;
+    }
+
+    // Taken after the batch, so a marker in it has its pixels staged unless its
+    // producer is still between the push and the copy. Those pixels are taken,
+    // without a marker, by the next drain.
+    StagedFrame* frame = takeFrame();
+
+    store.update([&batch, count, frame](AppState& s) {
+        bool frameApplied = false;
+        for (size_t i = 0; i < count; i++) {
+            if (batch[i].type != Command::Type::SetFrame) {
+                apply(s, batch[i]);
+            } else if (frame && !frameApplied) {
+                applyFrame(s, *frame);
+                frameApplied = true;
+            }
+        }
+        if (frame && !frameApplied) applyFrame(s, *frame);
+    });
+    Metrics::commandsApplied += count;
+    Metrics::commandsCoalesced += countCoalesced(batch, count);
+}
+
+size_t CommandQueue::countCoalesced(const Command* batch, size_t count) {
+    // A command is coalesced when a later one in the batch overwrites the same
+    // field; toggles and multi-pixel fills always take effect
+    bool seenType[static_cast<size_t>(Command::Type::Count)] = {false};
+    bool seenPixel[Config::NUM_PIXELS] = {false};
+    size_t coalesced = 0;
+    for (size_t i = count; i-- > 0;) {
+        const Command& cmd = batch[i];
+        switch (cmd.type) {
+            case Command::Type::TogglePower:
+            case Command::Type::FillPixels:
+            case Command::Type::MaskPixels:
+            case Command::Type::SetFrame:
+                break;
+            case Command::Type::SetPixel:
+                if (cmd.position < Config::NUM_PIXELS) {
+                    if (seenPixel[cmd.position]) coalesced++;
+                    seenPixel[cmd.position] = true;
+                }
+                break;
+            default: {
+                const size_t t = static_cast<size_t>(cmd.type);
+                if (seenType[t]) coalesced++;
+                seenType[t] = true;
+                break;
+            }
+        }
+    }
+    return coalesced;
+}
+
+void CommandQueue::apply(AppState& s, const Command& cmd) {
+    switch (cmd.type) {
+        case Command::Type::SetPower:
+            s.powerOn = cmd.value != 0;
+            break;
+        case Command::Type::TogglePower:
+            s.powerOn = !s.powerOn;
+            break;
+        case Command::Type::SetBrightness:
+            s.brightness = (uint8_t)cmd.value;
+            break;
+        case Command::Type::SetColor:
+            s.primaryColor = cmd.value;
+            break;
+        case Command::Type::SetPixel:
+            if (cmd.position < Config::NUM_PIXELS) {
+                s.pixelColors[cmd.position] = cmd.value;
+                s.pixelVersion++;
+            }
+            break;
+        case Command::Type::FillPixels:
+            for (uint32_t i = cmd.position; i < (uint32_t)cmd.position + cmd.count && i < Config::NUM_PIXELS; i++) {
+                s.pixelColors[i] = cmd.value;
+            }
+            s.pixelVersion++;
+            break;
+        case Command::Type::MaskPixels:
+            for (uint16_t i = 0; i < Config::NUM_PIXELS; i++) {
+                const bool lit = (cmd.mask >> (i < 31 ? i : 31)) & 1;
+                s.pixelColors[i] = lit ? cmd.value : 0;
+            }
+            s.pixelVersion++;
+            break;
+        case Command::Type::SetAnimation:
+            s.setAnimation(cmd.name);
+            break;
+        case Command::Type::SetSpeed:
+            s.speedMs = (uint16_t)cmd.value;
+            break;
+        case Command::Type::SetTail:
+            s.tailLength = (uint8_t)cmd.value;
+            break;
+        case Command::Type::SetStrobe:
+            s.strobePeriodMs = (uint16_t)cmd.value;
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "AppStateStore.h"
+
+// One state mutation. Produced by HTTP, button, presence and fleet code and
+// applied by the render loop.
+struct Command {
+    enum class Type : uint8_t {
+        SetPower,
+        TogglePower,
+        SetBrightness,
+        SetColor,
+        SetPixel,       // position, value = color
+        FillPixels,     // position..position+count-1 = value
+        MaskPixels,     // pixel i = value if bit i of mask, else off
+        SetAnimation,   // name
+        SetSpeed,
+        SetTail,
+        SetStrobe,
+        SetFrame,       // apply the frame staged by CommandQueue::postFrame
+        Count
+    };
+
+    Type type = Type::SetPower;
+    uint16_t position = 0;
+    uint16_t count = 0;
+    uint32_t value = 0;
+    uint32_t mask = 0;
+    char name[AppState::ANIMATION_NAME_LEN] = {0};
+};
+
+// Bounded multi-producer queue of Commands, drained by the render loop once
+// per frame. A drain folds the whole batch into a single AppStateStore
+// update, so redundant commands (e.g. 50 brightness values from a slider)
+// collapse into one state change.
+class CommandQueue {
+public:
+    static constexpr size_t DEPTH = 32;
+
+    void begin();
+
+    // Non-blocking and safe from any task; wakes the render loop, and counts a
+    // drop when the queue is full
+    bool push(const Command& cmd);
+
+    // Stages pixels[first..first+count-1] for the next drain. A full strip
+    // doesn't fit in a Command, so frames are merged into one staging buffer
+    // and a single SetFrame marker keeps their place in the command order.
+    // False, with nothing staged, when the marker doesn't fit in the queue.
+    bool postFrame(const uint32_t* pixels, uint16_t first, uint16_t count);
+
+    // Applies everything queued so far; call once per frame before rendering
+    void drain(AppStateStore& store);
+
+private:
+    static constexpr size_t FRAME_WORDS = (Config::NUM_PIXELS + 31) / 32;
+
+    QueueHandle_t _queue = nullptr;
+
+    // Double-buffered: postFrame() fills _frames[_staging] while drain() reads
+    // the other, so the lock only covers the swap and never nests in the store's
+    struct StagedFrame {
+        uint32_t pixels[Config::NUM_PIXELS] = {0};
+        uint32_t dirty[FRAME_WORDS] = {0};      // Bit i: pixel i is staged
+    };
+    portMUX_TYPE _frameLock = portMUX_INITIALIZER_UNLOCKED;
+    StagedFrame _frames[2];
+    uint8_t _staging = 0;                       // Guarded by _frameLock
+    std::atomic<bool> _framePending{false};     // Written under _frameLock; read unlocked for the early-out
+
+    // Hands the staged frame to the drain side; null when nothing was staged
+    StagedFrame* takeFrame();
+    static void applyFrame(AppState& state, StagedFrame& frame);
+
+    static void apply(AppState& state, const Command& cmd);
+    static size_t countCoalesced(const Command* batch, size_t count);
+};
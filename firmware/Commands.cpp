@@ -2,35 +2,67 @@
 
 namespace Commands {
 
-void togglePower(AppState& state, LedRing& ring) {
-    setPower(state, ring, !state.powerOn);
+static bool push(CommandQueue& queue, Command::Type type, uint32_t value) {
+    Command cmd;
+    cmd.type = type;
+    cmd.value = value;
+    return queue.push(cmd);
 }
 
-void setPower(AppState& state, LedRing& ring, bool on) {
-    state.powerOn = on;
-    if (!on) {
-        ring.clear();
-        ring.show();
+bool togglePower(CommandQueue& queue) {
+    return push(queue, Command::Type::TogglePower, 0);
+}
+
+bool setPower(CommandQueue& queue, bool on) {
+    return push(queue, Command::Type::SetPower, on ? 1 : 0);
+}
+
+bool setBrightness(CommandQueue& queue, uint8_t brightness) {
+    return push(queue, Command::Type::SetBrightness, brightness);
+}
+
+bool setColor(CommandQueue& queue, uint32_t color) {
+    return push(queue, Command::Type::SetColor, color);
+}
+
+bool setColor(CommandQueue& queue, uint16_t position, uint32_t color) {
+    if (position >= Config::NUM_PIXELS) return false;
+    Command cmd;
+    cmd.type = Command::Type::SetPixel;
+    cmd.position = position;
+    cmd.value = color;
+    return queue.push(cmd);
+}
+
+bool setColors(CommandQueue& queue, const PixelUpdate* updates, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (!setColor(queue, updates[i].position, updates[i].color)) return false;
     }
+    return true;
 }
 
-void setBrightness(AppState& state, LedRing& ring, uint8_t brightness) {
-    state.brightness = brightness;
-    ring.setBrightness(brightness);
-    ring.show();
+bool fillPixels(CommandQueue& queue, uint16_t first, uint16_t count, uint32_t color) {
+    Command cmd;
+    cmd.type = Command::Type::FillPixels;
+    cmd.position = first;
+    cmd.count = count;
+    cmd.value = color;
+    return queue.push(cmd);
 }
 
-void setColor(AppState& state, uint32_t color) {
-    state.primaryColor = color;
+bool maskPixels(CommandQueue& queue, uint32_t mask, uint32_t color) {
+    Command cmd;
+    cmd.type = Command::Type::MaskPixels;
+    cmd.mask = mask;
+    cmd.value = color;
+    return queue.push(cmd);
 }
 
-void setColor(AppState& state, uint16_t position, uint32_t color) {
-    if (position >= Config::NUM_PIXELS) return;
-    state.pixelColors[position] = color;
-    state.pixelVersion++;
+bool setFrame(CommandQueue& queue, const uint32_t* pixels, uint16_t first, uint16_t count) {
+    return queue.postFrame(pixels, first, count);
 }
 
-void setColors(AppState& state, const PixelUpdate* updates, size_t count) {
+bool setColors(AppState& state, const PixelUpdate* updates, size_t count) {
     bool changed = false;
     for (size_t i = 0; i < count; i++) {
         const uint16_t pos = updates[i].position;
@@ -41,28 +73,41 @@ void setColors(AppState& state, const PixelUpdate* updates, size_t count) {
     if (changed) {
         state.pixelVersion++;
     }
+    return changed;
 }
 
-void setAnimation(AppState& state, AnimationManager& mgr, const String& name) {
-    state.currentAnimationName = name;
-    mgr.setActive(name, state);
+bool setAnimation(CommandQueue& queue, const char* name) {
+    Command cmd;
+    cmd.type = Command::Type::SetAnimation;
+    strlcpy(cmd.name, name, sizeof(cmd.name));
+    return queue.push(cmd);
 }
 
-void nextAnimation(AppState& state, AnimationManager& mgr) {
-    mgr.nextAnimation(state);
-    state.currentAnimationName = mgr.currentName();
+bool nextAnimation(CommandQueue& queue, const AppStateStore& store, const AnimationManager& mgr) {
+    const size_t count = mgr.animationCount();
+    if (count == 0) return false;
+
+    const AppState current = store.snapshot();
+    size_t next = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (strcasecmp(mgr.animationName(i), current.animation) == 0) {
+            next = (i + 1) % count;
+            break;
+        }
+    }
+    return setAnimation(queue, mgr.animationName(next));
 }
 
-void setSpeed(AppState& state, uint16_t speedMs) {
-    state.speedMs = speedMs;
+bool setSpeed(CommandQueue& queue, uint16_t speedMs) {
+    return push(queue, Command::Type::SetSpeed, speedMs);
 }
 
-void setTailLength(AppState& state, uint8_t tailLen) {
-    state.tailLength = tailLen;
+bool setTailLength(CommandQueue& queue, uint8_t tailLen) {
+    return push(queue, Command::Type::SetTail, tailLen);
 }
 
-void setStrobePeriod(AppState& state, uint16_t periodMs) {
-    state.strobePeriodMs = periodMs;
+bool setStrobePeriod(CommandQueue& queue, uint16_t periodMs) {
+    return push(queue, Command::Type::SetStrobe, periodMs);
 }
 
 }
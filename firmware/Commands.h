@@ -1,9 +1,14 @@
 #pragma once
 
-#include "AppState.h"
+#include "AppStateStore.h"
 #include "AnimationManager.h"
-#include "LedRing.h"
+#include "CommandQueue.h"
 
+// State mutations shared by the HTTP API, button, presence and fleet paths.
+// Each enqueues a Command; the render loop applies the batch once per frame
+// and then reacts to the changed fields (brightness, power, animation).
+// The queue calls return false when the command was dropped because the queue
+// was full, so callers that answer someone (HTTP) can say so.
 namespace Commands {
 
 struct PixelUpdate {
@@ -11,18 +16,30 @@ struct PixelUpdate {
     uint32_t color;
 };
 
-void togglePower(AppState& state, LedRing& ring);
-void setPower(AppState& state, LedRing& ring, bool on);
-void setBrightness(AppState& state, LedRing& ring, uint8_t brightness);
-void setColor(AppState& state, uint32_t color);
+bool togglePower(CommandQueue& queue);
+bool setPower(CommandQueue& queue, bool on);
+bool setBrightness(CommandQueue& queue, uint8_t brightness);
+bool setColor(CommandQueue& queue, uint32_t color);
 
-void setColor(AppState& state, uint16_t position, uint32_t color);
-void setColors(AppState& state, const PixelUpdate* updates, size_t count);
+// False also for a position off the strip
+bool setColor(CommandQueue& queue, uint16_t position, uint32_t color);
+// Stops at the first update that doesn't fit
+bool setColors(CommandQueue& queue, const PixelUpdate* updates, size_t count);
+// Sets pixels first..first+count-1 to `color`
+bool fillPixels(CommandQueue& queue, uint16_t first, uint16_t count, uint32_t color);
+// Lights pixel i with `color` when bit i of `mask` is set, turns the rest off
+bool maskPixels(CommandQueue& queue, uint32_t mask, uint32_t color);
+// Sets pixels first..first+count-1 from pixels[first..]; for full-strip frames.
+// Merges into a frame already waiting for the drain, so only the first of a
+// burst can be dropped.
+bool setFrame(CommandQueue& queue, const uint32_t* pixels, uint16_t first, uint16_t count);
+// Applies pixel updates to a plain state (e.g. a segment's parameters)
+bool setColors(AppState& state, const PixelUpdate* updates, size_t count);
 
-void setAnimation(AppState& state, AnimationManager& mgr, const String& name);
-void nextAnimation(AppState& state, AnimationManager& mgr);
-void setSpeed(AppState& state, uint16_t speedMs);
-void setTailLength(AppState& state, uint8_t tailLen);
-void setStrobePeriod(AppState& state, uint16_t periodMs);
+bool setAnimation(CommandQueue& queue, const char* name);
+bool nextAnimation(CommandQueue& queue, const AppStateStore& store, const AnimationManager& mgr);
+bool setSpeed(CommandQueue& queue, uint16_t speedMs);
+bool setTailLength(CommandQueue& queue, uint8_t tailLen);
+bool setStrobePeriod(CommandQueue& queue, uint16_t periodMs);
 
 }
@@ -6,15 +6,144 @@ namespace Config {
     constexpr uint8_t LED_PIN = 38;
     constexpr uint16_t NUM_PIXELS = 3;
     constexpr uint8_t BUTTON_PIN = 41;
+
+    // LED power model (WS2812B @ 5V): mA per channel at full duty, plus idle draw per pixel
+    constexpr uint16_t LED_MA_RED = 20;
+    constexpr uint16_t LED_MA_GREEN = 20;
+    constexpr uint16_t LED_MA_BLUE = 20;
+    constexpr uint16_t LED_MA_IDLE = 1;
+
+    // Total LED current budget; brightness is capped dynamically to stay below it
+    constexpr uint32_t POWER_BUDGET_MA = 500;
+
+    // Render loop idling: the loop blocks until its next deadline, but wakes at least
+    // every LOOP_POLL_MS for sources that can only be polled (HTTP server, fleet UDP)
+    constexpr uint32_t LOOP_POLL_MS = 20;
+    // CPU clock while rendering vs. while waiting; waits of CPU_DOWNCLOCK_MIN_WAIT_MS
+    // or more run at CPU_IDLE_MHZ (80 keeps WiFi and the RMT LED timing working)
+    constexpr uint32_t CPU_ACTIVE_MHZ = 240;
+    constexpr uint32_t CPU_IDLE_MHZ = 80;
+    constexpr uint32_t CPU_DOWNCLOCK_MIN_WAIT_MS = 15;
+
+    // Temporal dithering of the 16-bit frame buffer down to 8-bit output.
+    // While active, the frame is re-sent at most every DITHER_REFRESH_MS. A frame
+    // left unchanged for DITHER_SETTLE_MS is sent once more, rounded, and the
+    // refreshes stop, so a static frame lets the loop sleep.
+    constexpr bool DITHERING_ENABLED = true;
+    constexpr uint32_t DITHER_REFRESH_MS = 2;
+    constexpr uint32_t DITHER_SETTLE_MS = 1000;
+
+    // Periodic animations (fade, strobe, spin, spinTail) render each frame of one period
+    // once and then replay it; a period larger than this isn't cached
+    constexpr size_t FRAME_CACHE_BYTES = 16 * 1024;         // Internal RAM
+    constexpr size_t FRAME_CACHE_PSRAM_BYTES = 1024 * 1024; // When the board has PSRAM
+
+    // Per-task JSON scratch arenas (see Memory.h), in PSRAM when present. The network
+    // task's largest document is a ~4 KB token response; HTTP's the rules table.
+    constexpr size_t NET_SCRATCH_BYTES = 12 * 1024;
+    constexpr size_t HTTP_SCRATCH_BYTES = 8 * 1024;
     
     // Microsoft Graph API configuration
     // TODO: Replace with your Azure AD app registration values
     constexpr const char* MS_CLIENT_ID = "YOUR_CLIENT_ID_HERE";
     constexpr const char* MS_TENANT_ID = "YOUR_TENANT_ID_HERE";
     
+    // Trace recorder ring buffer (power of two); only reserved when built with -DTRACE_ENABLED=1
+    constexpr uint32_t TRACE_BUFFER_EVENTS = 1024;
+
+    // WiFi connection: per-attempt timeout and exponential backoff between attempts
+    constexpr uint32_t WIFI_CONNECT_TIMEOUT_MS = 15000;
+    constexpr uint32_t WIFI_RETRY_MIN_MS = 1000;
+    constexpr uint32_t WIFI_RETRY_MAX_MS = 60000;
+    // A direct connect to the cached access point (BSSID + channel, no scan) that hasn't
+    // associated by then falls back to a full scan straight away
+    constexpr uint32_t WIFI_FAST_CONNECT_TIMEOUT_MS = 3000;
+    // Static IPv4 config skips DHCP; leave WIFI_STATIC_IP all zero to use DHCP
+    constexpr uint8_t WIFI_STATIC_IP[4] = {0, 0, 0, 0};
+    constexpr uint8_t WIFI_GATEWAY[4] = {192, 168, 1, 1};
+    constexpr uint8_t WIFI_SUBNET[4] = {255, 255, 255, 0};
+    constexpr uint8_t WIFI_DNS[4] = {192, 168, 1, 1};
+
+    // Fleet mode: shared animation clock and multicast commands across devices
+    constexpr bool FLEET_ENABLED = false;
+    constexpr uint8_t FLEET_GROUP[4] = {239, 42, 0, 1};
+    constexpr uint16_t FLEET_PORT = 4210;
+
+    // MQTT: optional persistent control channel alongside the HTTP API
+    constexpr bool MQTT_ENABLED = false;
+    constexpr const char* MQTT_HOST = "192.168.1.10";
+    constexpr uint16_t MQTT_PORT = 1883;
+    constexpr const char* MQTT_USER = "";       // Empty for anonymous brokers
+    constexpr const char* MQTT_PASS = "";
+    constexpr const char* MQTT_TOPIC_PREFIX = "teamsring";
+
+    // Audio: I2S MEMS microphone (INMP441 or similar, L/R tied low) for the
+    // vu / spectrum / beat animations. 16 kHz in 256-sample hops is 62.5 feature frames/s.
+    constexpr bool AUDIO_ENABLED = false;
+    constexpr uint8_t MIC_SCK_PIN = 4;
+    constexpr uint8_t MIC_WS_PIN = 5;
+    constexpr uint8_t MIC_SD_PIN = 6;
+    constexpr uint32_t AUDIO_SAMPLE_RATE = 16000;
+    constexpr uint8_t MIC_SAMPLE_SHIFT = 12;    // 32-bit slot -> 16-bit sample; lower is more gain
+
+    // Team wall: poll presence for several users in one request and show each
+    // on its own pixel range. Needs the Presence.Read.All scope (admin consent).
+    // Leave the first userId empty to track only the signed-in user.
+    struct TeamMember {
+        const char* userId;     // Azure AD object id
+        uint16_t firstPixel;
+        uint16_t pixelCount;
+    };
+    constexpr TeamMember TEAM_MEMBERS[] = {
+        {"", 0, 0},
+    };
+    constexpr size_t TEAM_MEMBER_COUNT = sizeof(TEAM_MEMBERS) / sizeof(TEAM_MEMBERS[0]);
+    constexpr bool TEAM_MODE = TEAM_MEMBERS[0].userId[0] != '\0';
+
     // Presence polling interval in milliseconds
     constexpr unsigned long PRESENCE_POLL_INTERVAL_MS = 15000;  // 15 seconds
+    // Requests in one network-task step (a 401 and its retry, calendar then presence)
+    // share a TLS connection, which is closed afterwards so its ~40 KB of buffers go back
+    // to the heap between polls. Keeping it open instead saves a handshake per poll, but
+    // holds that heap for good at a 15 s poll interval.
+    constexpr bool TLS_KEEP_ALIVE_BETWEEN_POLLS = false;
+    // With keep-alive between polls, a connection idle longer than this is closed and
+    // reopened rather than trusted, since the server may have dropped it
+    constexpr uint32_t TLS_KEEP_ALIVE_IDLE_MS = 60000;
+
+    // The network task refreshes the access token this long before it expires, between
+    // polls, so requests never carry an expired token; a request only refreshes inline
+    // when the token is inside the shorter margin (or its expiry can't be told)
+    constexpr uint32_t TOKEN_REFRESH_AHEAD_S = 600;
+    constexpr uint32_t TOKEN_EXPIRY_MARGIN_S = 60;
+    constexpr uint32_t TOKEN_REFRESH_RETRY_MS = 30000;
+    // Stored expiries are UTC, so the first poll after boot waits this long for SNTP
+    constexpr uint32_t CLOCK_SYNC_WAIT_MS = 3000;
     
-    // Strobe duration before transitioning to solid (milliseconds)
+    // Calendar pre-switching (single-user mode): busy events from /me/calendarView switch
+    // the light at meeting start/end; presence polls confirm afterwards. Needs the
+    // Calendars.Read scope, so enabling it means signing in again.
+    constexpr bool CALENDAR_ENABLED = false;
+    constexpr uint32_t CALENDAR_REFRESH_MS = 5 * 60 * 1000;
+    constexpr uint32_t CALENDAR_LOOKAHEAD_S = 8 * 3600;
+    // After a calendar switch, polls that still show the old status are ignored this
+    // long (Teams lags the meeting start); the confirming poll runs when it ends
+    constexpr uint32_t CALENDAR_HOLD_MS = 90000;
+
+    // Off-hours deep sleep: outside working hours (local time, from SNTP) the ring is blanked
+    // and the chip sleeps until shortly before they start again. TIMEZONE is a POSIX TZ
+    // string, e.g. "CET-1CEST,M3.5.0,M10.5.0/3"; WORK_DAYS bit 0 is Sunday.
+    constexpr bool SLEEP_SCHEDULE_ENABLED = false;
+    constexpr const char* TIMEZONE = "UTC0";
+    constexpr uint8_t WORK_DAYS = 0b0111110;            // Monday to Friday
+    constexpr uint16_t WORK_START_MINUTE = 8 * 60;
+    constexpr uint16_t WORK_END_MINUTE = 18 * 60;
+    constexpr uint32_t SLEEP_WAKE_EARLY_S = 120;        // WiFi and presence are ready at the start
+    // Longest single sleep; the RTC clock drifts, so long gaps are slept in legs
+    constexpr uint32_t SLEEP_MAX_S = 4 * 3600;
+    // Stay awake this long after power-on, a button wake or any press, even off-hours
+    constexpr uint32_t SLEEP_AWAKE_MS = 10 * 60 * 1000;
+
+    // Default intro (strobe) length for presence rules before their main animation (milliseconds)
     constexpr unsigned long STROBE_DURATION_MS = 3500;
 }
@@ -0,0 +1,103 @@
+#include "DeepSleep.h"
+#include <esp_sleep.h>
+#include <driver/rtc_io.h>
+#include <time.h>
+#include "Config.h"
+#include "Metrics.h"
+#include "SleepSchedule.h"
+#include "WallClock.h"
+
+namespace DeepSleep {
+
+static const SleepSchedule s_schedule(Config::WORK_DAYS, Config::WORK_START_MINUTE, Config::WORK_END_MINUTE);
+
+// Kept in RTC memory across deep sleep; reset by a power cycle
+RTC_DATA_ATTR static uint32_t s_sleeps = 0;
+RTC_DATA_ATTR static uint32_t s_sleptSeconds = 0;
+
+static uint32_t s_awakeUntilMs = 0;
+static uint32_t s_lastCheckMs = 0;
+static bool s_checked = false;
+
+static bool buttonCanWake() {
+    return rtc_gpio_is_valid_gpio((gpio_num_t)Config::BUTTON_PIN);
+}
+
+void begin() {
+    setenv("TZ", Config::TIMEZONE, 1);
+    tzset();
+    Metrics::deepSleeps = s_sleeps;
+    Metrics::deepSleepSeconds = s_sleptSeconds;
+
+    const esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+    if (cause == ESP_SLEEP_WAKEUP_TIMER) {
+        Serial.println("[Sleep] Woke on the timer");
+        return;
+    }
+    // Power-on or the button: someone is at the desk, so don't drop straight back to sleep
+    s_awakeUntilMs = Config::SLEEP_AWAKE_MS;
+    if (cause == ESP_SLEEP_WAKEUP_EXT0) {
+        Serial.println("[Sleep] Woke on the button");
+    }
+    if (Config::SLEEP_SCHEDULE_ENABLED && !buttonCanWake()) {
+        Serial.printf("[Sleep] GPIO %u isn't an RTC pin, so only the timer can end a sleep\n", Config::BUTTON_PIN);
+    }
+}
+
+void stayAwake(uint32_t nowMs) {
+    s_awakeUntilMs = nowMs + Config::SLEEP_AWAKE_MS;
+}
+
+uint32_t due(uint32_t nowMs) {
+    if (!Config::SLEEP_SCHEDULE_ENABLED || (int32_t)(nowMs - s_awakeUntilMs) < 0) {
+        return 0;
+    }
+    if (s_checked && nowMs - s_lastCheckMs < 1000) {
+        return 0;
+    }
+    s_checked = true;
+    s_lastCheckMs = nowMs;
+
+    const uint32_t nowUnix = WallClock::now();
+    if (nowUnix == 0) {
+        return 0;
+    }
+    const time_t t = nowUnix;
+    struct tm local;
+    localtime_r(&t, &local);
+    const uint32_t minutes = s_schedule.minutesUntilWork(local.tm_wday, local.tm_hour * 60 + local.tm_min);
+    if (minutes == 0) {
+        return 0;
+    }
+    if (minutes == UINT32_MAX) {
+        return Config::SLEEP_MAX_S;
+    }
+    // Not worth sleeping for the last minute or so before waking early anyway
+    const uint32_t untilWork = minutes * 60 - local.tm_sec;
+    if (untilWork <= Config::SLEEP_WAKE_EARLY_S + 60) {
+        return 0;
+    }
+    const uint32_t seconds = untilWork - Config::SLEEP_WAKE_EARLY_S;
+    return seconds < Config::SLEEP_MAX_S ? seconds : Config::SLEEP_MAX_S;
+}
+
+void enter(uint32_t seconds) {
+    char wakeAt[21];
+    WallClock::format(WallClock::now() + seconds, wakeAt);
+    Serial.printf("[Sleep] Off-hours, sleeping %lu s until %s\n", (unsigned long)seconds, wakeAt);
+    Serial.flush();
+
+    s_sleeps++;
+    s_sleptSeconds += seconds;
+    esp_sleep_enable_timer_wakeup((uint64_t)seconds * 1000000ULL);
+    if (buttonCanWake()) {
+        // Active-low button; the RTC domain keeps the pull-up while the chip sleeps
+        const gpio_num_t pin = (gpio_num_t)Config::BUTTON_PIN;
+        rtc_gpio_pullup_en(pin);
+        rtc_gpio_pulldown_dis(pin);
+        esp_sleep_enable_ext0_wakeup(pin, 0);
+    }
+    esp_deep_sleep_start();
+}
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Off-hours deep sleep (Config::SLEEP_SCHEDULE_ENABLED). The system time keeps
+// running through deep sleep, so after a timer wake the schedule can be checked
+// before WiFi is even started, and a wake that is still off-hours goes straight
+// back to sleep.
+namespace DeepSleep {
+
+// Call first in setup(): applies the time zone and reads why the chip woke
+void begin();
+
+// Postpones sleep by Config::SLEEP_AWAKE_MS (e.g. on a button press)
+void stayAwake(uint32_t nowMs);
+
+// Seconds to sleep when it is off-hours now, 0 otherwise (or when the clock
+// isn't set yet). Checked at most once a second.
+uint32_t due(uint32_t nowMs);
+
+// Arms the RTC timer (and the button, when it is on an RTC GPIO) and sleeps.
+// The caller blanks the ring and saves state first.
+[[noreturn]] void enter(uint32_t seconds);
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdarg.h>
+
+// NUL-terminated string with inline storage for up to N characters. Used in
+// place of Arduino String on long-lived and hot paths so they never touch
+// the heap. Writes that don't fit are truncated and reported by returning
+// false; the contents are always a valid C string.
+template <size_t N>
+class FixedString {
+public:
+    FixedString() { _buf[0] = '\0'; }
+    FixedString(const char* s) { assign(s); }
+
+    static constexpr size_t capacity() { return N; }
+    size_t length() const { return _len; }
+    bool isEmpty() const { return _len == 0; }
+    const char* c_str() const { return _buf; }
+    operator const char*() const { return _buf; }
+
+    void clear() {
+        _len = 0;
+        _buf[0] = '\0';
+    }
+
+    // Lets a C-style API write into the buffer: `write(char* buf, size_t size)`
+    // gets capacity() + 1 bytes including room for the terminator
+    template <typename Fn>
+    void fill(Fn&& write) {
+        _buf[0] = '\0';
+        write(_buf, N + 1);
+        _buf[N] = '\0';
+        _len = strlen(_buf);
+    }
+
+    bool assign(const char* s) {
+        clear();
+        return append(s);
+    }
+
+    bool append(const char* s) {
+        return append(s, s ? strlen(s) : 0);
+    }
+
+    bool append(const char* s, size_t len) {
+        const size_t room = N - _len;
+        const size_t n = len < room ? len : room;
+        memcpy(_buf + _len, s, n);
+        _len += n;
+        _buf[_len] = '\0';
+        return n == len;
+    }
+
+    bool append(char c) {
+        return append(&c, 1);
+    }
+
+    bool appendf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, fmt);
+        const int n = vsnprintf(_buf + _len, N + 1 - _len, fmt, args);
+        va_end(args);
+        if (n < 0) {
+            _buf[_len] = '\0';
+            return false;
+        }
+        const size_t room = N - _len;
+        _len += (size_t)n < room ? (size_t)n : room;
+        return (size_t)n <= room;
+    }
+
+    bool operator==(const char* s) const { return strcmp(_buf, s) == 0; }
+    bool operator!=(const char* s) const { return strcmp(_buf, s) != 0; }
+
+private:
+    size_t _len = 0;
+    char _buf[N + 1];
+};
+
+// FNV-1a, usable in constant expressions so string switches can be written as
+// `switch (fnv1a(s)) { case fnv1a("name"): ... }`
+constexpr uint32_t fnv1a(const char* s, uint32_t hash = 2166136261u) {
+    return *s ? fnv1a(s + 1, (hash ^ (uint8_t)*s) * 16777619u) : hash;
+}
@@ -0,0 +1,220 @@
+#include "FleetSync.h"
+#include <WiFi.h>
+#include <esp_timer.h>
+#include "Config.h"
+
+namespace {
+
+constexpr uint32_t MAGIC = 0x53465254;  // "TRFS" on the wire
+constexpr uint8_t VERSION = 1;
+
+enum PacketType : uint8_t {
+    PACKET_BEACON = 1,
+    PACKET_SYNC_REQUEST = 2,
+    PACKET_SYNC_RESPONSE = 3,
+    PACKET_COMMAND = 4
+};
+
+// Little-endian, packed; server/fleet_client.py builds PACKET_COMMAND
+struct __attribute__((packed)) Header {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t type;
+};
+
+struct __attribute__((packed)) BeaconPacket {
+    Header header;
+    uint32_t nodeId;
+};
+
+struct __attribute__((packed)) SyncPacket {
+    Header header;
+    int64_t t1;     // Follower send time (follower clock)
+    int64_t t2;     // Leader receive time (leader clock)
+    int64_t t3;     // Leader send time (leader clock)
+};
+
+struct __attribute__((packed)) CommandPacket {
+    Header header;
+    uint8_t fields;
+    uint8_t powerOn;
+    uint32_t seq;
+    uint32_t color;
+    uint16_t speedMs;
+    uint8_t brightness;
+    char animation[16];
+};
+
+Header makeHeader(PacketType type) {
+    return {MAGIC, VERSION, type};
+}
+
+}
+
+bool FleetSync::begin() {
+    const uint64_t mac = ESP.getEfuseMac();
+    _nodeId = (uint32_t)(mac ^ (mac >> 32));
+    _leaderId = _nodeId;
+    _started = _udp.beginMulticast(IPAddress(Config::FLEET_GROUP[0], Config::FLEET_GROUP[1],
+                                             Config::FLEET_GROUP[2], Config::FLEET_GROUP[3]),
+                                   Config::FLEET_PORT);
+    Serial.printf("[Fleet] %s, node %08lX\n", _started ? "Joined multicast group" : "Failed to join group",
+                  (unsigned long)_nodeId);
+    return _started;
+}
+
+uint32_t FleetSync::nowMs() const {
+    return (uint32_t)((esp_timer_get_time() + _offsetUs) / 1000);
+}
+
+bool FleetSync::isSynced() const {
+    return _started && (isLeader() || (_sampleCount > 0 && millis() - _lastSyncMs < SYNC_STALE_MS));
+}
+
+bool FleetSync::takeCommand(FleetCommand& out) {
+    if (!_hasCommand) return false;
+    out = _command;
+    _hasCommand = false;
+    return true;
+}
+
+void FleetSync::poll(uint32_t nowMs) {
+    if (!_started) return;
+
+    uint8_t buf[64];
+    while (int len = _udp.parsePacket()) {
+        const int n = _udp.read(buf, sizeof(buf));
+        if (n == len) {
+            handlePacket(nowMs, buf, (size_t)n);
+        }
+    }
+
+    // Fall back to leading ourselves if the leader went quiet
+    if (!isLeader() && nowMs - _leaderSeenMs >= LEADER_TIMEOUT_MS) {
+        Serial.println("[Fleet] Leader lost");
+        setLeader(_nodeId, IPAddress(), nowMs);
+    }
+
+    if (nowMs - _lastBeaconMs >= BEACON_INTERVAL_MS) {
+        _lastBeaconMs = nowMs;
+        sendBeacon();
+    }
+    if (!isLeader() && nowMs - _lastSyncRequestMs >= SYNC_INTERVAL_MS) {
+        _lastSyncRequestMs = nowMs;
+        sendSyncRequest();
+    }
+}
+
+void FleetSync::handlePacket(uint32_t nowMs, const uint8_t* data, size_t len) {
+    const int64_t receivedUs = esp_timer_get_time();
+    if (len < sizeof(Header)) return;
+    Header header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION) return;
+
+    switch (header.type) {
+        case PACKET_BEACON: {
+            if (len != sizeof(BeaconPacket)) return;
+            BeaconPacket p;
+            memcpy(&p, data, sizeof(p));
+            if (p.nodeId == _nodeId) return;  // Our own multicast looped back
+            if (p.nodeId <= _leaderId) {
+                setLeader(p.nodeId, _udp.remoteIP(), nowMs);
+            }
+            break;
+        }
+
+        case PACKET_SYNC_REQUEST: {
+            if (len != sizeof(SyncPacket) || !isLeader()) return;
+            SyncPacket p;
+            memcpy(&p, data, sizeof(p));
+            p.header = makeHeader(PACKET_SYNC_RESPONSE);
+            p.t2 = receivedUs;
+            p.t3 = esp_timer_get_time();
+            _udp.beginPacket(_udp.remoteIP(), _udp.remotePort());
+            _udp.write((const uint8_t*)&p, sizeof(p));
+            _udp.endPacket();
+            break;
+        }
+
+        case PACKET_SYNC_RESPONSE: {
+            if (len != sizeof(SyncPacket) || isLeader()) return;
+            SyncPacket p;
+            memcpy(&p, data, sizeof(p));
+            const int64_t t4 = receivedUs;
+            const int64_t rtt = (t4 - p.t1) - (p.t3 - p.t2);
+            if (rtt < 0) return;
+            addSample(((p.t2 - p.t1) + (p.t3 - t4)) / 2, (uint32_t)rtt, nowMs);
+            break;
+        }
+
+        case PACKET_COMMAND: {
+            if (len != sizeof(CommandPacket)) return;
+            CommandPacket p;
+            memcpy(&p, data, sizeof(p));
+            // Senders repeat each command for reliability; apply it once
+            const IPAddress from = _udp.remoteIP();
+            if (p.seq == _lastCommandSeq && from == _lastCommandIp) return;
+            _lastCommandSeq = p.seq;
+            _lastCommandIp = from;
+
+            _command.fields = p.fields;
+            _command.powerOn = p.powerOn != 0;
+            _command.brightness = p.brightness;
+            _command.color = p.color & 0xFFFFFF;
+            _command.speedMs = p.speedMs;
+            memcpy(_command.animation, p.animation, sizeof(_command.animation));
+            _command.animation[sizeof(_command.animation) - 1] = '\0';
+            _hasCommand = true;
+            _commandsReceived++;
+            _lastCommandFleetMs = this->nowMs();
+            break;
+        }
+    }
+}
+
+void FleetSync::setLeader(uint32_t id, IPAddress ip, uint32_t nowMs) {
+    _leaderSeenMs = nowMs;
+    if (id == _leaderId) return;
+
+    Serial.printf("[Fleet] Leader is now %08lX%s\n", (unsigned long)id, id == _nodeId ? " (self)" : "");
+    _leaderId = id;
+    _leaderIp = ip;
+    _sampleCount = 0;
+    _sampleNext = 0;
+    _bestRttUs = 0;
+    if (id == _nodeId) {
+        _offsetUs = 0;
+    } else {
+        _lastSyncRequestMs = nowMs - SYNC_INTERVAL_MS;  // Sync right away
+    }
+}
+
+void FleetSync::sendBeacon() {
+    BeaconPacket p = {makeHeader(PACKET_BEACON), _nodeId};
+    _udp.beginMulticastPacket();
+    _udp.write((const uint8_t*)&p, sizeof(p));
+    _udp.endPacket();
+}
+
+void FleetSync::sendSyncRequest() {
+    SyncPacket p = {makeHeader(PACKET_SYNC_REQUEST), esp_timer_get_time(), 0, 0};
+    _udp.beginPacket(_leaderIp, Config::FLEET_PORT);
+    _udp.write((const uint8_t*)&p, sizeof(p));
+    _udp.endPacket();
+}
+
+void FleetSync::addSample(int64_t offsetUs, uint32_t rttUs, uint32_t nowMs) {
+    _samples[_sampleNext] = {offsetUs, rttUs};
+    _sampleNext = (_sampleNext + 1) % SYNC_WINDOW;
+    if (_sampleCount < SYNC_WINDOW) _sampleCount++;
+
+    // The lowest-RTT sample has the least asymmetric queuing delay
+    const Sample* best = &_samples[0];
+    for (uint8_t i = 1; i < _sampleCount; i++) {
+        if (_samples[i].rttUs < best->rttUs) best = &_samples[i];
+    }
+    _offsetUs = best->offsetUs;
+    _bestRttUs = best->rttUs;
+    _lastSyncMs = nowMs;
+}
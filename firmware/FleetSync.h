@@ -0,0 +1,97 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+
+// A command multicast to every device in the fleet
+struct FleetCommand {
+    enum Field : uint8_t {
+        POWER = 1 << 0,
+        BRIGHTNESS = 1 << 1,
+        COLOR = 1 << 2,
+        ANIMATION = 1 << 3,
+        SPEED = 1 << 4
+    };
+
+    uint8_t fields;         // Which of the values below are set
+    bool powerOn;
+    uint8_t brightness;
+    uint32_t color;
+    uint16_t speedMs;
+    char animation[16];
+};
+
+// Fleet mode: a shared clock across devices via lightweight UDP time sync,
+// and multicast commands that reach every device with one packet.
+//
+// Every device multicasts a beacon each second; the lowest node id heard is
+// the leader and its clock is the fleet time. Followers sync to the leader
+// with NTP-style request/response exchanges, keeping the lowest-RTT sample.
+class FleetSync {
+public:
+    bool begin();   // Call once WiFi is up
+    bool isStarted() const { return _started; }
+
+    // Handles incoming packets and sends beacons / sync requests; call every loop
+    void poll(uint32_t nowMs);
+
+    // Fleet time in ms; the local clock until the first sync completes
+    uint32_t nowMs() const;
+
+    // Returns true and fills `out` for each new multicast command
+    bool takeCommand(FleetCommand& out);
+
+    uint32_t nodeId() const { return _nodeId; }
+    uint32_t leaderId() const { return _leaderId; }
+    bool isLeader() const { return _leaderId == _nodeId; }
+    bool isSynced() const;
+    int32_t offsetUs() const { return (int32_t)_offsetUs; }
+    // Upper bound on clock error: half the round trip of the sample in use
+    uint32_t syncErrorUs() const { return _bestRttUs / 2; }
+    uint32_t commandsReceived() const { return _commandsReceived; }
+    uint32_t lastCommandSeq() const { return _lastCommandSeq; }
+    // Fleet time at which the last command was applied; compare across devices for fan-out spread
+    uint32_t lastCommandFleetMs() const { return _lastCommandFleetMs; }
+
+private:
+    static constexpr uint32_t BEACON_INTERVAL_MS = 1000;
+    static constexpr uint32_t LEADER_TIMEOUT_MS = 3500;
+    static constexpr uint32_t SYNC_INTERVAL_MS = 2000;
+    static constexpr uint32_t SYNC_STALE_MS = 10000;
+    static constexpr uint8_t SYNC_WINDOW = 8;
+
+    struct Sample {
+        int64_t offsetUs;
+        uint32_t rttUs;
+    };
+
+    WiFiUDP _udp;
+    bool _started = false;
+    uint32_t _nodeId = 0;
+
+    uint32_t _leaderId = 0;
+    IPAddress _leaderIp;
+    uint32_t _leaderSeenMs = 0;
+    uint32_t _lastBeaconMs = 0;
+    uint32_t _lastSyncRequestMs = 0;
+
+    Sample _samples[SYNC_WINDOW] = {};
+    uint8_t _sampleCount = 0;
+    uint8_t _sampleNext = 0;
+    int64_t _offsetUs = 0;
+    uint32_t _bestRttUs = 0;
+    uint32_t _lastSyncMs = 0;
+
+    bool _hasCommand = false;
+    FleetCommand _command = {};
+    IPAddress _lastCommandIp;
+    uint32_t _lastCommandSeq = 0;
+    uint32_t _lastCommandFleetMs = 0;
+    uint32_t _commandsReceived = 0;
+
+    void handlePacket(uint32_t nowMs, const uint8_t* data, size_t len);
+    void sendBeacon();
+    void sendSyncRequest();
+    void addSample(int64_t offsetUs, uint32_t rttUs, uint32_t nowMs);
+    void setLeader(uint32_t id, IPAddress ip, uint32_t nowMs);
+};
@@ -0,0 +1,56 @@
+#include "FrameCache.h"
+#include "Memory.h"
+
+bool FrameCache::begin(uint16_t pixels, uint32_t stepMs, uint32_t frames) {
+    reset();
+    if (pixels == 0 || frames == 0) {
+        return false;
+    }
+    const size_t frameValues = (size_t)pixels * 3;
+    const size_t frameBytes = frameValues * sizeof(uint16_t);
+    // A period too long for the arena is checked up front, so it isn't counted
+    // as a failure. Frames are checked before multiplying, since size_t is 32
+    // bits on the device.
+    if (frames > Memory::frameCache.capacity() / frameBytes) {
+        return false;
+    }
+    const size_t bytes = frameBytes * frames;
+    if (bytes + (frames + 7) / 8 > Memory::frameCache.capacity()) {
+        return false;
+    }
+    Memory::frameCache.reset();
+    _buffer = static_cast<uint16_t*>(Memory::frameCache.allocate(bytes));
+    _filled = static_cast<uint8_t*>(Memory::frameCache.allocate((frames + 7) / 8));
+    if (!_buffer || !_filled) {
+        return false;
+    }
+    _frameValues = frameValues;
+    _stepMs = stepMs ? stepMs : 1;
+    _frames = frames;
+    memset(_filled, 0, (frames + 7) / 8);
+    return true;
+}
+
+void FrameCache::reset() {
+    _frames = 0;
+}
+
+const uint16_t* FrameCache::frame(uint32_t step) const {
+    if (_frames == 0) {
+        return nullptr;
+    }
+    const uint32_t slot = step % _frames;
+    if (!(_filled[slot / 8] & (1 << (slot % 8)))) {
+        return nullptr;
+    }
+    return _buffer + slot * _frameValues;
+}
+
+void FrameCache::store(uint32_t step, const uint16_t* data) {
+    if (_frames == 0) {
+        return;
+    }
+    const uint32_t slot = step % _frames;
+    memcpy(_buffer + slot * _frameValues, data, _frameValues * sizeof(uint16_t));
+    _filled[slot / 8] |= 1 << (slot % 8);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+
+// One period of a periodic animation's frames, filled the first time each
+// frame is drawn and replayed by step index afterwards. Frames are stored as
+// LedRing's unscaled 16-bit RGB, so brightness and dithering still apply on
+// show(). Frames are carved from the Memory::frameCache arena (PSRAM when the
+// board has it), which begin() starts over each time.
+class FrameCache {
+public:
+    // Sets up a period of `frames` frames, one per `stepMs`, of `pixels`
+    // pixels each. False (and the cache stays inactive) when it doesn't fit
+    // the arena.
+    bool begin(uint16_t pixels, uint32_t stepMs, uint32_t frames);
+
+    // Drops all frames; call whenever anything the frames depend on changes
+    void reset();
+
+    bool active() const { return _frames != 0; }
+    uint32_t stepMs() const { return _stepMs; }
+    uint32_t stepAt(uint32_t nowMs) const { return nowMs / _stepMs; }
+
+    // Cached frame for `step`, nullptr until store() filled it. Both are
+    // no-ops while the cache is inactive.
+    const uint16_t* frame(uint32_t step) const;
+    void store(uint32_t step, const uint16_t* data);
+
+private:
+    uint16_t* _buffer = nullptr;
+    uint8_t* _filled = nullptr;         // One bit per frame
+    size_t _frameValues = 0;            // uint16_t values per frame
+    uint32_t _stepMs = 1;
+    uint32_t _frames = 0;
+};
@@ -0,0 +1,143 @@
+#include "FrameDecoder.h"
+
+static uint8_t addSaturating(uint8_t a, uint8_t b) {
+    const uint16_t sum = (uint16_t)a + b;
+    return sum > 255 ? 255 : (uint8_t)sum;
+}
+
+bool FrameDecoder::parseEncoding(const char* name, Encoding& out) {
+    if (name[0] == '\0' || strcmp(name, "raw") == 0) {
+        out = Encoding::Raw;
+    } else if (strcmp(name, "rle") == 0) {
+        out = Encoding::Rle;
+    } else if (strcmp(name, "delta") == 0) {
+        out = Encoding::Delta;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void FrameDecoder::begin(uint32_t* pixels, uint16_t offset, uint16_t length, uint8_t bytesPerPixel,
+                         Encoding encoding) {
+    _pixels = pixels;
+    _offset = offset;
+    _length = length;
+    _bytesPerPixel = bytesPerPixel;
+    _encoding = encoding;
+
+    _stage = encoding == Encoding::Raw ? Stage::Pixel : Stage::Header;
+    _cursor = 0;
+    _headerBytes = 0;
+    _pixelsLeft = 0;
+    _pixelBytes = 0;
+
+    _firstWritten = UINT16_MAX;
+    _lastWritten = 0;
+    _pixelsWritten = 0;
+    _error = nullptr;
+}
+
+bool FrameDecoder::fail(const char* error) {
+    if (!_error) _error = error;
+    return false;
+}
+
+bool FrameDecoder::write(const uint8_t* data, size_t len) {
+    if (_error) return false;
+    const uint8_t headerSize = _encoding == Encoding::Rle ? 1 : 2;
+
+    for (size_t i = 0; i < len; i++) {
+        if (_stage == Stage::Header) {
+            _header[_headerBytes++] = data[i];
+            if (_headerBytes == headerSize) {
+                _headerBytes = 0;
+                onHeader();
+                if (_error) return false;
+            }
+        } else {
+            _pixel[_pixelBytes++] = data[i];
+            if (_pixelBytes == _bytesPerPixel) {
+                _pixelBytes = 0;
+                if (!onPixel()) return false;
+            }
+        }
+    }
+    return true;
+}
+
+void FrameDecoder::onHeader() {
+    if (_encoding == Encoding::Rle) {
+        _pixelsLeft = (uint16_t)_header[0] + 1;
+        _stage = Stage::Pixel;
+        return;
+    }
+
+    // Delta: skip unchanged pixels, then expect `count` literal pixels
+    const uint16_t skip = _header[0];
+    if ((uint32_t)_cursor + skip > _length) {
+        fail("Delta skip runs past 'length'");
+        return;
+    }
+    _cursor += skip;
+    _pixelsLeft = _header[1];
+    _stage = _pixelsLeft > 0 ? Stage::Pixel : Stage::Header;
+}
+
+bool FrameDecoder::onPixel() {
+    uint8_t r = _pixel[0], g = _pixel[1], b = _pixel[2];
+    if (_bytesPerPixel == 4) {
+        // The strip has no white channel, so white is mixed into RGB
+        const uint8_t w = _pixel[3];
+        r = addSaturating(r, w);
+        g = addSaturating(g, w);
+        b = addSaturating(b, w);
+    }
+    const uint32_t color = (uint32_t)r << 16 | (uint32_t)g << 8 | b;
+
+    switch (_encoding) {
+        case Encoding::Raw:
+            return emit(color, 1);
+        case Encoding::Rle:
+            _stage = Stage::Header;
+            return emit(color, _pixelsLeft);
+        case Encoding::Delta:
+            if (--_pixelsLeft == 0) _stage = Stage::Header;
+            return emit(color, 1);
+    }
+    return false;
+}
+
+bool FrameDecoder::emit(uint32_t color, uint16_t count) {
+    if ((uint32_t)_cursor + count > _length) {
+        return fail("Payload has more pixels than 'length'");
+    }
+    uint32_t* out = _pixels + _offset + _cursor;
+    for (uint16_t i = 0; i < count; i++) {
+        out[i] = color;
+    }
+    const uint16_t first = _offset + _cursor;
+    const uint16_t last = first + count - 1;
+    if (first < _firstWritten) _firstWritten = first;
+    if (last > _lastWritten) _lastWritten = last;
+    _cursor += count;
+    _pixelsWritten += count;
+    return true;
+}
+
+bool FrameDecoder::finish() {
+    if (_error) return false;
+    if (_pixelBytes != 0) {
+        return fail("Payload ends mid-pixel");
+    }
+    if (_stage == Stage::Pixel && _encoding != Encoding::Raw) {
+        return fail("Payload ends mid-run");
+    }
+    if (_headerBytes != 0) {
+        return fail("Payload ends mid-header");
+    }
+    if (_encoding != Encoding::Delta && _cursor != _length) {
+        return fail("Payload has fewer pixels than 'length'");
+    }
+    return true;
+}
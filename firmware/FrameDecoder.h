@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Incremental decoder for POST /frame bodies. Bytes arrive in whatever chunks
+// the socket delivers and are decoded straight into a 0xRRGGBB pixel buffer,
+// so a full strip never has to be held as a request body or JSON document.
+//
+// Encodings (pixels are 3 bytes RGB or 4 bytes RGBW):
+//   Raw    pixel pixel pixel ...                    exactly `length` pixels
+//   Rle    [n] pixel  -> n+1 copies of pixel         exactly `length` pixels
+//   Delta  [skip] [n] pixel x n                      skip pixels, then write n
+class FrameDecoder {
+public:
+    enum class Encoding : uint8_t {
+        Raw,
+        Rle,
+        Delta
+    };
+
+    // Decodes into pixels[offset .. offset+length-1]
+    void begin(uint32_t* pixels, uint16_t offset, uint16_t length, uint8_t bytesPerPixel, Encoding encoding);
+
+    // Returns false (and stops consuming) once the payload is malformed
+    bool write(const uint8_t* data, size_t len);
+
+    // Checks the payload ended cleanly; call after the last write
+    bool finish();
+
+    const char* error() const { return _error; }
+
+    // Range of pixels actually written; empty when lastWritten < firstWritten
+    uint16_t firstWritten() const { return _firstWritten; }
+    uint16_t lastWritten() const { return _lastWritten; }
+    uint16_t pixelsWritten() const { return _pixelsWritten; }
+
+    static bool parseEncoding(const char* name, Encoding& out);
+
+private:
+    enum class Stage : uint8_t {
+        Header,     // Rle run count or Delta skip/count bytes
+        Pixel
+    };
+
+    uint32_t* _pixels = nullptr;
+    uint16_t _offset = 0;
+    uint16_t _length = 0;
+    uint8_t _bytesPerPixel = 3;
+    Encoding _encoding = Encoding::Raw;
+
+    Stage _stage = Stage::Pixel;
+    uint16_t _cursor = 0;           // Next pixel, relative to _offset
+    uint8_t _header[2] = {0};
+    uint8_t _headerBytes = 0;
+    uint16_t _pixelsLeft = 0;       // In the current Rle run / Delta record
+    uint8_t _pixel[4] = {0};
+    uint8_t _pixelBytes = 0;
+
+    uint16_t _firstWritten = 0;
+    uint16_t _lastWritten = 0;
+    uint16_t _pixelsWritten = 0;
+    const char* _error = nullptr;
+
+    bool fail(const char* error);
+    void onHeader();
+    bool onPixel();
+    bool emit(uint32_t color, uint16_t count);
+};
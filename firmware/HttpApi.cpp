@@ -1,79 +1,203 @@
 #include "HttpApi.h"
+#include "BootTimings.h"
+#include "ColorCodec.h"
+#include "Memory.h"
+#include "Metrics.h"
+#include "Trace.h"
 
-HttpApi::HttpApi(AppState& state, AnimationManager& mgr, LedRing& ring, uint16_t port)
-    : _state(state), _mgr(mgr), _ring(ring), _server(port) {}
+namespace {
+
+// Buffers Print output and streams it as a chunked HTTP response
+class ChunkedResponse : public Print {
+public:
+    ChunkedResponse(WebServer& server, const char* contentType) : _server(server) {
+        _server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+        _server.send(200, contentType, "");
+    }
+    ~ChunkedResponse() {
+        flush();
+        _server.sendContent("");
+    }
+
+    size_t write(uint8_t c) override {
+        if (_len == sizeof(_buf)) flush();
+        _buf[_len++] = (char)c;
+        return 1;
+    }
+
+    void flush() {
+        if (_len == 0) return;
+        _server.sendContent(_buf, _len);
+        _len = 0;
+    }
+
+private:
+    WebServer& _server;
+    char _buf[1024];
+    size_t _len = 0;
+};
+
+}
+
+HttpApi::HttpApi(AppStateStore& store, CommandQueue& commands, AnimationManager& mgr, LedRing& ring, StatePersistence& persistence,
+                 FleetSync& fleet, PresenceRules& rules, uint16_t port)
+    : _store(store), _commands(commands), _mgr(mgr), _ring(ring), _persistence(persistence), _fleet(fleet), _rules(rules),
+      _server(port) {}
 
 void HttpApi::begin() {
-    _server.on("/status", HTTP_GET, [this]() { handleStatus(); });
-    _server.on("/animations", HTTP_GET, [this]() { handleAnimations(); });
-    _server.on("/animation", HTTP_GET, [this]() { handleSetAnimation(); });
-    _server.on("/animation", HTTP_POST, [this]() { handleSetAnimation(); });
-    _server.on("/brightness", HTTP_GET, [this]() { handleSetBrightness(); });
-    _server.on("/brightness", HTTP_POST, [this]() { handleSetBrightness(); });
-    _server.on("/color", HTTP_GET, [this]() { handleSetColor(); });
-    _server.on("/color", HTTP_POST, [this]() { handleSetColor(); });
-    _server.on("/pixel", HTTP_GET, [this]() { handleSetPixel(); });
-    _server.on("/pixel", HTTP_POST, [this]() { handleSetPixel(); });
-    _server.on("/pixels", HTTP_POST, [this]() { handleSetPixels(); });
-    _server.on("/power", HTTP_GET, [this]() { handleSetPower(); });
-    _server.on("/power", HTTP_POST, [this]() { handleSetPower(); });
-    _server.on("/speed", HTTP_GET, [this]() { handleSetSpeed(); });
-    _server.on("/speed", HTTP_POST, [this]() { handleSetSpeed(); });
-    _server.on("/tail", HTTP_GET, [this]() { handleSetTail(); });
-    _server.on("/tail", HTTP_POST, [this]() { handleSetTail(); });
-    _server.on("/strobe", HTTP_GET, [this]() { handleSetStrobe(); });
-    _server.on("/strobe", HTTP_POST, [this]() { handleSetStrobe(); });
+    route("/status", HTTP_GET, &HttpApi::handleStatus);
+    route("/metrics", HTTP_GET, &HttpApi::handleMetrics);
+    route("/trace", HTTP_GET, &HttpApi::handleTrace);
+    route("/animations", HTTP_GET, &HttpApi::handleAnimations);
+    route("/animation", HTTP_GET, &HttpApi::handleSetAnimation);
+    route("/animation", HTTP_POST, &HttpApi::handleSetAnimation);
+    route("/brightness", HTTP_GET, &HttpApi::handleSetBrightness);
+    route("/brightness", HTTP_POST, &HttpApi::handleSetBrightness);
+    route("/color", HTTP_GET, &HttpApi::handleSetColor);
+    route("/color", HTTP_POST, &HttpApi::handleSetColor);
+    route("/pixel", HTTP_GET, &HttpApi::handleSetPixel);
+    route("/pixel", HTTP_POST, &HttpApi::handleSetPixel);
+    route("/pixels", HTTP_POST, &HttpApi::handleSetPixels);
+    route("/frame", HTTP_POST, &HttpApi::handleFrame, &HttpApi::handleFrameBody);
+    route("/power", HTTP_GET, &HttpApi::handleSetPower);
+    route("/power", HTTP_POST, &HttpApi::handleSetPower);
+    route("/speed", HTTP_GET, &HttpApi::handleSetSpeed);
+    route("/speed", HTTP_POST, &HttpApi::handleSetSpeed);
+    route("/tail", HTTP_GET, &HttpApi::handleSetTail);
+    route("/tail", HTTP_POST, &HttpApi::handleSetTail);
+    route("/strobe", HTTP_GET, &HttpApi::handleSetStrobe);
+    route("/strobe", HTTP_POST, &HttpApi::handleSetStrobe);
+    route("/rules", HTTP_GET, &HttpApi::handleGetRules);
+    route("/rules", HTTP_POST, &HttpApi::handleSetRules);
+    route("/rules", HTTP_DELETE, &HttpApi::handleResetRules);
+    route("/segments", HTTP_GET, &HttpApi::handleGetSegments);
+    route("/segment", HTTP_POST, &HttpApi::handleSetSegment);
+    route("/segment", HTTP_DELETE, &HttpApi::handleDeleteSegment);
     _server.begin();
 }
 
+void HttpApi::route(const char* path, HTTPMethod method, Handler handler) {
+    Metrics::HttpRoute* metrics = Metrics::httpRoute(path);
+    _server.on(path, method, [this, path, handler, metrics]() {
+        TRACE_SCOPE(path);
+        Memory::Scope scratch(Memory::httpScratch);     // Frees the handler's JSON documents
+        const uint32_t startUs = micros();
+        (this->*handler)();
+        if (metrics) metrics->latency.observe(micros() - startUs);
+    });
+}
+
+void HttpApi::route(const char* path, HTTPMethod method, Handler handler, Handler bodyHandler) {
+    Metrics::HttpRoute* metrics = Metrics::httpRoute(path);
+    _server.on(path, method, [this, path, handler, metrics]() {
+        TRACE_SCOPE(path);
+        Memory::Scope scratch(Memory::httpScratch);     // Frees the handler's JSON documents
+        const uint32_t startUs = micros();
+        (this->*handler)();
+        if (metrics) metrics->latency.observe(micros() - startUs);
+    }, [this, bodyHandler]() {
+        (this->*bodyHandler)();
+    });
+}
+
 void HttpApi::poll() {
     _server.handleClient();
 }
 
 void HttpApi::handleStatus() {
-    StaticJsonDocument<512> doc;
-    doc["powerOn"] = _state.powerOn;
-    doc["brightness"] = _state.brightness;
+    const AppState state = _store.snapshot();
+    Memory::HttpJsonDocument doc(1024);
+    doc["powerOn"] = state.powerOn;
+    doc["brightness"] = state.brightness;
     doc["animation"] = _mgr.currentName();
     char colorHex[8];
-    snprintf(colorHex, sizeof(colorHex), "#%06X", (unsigned int)_state.primaryColor);
+    ColorCodec::formatHex(state.primaryColor, colorHex);
     doc["color"] = colorHex;
-    doc["speedMs"] = _state.speedMs;
-    doc["tailLength"] = _state.tailLength;
-    doc["strobePeriodMs"] = _state.strobePeriodMs;
+    doc["speedMs"] = state.speedMs;
+    doc["tailLength"] = state.tailLength;
+    doc["strobePeriodMs"] = state.strobePeriodMs;
     doc["uptimeMs"] = millis();
 
-    String out;
-    serializeJson(doc, out);
-    _server.send(200, "application/json", out);
+    const PowerLimiter& limiter = _ring.powerLimiter();
+    JsonObject power = doc.createNestedObject("power");
+    power["estimatedMa"] = limiter.estimatedMa();
+    power["requestedMa"] = limiter.requestedMa();
+    power["budgetMa"] = limiter.budgetMa();
+    power["limiting"] = limiter.isLimiting();
+    power["brightnessCap"] = limiter.brightnessCap();
+    power["limitedFrames"] = limiter.limitedFrames();
+
+    JsonObject persist = doc.createNestedObject("persistence");
+    persist["writes"] = _persistence.writeCount();
+    persist["lifetimeWrites"] = _persistence.lifetimeWrites();
+    persist["coalescedChanges"] = _persistence.coalescedChanges();
+
+    JsonObject boot = doc.createNestedObject("boot");
+    boot["firstFrameMs"] = BootTimings::firstFrameMs();
+    boot["wifiConnectedMs"] = BootTimings::wifiConnectedMs();
+    boot["firstPresenceMs"] = BootTimings::firstPresenceMs();
+
+    if (_fleet.isStarted()) {
+        JsonObject fleet = doc.createNestedObject("fleet");
+        char id[9];
+        snprintf(id, sizeof(id), "%08lX", (unsigned long)_fleet.nodeId());
+        fleet["nodeId"] = id;
+        snprintf(id, sizeof(id), "%08lX", (unsigned long)_fleet.leaderId());
+        fleet["leaderId"] = id;
+        fleet["synced"] = _fleet.isSynced();
+        fleet["offsetUs"] = _fleet.offsetUs();
+        fleet["syncErrorUs"] = _fleet.syncErrorUs();
+        fleet["fleetMs"] = _fleet.nowMs();
+        fleet["commandsReceived"] = _fleet.commandsReceived();
+        fleet["lastCommandSeq"] = _fleet.lastCommandSeq();
+        fleet["lastCommandFleetMs"] = _fleet.lastCommandFleetMs();
+    }
+
+    sendJson(doc);
+}
+
+void HttpApi::handleMetrics() {
+    ChunkedResponse out(_server, "text/plain; version=0.0.4");
+    Metrics::writePrometheus(out);
+}
+
+void HttpApi::handleTrace() {
+    if (!Trace::enabled) {
+        _server.send(404, "application/json",
+                     "{\"ok\":false,\"error\":\"Tracing disabled (build with -DTRACE_ENABLED=1)\"}");
+        return;
+    }
+    ChunkedResponse out(_server, "application/json");
+    Trace::writeChromeJson(out);
 }
 
 void HttpApi::handleAnimations() {
     StaticJsonDocument<256> doc;
     JsonArray arr = doc.to<JsonArray>();
-    for (auto* name : _mgr.listNames()) {
-        arr.add(name);
+    for (size_t i = 0; i < _mgr.animationCount(); i++) {
+        arr.add(_mgr.animationName(i));
     }
-    String out;
-    serializeJson(doc, out);
-    _server.send(200, "application/json", out);
+    sendJson(doc);
 }
 
 void HttpApi::handleSetAnimation() {
-    String name;
+    FixedString<AppState::ANIMATION_NAME_LEN - 1> name;
     if (_server.hasArg("name")) {
-        name = _server.arg("name");
+        name.assign(_server.arg("name").c_str());
     } else if (_server.hasArg("plain")) {
         StaticJsonDocument<128> doc;
         if (deserializeJson(doc, _server.arg("plain")) == DeserializationError::Ok) {
-            name = doc["name"] | "";
+            name.assign(doc["name"] | "");
         }
     }
-    if (name.length() == 0) {
+    if (name.isEmpty()) {
         sendError("Missing 'name'");
         return;
     }
-    Commands::setAnimation(_state, _mgr, name);
+    if (!Commands::setAnimation(_commands, name.c_str())) {
+        sendBusy();
+        return;
+    }
     sendOk();
 }
 
@@ -91,45 +215,56 @@ void HttpApi::handleSetBrightness() {
         sendError("Invalid 'value' (0-255)");
         return;
     }
-    Commands::setBrightness(_state, _ring, (uint8_t)val);
+    if (!Commands::setBrightness(_commands, (uint8_t)val)) {
+        sendBusy();
+        return;
+    }
     sendOk();
 }
 
 void HttpApi::handleSetColor() {
-    String colorStr;
+    FixedString<31> colorStr;
     if (_server.hasArg("rgb")) {
-        colorStr = _server.arg("rgb");
+        colorStr.assign(_server.arg("rgb").c_str());
     } else if (_server.hasArg("plain")) {
         StaticJsonDocument<64> doc;
         if (deserializeJson(doc, _server.arg("plain")) == DeserializationError::Ok) {
-            colorStr = doc["rgb"] | "";
+            colorStr.assign(doc["rgb"] | "");
         }
     }
-    if (colorStr.length() == 0) {
+    if (colorStr.isEmpty()) {
         sendError("Missing 'rgb'");
         return;
     }
-    uint32_t color = parseColor(colorStr);
-    Commands::setColor(_state, color);
+    uint32_t color;
+    if (!parseColor(colorStr, color)) {
+        return;
+    }
+    if (!Commands::setColor(_commands, color)) {
+        sendBusy();
+        return;
+    }
     sendOk();
 }
 
 void HttpApi::handleSetPixel() {
     int pos = -1;
-    String colorStr;
+    FixedString<31> colorStr;
 
     if (_server.hasArg("position")) {
         pos = _server.arg("position").toInt();
     }
     if (_server.hasArg("rgb")) {
-        colorStr = _server.arg("rgb");
+        colorStr.assign(_server.arg("rgb").c_str());
     }
 
     if (_server.hasArg("plain")) {
         StaticJsonDocument<128> doc;
         if (deserializeJson(doc, _server.arg("plain")) == DeserializationError::Ok) {
             pos = doc["position"] | pos;
-            colorStr = doc["rgb"] | colorStr;
+            if (const char* rgb = doc["rgb"]) {
+                colorStr.assign(rgb);
+            }
         }
     }
 
@@ -137,14 +272,19 @@ void HttpApi::handleSetPixel() {
         sendError("Invalid 'position' (0-11)");
         return;
     }
-    if (colorStr.length() == 0) {
+    if (colorStr.isEmpty()) {
         sendError("Missing 'rgb'");
         return;
     }
 
-    uint32_t color = parseColor(colorStr);
-    Commands::setColor(_state, (uint16_t)pos, color);
-    Commands::setAnimation(_state, _mgr, "pixels");
+    uint32_t color;
+    if (!parseColor(colorStr, color)) {
+        return;
+    }
+    if (!Commands::setColor(_commands, (uint16_t)pos, color) || !Commands::setAnimation(_commands, "pixels")) {
+        sendBusy();
+        return;
+    }
     sendOk();
 }
 
@@ -154,7 +294,7 @@ void HttpApi::handleSetPixels() {
         return;
     }
 
-    StaticJsonDocument<768> doc;
+    Memory::HttpJsonDocument doc(768);
     if (deserializeJson(doc, _server.arg("plain")) != DeserializationError::Ok) {
         sendError("Invalid JSON");
         return;
@@ -172,19 +312,8 @@ void HttpApi::handleSetPixels() {
 
     Commands::PixelUpdate updates[Config::NUM_PIXELS];
     size_t count = 0;
-
-    for (JsonVariant v : arr) {
-        if (!v.is<JsonObject>()) continue;
-        JsonObject o = v.as<JsonObject>();
-        int pos = o["position"] | -1;
-        String rgb = o["rgb"] | "";
-        if (pos < 0 || pos >= (int)Config::NUM_PIXELS) continue;
-        if (rgb.length() == 0) continue;
-
-        if (count >= Config::NUM_PIXELS) break;
-        updates[count].position = (uint16_t)pos;
-        updates[count].color = parseColor(rgb);
-        count++;
+    if (!readPixelUpdates(arr, updates, count)) {
+        return;
     }
 
     if (count == 0) {
@@ -192,11 +321,80 @@ void HttpApi::handleSetPixels() {
         return;
     }
 
-    Commands::setColors(_state, updates, count);
-    Commands::setAnimation(_state, _mgr, "pixels");
+    if (!Commands::setColors(_commands, updates, count) || !Commands::setAnimation(_commands, "pixels")) {
+        sendBusy();
+        return;
+    }
     sendOk();
 }
 
+void HttpApi::handleFrameBody() {
+    HTTPRaw& raw = _server.raw();
+    switch (raw.status) {
+        case RAW_START: {
+            _frameStarted = true;
+            _frameError = nullptr;
+            const int offset = _server.hasArg("offset") ? _server.arg("offset").toInt() : 0;
+            const int length = _server.hasArg("length") ? _server.arg("length").toInt()
+                                                        : (int)Config::NUM_PIXELS - offset;
+            const String format = _server.hasArg("format") ? _server.arg("format") : String("rgb");
+            FrameDecoder::Encoding encoding;
+
+            if (offset < 0 || length < 1 || offset + length > (int)Config::NUM_PIXELS) {
+                _frameError = "Invalid 'offset'/'length' for this strip";
+            } else if (format != "rgb" && format != "rgbw") {
+                _frameError = "Invalid 'format' (rgb, rgbw)";
+            } else if (!FrameDecoder::parseEncoding(_server.arg("encoding").c_str(), encoding)) {
+                _frameError = "Invalid 'encoding' (raw, rle, delta)";
+            } else {
+                // Start from the current pixels, so delta skips keep what's shown
+                const AppState state = _store.snapshot();
+                memcpy(_frame, state.pixelColors, sizeof(_frame));
+                _frameDecoder.begin(_frame, (uint16_t)offset, (uint16_t)length, format == "rgbw" ? 4 : 3, encoding);
+            }
+            break;
+        }
+        case RAW_WRITE:
+            if (!_frameError && !_frameDecoder.write(raw.buf, raw.currentSize)) {
+                _frameError = _frameDecoder.error();
+            }
+            break;
+        case RAW_END:
+            if (!_frameError && !_frameDecoder.finish()) {
+                _frameError = _frameDecoder.error();
+            }
+            break;
+        case RAW_ABORTED:
+            _frameError = "Upload aborted";
+            break;
+    }
+}
+
+void HttpApi::handleFrame() {
+    if (!_frameStarted) {
+        sendError("Send the frame as an application/octet-stream body");
+        return;
+    }
+    _frameStarted = false;
+    if (_frameError) {
+        sendError(_frameError);
+        return;
+    }
+
+    // The frame goes last: once it is queued, nothing below can still answer 503
+    const uint16_t written = _frameDecoder.pixelsWritten();
+    const uint16_t first = _frameDecoder.firstWritten();
+    if (!Commands::setAnimation(_commands, "pixels") ||
+        (written > 0 && !Commands::setFrame(_commands, _frame, first, _frameDecoder.lastWritten() - first + 1))) {
+        sendBusy();
+        return;
+    }
+
+    FixedString<47> out;
+    out.appendf("{\"ok\":true,\"pixels\":%u}", (unsigned)written);
+    _server.send(200, "application/json", out.c_str());
+}
+
 void HttpApi::handleSetPower() {
     int on = -1;
     if (_server.hasArg("on")) {
@@ -215,7 +413,10 @@ void HttpApi::handleSetPower() {
         sendError("Missing 'on' (true/false)");
         return;
     }
-    Commands::setPower(_state, _ring, on == 1);
+    if (!Commands::setPower(_commands, on == 1)) {
+        sendBusy();
+        return;
+    }
     sendOk();
 }
 
@@ -233,7 +434,10 @@ void HttpApi::handleSetSpeed() {
         sendError("Invalid 'value' (>0)");
         return;
     }
-    Commands::setSpeed(_state, (uint16_t)val);
+    if (!Commands::setSpeed(_commands, (uint16_t)val)) {
+        sendBusy();
+        return;
+    }
     sendOk();
 }
 
@@ -251,7 +455,10 @@ void HttpApi::handleSetTail() {
         sendError("Invalid 'value' (1-12)");
         return;
     }
-    Commands::setTailLength(_state, (uint8_t)val);
+    if (!Commands::setTailLength(_commands, (uint8_t)val)) {
+        sendBusy();
+        return;
+    }
     sendOk();
 }
 
@@ -269,7 +476,165 @@ void HttpApi::handleSetStrobe() {
         sendError("Invalid 'value' (>=10)");
         return;
     }
-    Commands::setStrobePeriod(_state, (uint16_t)val);
+    if (!Commands::setStrobePeriod(_commands, (uint16_t)val)) {
+        sendBusy();
+        return;
+    }
+    sendOk();
+}
+
+void HttpApi::handleGetRules() {
+    Memory::HttpJsonDocument doc(4096);
+    _rules.toJson(doc);
+    sendJson(doc);
+}
+
+void HttpApi::handleSetRules() {
+    if (!_server.hasArg("plain")) {
+        sendError("Missing JSON body");
+        return;
+    }
+
+    Memory::HttpJsonDocument doc(4096);
+    if (deserializeJson(doc, _server.arg("plain")) != DeserializationError::Ok) {
+        sendError("Invalid JSON");
+        return;
+    }
+
+    PresenceRules::Error error;
+    if (!_rules.fromJson(doc.as<JsonVariantConst>(), error)) {
+        sendError(error);
+        return;
+    }
+    sendOk();
+}
+
+void HttpApi::handleResetRules() {
+    _rules.resetDefaults();
+    sendOk();
+}
+
+void HttpApi::handleGetSegments() {
+    Memory::HttpJsonDocument doc(2048);
+    JsonArray arr = doc.to<JsonArray>();
+    for (const Segment& seg : _mgr.segments()) {
+        JsonObject o = arr.createNestedObject();
+        o["name"] = seg.name;
+        o["start"] = seg.start;
+        o["length"] = seg.length;
+        o["reverse"] = seg.reverse;
+        o["mirror"] = seg.mirror;
+        o["brightness"] = seg.brightness;
+        o["animation"] = seg.animation ? seg.animation->name() : "";
+        char colorHex[8];
+        ColorCodec::formatHex(seg.params.primaryColor, colorHex);
+        o["color"] = colorHex;
+        o["speedMs"] = seg.params.speedMs;
+        o["tailLength"] = seg.params.tailLength;
+        o["strobePeriodMs"] = seg.params.strobePeriodMs;
+    }
+    sendJson(doc);
+}
+
+// Segments and rules live outside AppState and are edited here directly rather
+// than queued: handlers run on the loop task between frames, and the next frame
+// picks the change up (see "Command queue" in the README)
+void HttpApi::handleSetSegment() {
+    if (!_server.hasArg("plain")) {
+        sendError("Missing JSON body");
+        return;
+    }
+
+    Memory::HttpJsonDocument doc(1024);
+    if (deserializeJson(doc, _server.arg("plain")) != DeserializationError::Ok) {
+        sendError("Invalid JSON");
+        return;
+    }
+
+    const char* name = doc["name"] | "";
+    if (name[0] == '\0' || strlen(name) >= Segment::NAME_LEN) {
+        sendError("Missing or too long 'name'");
+        return;
+    }
+
+    Segment* existing = _mgr.findSegment(name);
+    const int start = doc["start"] | (existing ? (int)existing->start : -1);
+    const int length = doc["length"] | (existing ? (int)existing->length : -1);
+    if (start < 0 || length < 1 || start + length > (int)_ring.numPixels()) {
+        sendError("Invalid 'start'/'length' for this strip");
+        return;
+    }
+    const char* animation = doc["animation"] | (existing ? "" : "solid");
+    if (animation[0] != '\0') {
+        if (!_mgr.hasAnimation(animation)) {
+            sendError("Unknown 'animation'");
+            return;
+        }
+    }
+
+    // Parse colors before touching the segment, so a bad request changes nothing
+    uint32_t color = 0;
+    if (doc.containsKey("color") && !parseColor(doc["color"] | "", color)) {
+        return;
+    }
+    Commands::PixelUpdate updates[Config::NUM_PIXELS];
+    size_t pixelCount = 0;
+    if (doc["pixels"].is<JsonArray>() && !readPixelUpdates(doc["pixels"].as<JsonArray>(), updates, pixelCount)) {
+        return;
+    }
+
+    Segment* seg = _mgr.upsertSegment(name, _store.snapshot());
+    if (!seg) {
+        sendError("Too many segments");
+        return;
+    }
+    if (animation[0] != '\0') {
+        _mgr.setSegmentAnimation(*seg, animation);
+    }
+
+    seg->start = (uint16_t)start;
+    seg->length = (uint16_t)length;
+    seg->reverse = doc["reverse"] | seg->reverse;
+    seg->mirror = doc["mirror"] | seg->mirror;
+    seg->brightness = doc["brightness"] | seg->brightness;
+
+    AppState& params = seg->params;
+    if (doc.containsKey("color")) {
+        params.primaryColor = color;
+    }
+    params.speedMs = doc["speedMs"] | params.speedMs;
+    params.tailLength = doc["tailLength"] | params.tailLength;
+    params.strobePeriodMs = doc["strobePeriodMs"] | params.strobePeriodMs;
+    if (pixelCount > 0) {
+        Commands::setColors(params, updates, pixelCount);
+    }
+
+    // Re-enter so the animation picks up the new parameters on the next pass
+    if (seg->animation) {
+        seg->animation->onEnter(params);
+    }
+    _mgr.invalidate();
+    sendOk();
+}
+
+void HttpApi::handleDeleteSegment() {
+    FixedString<Segment::NAME_LEN - 1> name;
+    if (_server.hasArg("name")) {
+        name.assign(_server.arg("name").c_str());
+    } else if (_server.hasArg("plain")) {
+        StaticJsonDocument<128> doc;
+        if (deserializeJson(doc, _server.arg("plain")) == DeserializationError::Ok) {
+            name.assign(doc["name"] | "");
+        }
+    }
+    if (name.isEmpty()) {
+        sendError("Missing 'name'");
+        return;
+    }
+    if (!_mgr.removeSegment(name.c_str())) {
+        sendError("Unknown segment");
+        return;
+    }
     sendOk();
 }
 
@@ -277,13 +642,66 @@ void HttpApi::sendOk() {
     _server.send(200, "application/json", "{\"ok\":true}");
 }
 
-void HttpApi::sendError(const String& msg) {
-    String out = "{\"ok\":false,\"error\":\"" + msg + "\"}";
-    _server.send(400, "application/json", out);
+void HttpApi::sendError(const char* msg) {
+    FixedString<160> out;
+    out.append("{\"ok\":false,\"error\":\"");
+    // Messages quote JSON examples and user input, so escape them as a string
+    for (const char* p = msg; *p; p++) {
+        if (*p == '"' || *p == '\\') out.append('\\');
+        out.append((uint8_t)*p < 0x20 ? ' ' : *p);
+    }
+    out.append("\"}");
+    _server.send(400, "application/json", out.c_str());
+}
+
+// The command queue was full and the request's command was dropped; it may
+// have been partly applied, and is safe to repeat
+void HttpApi::sendBusy() {
+    _server.sendHeader("Retry-After", "1");
+    _server.send(503, "application/json", "{\"ok\":false,\"error\":\"Command queue full, retry\"}");
+}
+
+void HttpApi::sendJson(const JsonDocument& doc) {
+    ChunkedResponse out(_server, "application/json");
+    serializeJson(doc, out);
+}
+
+bool HttpApi::parseColor(const char* str, uint32_t& out) {
+    const ColorCodec::Error error = ColorCodec::parse(str, out);
+    if (error != ColorCodec::Error::None) {
+        sendError(ColorCodec::errorString(error));
+        return false;
+    }
+    return true;
 }
 
-uint32_t HttpApi::parseColor(const String& str) {
-    String s = str;
-    if (s.startsWith("#")) s = s.substring(1);
-    return (uint32_t)strtoul(s.c_str(), nullptr, 16);
+bool HttpApi::readPixelUpdates(JsonArray arr, Commands::PixelUpdate* updates, size_t& count) {
+    const char* colors[Config::NUM_PIXELS];
+    count = 0;
+    for (JsonVariant v : arr) {
+        if (!v.is<JsonObject>()) continue;
+        JsonObject o = v.as<JsonObject>();
+        const int pos = o["position"] | -1;
+        const char* rgb = o["rgb"] | "";
+        if (pos < 0 || pos >= (int)Config::NUM_PIXELS || rgb[0] == '\0') continue;
+        if (count >= Config::NUM_PIXELS) break;
+        updates[count].position = (uint16_t)pos;
+        colors[count] = rgb;
+        count++;
+    }
+
+    // Colors go through in one batch so the hex fast path stays hot
+    uint32_t parsed[Config::NUM_PIXELS];
+    ColorCodec::Error error;
+    const size_t bad = ColorCodec::parseBatch(colors, count, parsed, error);
+    if (bad < count) {
+        FixedString<95> msg;
+        msg.appendf("Pixel %u: %s", (unsigned)updates[bad].position, ColorCodec::errorString(error));
+        sendError(msg);
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        updates[i].color = parsed[i];
+    }
+    return true;
 }
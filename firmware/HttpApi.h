@@ -4,37 +4,74 @@
 #include <WiFi.h>
 #include <WebServer.h>
 #include <ArduinoJson.h>
-#include "AppState.h"
+#include "AppStateStore.h"
 #include "AnimationManager.h"
 #include "LedRing.h"
 #include "Commands.h"
+#include "StatePersistence.h"
+#include "FleetSync.h"
+#include "PresenceRules.h"
+#include "FixedString.h"
+#include "FrameDecoder.h"
 
 class HttpApi {
 public:
-    HttpApi(AppState& state, AnimationManager& mgr, LedRing& ring, uint16_t port = 80);
+    HttpApi(AppStateStore& store, CommandQueue& commands, AnimationManager& mgr, LedRing& ring, StatePersistence& persistence,
+            FleetSync& fleet, PresenceRules& rules, uint16_t port = 80);
 
     void begin();
     void poll();
 
 private:
-    AppState& _state;
+    AppStateStore& _store;
+    CommandQueue& _commands;
     AnimationManager& _mgr;
     LedRing& _ring;
+    StatePersistence& _persistence;
+    FleetSync& _fleet;
+    PresenceRules& _rules;
     WebServer _server;
 
+    // POST /frame: the body is decoded into _frame as it arrives, then staged in one go
+    FrameDecoder _frameDecoder;
+    uint32_t _frame[Config::NUM_PIXELS];
+    bool _frameStarted = false;
+    const char* _frameError = nullptr;
+
+    using Handler = void (HttpApi::*)();
+    // Registers a handler and records its latency under the route's metrics
+    void route(const char* path, HTTPMethod method, Handler handler);
+    // As above, with `bodyHandler` called for each chunk of a raw (non-form) body
+    void route(const char* path, HTTPMethod method, Handler handler, Handler bodyHandler);
+
     void handleStatus();
+    void handleMetrics();
+    void handleTrace();
     void handleAnimations();
     void handleSetAnimation();
     void handleSetBrightness();
     void handleSetColor();
     void handleSetPixel();
     void handleSetPixels();
+    void handleFrame();
+    void handleFrameBody();
     void handleSetPower();
     void handleSetSpeed();
     void handleSetTail();
     void handleSetStrobe();
+    void handleGetRules();
+    void handleSetRules();
+    void handleResetRules();
+    void handleGetSegments();
+    void handleSetSegment();
+    void handleDeleteSegment();
 
     void sendOk();
-    void sendError(const String& msg);
-    uint32_t parseColor(const String& str);
+    void sendError(const char* msg);
+    void sendBusy();
+    // Streams `doc` as the response body, without building it in a String
+    void sendJson(const JsonDocument& doc);
+    // Parse helpers send the error response themselves and return false
+    bool parseColor(const char* str, uint32_t& out);
+    bool readPixelUpdates(JsonArray arr, Commands::PixelUpdate* updates, size_t& count);
 };
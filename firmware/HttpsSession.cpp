@@ -0,0 +1,209 @@
+#include "HttpsSession.h"
+#include "Config.h"
+#include "Metrics.h"
+
+static constexpr uint32_t DRAIN_TIMEOUT_MS = 2000;
+static const char* RESPONSE_HEADERS[] = {"Transfer-Encoding"};
+
+void HttpsSession::begin(HTTPClient& http, const char* url, bool keepAlive) {
+    // Host is between "://" and the next ':' or '/'
+    const char* host = strstr(url, "://");
+    host = host ? host + 3 : url;
+    FixedString<63> target;
+    target.append(host, strcspn(host, ":/"));
+
+    const uint32_t nowMs = millis();
+    if (_client.connected() && (target != _host.c_str() || nowMs - _lastUsedMs > Config::TLS_KEEP_ALIVE_IDLE_MS)) {
+        close();
+    }
+    _reused = _client.connected();
+    if (!_reused) {
+        Metrics::tlsHeldBytes = 0;  // A failed request may have dropped it without close()
+        _client.setInsecure();  // TODO: Add proper CA cert for production
+        _freeBeforeConnect = ESP.getFreeHeap();
+    }
+    _host.assign(target.c_str());
+    _keepAlive = keepAlive;
+    _bodyOpen = false;
+
+    // HTTPClient only reuses an open connection when reuse is on and both sides
+    // speak HTTP/1.1; HTTP/1.0 gets an unchunked body and a close after it
+    http.setReuse(keepAlive);
+    http.useHTTP10(!keepAlive);
+    http.collectHeaders(RESPONSE_HEADERS, 1);
+    http.begin(_client, url);
+}
+
+void HttpsSession::openBody(HTTPClient& http) {
+    _bodyOpen = true;
+    if (!_reused) {
+        Metrics::tlsConnects++;
+        // The connection's buffers are all allocated once the response headers are in
+        const uint32_t freeNow = ESP.getFreeHeap();
+        Metrics::tlsConnectionBytes = _freeBeforeConnect > freeNow ? _freeBeforeConnect - freeNow : 0;
+        Metrics::tlsHeldBytes = Metrics::tlsConnectionBytes;
+    } else {
+        Metrics::tlsReuses++;
+    }
+    const uint32_t largest = ESP.getMaxAllocHeap();
+    if (Metrics::tlsLargestFreeBlockLow == 0 || largest < Metrics::tlsLargestFreeBlockLow) {
+        Metrics::tlsLargestFreeBlockLow = largest;
+    }
+
+    Stream& in = http.getStream();
+    Body::Framing framing = Body::Framing::UntilClose;
+    if (http.header("Transfer-Encoding").equalsIgnoreCase("chunked")) {
+        framing = Body::Framing::Chunked;
+    } else if (http.getSize() >= 0) {
+        framing = Body::Framing::Length;
+    }
+    _body.begin(in, framing, http.getSize());
+}
+
+Stream& HttpsSession::body(HTTPClient& http) {
+    if (!_bodyOpen) openBody(http);
+    // HTTP/1.0 bodies run to the close, so the socket can be read directly
+    return _keepAlive ? static_cast<Stream&>(_body) : http.getStream();
+}
+
+void HttpsSession::end(HTTPClient& http) {
+    // A failed request has already stopped the client, so only live ones are drained
+    if (_keepAlive && _client.connected()) {
+        if (!_bodyOpen) openBody(http);
+        if (!_body.drain(DRAIN_TIMEOUT_MS)) {
+            close();
+        }
+    }
+    http.end();
+    if (!_keepAlive || !_client.connected()) {
+        close();
+    }
+    _lastUsedMs = millis();
+}
+
+void HttpsSession::endBurst() {
+    if (!Config::TLS_KEEP_ALIVE_BETWEEN_POLLS) {
+        close();
+    }
+}
+
+void HttpsSession::close() {
+    _client.stop();
+    Metrics::tlsHeldBytes = 0;
+}
+
+// ---------------------------------------------------------------------------
+
+void HttpsSession::Body::begin(Stream& in, Framing framing, int32_t length) {
+    _in = &in;
+    _framing = framing;
+    _chunkSize = 0;
+    _lineBytes = 0;
+    switch (framing) {
+        case Framing::Length:
+            _remaining = (uint32_t)length;
+            _stage = _remaining > 0 ? Stage::Data : Stage::Done;
+            break;
+        case Framing::Chunked:
+            _remaining = 0;
+            _stage = Stage::Size;
+            break;
+        case Framing::UntilClose:
+            _remaining = UINT32_MAX;
+            _stage = Stage::Data;
+            break;
+    }
+}
+
+static int hexValue(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+void HttpsSession::Body::endSizeLine() {
+    if (_chunkSize == 0) {
+        _stage = Stage::Trailer;
+        _lineBytes = 0;
+    } else {
+        _remaining = _chunkSize;
+        _chunkSize = 0;
+        _stage = Stage::Data;
+    }
+}
+
+bool HttpsSession::Body::advance() {
+    while (_stage != Stage::Data && _stage != Stage::Done) {
+        const int c = _in->read();
+        if (c < 0) return false;
+
+        switch (_stage) {
+            case Stage::Size: {
+                const int digit = hexValue(c);
+                if (digit >= 0) {
+                    _chunkSize = _chunkSize * 16 + digit;
+                    break;
+                }
+                _stage = Stage::SizeLine;
+                if (c == '\n') endSizeLine();
+                break;
+            }
+            case Stage::SizeLine:
+                if (c == '\n') endSizeLine();
+                break;
+            case Stage::DataEnd:
+                if (c == '\n') _stage = Stage::Size;
+                break;
+            case Stage::Trailer:
+                if (c == '\n') {
+                    if (_lineBytes == 0) _stage = Stage::Done;
+                    _lineBytes = 0;
+                } else if (c != '\r') {
+                    _lineBytes = 1;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return _stage == Stage::Data;
+}
+
+int HttpsSession::Body::available() {
+    if (!advance()) return 0;
+    const int n = _in->available();
+    return (uint32_t)n < _remaining ? n : (int)_remaining;
+}
+
+int HttpsSession::Body::read() {
+    if (!advance()) return -1;
+    const int c = _in->read();
+    if (c < 0) return -1;
+    if (_framing == Framing::UntilClose) return c;
+
+    if (--_remaining == 0) {
+        _stage = _framing == Framing::Chunked ? Stage::DataEnd : Stage::Done;
+    }
+    return c;
+}
+
+int HttpsSession::Body::peek() {
+    if (!advance()) return -1;
+    return _in->peek();
+}
+
+bool HttpsSession::Body::drain(uint32_t timeoutMs) {
+    // A body without framing can't be finished early; the caller closes instead
+    if (_framing == Framing::UntilClose) return false;
+
+    const uint32_t startMs = millis();
+    while (_stage != Stage::Done) {
+        if (read() < 0) {
+            if (_stage == Stage::Done) break;
+            if (millis() - startMs > timeoutMs) return false;
+            delay(1);
+        }
+    }
+    return true;
+}
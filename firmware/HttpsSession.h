@@ -0,0 +1,89 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include "FixedString.h"
+
+// The one TLS connection the network task uses for Graph and sign-in requests.
+// The WiFiClientSecure (and its mbedTLS context) lives for the whole run. With
+// keep-alive, the requests of one poll share a connection, and endBurst()
+// closes it afterwards so its ~40 KB of record buffers aren't held while idle
+// (unless Config::TLS_KEEP_ALIVE_BETWEEN_POLLS). Only one host is connected at
+// a time: a request to another host closes the current connection first, so
+// there is never more than one set of buffers.
+class HttpsSession {
+public:
+    // Points `http` at `url`. With `keepAlive` the request goes out as HTTP/1.1
+    // and the connection is left open for the next request to the same host;
+    // without it (rare requests, e.g. sign-in) end() closes it.
+    void begin(HTTPClient& http, const char* url, bool keepAlive);
+
+    // Response body after GET()/POST(); reads stop at the end of the body, with
+    // chunked transfer encoding already removed
+    Stream& body(HTTPClient& http);
+
+    // Finishes the request. On a kept-alive connection the rest of the body is
+    // read first so the next response starts at its status line.
+    void end(HTTPClient& http);
+
+    // Call after the last request of a poll: closes the connection unless
+    // Config::TLS_KEEP_ALIVE_BETWEEN_POLLS keeps it for the next one
+    void endBurst();
+
+    // Drops the connection, e.g. after WiFi went away
+    void close();
+
+private:
+    // Reads one HTTP/1.1 body off the socket: up to Content-Length, or through
+    // the last chunk. Never reads into the next response.
+    class Body : public Stream {
+    public:
+        enum class Framing : uint8_t {
+            Length,
+            Chunked,
+            UntilClose      // Neither; the server closes the connection after it
+        };
+
+        void begin(Stream& in, Framing framing, int32_t length);
+        // Reads to the end of the body; false if it didn't arrive in time
+        bool drain(uint32_t timeoutMs);
+
+        int available() override;
+        int read() override;
+        int peek() override;
+        size_t write(uint8_t) override { return 0; }
+
+    private:
+        enum class Stage : uint8_t {
+            Size,           // Chunk size in hex
+            SizeLine,       // Chunk extension, up to LF
+            Data,
+            DataEnd,        // CRLF after the chunk data
+            Trailer,        // After the last chunk; ends at an empty line
+            Done
+        };
+
+        Stream* _in = nullptr;
+        Framing _framing = Framing::Length;
+        Stage _stage = Stage::Done;
+        uint32_t _remaining = 0;    // Data bytes left in the body or current chunk
+        uint32_t _chunkSize = 0;
+        uint8_t _lineBytes = 0;     // Bytes on the current trailer line
+
+        // Consumes framing bytes until data is next (or nothing more has arrived)
+        bool advance();
+        void endSizeLine();
+    };
+
+    WiFiClientSecure _client;
+    FixedString<63> _host;
+    Body _body;
+    bool _keepAlive = false;
+    bool _reused = false;           // Current request went over an already open connection
+    bool _bodyOpen = false;
+    uint32_t _lastUsedMs = 0;
+    uint32_t _freeBeforeConnect = 0;
+
+    void openBody(HTTPClient& http);
+};
@@ -0,0 +1,91 @@
+#include "IdleControl.h"
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_pm.h>
+#include "Config.h"
+#include "Metrics.h"
+
+namespace IdleControl {
+
+static TaskHandle_t s_loopTask = nullptr;
+static std::atomic<uint32_t> s_notifiedUs{0};   // First notify() since the last wait; 0 = none
+static bool s_powerManaged = false;
+
+void begin() {
+    s_loopTask = xTaskGetCurrentTaskHandle();
+
+    // Only succeeds on builds with CONFIG_PM_ENABLE; the stock Arduino core returns ESP_ERR_NOT_SUPPORTED
+    esp_pm_config_esp32s3_t pm = {};
+    pm.max_freq_mhz = Config::CPU_ACTIVE_MHZ;
+    pm.min_freq_mhz = Config::CPU_IDLE_MHZ;
+    pm.light_sleep_enable = true;
+    const esp_err_t err = esp_pm_configure(&pm);
+    s_powerManaged = err == ESP_OK;
+    if (s_powerManaged) {
+        Serial.printf("[Idle] esp_pm: %u-%u MHz, light sleep enabled\n",
+                      (unsigned)Config::CPU_IDLE_MHZ, (unsigned)Config::CPU_ACTIVE_MHZ);
+    } else {
+        Serial.printf("[Idle] esp_pm unavailable (%s), scaling CPU frequency from the loop\n", esp_err_to_name(err));
+    }
+}
+
+static void stamp(uint32_t nowUs) {
+    uint32_t expected = 0;
+    s_notifiedUs.compare_exchange_strong(expected, nowUs ? nowUs : 1);
+}
+
+void notify() {
+    if (!s_loopTask) return;
+    stamp(micros());
+    xTaskNotifyGive(s_loopTask);
+}
+
+void IRAM_ATTR notifyFromIsr() {
+    if (!s_loopTask) return;
+    stamp(micros());
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(s_loopTask, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static void setFrequency(uint32_t mhz) {
+    if (s_powerManaged || getCpuFrequencyMhz() == mhz) return;
+    setCpuFrequencyMhz(mhz);
+}
+
+bool wait(uint32_t ms) {
+    // Long waits mean nothing is animating quickly; short ones need full speed
+    setFrequency(ms >= Config::CPU_DOWNCLOCK_MIN_WAIT_MS ? Config::CPU_IDLE_MHZ : Config::CPU_ACTIVE_MHZ);
+
+    const TickType_t ticks = pdMS_TO_TICKS(ms);
+    if (ticks == 0) {
+        // Nothing to sleep through; still consume a notify that already arrived
+        const bool woken = ulTaskNotifyTake(pdTRUE, 0) > 0;
+        s_notifiedUs.store(0);
+        return woken;
+    }
+
+    const uint32_t startUs = micros();
+    const bool woken = ulTaskNotifyTake(pdTRUE, ticks) > 0;
+    const uint32_t endUs = micros();
+    Metrics::loopIdleUs += endUs - startUs;
+
+    const uint32_t notifiedUs = s_notifiedUs.exchange(0);
+    if (woken) {
+        Metrics::loopWakesByEvent++;
+        // A notify from the previous iteration returns at once and says nothing about wake-up time
+        if (notifiedUs && (int32_t)(notifiedUs - startUs) >= 0) {
+            Metrics::wakeLatency.observe(endUs - notifiedUs);
+        }
+    } else {
+        Metrics::loopWakesByDeadline++;
+    }
+    return woken;
+}
+
+bool powerManaged() {
+    return s_powerManaged;
+}
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Lets the render loop block until its next deadline instead of spinning.
+// Anything that gives the loop new work (queued commands, presence updates,
+// the button) calls notify(), which ends the wait early.
+//
+// CPU frequency: when the build has power management enabled (CONFIG_PM_ENABLE,
+// plus tickless idle for light sleep) esp_pm scales the clock and sleeps on
+// its own. Otherwise the loop drops to Config::CPU_IDLE_MHZ before long waits
+// and goes back to Config::CPU_ACTIVE_MHZ when frames are due close together.
+namespace IdleControl {
+
+// Waits that are never satisfied by a deadline alone
+constexpr uint32_t FOREVER = UINT32_MAX;
+
+// Call from setup(), which runs on the loop task
+void begin();
+
+// Ends the loop's current (or next) wait; safe from any task
+void notify();
+// Same, from an interrupt handler
+void IRAM_ATTR notifyFromIsr();
+
+// Blocks the loop task for up to `ms`; returns true when woken by notify()
+bool wait(uint32_t ms);
+
+// True when esp_pm took over frequency scaling and light sleep
+bool powerManaged();
+
+}
@@ -1,31 +1,143 @@
 #include "LedRing.h"
+#include "Config.h"
+#include "Trace.h"
+#include "IdleControl.h"
+#include "Memory.h"
 
 LedRing::LedRing(uint8_t pin, uint16_t numPixels)
-    : _strip(numPixels, pin, NEO_GRB + NEO_KHZ800) {}
+    : _strip(numPixels, pin, NEO_GRB + NEO_KHZ800)
+    , _limiter(Config::POWER_BUDGET_MA,
+               {Config::LED_MA_RED, Config::LED_MA_GREEN, Config::LED_MA_BLUE, Config::LED_MA_IDLE}) {}
 
 void LedRing::begin() {
+    const size_t channels = (size_t)numPixels() * 3;
+    _frame = static_cast<uint16_t*>(Memory::frames.allocate(channels * sizeof(uint16_t)));
+    _residue = static_cast<uint8_t*>(Memory::frames.allocate(channels));
+    if (!_frame || !_residue) {
+        Serial.println("[LedRing] No frame buffer; nothing will be drawn");
+        _frame = nullptr;
+    } else {
+        memset(_frame, 0, channels * sizeof(uint16_t));
+        memset(_residue, 0, channels);
+    }
     _strip.begin();
     _strip.show();
 }
 
 void LedRing::setBrightness(uint8_t brightness) {
-    _strip.setBrightness(brightness);
+    _brightness = brightness;
 }
 
 void LedRing::clear() {
-    _strip.clear();
+    if (!_frame) return;
+    memset(_frame, 0, (size_t)numPixels() * 3 * sizeof(uint16_t));
+}
+
+void LedRing::loadFrame(const uint16_t* data) {
+    if (!_frame) return;
+    memcpy(_frame, data, (size_t)numPixels() * 3 * sizeof(uint16_t));
 }
 
 void LedRing::setPixelColor(uint16_t index, uint32_t color) {
-    _strip.setPixelColor(index, color);
+    // x * 257 maps 0-255 onto the full 0-65535 range
+    setPixelColor16(index,
+                    ((color >> 16) & 0xFF) * 257,
+                    ((color >> 8) & 0xFF) * 257,
+                    (color & 0xFF) * 257);
 }
 
 void LedRing::setPixelRgb(uint16_t index, uint8_t r, uint8_t g, uint8_t b) {
-    _strip.setPixelColor(index, _strip.Color(r, g, b));
+    setPixelColor16(index, r * 257, g * 257, b * 257);
+}
+
+void LedRing::setPixelColor16(uint16_t index, uint16_t r, uint16_t g, uint16_t b) {
+    if (index >= numPixels() || !_frame) return;
+    uint16_t* p = &_frame[index * 3];
+    p[0] = r;
+    p[1] = g;
+    p[2] = b;
+}
+
+void LedRing::setPixelScaled(uint16_t index, uint32_t color, uint16_t level) {
+    const uint32_t scale = (uint32_t)level + 1;
+    setPixelColor16(index,
+                    (((color >> 16) & 0xFF) * 257 * scale) >> 16,
+                    (((color >> 8) & 0xFF) * 257 * scale) >> 16,
+                    ((color & 0xFF) * 257 * scale) >> 16);
 }
 
 void LedRing::show() {
+    TRACE_SCOPE("LedRing::show");
+    if (!_frame) return;
+    _lastFrameMs = millis();
+    _settled = false;
+    send();
+}
+
+void LedRing::send() {
+    const uint16_t n = numPixels();
+    const bool dither = Config::DITHERING_ENABLED && !_settled;
+    const uint32_t brightness = _limiter.limit(_frame, n, _brightness);
+
+    // Scale to 8.8 fixed point: channel * brightness / 255, exact for full-scale
+    // input (255 * 257 at brightness 255 is 255.0), and 0 at brightness 0.
+    // Then emit the integer part and carry the fraction into the next frame so
+    // the average output matches. The largest value plus residue is 0xFFFF.
+    // Without dithering the value is rounded, and a lit channel stays at least 1.
+    uint8_t out[3];
+    uint8_t fraction = 0;
+    for (uint16_t i = 0; i < n; i++) {
+        for (uint8_t c = 0; c < 3; c++) {
+            const uint32_t idx = i * 3 + c;
+            const uint32_t value = (_frame[idx] * brightness * 256) / 0xFFFF;
+            fraction |= value & 0xFF;
+            if (dither) {
+                const uint32_t acc = value + _residue[idx];
+                out[c] = acc >> 8;
+                _residue[idx] = acc & 0xFF;
+            } else {
+                const uint32_t rounded = (value + 0x80) >> 8;
+                out[c] = rounded == 0 && value != 0 ? 1 : rounded;
+            }
+        }
+        _strip.setPixelColor(i, out[0], out[1], out[2]);
+    }
+    if (brightness == 0 || !dither) {
+        // Start from a clean residue when the ring lights up or dithers again
+        memset(_residue, 0, (size_t)n * 3);
+    }
     _strip.show();
+    _lastShowMs = millis();
+    _showCount++;
+    // Only a fractional channel makes later frames differ from this one
+    _dithering = dither && fraction != 0;
+}
+
+uint32_t LedRing::msUntilRefresh(uint32_t nowMs) const {
+    const uint32_t elapsed = nowMs - _lastShowMs;
+    uint32_t wait = IdleControl::FOREVER;
+    if (_dithering) {
+        wait = elapsed >= Config::DITHER_REFRESH_MS ? 0 : Config::DITHER_REFRESH_MS - elapsed;
+    }
+    if (_limiter.isSettling()) {
+        const uint32_t settle = elapsed >= REFRESH_INTERVAL_MS ? 0 : REFRESH_INTERVAL_MS - elapsed;
+        if (settle < wait) wait = settle;
+    }
+    return wait;
+}
+
+void LedRing::refresh(uint32_t nowMs) {
+    const uint32_t elapsed = nowMs - _lastShowMs;
+    // Dithering only pays while frames change (fades); a static one is sent
+    // rounded one last time so the loop isn't woken every DITHER_REFRESH_MS
+    const bool settle = _dithering && nowMs - _lastFrameMs >= Config::DITHER_SETTLE_MS;
+    const bool due = settle || (_dithering && elapsed >= Config::DITHER_REFRESH_MS) ||
+                     (_limiter.isSettling() && elapsed >= REFRESH_INTERVAL_MS);
+    // Skip rather than block while the previous frame is still latching
+    if (due && _strip.canShow()) {
+        if (settle) _settled = true;
+        send();
+    }
 }
 
 uint16_t LedRing::numPixels() const {
@@ -2,6 +2,7 @@
 
 #include <Arduino.h>
 #include <Adafruit_NeoPixel.h>
+#include "PowerLimiter.h"
 
 class LedRing {
 public:
@@ -12,9 +13,26 @@ public:
     void clear();
     void setPixelColor(uint16_t index, uint32_t color);
     void setPixelRgb(uint16_t index, uint8_t r, uint8_t g, uint8_t b);
+    // 16-bit per channel (0-65535)
+    void setPixelColor16(uint16_t index, uint16_t r, uint16_t g, uint16_t b);
+    // Sets `color` scaled by `level` (0-65535) without losing low-end precision
+    void setPixelScaled(uint16_t index, uint32_t color, uint16_t level);
     void show();
-    
+
+    // The unscaled 16-bit R,G,B frame (numPixels() * 3 values), for FrameCache
+    const uint16_t* frameData() const { return _frame; }
+    void loadFrame(const uint16_t* data);
+
+    // Re-sends the current frame while temporal dithering is active or the
+    // power limiter is still settling. Dithering ends DITHER_SETTLE_MS after the
+    // last show() with one rounded frame.
+    void refresh(uint32_t nowMs);
+    // Milliseconds until refresh() has something to send (IdleControl::FOREVER if not)
+    uint32_t msUntilRefresh(uint32_t nowMs) const;
+
     uint16_t numPixels() const;
+    uint32_t showCount() const { return _showCount; }
+    const PowerLimiter& powerLimiter() const { return _limiter; }
     
     // Utility: pack RGB into uint32_t
     static uint32_t colorRgb(uint8_t r, uint8_t g, uint8_t b);
@@ -22,5 +40,22 @@ public:
     static uint32_t scaleColor(uint32_t color, float factor);
 
 private:
+    static constexpr uint32_t REFRESH_INTERVAL_MS = 20;
+
     Adafruit_NeoPixel _strip;
+    // 16-bit R,G,B per pixel, unscaled; brightness and dithering are applied in show().
+    // Both live in the Memory::frames arena from begin() on.
+    uint16_t* _frame = nullptr;
+    // Per-channel residue carried into the next show() (temporal dithering)
+    uint8_t* _residue = nullptr;
+    uint8_t _brightness = 255;
+    PowerLimiter _limiter;
+    uint32_t _lastShowMs = 0;      // Last send, including refreshes
+    uint32_t _lastFrameMs = 0;     // Last show(), i.e. last new frame
+    uint32_t _showCount = 0;
+    bool _dithering = false;
+    bool _settled = false;          // Frame unchanged for DITHER_SETTLE_MS; sent rounded
+
+    // Scales the frame and sends it, dithered unless settled
+    void send();
 };
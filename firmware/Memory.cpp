@@ -0,0 +1,94 @@
+#include "Memory.h"
+#include "Config.h"
+
+namespace Memory {
+
+// LedRing's 16-bit frame plus 8-bit dither residue per channel, with room for alignment
+Arena frames("frames", Config::NUM_PIXELS * 3 * (sizeof(uint16_t) + sizeof(uint8_t)) + 16, false);
+Arena frameCache("frameCache", 0, true);    // Sized in begin(), by whether PSRAM is present
+Arena netScratch("netScratch", Config::NET_SCRATCH_BYTES, true);
+Arena httpScratch("httpScratch", Config::HTTP_SCRATCH_BYTES, true);
+
+static Arena* const s_arenas[] = {&frames, &frameCache, &netScratch, &httpScratch};
+
+bool Arena::begin() {
+    if (_base || _capacity == 0) {
+        return _base != nullptr;
+    }
+    if (_preferPsram && psramFound()) {
+        _base = static_cast<uint8_t*>(ps_malloc(_capacity));
+        _inPsram = _base != nullptr;
+    }
+    if (!_base) {
+        _base = static_cast<uint8_t*>(malloc(_capacity));
+    }
+    if (!_base) {
+        Serial.printf("[Memory] Can't reserve %u bytes for '%s'\n", (unsigned)_capacity, _name);
+        _capacity = 0;
+        return false;
+    }
+    return true;
+}
+
+void* Arena::allocate(size_t size) {
+    const size_t start = (_used + ALIGN - 1) & ~(ALIGN - 1);
+    if (!_base || start + size > _capacity) {
+        _failures++;
+        return nullptr;
+    }
+    _last = start;
+    _used = start + size;
+    if (_used > _highWater) _highWater = _used;
+    return _base + start;
+}
+
+void* Arena::reallocate(void* ptr, size_t size) {
+    if (!ptr) {
+        return allocate(size);
+    }
+    const size_t offset = static_cast<uint8_t*>(ptr) - _base;
+    if (offset == _last) {
+        if (_last + size > _capacity) {
+            _failures++;
+            return nullptr;
+        }
+        _used = _last + size;
+        if (_used > _highWater) _highWater = _used;
+        return ptr;
+    }
+    // Not the latest block, so its size is unknown; it can't extend past what was in use
+    const size_t available = _used - offset;
+    void* moved = allocate(size);
+    if (moved) {
+        memcpy(moved, ptr, size < available ? size : available);
+    }
+    return moved;
+}
+
+void Arena::rewind(size_t mark) {
+    if (mark < _used) {
+        _used = mark;
+        _last = mark;
+    }
+}
+
+void begin() {
+    frameCache = Arena("frameCache", psramFound() ? Config::FRAME_CACHE_PSRAM_BYTES : Config::FRAME_CACHE_BYTES,
+                       true);
+    for (Arena* a : s_arenas) {
+        if (a->begin()) {
+            Serial.printf("[Memory] %-11s %6u bytes in %s\n", a->name(), (unsigned)a->capacity(),
+                          a->inPsram() ? "PSRAM" : "internal RAM");
+        }
+    }
+}
+
+size_t arenaCount() {
+    return sizeof(s_arenas) / sizeof(s_arenas[0]);
+}
+
+const Arena& arena(size_t index) {
+    return *s_arenas[index];
+}
+
+}
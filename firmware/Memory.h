@@ -0,0 +1,93 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Startup memory plan. Each arena is one block reserved in setup() and carved
+// up by bumping a pointer, so frame buffers and JSON documents never come from
+// the general heap after boot. The render loop allocates nothing; HTTP handlers
+// and the network task still do, through String (WebServer::arg(), bodies) and
+// the WiFi, mbedTLS, WebServer and HTTPClient internals:
+//   frames       LED frame and dither buffers (internal RAM, read every show())
+//   frameCache   FrameCache's period of frames (PSRAM when present)
+//   netScratch   JSON documents on the network task (token, device code)
+//   httpScratch  JSON documents in HTTP handlers on the loop task
+// Scratch arenas are rewound after each network step / HTTP request by a
+// Memory::Scope. An arena that runs out returns nullptr rather than falling
+// back to the heap; ArduinoJson reports that as NoMemory.
+namespace Memory {
+
+class Arena {
+public:
+    constexpr Arena(const char* name, size_t capacity, bool preferPsram)
+        : _name(name), _capacity(capacity), _preferPsram(preferPsram) {}
+
+    // Reserves the block; false if even internal RAM can't fit it
+    bool begin();
+
+    void* allocate(size_t size);
+    // Grows in place when `ptr` is the latest allocation, else moves it
+    void* reallocate(void* ptr, size_t size);
+
+    size_t mark() const { return _used; }
+    void rewind(size_t mark);
+    void reset() { rewind(0); }
+
+    const char* name() const { return _name; }
+    size_t capacity() const { return _capacity; }
+    size_t used() const { return _used; }
+    size_t highWater() const { return _highWater; }
+    uint32_t failures() const { return _failures; }
+    bool inPsram() const { return _inPsram; }
+
+private:
+    static constexpr size_t ALIGN = 8;
+
+    const char* _name;
+    size_t _capacity;
+    bool _preferPsram;
+    bool _inPsram = false;
+    uint8_t* _base = nullptr;
+    size_t _used = 0;
+    size_t _last = 0;               // Offset of the latest allocation
+    size_t _highWater = 0;
+    uint32_t _failures = 0;
+};
+
+extern Arena frames;
+extern Arena frameCache;
+extern Arena netScratch;
+extern Arena httpScratch;
+
+// Call first in setup(), before anything allocates from an arena
+void begin();
+
+size_t arenaCount();
+const Arena& arena(size_t index);
+
+// Rewinds `arena` to where it was when the scope opened
+class Scope {
+public:
+    explicit Scope(Arena& arena) : _arena(arena), _mark(arena.mark()) {}
+    ~Scope() { _arena.rewind(_mark); }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    Arena& _arena;
+    size_t _mark;
+};
+
+// ArduinoJson allocator over an arena; freeing is left to the owning Scope
+template <Arena& A>
+struct JsonAllocator {
+    void* allocate(size_t size) { return A.allocate(size); }
+    void deallocate(void* ptr) { (void)ptr; }
+    void* reallocate(void* ptr, size_t size) { return A.reallocate(ptr, size); }
+};
+
+// Documents for the network task and for HTTP handlers respectively
+using NetJsonDocument = BasicJsonDocument<JsonAllocator<netScratch>>;
+using HttpJsonDocument = BasicJsonDocument<JsonAllocator<httpScratch>>;
+
+}
@@ -0,0 +1,257 @@
+#include "Metrics.h"
+#include <WiFi.h>
+#include <stdarg.h>
+#include "Memory.h"
+
+namespace Metrics {
+
+static constexpr uint32_t BOUNDS_US[Histogram::BUCKETS] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000,
+    25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000
+};
+static const char* const BOUNDS_LABEL[Histogram::BUCKETS] = {
+    "0.00005", "0.0001", "0.00025", "0.0005", "0.001", "0.0025", "0.005", "0.01",
+    "0.025", "0.05", "0.1", "0.25", "0.5", "1", "2.5", "5"
+};
+
+static constexpr uint8_t MAX_HTTP_ROUTES = 24;
+static const char* const SUBSYSTEM_NAMES[(uint8_t)Subsystem::Count] = {
+    "button", "http", "presence", "render"
+};
+
+Histogram loopDuration;
+Histogram wakeLatency;
+Histogram wifiAssociateDuration;
+Histogram wifiIpDuration;
+Histogram wifiConnectDuration;
+uint32_t wifiConnectsDirect = 0;
+uint32_t wifiConnectsScanned = 0;
+uint32_t wifiDirectFallbacks = 0;
+uint32_t tlsConnects = 0;
+uint32_t tlsReuses = 0;
+uint32_t tlsConnectionBytes = 0;
+uint32_t tlsHeldBytes = 0;
+uint32_t tlsLargestFreeBlockLow = 0;
+uint64_t loopIdleUs = 0;
+uint32_t loopWakesByEvent = 0;
+uint32_t loopWakesByDeadline = 0;
+Histogram presencePollDuration;
+uint32_t framesRendered = 0;
+uint32_t framesSkipped = 0;
+uint32_t frameCacheHits = 0;
+uint32_t frameCacheFills = 0;
+uint32_t presencePollFailures = 0;
+uint32_t tokenRefreshes = 0;
+uint32_t tokenRefreshFailures = 0;
+uint32_t tokenRefreshesAhead = 0;
+uint32_t graphUnauthorized = 0;
+uint32_t commandsApplied = 0;
+uint32_t commandsCoalesced = 0;
+std::atomic<uint32_t> commandsDropped{0};
+uint32_t commandQueueDepth = 0;
+uint32_t commandQueueHighWater = 0;
+uint32_t calendarFetches = 0;
+uint32_t calendarFetchFailures = 0;
+uint32_t calendarTransitions = 0;
+uint32_t calendarPollsHeld = 0;
+Histogram audioDspDuration;
+uint32_t audioHops = 0;
+uint32_t audioBeats = 0;
+uint32_t deepSleeps = 0;
+uint32_t deepSleepSeconds = 0;
+uint32_t mqttConnects = 0;
+uint32_t mqttMessagesReceived = 0;
+uint32_t mqttStatesPublished = 0;
+
+static uint64_t s_subsystemUs[(uint8_t)Subsystem::Count] = {0};
+static HttpRoute s_routes[MAX_HTTP_ROUTES];
+static uint8_t s_routeCount = 0;
+
+void Histogram::observe(uint32_t us) {
+    uint8_t i = 0;
+    while (i < BUCKETS && us > BOUNDS_US[i]) i++;
+    _buckets[i]++;
+    _count++;
+    _sumUs += us;
+}
+
+static void appendf(Print& out, const char* fmt, ...) {
+    char line[192];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    out.print(line);
+}
+
+static void writeHeader(Print& out, const char* name, const char* help, const char* type) {
+    appendf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void Histogram::write(Print& out, const char* name, const char* help, const char* labels) const {
+    if (help) writeHeader(out, name, help, "histogram");
+    const char* sep = labels ? "," : "";
+    if (!labels) labels = "";
+
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i < BUCKETS; i++) {
+        cumulative += _buckets[i];
+        appendf(out, "%s_bucket{%s%sle=\"%s\"} %lu\n", name, labels, sep, BOUNDS_LABEL[i], (unsigned long)cumulative);
+    }
+    appendf(out, "%s_bucket{%s%sle=\"+Inf\"} %lu\n", name, labels, sep, (unsigned long)_count);
+    const char* open = *labels ? "{" : "";
+    const char* close = *labels ? "}" : "";
+    appendf(out, "%s_sum%s%s%s %.6f\n", name, open, labels, close, _sumUs / 1e6);
+    appendf(out, "%s_count%s%s%s %lu\n", name, open, labels, close, (unsigned long)_count);
+}
+
+SubsystemTimer::~SubsystemTimer() {
+    addSubsystemTime(_subsystem, micros() - _startUs);
+}
+
+void addSubsystemTime(Subsystem subsystem, uint32_t us) {
+    s_subsystemUs[(uint8_t)subsystem] += us;
+}
+
+HttpRoute* httpRoute(const char* path) {
+    for (uint8_t i = 0; i < s_routeCount; i++) {
+        if (strcmp(s_routes[i].path, path) == 0) return &s_routes[i];
+    }
+    if (s_routeCount >= MAX_HTTP_ROUTES) return nullptr;
+    s_routes[s_routeCount].path = path;
+    return &s_routes[s_routeCount++];
+}
+
+static void writeCounter(Print& out, const char* name, const char* help, uint32_t value) {
+    writeHeader(out, name, help, "counter");
+    appendf(out, "%s %lu\n", name, (unsigned long)value);
+}
+
+static void writeGauge(Print& out, const char* name, const char* help, long value) {
+    writeHeader(out, name, help, "gauge");
+    appendf(out, "%s %ld\n", name, value);
+}
+
+void writePrometheus(Print& out) {
+    loopDuration.write(out, "teamsring_loop_duration_seconds", "Duration of one loop() iteration");
+
+    writeHeader(out, "teamsring_loop_subsystem_seconds_total", "Loop time spent per subsystem", "counter");
+    for (uint8_t i = 0; i < (uint8_t)Subsystem::Count; i++) {
+        appendf(out, "teamsring_loop_subsystem_seconds_total{subsystem=\"%s\"} %.6f\n",
+                SUBSYSTEM_NAMES[i], s_subsystemUs[i] / 1e6);
+    }
+
+    writeHeader(out, "teamsring_loop_idle_seconds_total", "Time the loop spent waiting for its next deadline",
+                "counter");
+    appendf(out, "teamsring_loop_idle_seconds_total %.6f\n", loopIdleUs / 1e6);
+    writeHeader(out, "teamsring_loop_wakes_total", "Loop waits ended by an event or by the deadline", "counter");
+    appendf(out, "teamsring_loop_wakes_total{reason=\"event\"} %lu\n", (unsigned long)loopWakesByEvent);
+    appendf(out, "teamsring_loop_wakes_total{reason=\"deadline\"} %lu\n", (unsigned long)loopWakesByDeadline);
+    wakeLatency.write(out, "teamsring_loop_wake_latency_seconds", "Time from an event to the loop running");
+    writeGauge(out, "teamsring_cpu_frequency_mhz", "Current CPU clock", getCpuFrequencyMhz());
+
+    writeCounter(out, "teamsring_frames_rendered_total", "Animation updates that produced a frame", framesRendered);
+    writeCounter(out, "teamsring_frames_skipped_total", "Animation updates with nothing new to draw", framesSkipped);
+    writeCounter(out, "teamsring_frame_cache_hits_total", "Base animation frames replayed from the frame cache",
+                 frameCacheHits);
+    writeCounter(out, "teamsring_frame_cache_fills_total", "Base animation frames rendered into the frame cache",
+                 frameCacheFills);
+
+    writeCounter(out, "teamsring_commands_applied_total", "Commands applied by the render loop", commandsApplied);
+    writeCounter(out, "teamsring_commands_coalesced_total", "Commands superseded by a later one in the same frame",
+                 commandsCoalesced);
+    writeCounter(out, "teamsring_commands_dropped_total", "Commands dropped because the queue was full",
+                 commandsDropped.load());
+    writeGauge(out, "teamsring_command_queue_depth", "Commands waiting at the last drain", commandQueueDepth);
+    writeGauge(out, "teamsring_command_queue_high_water", "Most commands waiting at one drain", commandQueueHighWater);
+
+    writeCounter(out, "teamsring_calendar_fetches_total", "Calendar view requests", calendarFetches);
+    writeCounter(out, "teamsring_calendar_fetch_failures_total", "Failed calendar view requests",
+                 calendarFetchFailures);
+    writeCounter(out, "teamsring_calendar_transitions_total", "Presence switches made at a meeting start or end",
+                 calendarTransitions);
+    writeCounter(out, "teamsring_calendar_polls_held_total", "Presence polls ignored just after a calendar switch",
+                 calendarPollsHeld);
+
+    writeCounter(out, "teamsring_audio_hops_total", "Microphone hops analysed", audioHops);
+    writeCounter(out, "teamsring_audio_beats_total", "Beats detected", audioBeats);
+    audioDspDuration.write(out, "teamsring_audio_dsp_duration_seconds", "FFT, bands and beat detection per hop");
+
+    writeCounter(out, "teamsring_mqtt_connects_total", "Successful MQTT broker connections", mqttConnects);
+    writeCounter(out, "teamsring_mqtt_messages_received_total", "MQTT command messages received",
+                 mqttMessagesReceived);
+    writeCounter(out, "teamsring_mqtt_states_published_total", "Retained state messages published",
+                 mqttStatesPublished);
+
+    writeHeader(out, "teamsring_http_requests_total", "HTTP requests handled per route", "counter");
+    for (uint8_t i = 0; i < s_routeCount; i++) {
+        appendf(out, "teamsring_http_requests_total{route=\"%s\"} %lu\n",
+                s_routes[i].path, (unsigned long)s_routes[i].latency.count());
+    }
+    for (uint8_t i = 0; i < s_routeCount; i++) {
+        char labels[64];
+        snprintf(labels, sizeof(labels), "route=\"%s\"", s_routes[i].path);
+        s_routes[i].latency.write(out, "teamsring_http_request_duration_seconds",
+                                  i == 0 ? "HTTP handler latency per route" : nullptr, labels);
+    }
+
+    presencePollDuration.write(out, "teamsring_presence_poll_duration_seconds", "Graph presence request latency");
+    writeCounter(out, "teamsring_presence_poll_failures_total", "Failed presence polls", presencePollFailures);
+    wifiAssociateDuration.write(out, "teamsring_wifi_associate_duration_seconds", "WiFi association time");
+    wifiIpDuration.write(out, "teamsring_wifi_ip_duration_seconds", "Association to IP address (DHCP or static)");
+    wifiConnectDuration.write(out, "teamsring_wifi_connect_duration_seconds",
+                              "Whole WiFi connect, including a fallback scan");
+    writeCounter(out, "teamsring_wifi_connects_direct_total", "Connects to the cached AP without a scan",
+                 wifiConnectsDirect);
+    writeCounter(out, "teamsring_wifi_connects_scanned_total", "Connects that scanned for the AP", wifiConnectsScanned);
+    writeCounter(out, "teamsring_wifi_direct_fallbacks_total", "Cached AP didn't answer, fell back to a scan",
+                 wifiDirectFallbacks);
+    writeCounter(out, "teamsring_token_refreshes_total", "Successful access token refreshes", tokenRefreshes);
+    writeCounter(out, "teamsring_token_refresh_failures_total", "Failed access token refreshes", tokenRefreshFailures);
+    writeCounter(out, "teamsring_token_refreshes_ahead_total",
+                 "Token refreshes done in the background before expiry (401s avoided)", tokenRefreshesAhead);
+    writeCounter(out, "teamsring_graph_unauthorized_total", "Graph requests rejected with 401", graphUnauthorized);
+
+    static const struct {
+        const char* name;
+        const char* help;
+        const char* type;
+        size_t (*value)(const Memory::Arena&);
+    } ARENA_METRICS[] = {
+        {"teamsring_arena_capacity_bytes", "Bytes reserved for the arena at boot", "gauge",
+         [](const Memory::Arena& a) { return a.capacity(); }},
+        {"teamsring_arena_used_bytes", "Bytes in use right now", "gauge",
+         [](const Memory::Arena& a) { return a.used(); }},
+        {"teamsring_arena_high_water_bytes", "Most bytes in use at once since boot", "gauge",
+         [](const Memory::Arena& a) { return a.highWater(); }},
+        {"teamsring_arena_failures_total", "Allocations the arena couldn't fit", "counter",
+         [](const Memory::Arena& a) { return (size_t)a.failures(); }},
+    };
+    for (const auto& metric : ARENA_METRICS) {
+        writeHeader(out, metric.name, metric.help, metric.type);
+        for (size_t i = 0; i < Memory::arenaCount(); i++) {
+            const Memory::Arena& arena = Memory::arena(i);
+            appendf(out, "%s{arena=\"%s\",psram=\"%d\"} %lu\n", metric.name, arena.name(), arena.inPsram() ? 1 : 0,
+                    (unsigned long)metric.value(arena));
+        }
+    }
+
+    writeGauge(out, "teamsring_heap_free_bytes", "Current free heap", ESP.getFreeHeap());
+    writeGauge(out, "teamsring_heap_min_free_bytes", "Lowest free heap since boot", ESP.getMinFreeHeap());
+    writeGauge(out, "teamsring_heap_largest_free_block_bytes", "Largest allocatable block", ESP.getMaxAllocHeap());
+    writeCounter(out, "teamsring_tls_connects_total", "TLS handshakes for Graph and sign-in requests", tlsConnects);
+    writeCounter(out, "teamsring_tls_reuses_total", "Requests sent over an already open TLS connection", tlsReuses);
+    writeGauge(out, "teamsring_tls_connection_bytes", "Heap taken by the last TLS connection opened",
+               tlsConnectionBytes);
+    writeGauge(out, "teamsring_tls_held_bytes", "Heap held by the TLS connection open right now", tlsHeldBytes);
+    writeGauge(out, "teamsring_tls_largest_free_block_low_bytes",
+               "Smallest largest-free-block seen during a TLS request", tlsLargestFreeBlockLow);
+    writeGauge(out, "teamsring_wifi_rssi_dbm", "WiFi signal strength (0 when disconnected)",
+               WiFi.status() == WL_CONNECTED ? WiFi.RSSI() : 0);
+    writeCounter(out, "teamsring_deep_sleeps_total", "Off-hours deep sleeps since power-on", deepSleeps);
+    writeCounter(out, "teamsring_deep_sleep_seconds_total", "Time scheduled in deep sleep since power-on",
+                 deepSleepSeconds);
+    writeGauge(out, "teamsring_uptime_seconds", "Seconds since boot", millis() / 1000);
+}
+
+}
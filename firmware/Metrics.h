@@ -0,0 +1,102 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+// Runtime metrics rendered in Prometheus text format on /metrics.
+// Recording is allocation-free: fixed buckets and plain 32/64-bit counters.
+// Each metric has a single writer task; readers may see a value one update stale.
+namespace Metrics {
+
+// Latency histogram with fixed bucket bounds from 50 us to 5 s
+class Histogram {
+public:
+    static constexpr uint8_t BUCKETS = 16;
+
+    void observe(uint32_t us);
+
+    uint32_t count() const { return _count; }
+    void write(Print& out, const char* name, const char* help, const char* labels = nullptr) const;
+
+private:
+    uint32_t _buckets[BUCKETS + 1] = {0};   // Non-cumulative; last slot is +Inf
+    uint32_t _count = 0;
+    uint64_t _sumUs = 0;
+};
+
+enum class Subsystem : uint8_t {
+    Button,
+    Http,
+    Presence,
+    Render,
+    Count
+};
+
+// Adds the elapsed time to a subsystem's share of the loop when it goes out of scope
+class SubsystemTimer {
+public:
+    explicit SubsystemTimer(Subsystem subsystem) : _subsystem(subsystem), _startUs(micros()) {}
+    ~SubsystemTimer();
+
+private:
+    Subsystem _subsystem;
+    uint32_t _startUs;
+};
+
+struct HttpRoute {
+    const char* path = nullptr;
+    Histogram latency;
+};
+
+extern Histogram loopDuration;
+extern Histogram wakeLatency;       // notify() to the loop running again
+extern uint64_t loopIdleUs;         // Time the loop spent blocked in IdleControl::wait()
+extern uint32_t loopWakesByEvent;
+extern uint32_t loopWakesByDeadline;
+extern Histogram presencePollDuration;
+extern Histogram wifiAssociateDuration;      // WiFi.begin() to associated with the AP
+extern Histogram wifiIpDuration;             // Associated to having an IP (DHCP, or static)
+extern Histogram wifiConnectDuration;        // Whole connect, including a fallback scan
+extern uint32_t wifiConnectsDirect;          // Joined the cached AP without scanning
+extern uint32_t wifiConnectsScanned;
+extern uint32_t wifiDirectFallbacks;         // Cached AP didn't answer, fell back to a scan
+extern uint32_t tlsConnects;                 // TLS handshakes made by HttpsSession
+extern uint32_t tlsReuses;                   // Requests sent over an already open connection
+extern uint32_t tlsConnectionBytes;          // Heap taken by the last connection opened
+extern uint32_t tlsHeldBytes;                // Heap held by the connection open now; 0 between polls
+extern uint32_t tlsLargestFreeBlockLow;      // Smallest largest-free-block seen during a request
+extern uint32_t framesRendered;     // Animation updates that produced a frame
+extern uint32_t framesSkipped;      // Animation updates with nothing to draw
+extern uint32_t frameCacheHits;     // Base frames replayed from FrameCache
+extern uint32_t frameCacheFills;    // Base frames rendered into FrameCache
+extern uint32_t presencePollFailures;
+extern uint32_t tokenRefreshes;
+extern uint32_t tokenRefreshFailures;
+extern uint32_t tokenRefreshesAhead;         // Background refreshes before expiry; each is a 401 avoided
+extern uint32_t graphUnauthorized;           // Graph requests rejected with 401 (then refreshed and retried)
+extern uint32_t commandsApplied;
+extern uint32_t commandsCoalesced;           // Overwritten by a later command in the same frame
+extern std::atomic<uint32_t> commandsDropped;   // Queue full; written by any producer task
+extern uint32_t commandQueueDepth;           // Commands waiting at the last drain
+extern uint32_t commandQueueHighWater;
+extern uint32_t calendarFetches;
+extern uint32_t calendarFetchFailures;
+extern uint32_t calendarTransitions;         // Switches made at an event's start or end
+extern uint32_t calendarPollsHeld;           // Poll results ignored while Teams caught up
+extern Histogram audioDspDuration;   // One AudioDsp::process() call
+extern uint32_t audioHops;
+extern uint32_t audioBeats;
+extern uint32_t deepSleeps;                  // Since power-on; survives deep sleep
+extern uint32_t deepSleepSeconds;            // Scheduled sleep time, same lifetime
+extern uint32_t mqttConnects;
+extern uint32_t mqttMessagesReceived;
+extern uint32_t mqttStatesPublished;
+
+void addSubsystemTime(Subsystem subsystem, uint32_t us);
+
+// Returns the slot for `path`, registering it on first use; nullptr when full
+HttpRoute* httpRoute(const char* path);
+
+void writePrometheus(Print& out);
+
+}
@@ -1,22 +1,30 @@
 #include "MicrosoftAuth.h"
-#include <WiFiClientSecure.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
+#include "Config.h"
+#include "Memory.h"
+#include "Metrics.h"
+#include "Trace.h"
+#include "WallClock.h"
 
 static const char* PREFS_NAMESPACE = "msauth";
 static const char* KEY_ACCESS_TOKEN = "access";
 static const char* KEY_REFRESH_TOKEN = "refresh";
-static const char* KEY_EXPIRES_AT = "expires";
+// Unix seconds; the older "expires" key held a millis() value and is ignored
+static const char* KEY_EXPIRES_AT = "expiresUtc";
 
-static const char* SCOPE = "Presence.Read offline_access";
+// Team mode reads other users' presence, which needs the tenant-wide scope;
+// calendar pre-switching reads the user's own calendar
+static const char* SCOPE = Config::TEAM_MODE          ? "Presence.Read Presence.Read.All offline_access"
+                           : Config::CALENDAR_ENABLED ? "Presence.Read Calendars.Read offline_access"
+                                                      : "Presence.Read offline_access";
 
-MicrosoftAuth::MicrosoftAuth(const char* clientId, const char* tenantId)
+MicrosoftAuth::MicrosoftAuth(const char* clientId, const char* tenantId, HttpsSession& session)
     : _clientId(clientId)
     , _tenantId(tenantId)
+    , _session(session)
     , _lastPollTime(0)
 {
-    _tokens = {String(), String(), 0, false};
-    _deviceCode = {String(), String(), String(), 0, 0, false};
 }
 
 bool MicrosoftAuth::begin() {
@@ -26,9 +34,10 @@ bool MicrosoftAuth::begin() {
 }
 
 void MicrosoftAuth::loadTokens() {
-    _tokens.accessToken = _prefs.getString(KEY_ACCESS_TOKEN, "");
-    _tokens.refreshToken = _prefs.getString(KEY_REFRESH_TOKEN, "");
+    _tokens.accessToken.fill([this](char* buf, size_t size) { _prefs.getString(KEY_ACCESS_TOKEN, buf, size); });
+    _tokens.refreshToken.fill([this](char* buf, size_t size) { _prefs.getString(KEY_REFRESH_TOKEN, buf, size); });
     _tokens.expiresAt = _prefs.getULong(KEY_EXPIRES_AT, 0);
+    _tokens.expiresAtMsSet = false;
     _tokens.valid = _tokens.refreshToken.length() > 0;
     
     Serial.printf("[Auth] Loaded tokens - refresh token present: %s\n", 
@@ -36,88 +45,163 @@ void MicrosoftAuth::loadTokens() {
 }
 
 void MicrosoftAuth::saveTokens() {
-    _prefs.putString(KEY_ACCESS_TOKEN, _tokens.accessToken);
-    _prefs.putString(KEY_REFRESH_TOKEN, _tokens.refreshToken);
+    _prefs.putString(KEY_ACCESS_TOKEN, _tokens.accessToken.c_str());
+    _prefs.putString(KEY_REFRESH_TOKEN, _tokens.refreshToken.c_str());
     _prefs.putULong(KEY_EXPIRES_AT, _tokens.expiresAt);
     Serial.println("[Auth] Tokens saved to flash");
 }
 
 void MicrosoftAuth::clearTokens() {
-    _tokens = {String(), String(), 0, false};
+    _tokens = AuthTokens();
     _prefs.clear();
     Serial.println("[Auth] Tokens cleared");
 }
 
-String MicrosoftAuth::buildTokenEndpoint() {
-    return String("https://login.microsoftonline.com/") + _tenantId + "/oauth2/v2.0/token";
+const char* MicrosoftAuth::buildEndpoint(const char* path) {
+    _endpoint.assign("https://login.microsoftonline.com/");
+    _endpoint.append(_tenantId);
+    _endpoint.append(path);
+    return _endpoint.c_str();
 }
 
-String MicrosoftAuth::buildDeviceCodeEndpoint() {
-    return String("https://login.microsoftonline.com/") + _tenantId + "/oauth2/v2.0/devicecode";
+// Copies the token fields out of a successful token response; false if a
+// token doesn't fit, in which case the current tokens are left untouched
+bool MicrosoftAuth::storeTokens(const JsonDocument& doc) {
+    const char* access = doc["access_token"] | "";
+    const char* refresh = doc["refresh_token"] | "";
+    if (access[0] == '\0' || strlen(access) > AuthTokens::ACCESS_TOKEN_LEN ||
+        strlen(refresh) > AuthTokens::REFRESH_TOKEN_LEN) {
+        Serial.printf("[Auth] Token missing or too long (access %u, refresh %u bytes)\n",
+                      (unsigned)strlen(access), (unsigned)strlen(refresh));
+        return false;
+    }
+    _tokens.accessToken.assign(access);
+    if (refresh[0]) {
+        _tokens.refreshToken.assign(refresh);
+    }
+    const uint32_t expiresIn = doc["expires_in"].as<uint32_t>();
+    _tokens.expiresAtMs = millis() + expiresIn * 1000UL;
+    _tokens.expiresAtMsSet = true;
+    // Absolute expiry survives a reboot: the token's own claim, else the clock
+    _tokens.expiresAt = jwtExpiry(access);
+    const uint32_t now = WallClock::now();
+    if (_tokens.expiresAt == 0 && now != 0) {
+        _tokens.expiresAt = now + expiresIn;
+    }
+    _tokens.valid = true;
+    return true;
 }
 
-bool MicrosoftAuth::hasValidToken() {
-    if (_tokens.accessToken.length() == 0) {
-        return false;
+static int8_t base64UrlValue(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '-' || c == '+') return 62;
+    if (c == '_' || c == '/') return 63;
+    return -1;
+}
+
+uint32_t MicrosoftAuth::jwtExpiry(const char* token) {
+    // header.payload.signature; the payload is base64url JSON
+    const char* payload = strchr(token, '.');
+    const char* end = payload ? strchr(payload + 1, '.') : nullptr;
+    if (!end) {
+        return 0;
     }
-    // Check if token expires in the next 5 minutes
-    unsigned long now = millis();
-    if (_tokens.expiresAt > 0 && now > _tokens.expiresAt - 300000) {
-        return false;
+    // Decoded into the request scratch buffer, which is free once a response is in
+    _body.clear();
+    uint32_t bits = 0;
+    uint8_t bitCount = 0;
+    for (const char* p = payload + 1; p < end; p++) {
+        const int8_t value = base64UrlValue(*p);
+        if (value < 0) {
+            return 0;
+        }
+        bits = bits << 6 | (uint8_t)value;
+        bitCount += 6;
+        if (bitCount >= 8) {
+            bitCount -= 8;
+            // A payload too long for the buffer is cut short; exp comes early in practice
+            if (!_body.append((char)(bits >> bitCount & 0xFF))) break;
+        }
+    }
+    const char* claim = strstr(_body.c_str(), "\"exp\":");
+    return claim ? strtoul(claim + 6, nullptr, 10) : 0;
+}
+
+bool MicrosoftAuth::expiryKnown() const {
+    return (_tokens.expiresAt != 0 && WallClock::isSynced()) || _tokens.expiresAtMsSet;
+}
+
+bool MicrosoftAuth::expiresWithin(uint32_t seconds) const {
+    const uint32_t now = WallClock::now();
+    if (_tokens.expiresAt != 0 && now != 0) {
+        return now + seconds >= _tokens.expiresAt;
+    }
+    if (_tokens.expiresAtMsSet) {
+        return (int32_t)(_tokens.expiresAtMs - millis()) <= (int32_t)(seconds * 1000UL);
     }
     return true;
 }
 
-String MicrosoftAuth::getAccessToken() {
+bool MicrosoftAuth::hasValidToken() {
+    return !_tokens.accessToken.isEmpty() && !expiresWithin(Config::TOKEN_EXPIRY_MARGIN_S);
+}
+
+const char* MicrosoftAuth::getAccessToken() {
     if (hasValidToken()) {
-        return _tokens.accessToken;
+        return _tokens.accessToken.c_str();
     }
     
     // Try to refresh if we have a refresh token
-    if (_tokens.refreshToken.length() > 0) {
-        Serial.println("[Auth] Access token expired, attempting refresh...");
+    if (!_tokens.refreshToken.isEmpty()) {
+        Serial.println("[Auth] Access token expired or expiring, refreshing before the request...");
         if (refreshAccessToken()) {
-            return _tokens.accessToken;
+            return _tokens.accessToken.c_str();
         }
     }
     
-    return String();
+    return "";
 }
 
 bool MicrosoftAuth::startDeviceFlow() {
+    TRACE_SCOPE("MicrosoftAuth::startDeviceFlow");
     Serial.println("[Auth] Starting device code flow...");
     
-    WiFiClientSecure client;
-    client.setInsecure();  // TODO: Add proper CA cert for production
-    
+    // Sign-in requests are rare, so the connection isn't kept open after them
     HTTPClient http;
-    http.begin(client, buildDeviceCodeEndpoint());
+    _session.begin(http, buildEndpoint("/oauth2/v2.0/devicecode"), false);
     http.addHeader("Content-Type", "application/x-www-form-urlencoded");
     
-    String body = "client_id=" + String(_clientId) + "&scope=" + String(SCOPE);
+    _body.assign("client_id=");
+    _body.append(_clientId);
+    _body.append("&scope=");
+    _body.append(SCOPE);
     
-    int httpCode = http.POST(body);
+    int httpCode = http.POST(reinterpret_cast<const uint8_t*>(_body.c_str()), _body.length());
     
     if (httpCode != 200) {
         Serial.printf("[Auth] Device code request failed: %d\n", httpCode);
-        Serial.println(http.getString());
-        http.end();
+        http.writeToStream(&Serial);
+        Serial.println();
+        _session.end(http);
         return false;
     }
     
-    String response = http.getString();
-    http.end();
-    
-    DynamicJsonDocument doc(2048);
-    DeserializationError error = deserializeJson(doc, response);
+    Memory::NetJsonDocument doc(2048);
+    DeserializationError error = deserializeJson(doc, _session.body(http));
+    _session.end(http);
     if (error) {
         Serial.printf("[Auth] JSON parse error: %s\n", error.c_str());
         return false;
     }
     
-    _deviceCode.deviceCode = doc["device_code"].as<String>();
-    _deviceCode.userCode = doc["user_code"].as<String>();
-    _deviceCode.verificationUri = doc["verification_uri"].as<String>();
+    if (!_deviceCode.deviceCode.assign(doc["device_code"] | "")) {
+        Serial.println("[Auth] Device code too long");
+        return false;
+    }
+    _deviceCode.userCode.assign(doc["user_code"] | "");
+    _deviceCode.verificationUri.assign(doc["verification_uri"] | "");
     _deviceCode.expiresIn = doc["expires_in"].as<int>();
     _deviceCode.interval = doc["interval"].as<int>();
     _deviceCode.valid = true;
@@ -140,60 +224,53 @@ bool MicrosoftAuth::pollForToken() {
     
     // Respect polling interval
     unsigned long now = millis();
-    if (_lastPollTime > 0 && (now - _lastPollTime) < (_deviceCode.interval * 1000)) {
+    if (_lastPollTime > 0 && (now - _lastPollTime) < (unsigned long)(_deviceCode.interval * 1000)) {
         return false;
     }
+    TRACE_SCOPE("MicrosoftAuth::pollForToken");
     _lastPollTime = now;
     
-    WiFiClientSecure client;
-    client.setInsecure();
-    
     HTTPClient http;
-    http.begin(client, buildTokenEndpoint());
+    _session.begin(http, buildEndpoint("/oauth2/v2.0/token"), false);
     http.addHeader("Content-Type", "application/x-www-form-urlencoded");
     
-    String body = "grant_type=urn%3Aietf%3Aparams%3Aoauth%3Agrant-type%3Adevice_code";
-    body += "&client_id=" + String(_clientId);
-    body += "&device_code=" + _deviceCode.deviceCode;
-    
-    int httpCode = http.POST(body);
-    String response = http.getString();
-    
-    // Debug: print the response for troubleshooting
-    if (httpCode != 200) {
-        Serial.printf("[Auth] Token poll response (%d): %s\n", httpCode, response.c_str());
-    }
+    _body.assign("grant_type=urn%3Aietf%3Aparams%3Aoauth%3Agrant-type%3Adevice_code");
+    _body.append("&client_id=");
+    _body.append(_clientId);
+    _body.append("&device_code=");
+    _body.append(_deviceCode.deviceCode);
     
-    http.end();
+    int httpCode = http.POST(reinterpret_cast<const uint8_t*>(_body.c_str()), _body.length());
     
-    DynamicJsonDocument doc(6144);  // Token response can be ~4KB with JWTs
-    DeserializationError error = deserializeJson(doc, response);
+    // Pending/slow_down come back as 400 with a JSON error body, so parse either way
+    Memory::NetJsonDocument doc(6144);  // Token response can be ~4KB with JWTs
+    DeserializationError error = deserializeJson(doc, _session.body(http));
+    _session.end(http);
     if (error) {
-        Serial.printf("[Auth] JSON parse error: %s\n", error.c_str());
+        Serial.printf("[Auth] Token poll (%d) JSON parse error: %s\n", httpCode, error.c_str());
         return false;
     }
     
     if (doc.containsKey("error")) {
-        String errorCode = doc["error"].as<String>();
-        if (errorCode == "authorization_pending") {
+        const char* errorCode = doc["error"] | "";
+        if (strcmp(errorCode, "authorization_pending") == 0) {
             // User hasn't completed auth yet, keep polling
             return false;
-        } else if (errorCode == "slow_down") {
+        } else if (strcmp(errorCode, "slow_down") == 0) {
             _deviceCode.interval += 5;
             return false;
         } else {
-            Serial.printf("[Auth] Token error: %s\n", errorCode.c_str());
+            Serial.printf("[Auth] Token error (%d): %s\n", httpCode, errorCode);
             _deviceCode.valid = false;
             return false;
         }
     }
     
     // Success!
-    _tokens.accessToken = doc["access_token"].as<String>();
-    _tokens.refreshToken = doc["refresh_token"].as<String>();
-    int expiresIn = doc["expires_in"].as<int>();
-    _tokens.expiresAt = millis() + (expiresIn * 1000UL);
-    _tokens.valid = true;
+    if (!storeTokens(doc)) {
+        _deviceCode.valid = false;
+        return false;
+    }
     _deviceCode.valid = false;
     
     saveTokens();
@@ -203,52 +280,62 @@ bool MicrosoftAuth::pollForToken() {
 }
 
 bool MicrosoftAuth::refreshAccessToken() {
-    if (_tokens.refreshToken.length() == 0) {
+    TRACE_SCOPE("MicrosoftAuth::refreshAccessToken");
+    if (_tokens.refreshToken.isEmpty()) {
         return false;
     }
     
     Serial.println("[Auth] Refreshing access token...");
     
-    WiFiClientSecure client;
-    client.setInsecure();
-    
     HTTPClient http;
-    http.begin(client, buildTokenEndpoint());
+    _session.begin(http, buildEndpoint("/oauth2/v2.0/token"), false);
     http.addHeader("Content-Type", "application/x-www-form-urlencoded");
     
-    String body = "grant_type=refresh_token";
-    body += "&client_id=" + String(_clientId);
-    body += "&refresh_token=" + _tokens.refreshToken;
-    body += "&scope=" + String(SCOPE);
+    _body.assign("grant_type=refresh_token");
+    _body.append("&client_id=");
+    _body.append(_clientId);
+    _body.append("&refresh_token=");
+    _body.append(_tokens.refreshToken);
+    _body.append("&scope=");
+    _body.append(SCOPE);
     
-    int httpCode = http.POST(body);
-    String response = http.getString();
-    http.end();
+    int httpCode = http.POST(reinterpret_cast<const uint8_t*>(_body.c_str()), _body.length());
     
     if (httpCode != 200) {
-        Serial.printf("[Auth] Refresh failed: %d\n", httpCode);
-        Serial.println(response);
-        // Clear tokens if refresh fails - will need to re-auth
-        clearTokens();
+        Metrics::tokenRefreshFailures++;
+        // Only a rejected refresh token means signing in again. Timeouts, 5xx and
+        // throttling keep the tokens, so NetworkTask retries after TOKEN_REFRESH_RETRY_MS.
+        const char* errorCode = "";
+        StaticJsonDocument<16> filter;
+        filter["error"] = true;
+        StaticJsonDocument<96> doc;
+        if (httpCode == 400 &&
+            !deserializeJson(doc, _session.body(http), DeserializationOption::Filter(filter))) {
+            errorCode = doc["error"] | "";
+        }
+        _session.end(http);
+        Serial.printf("[Auth] Refresh failed: %d %s\n", httpCode, errorCode);
+        if (strcmp(errorCode, "invalid_grant") == 0) {
+            clearTokens();
+        }
         return false;
     }
     
-    DynamicJsonDocument doc(6144);  // Token response can be ~4KB with JWTs
-    DeserializationError error = deserializeJson(doc, response);
+    Memory::NetJsonDocument doc(6144);  // Token response can be ~4KB with JWTs
+    DeserializationError error = deserializeJson(doc, _session.body(http));
+    _session.end(http);
     if (error) {
         Serial.printf("[Auth] JSON parse error: %s\n", error.c_str());
         return false;
     }
     
-    _tokens.accessToken = doc["access_token"].as<String>();
-    if (doc.containsKey("refresh_token")) {
-        _tokens.refreshToken = doc["refresh_token"].as<String>();
+    if (!storeTokens(doc)) {
+        Metrics::tokenRefreshFailures++;
+        return false;
     }
-    int expiresIn = doc["expires_in"].as<int>();
-    _tokens.expiresAt = millis() + (expiresIn * 1000UL);
-    _tokens.valid = true;
     
     saveTokens();
+    Metrics::tokenRefreshes++;
     Serial.println("[Auth] Token refreshed successfully");
     
     return true;
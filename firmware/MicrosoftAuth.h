@@ -2,37 +2,59 @@
 
 #include <Arduino.h>
 #include <Preferences.h>
+#include <ArduinoJson.h>
+#include "FixedString.h"
+#include "HttpsSession.h"
 
 struct AuthTokens {
-    String accessToken;
-    String refreshToken;
-    unsigned long expiresAt;  // millis() timestamp when access token expires
-    bool valid;
+    // NVS strings top out at 4000 bytes including the terminator
+    static constexpr size_t ACCESS_TOKEN_LEN = 3999;
+    static constexpr size_t REFRESH_TOKEN_LEN = 2047;
+
+    FixedString<ACCESS_TOKEN_LEN> accessToken;
+    FixedString<REFRESH_TOKEN_LEN> refreshToken;
+    uint32_t expiresAt = 0;         // Unix seconds (UTC) when the access token expires; 0 if unknown
+    uint32_t expiresAtMs = 0;       // millis() deadline from expires_in; this boot only, never saved
+    bool expiresAtMsSet = false;
+    bool valid = false;
 };
 
 struct DeviceCodeResponse {
-    String deviceCode;
-    String userCode;
-    String verificationUri;
-    int expiresIn;
-    int interval;
-    bool valid;
+    FixedString<511> deviceCode;
+    FixedString<15> userCode;
+    FixedString<63> verificationUri;
+    int expiresIn = 0;
+    int interval = 0;
+    bool valid = false;
 };
 
 class MicrosoftAuth {
 public:
-    MicrosoftAuth(const char* clientId, const char* tenantId);
+    MicrosoftAuth(const char* clientId, const char* tenantId, HttpsSession& session);
     
     bool begin();
     
+    // True when an access token is held and isn't within TOKEN_EXPIRY_MARGIN_S of expiring
     bool hasValidToken();
+
+    // A refresh token is held, so an access token can be had without the device flow
+    bool isSignedIn() const { return !_tokens.refreshToken.isEmpty(); }
+
+    // Whether the access token expires within `seconds`. True when its expiry can't
+    // be told (no wall clock yet and the token came from flash), so callers refresh.
+    bool expiresWithin(uint32_t seconds) const;
+    bool expiryKnown() const;
     
-    String getAccessToken();
+    // Empty string when there is no usable token. Points into this object, so
+    // it stays valid until the next refresh.
+    const char* getAccessToken();
     
     bool startDeviceFlow();
     
     bool pollForToken();
     
+    // A 400 invalid_grant (refresh token revoked or expired) clears the tokens, so
+    // the device flow is needed again; any other failure keeps them for a retry
     bool refreshAccessToken();
     
     void clearTokens();
@@ -42,6 +64,7 @@ public:
 private:
     const char* _clientId;
     const char* _tenantId;
+    HttpsSession& _session;
     
     Preferences _prefs;
     AuthTokens _tokens;
@@ -51,6 +74,12 @@ private:
     void loadTokens();
     void saveTokens();
     
-    String buildTokenEndpoint();
-    String buildDeviceCodeEndpoint();
+    // Request scratch space, kept off the network task's stack
+    FixedString<128> _endpoint;
+    FixedString<AuthTokens::REFRESH_TOKEN_LEN + 512> _body;
+
+    const char* buildEndpoint(const char* path);
+    bool storeTokens(const JsonDocument& doc);
+    // The `exp` claim of a JWT access token; 0 for opaque tokens
+    uint32_t jwtExpiry(const char* token);
 };
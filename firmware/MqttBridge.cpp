@@ -0,0 +1,233 @@
+#include "MqttBridge.h"
+#include <ArduinoJson.h>
+#include "ColorCodec.h"
+#include "Commands.h"
+#include "Config.h"
+#include "Metrics.h"
+
+namespace {
+
+bool parseBool(const char* value, bool& out) {
+    if (strcmp(value, "on") == 0 || strcmp(value, "true") == 0 || strcmp(value, "1") == 0) {
+        out = true;
+        return true;
+    }
+    if (strcmp(value, "off") == 0 || strcmp(value, "false") == 0 || strcmp(value, "0") == 0) {
+        out = false;
+        return true;
+    }
+    return false;
+}
+
+bool parseInt(const char* value, long& out) {
+    char* end = nullptr;
+    out = strtol(value, &end, 10);
+    return end != value && *end == '\0';
+}
+
+}
+
+MqttBridge::MqttBridge(AppStateStore& store, CommandQueue& commands)
+    : _store(store), _commands(commands), _client(_net) {}
+
+void MqttBridge::start() {
+    begin();
+    // Core 0 next to the network task; commands reach the render loop through the queue
+    xTaskCreatePinnedToCore(taskEntry, "mqtt", TASK_STACK_BYTES, this, 1, &_task, 0);
+}
+
+void MqttBridge::begin() {
+    // Low three MAC bytes identify the device, as in its default hostname
+    char deviceId[7];
+    snprintf(deviceId, sizeof(deviceId), "%06lX", (unsigned long)(ESP.getEfuseMac() >> 24) & 0xFFFFFF);
+    snprintf(_clientId, sizeof(_clientId), "teamsring-%s", deviceId);
+    snprintf(_baseTopic, sizeof(_baseTopic), "%s/%s", Config::MQTT_TOPIC_PREFIX, deviceId);
+    snprintf(_statusTopic, sizeof(_statusTopic), "%s/status", _baseTopic);
+    snprintf(_stateTopic, sizeof(_stateTopic), "%s/state", _baseTopic);
+
+    _client.setServer(Config::MQTT_HOST, Config::MQTT_PORT);
+    _client.setKeepAlive(KEEPALIVE_S);
+    _client.setSocketTimeout(2);
+    _client.setBufferSize(BUFFER_BYTES);
+    _client.setCallback([this](char* topic, uint8_t* payload, unsigned int length) {
+        handleMessage(topic, payload, length);
+    });
+}
+
+void MqttBridge::taskEntry(void* arg) {
+    MqttBridge* self = static_cast<MqttBridge*>(arg);
+    for (;;) {
+        self->step(millis());
+        vTaskDelay(pdMS_TO_TICKS(STEP_INTERVAL_MS));
+    }
+}
+
+void MqttBridge::step(uint32_t nowMs) {
+    if (WiFi.status() != WL_CONNECTED) {
+        _connected.store(false);
+        return;
+    }
+
+    if (!_client.connected()) {
+        if (_connected.exchange(false)) {
+            Serial.printf("[MQTT] Disconnected (state %d)\n", _client.state());
+        }
+        if ((int32_t)(nowMs - _nextAttemptMs) < 0) {
+            return;
+        }
+        if (!connect()) {
+            _nextAttemptMs = millis() + _retryDelayMs;
+            _retryDelayMs = _retryDelayMs < RETRY_MAX_MS / 2 ? _retryDelayMs * 2 : RETRY_MAX_MS;
+            return;
+        }
+        _retryDelayMs = RETRY_MIN_MS;
+        _statePending = true;   // A fresh session always republishes the retained state
+        _connected.store(true);
+    }
+
+    _client.loop();
+    publishState(nowMs);
+}
+
+bool MqttBridge::connect() {
+    Serial.printf("[MQTT] Connecting to %s:%u as %s\n", Config::MQTT_HOST, Config::MQTT_PORT, _clientId);
+    const char* user = Config::MQTT_USER[0] ? Config::MQTT_USER : nullptr;
+    const char* pass = Config::MQTT_USER[0] ? Config::MQTT_PASS : nullptr;
+    // Last will marks the device offline if the connection drops without a DISCONNECT
+    if (!_client.connect(_clientId, user, pass, _statusTopic, 0, true, "offline")) {
+        Serial.printf("[MQTT] Connect failed (state %d), retry in %lu ms\n",
+                      _client.state(), (unsigned long)_retryDelayMs);
+        return false;
+    }
+
+    char topic[TOPIC_LEN];
+    snprintf(topic, sizeof(topic), "%s/set/#", _baseTopic);
+    _client.subscribe(topic, 0);
+    snprintf(topic, sizeof(topic), "%s/all/set/#", Config::MQTT_TOPIC_PREFIX);
+    _client.subscribe(topic, 0);
+    _client.publish(_statusTopic, "online", true);
+
+    Metrics::mqttConnects++;
+    Serial.printf("[MQTT] Connected, base topic %s\n", _baseTopic);
+    return true;
+}
+
+void MqttBridge::publishState(uint32_t nowMs) {
+    if (!_statePending && _store.changesSince(_publishedSequence) == 0) {
+        return;
+    }
+    _statePending = true;
+    if (nowMs - _lastPublishMs < PUBLISH_INTERVAL_MS) {
+        return;
+    }
+
+    uint32_t sequence = 0;
+    const AppState state = _store.snapshot(sequence);
+    StaticJsonDocument<256> doc;
+    doc["powerOn"] = state.powerOn;
+    doc["brightness"] = state.brightness;
+    char colorHex[8];
+    ColorCodec::formatHex(state.primaryColor, colorHex);
+    doc["color"] = colorHex;
+    doc["animation"] = state.animation;
+    doc["speedMs"] = state.speedMs;
+    doc["tailLength"] = state.tailLength;
+    doc["strobePeriodMs"] = state.strobePeriodMs;
+    doc["sequence"] = sequence;
+
+    char payload[BUFFER_BYTES - TOPIC_LEN];
+    const size_t length = serializeJson(doc, payload, sizeof(payload));
+    if (_client.publish(_stateTopic, reinterpret_cast<const uint8_t*>(payload), length, true)) {
+        _publishedSequence = sequence;
+        _lastPublishMs = nowMs;
+        _statePending = false;
+        Metrics::mqttStatesPublished++;
+    }
+}
+
+void MqttBridge::handleMessage(const char* topic, const uint8_t* payload, unsigned int length) {
+    Metrics::mqttMessagesReceived++;
+
+    char value[128];
+    if (length >= sizeof(value)) {
+        Serial.printf("[MQTT] Payload too long on %s\n", topic);
+        return;
+    }
+    memcpy(value, payload, length);
+    value[length] = '\0';
+
+    // Topic is <base>/set[/<field>] or <prefix>/all/set[/<field>]
+    const char* set = strstr(topic + strlen(Config::MQTT_TOPIC_PREFIX), "/set");
+    if (!set) return;
+    const char* field = set + 4;
+
+    if (*field == '/') {
+        applyField(field + 1, value);
+        return;
+    }
+
+    // Bare .../set takes a JSON object, so several fields change in one message
+    StaticJsonDocument<256> doc;
+    if (deserializeJson(doc, value) != DeserializationError::Ok || !doc.is<JsonObject>()) {
+        Serial.printf("[MQTT] Expected JSON object on %s\n", topic);
+        return;
+    }
+    char scratch[32];
+    for (JsonPair kv : doc.as<JsonObject>()) {
+        if (kv.value().is<bool>()) {
+            strlcpy(scratch, kv.value().as<bool>() ? "on" : "off", sizeof(scratch));
+        } else if (kv.value().is<long>()) {
+            snprintf(scratch, sizeof(scratch), "%ld", kv.value().as<long>());
+        } else {
+            strlcpy(scratch, kv.value() | "", sizeof(scratch));
+        }
+        applyField(kv.key().c_str(), scratch);
+    }
+}
+
+void MqttBridge::applyField(const char* field, const char* value) {
+    long number = 0;
+    bool on = false;
+
+    if (strcmp(field, "power") == 0) {
+        if (strcmp(value, "toggle") == 0) {
+            Commands::togglePower(_commands);
+        } else if (parseBool(value, on)) {
+            Commands::setPower(_commands, on);
+        } else {
+            Serial.printf("[MQTT] Invalid power '%s'\n", value);
+        }
+    } else if (strcmp(field, "brightness") == 0) {
+        if (parseInt(value, number) && number >= 0 && number <= 255) {
+            Commands::setBrightness(_commands, (uint8_t)number);
+        } else {
+            Serial.printf("[MQTT] Invalid brightness '%s' (0-255)\n", value);
+        }
+    } else if (strcmp(field, "color") == 0) {
+        uint32_t color;
+        const ColorCodec::Error error = ColorCodec::parse(value, color);
+        if (error == ColorCodec::Error::None) {
+            Commands::setColor(_commands, color);
+        } else {
+            Serial.printf("[MQTT] Invalid color '%s': %s\n", value, ColorCodec::errorString(error));
+        }
+    } else if (strcmp(field, "animation") == 0) {
+        if (value[0] != '\0' && strlen(value) < AppState::ANIMATION_NAME_LEN) {
+            Commands::setAnimation(_commands, value);
+        }
+    } else if (strcmp(field, "speed") == 0) {
+        if (parseInt(value, number) && number >= 1 && number <= 65535) {
+            Commands::setSpeed(_commands, (uint16_t)number);
+        }
+    } else if (strcmp(field, "tail") == 0) {
+        if (parseInt(value, number) && number >= 1 && number <= 12) {
+            Commands::setTailLength(_commands, (uint8_t)number);
+        }
+    } else if (strcmp(field, "strobe") == 0) {
+        if (parseInt(value, number) && number >= 10 && number <= 65535) {
+            Commands::setStrobePeriod(_commands, (uint16_t)number);
+        }
+    } else {
+        Serial.printf("[MQTT] Unknown field '%s'\n", field);
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "AppStateStore.h"
+#include "CommandQueue.h"
+
+// Optional MQTT control channel. Keeps one persistent broker connection on a
+// background task, turns messages on <prefix>/<id>/set/<field> (and the
+// fleet-wide <prefix>/all/set/<field>) into queued commands, and publishes
+// the state as a retained JSON message on <prefix>/<id>/state whenever it
+// changes. Everything is QoS 0: a lost command is superseded by the next one.
+class MqttBridge {
+public:
+    static constexpr uint32_t STEP_INTERVAL_MS = 5;
+    static constexpr uint32_t RETRY_MIN_MS = 1000;          // Reconnect backoff, doubling up to RETRY_MAX_MS
+    static constexpr uint32_t RETRY_MAX_MS = 30000;
+    static constexpr uint32_t PUBLISH_INTERVAL_MS = 50;     // Coalesces bursts of state changes
+
+    MqttBridge(AppStateStore& store, CommandQueue& commands);
+
+    // Sets up the client and topics, then starts the task; it waits for WiFi
+    // and reconnects to the broker on its own
+    void start();
+
+    // start() without the task, for driving step() directly (host tests)
+    void begin();
+    // One pass of the task: connect or back off, deliver messages, publish state
+    void step(uint32_t nowMs);
+
+    bool isConnected() const { return _connected.load(); }
+    const char* baseTopic() const { return _baseTopic; }
+
+private:
+    static constexpr uint32_t TASK_STACK_BYTES = 6144;
+    static constexpr uint16_t KEEPALIVE_S = 30;
+    static constexpr uint16_t BUFFER_BYTES = 512;
+    static constexpr size_t TOPIC_LEN = 64;
+
+    AppStateStore& _store;
+    CommandQueue& _commands;
+    WiFiClient _net;
+    PubSubClient _client;
+
+    TaskHandle_t _task = nullptr;
+    std::atomic<bool> _connected{false};
+    char _clientId[24] = {0};
+    char _baseTopic[TOPIC_LEN - 8] = {0};  // Leaves room for the longest suffix, "/status"
+    char _statusTopic[TOPIC_LEN] = {0};
+    char _stateTopic[TOPIC_LEN] = {0};
+
+    uint32_t _nextAttemptMs = 0;
+    uint32_t _retryDelayMs = RETRY_MIN_MS;
+    uint32_t _publishedSequence = 0;
+    uint32_t _lastPublishMs = 0;
+    bool _statePending = true;
+
+    static void taskEntry(void* arg);
+    bool connect();
+    void publishState(uint32_t nowMs);
+    void handleMessage(const char* topic, const uint8_t* payload, unsigned int length);
+    void applyField(const char* field, const char* value);
+};
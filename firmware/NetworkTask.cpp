@@ -0,0 +1,289 @@
+#include "NetworkTask.h"
+#include <WiFi.h>
+#include "BootTimings.h"
+#include "Config.h"
+#include "IdleControl.h"
+#include "Memory.h"
+#include "Metrics.h"
+#include "WallClock.h"
+
+NetworkTask::NetworkTask(MicrosoftAuth& auth, TeamsPresence& presence, HttpsSession& session, const char* ssid,
+                         const char* pass)
+    : _auth(auth), _presence(presence), _session(session), _ssid(ssid), _pass(pass) {}
+
+void NetworkTask::start() {
+    _presenceQueue = xQueueCreate(1, sizeof(PresenceStatus));
+    if (Config::TEAM_MODE) {
+        _memberQueue = xQueueCreate(Config::TEAM_MEMBER_COUNT, sizeof(MemberPresence));
+    }
+    // Core 0 alongside the WiFi stack; the Arduino loop runs on core 1
+    xTaskCreatePinnedToCore(taskEntry, "net", TASK_STACK_BYTES, this, 1, &_task, 0);
+}
+
+bool NetworkTask::takePresence(PresenceStatus& out) {
+    return _presenceQueue && xQueueReceive(_presenceQueue, &out, 0) == pdTRUE;
+}
+
+bool NetworkTask::takeMemberPresence(MemberPresence& out) {
+    return _memberQueue && xQueueReceive(_memberQueue, &out, 0) == pdTRUE;
+}
+
+void NetworkTask::taskEntry(void* arg) {
+    NetworkTask* self = static_cast<NetworkTask*>(arg);
+    self->_wifi.begin(self->_ssid, self->_pass);
+    self->beginConnect(millis());
+    for (;;) {
+        self->step(millis());
+        vTaskDelay(pdMS_TO_TICKS(STEP_INTERVAL_MS));
+    }
+}
+
+void NetworkTask::beginConnect(uint32_t nowMs) {
+    _wifi.connect(nowMs);
+    _phase = Phase::Connecting;
+    _phaseStartMs = nowMs;
+}
+
+void NetworkTask::step(uint32_t nowMs) {
+    // Auth and Graph JSON documents last at most one step
+    Memory::Scope scratch(Memory::netScratch);
+    switch (_phase) {
+        case Phase::Connecting:
+            switch (_wifi.poll(nowMs)) {
+                case WifiConnector::Result::Connected:
+                    onConnected(nowMs);
+                    break;
+                case WifiConnector::Result::Failed:
+                    Serial.println("[Net] WiFi connect timed out");
+                    onDisconnected(nowMs);
+                    break;
+                case WifiConnector::Result::Pending:
+                    break;
+            }
+            break;
+
+        case Phase::Backoff:
+            if (nowMs - _phaseStartMs >= _retryDelayMs) {
+                beginConnect(nowMs);
+            }
+            break;
+
+        case Phase::Online:
+            if (WiFi.status() != WL_CONNECTED) {
+                onLinkLost(nowMs);
+            } else {
+                pollServices(nowMs);
+                // Whatever this step sent, its connection isn't held until the next poll
+                _session.endBurst();
+            }
+            break;
+    }
+}
+
+void NetworkTask::onConnected(uint32_t nowMs) {
+    Serial.printf("[Net] WiFi connected, IP %s\n", WiFi.localIP().toString().c_str());
+    BootTimings::markWifiConnected(nowMs);
+    _phase = Phase::Online;
+    _phaseStartMs = nowMs;
+    _retryDelayMs = 0;
+    _connected.store(true);
+    WallClock::begin();
+
+    if (!_authStarted) {
+        _authStarted = true;
+        _auth.begin();
+        if (!_auth.isSignedIn()) {
+            Serial.println("[Net] No stored sign-in, starting device flow...");
+            _authInProgress = _auth.startDeviceFlow();
+        } else {
+            Serial.println("[Net] Stored sign-in found, will poll presence");
+        }
+    }
+    // Poll presence right away after (re)connecting
+    _lastPresencePoll = 0;
+}
+
+void NetworkTask::onDisconnected(uint32_t nowMs) {
+    _connected.store(false);
+    WiFi.disconnect();
+
+    if (_retryDelayMs == 0) {
+        _retryDelayMs = Config::WIFI_RETRY_MIN_MS;
+    } else if (_retryDelayMs < Config::WIFI_RETRY_MAX_MS / 2) {
+        _retryDelayMs *= 2;
+    } else {
+        _retryDelayMs = Config::WIFI_RETRY_MAX_MS;
+    }
+    Serial.printf("[Net] Retrying WiFi in %lu ms\n", (unsigned long)_retryDelayMs);
+    _phase = Phase::Backoff;
+    _phaseStartMs = nowMs;
+}
+
+void NetworkTask::onLinkLost(uint32_t nowMs) {
+    // A drop is usually brief (AP reboot, roaming), so the first retry goes straight
+    // back to the cached AP; backoff only starts if that attempt fails too
+    Serial.println("[Net] WiFi connection lost, reconnecting");
+    _connected.store(false);
+    _session.close();
+    WiFi.disconnect();
+    _retryDelayMs = 0;
+    beginConnect(nowMs);
+}
+
+void NetworkTask::pollServices(uint32_t nowMs) {
+    // Handle Microsoft auth device flow polling
+    if (_authInProgress) {
+        if (_auth.pollForToken()) {
+            _authInProgress = false;
+            Serial.println("[Net] Authentication complete! Starting presence polling.");
+            _lastPresencePoll = 0;
+        }
+        return;
+    }
+
+    refreshTokenAhead(nowMs);
+
+    if (Config::CALENDAR_ENABLED && !Config::TEAM_MODE) {
+        pollCalendar(nowMs);
+        // The poll right after the hold confirms or corrects the calendar switch
+        if (_holding && (int32_t)(nowMs - _holdUntilMs) >= 0) {
+            _holding = false;
+            _lastPresencePoll = 0;
+        }
+    }
+
+    if (_lastPresencePoll != 0 && nowMs - _lastPresencePoll < Config::PRESENCE_POLL_INTERVAL_MS) {
+        return;
+    }
+    // A token loaded from flash only has a UTC expiry; without the clock it would be
+    // refreshed blindly, so give SNTP a moment first
+    if (!_auth.expiryKnown() && nowMs - _phaseStartMs < Config::CLOCK_SYNC_WAIT_MS) {
+        return;
+    }
+    _lastPresencePoll = nowMs > 0 ? nowMs : 1;
+
+    const uint32_t startUs = micros();
+    const bool fetched = Config::TEAM_MODE ? pollTeamPresence() : pollPresence();
+    Metrics::presencePollDuration.observe(micros() - startUs);
+
+    if (fetched) {
+        if (!_presenceFetched) {
+            _presenceFetched = true;
+            BootTimings::markFirstPresence(millis());
+        }
+        return;
+    }
+
+    Metrics::presencePollFailures++;
+    if (!_auth.isSignedIn()) {
+        // The refresh token was rejected, restart auth flow
+        Serial.println("[Net] Signed out, restarting device flow...");
+        _authInProgress = _auth.startDeviceFlow();
+    }
+}
+
+void NetworkTask::refreshTokenAhead(uint32_t nowMs) {
+    // Only once the expiry is actually known; an unknown one is refreshed by the next request
+    if (!_auth.isSignedIn() || !_auth.expiryKnown() || !_auth.expiresWithin(Config::TOKEN_REFRESH_AHEAD_S)) {
+        return;
+    }
+    if (_lastRefreshAttempt != 0 && nowMs - _lastRefreshAttempt < Config::TOKEN_REFRESH_RETRY_MS) {
+        return;
+    }
+    _lastRefreshAttempt = nowMs > 0 ? nowMs : 1;
+    if (_auth.refreshAccessToken()) {
+        Metrics::tokenRefreshesAhead++;
+    }
+}
+
+void NetworkTask::postPresence(const PresenceStatus& status) {
+    if (status == _lastPosted) return;
+    _lastPosted = status;
+    xQueueOverwrite(_presenceQueue, &status);
+    IdleControl::notify();
+}
+
+bool NetworkTask::pollPresence() {
+    if (!_presence.fetchPresence()) {
+        return false;
+    }
+    const PresenceStatus& current = _presence.getStatus();
+    _lastPolled = current;
+    if (_holding) {
+        if (current != _lastPosted) {
+            Serial.printf("[Calendar] Poll says %s, keeping the calendar switch for now\n",
+                          TeamsPresence::presenceToString(current.presence));
+            Metrics::calendarPollsHeld++;
+        }
+        return true;
+    }
+    postPresence(current);
+    return true;
+}
+
+void NetworkTask::pollCalendar(uint32_t nowMs) {
+    const uint32_t nowUnix = WallClock::now();
+    if (nowUnix == 0 || !_auth.isSignedIn()) {
+        return;
+    }
+
+    if (_lastCalendarFetch == 0 || nowMs - _lastCalendarFetch >= Config::CALENDAR_REFRESH_MS) {
+        _lastCalendarFetch = nowMs > 0 ? nowMs : 1;
+        CalendarEvent events[CalendarSchedule::MAX_EVENTS];
+        size_t count = 0;
+        Metrics::calendarFetches++;
+        if (_presence.fetchCalendar(nowUnix, nowUnix + Config::CALENDAR_LOOKAHEAD_S, events,
+                                    CalendarSchedule::MAX_EVENTS, count)) {
+            _calendar.setEvents(events, count, nowUnix);
+            if (const uint32_t next = _calendar.nextTransition(nowUnix)) {
+                char at[21];
+                WallClock::format(next, at);
+                Serial.printf("[Calendar] Next switch at %s\n", at);
+            }
+        } else {
+            Metrics::calendarFetchFailures++;
+        }
+    }
+
+    bool busy;
+    if (!_calendar.takeTransition(nowUnix, busy)) {
+        return;
+    }
+    Metrics::calendarTransitions++;
+    PresenceStatus predicted;
+    if (busy) {
+        _beforeMeeting = _lastPolled;
+        predicted.presence = Presence::Busy;
+        predicted.activity = Activity::InAMeeting;
+    } else if (_beforeMeeting.presence != Presence::Unknown) {
+        predicted = _beforeMeeting;
+    } else {
+        predicted.presence = Presence::Available;
+    }
+    Serial.printf("[Calendar] Meeting %s, switching to %s\n", busy ? "starts" : "ends",
+                  TeamsPresence::presenceToString(predicted.presence));
+    postPresence(predicted);
+
+    // Teams lags the calendar, so polls showing the old status are ignored for a while
+    _holding = true;
+    _holdUntilMs = nowMs + Config::CALENDAR_HOLD_MS;
+}
+
+bool NetworkTask::pollTeamPresence() {
+    // One batch request for the whole team instead of one round trip per user
+    if (!_presence.fetchTeamPresence(Config::TEAM_MEMBERS, Config::TEAM_MEMBER_COUNT, _memberPresence)) {
+        return false;
+    }
+    for (size_t i = 0; i < Config::TEAM_MEMBER_COUNT; i++) {
+        if (_memberPresence[i] == _memberPosted[i]) {
+            continue;
+        }
+        MemberPresence update{static_cast<uint8_t>(i), _memberPresence[i]};
+        if (xQueueSend(_memberQueue, &update, 0) == pdTRUE) {
+            _memberPosted[i] = _memberPresence[i];
+            IdleControl::notify();
+        }
+        // A full queue leaves _memberPosted stale, so the change is retried next poll
+    }
+    return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "MicrosoftAuth.h"
+#include "TeamsPresence.h"
+#include "CalendarSchedule.h"
+#include "WifiConnector.h"
+
+// Brings up WiFi, Microsoft auth and presence polling on a background task,
+// so the render loop and button are live from the first millisecond.
+// Reconnects with exponential backoff when the link drops.
+class NetworkTask {
+public:
+    NetworkTask(MicrosoftAuth& auth, TeamsPresence& presence, HttpsSession& session, const char* ssid,
+                const char* pass);
+
+    void start();
+
+    bool isConnected() const { return _connected.load(); }
+
+    // Returns true and fills `out` when a new presence value is available
+    bool takePresence(PresenceStatus& out);
+
+    struct MemberPresence {
+        uint8_t member;     // Index into Config::TEAM_MEMBERS
+        PresenceStatus status;
+    };
+
+    // Team mode: returns true and fills `out` for each member whose presence changed
+    bool takeMemberPresence(MemberPresence& out);
+
+private:
+    enum class Phase : uint8_t {
+        Connecting,
+        Backoff,
+        Online
+    };
+
+    static constexpr uint32_t TASK_STACK_BYTES = 10240;
+    static constexpr uint32_t STEP_INTERVAL_MS = 50;
+
+    MicrosoftAuth& _auth;
+    TeamsPresence& _presence;
+    HttpsSession& _session;
+    const char* _ssid;
+    const char* _pass;
+    WifiConnector _wifi;
+
+    TaskHandle_t _task = nullptr;
+    QueueHandle_t _presenceQueue = nullptr;
+    QueueHandle_t _memberQueue = nullptr;
+    std::atomic<bool> _connected{false};
+
+    Phase _phase = Phase::Connecting;
+    uint32_t _phaseStartMs = 0;
+    uint32_t _retryDelayMs = 0;
+    bool _authStarted = false;
+    bool _authInProgress = false;
+    uint32_t _lastPresencePoll = 0;
+    uint32_t _lastRefreshAttempt = 0;
+    bool _presenceFetched = false;
+    PresenceStatus _lastPosted;
+    PresenceStatus _lastPolled;
+
+    // Calendar pre-switching
+    CalendarSchedule _calendar;
+    uint32_t _lastCalendarFetch = 0;
+    uint32_t _holdUntilMs = 0;          // Polls contradicting a calendar switch are ignored until then
+    bool _holding = false;
+    PresenceStatus _beforeMeeting;      // Restored when the busy block ends
+    PresenceStatus _memberPresence[Config::TEAM_MEMBER_COUNT];
+    PresenceStatus _memberPosted[Config::TEAM_MEMBER_COUNT];
+
+    static void taskEntry(void* arg);
+    void step(uint32_t nowMs);
+    void beginConnect(uint32_t nowMs);
+    void onConnected(uint32_t nowMs);
+    void onDisconnected(uint32_t nowMs);
+    void onLinkLost(uint32_t nowMs);
+    void pollServices(uint32_t nowMs);
+    void refreshTokenAhead(uint32_t nowMs);
+    bool pollPresence();
+    void pollCalendar(uint32_t nowMs);
+    void postPresence(const PresenceStatus& status);
+    bool pollTeamPresence();
+};
@@ -0,0 +1,51 @@
+#include "PixelSpan.h"
+
+PixelSpan::PixelSpan(LedRing& ring, uint16_t start, uint16_t length,
+                     bool reverse, bool mirror, uint8_t brightness)
+    : _ring(ring)
+    , _start(start)
+    , _length(length)
+    , _logicalLength(mirror ? (length + 1) / 2 : length)
+    , _reverse(reverse)
+    , _mirror(mirror)
+    , _scale((uint32_t)brightness + 1) {}
+
+void PixelSpan::clear() {
+    for (uint16_t i = 0; i < _length; i++) {
+        _ring.setPixelColor16(_start + i, 0, 0, 0);
+    }
+}
+
+void PixelSpan::setPixelColor(uint16_t index, uint32_t color) {
+    setPixelColor16(index,
+                    ((color >> 16) & 0xFF) * 257,
+                    ((color >> 8) & 0xFF) * 257,
+                    (color & 0xFF) * 257);
+}
+
+void PixelSpan::setPixelScaled(uint16_t index, uint32_t color, uint16_t level) {
+    const uint32_t scale = (uint32_t)level + 1;
+    setPixelColor16(index,
+                    (((color >> 16) & 0xFF) * 257 * scale) >> 16,
+                    (((color >> 8) & 0xFF) * 257 * scale) >> 16,
+                    ((color & 0xFF) * 257 * scale) >> 16);
+}
+
+void PixelSpan::setPixelColor16(uint16_t index, uint16_t r, uint16_t g, uint16_t b) {
+    if (index >= _logicalLength) return;
+    if (_scale != 256) {
+        r = ((uint32_t)r * _scale) >> 8;
+        g = ((uint32_t)g * _scale) >> 8;
+        b = ((uint32_t)b * _scale) >> 8;
+    }
+    // Reverse flips the logical order, so a reversed mirror grows from the middle out
+    const uint16_t offset = _reverse ? _logicalLength - 1 - index : index;
+    write(offset, r, g, b);
+    if (_mirror) {
+        write(_length - 1 - offset, r, g, b);
+    }
+}
+
+void PixelSpan::write(uint16_t offset, uint16_t r, uint16_t g, uint16_t b) {
+    _ring.setPixelColor16(_start + offset, r, g, b);
+}
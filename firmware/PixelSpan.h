@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+#include "LedRing.h"
+
+// A window onto a range of ring pixels. Animations draw through a span, so the
+// same code can fill the whole ring or one segment of it. Logical index 0 maps
+// to `start` (or the far end when reversed); a mirrored span draws each pixel
+// twice, from both ends inward, and exposes half the length.
+class PixelSpan {
+public:
+    PixelSpan(LedRing& ring, uint16_t start, uint16_t length,
+              bool reverse = false, bool mirror = false, uint8_t brightness = 255);
+
+    uint16_t numPixels() const { return _logicalLength; }
+
+    void clear();
+    void setPixelColor(uint16_t index, uint32_t color);
+    // 16-bit per channel (0-65535)
+    void setPixelColor16(uint16_t index, uint16_t r, uint16_t g, uint16_t b);
+    // Sets `color` scaled by `level` (0-65535), as LedRing::setPixelScaled
+    void setPixelScaled(uint16_t index, uint32_t color, uint16_t level);
+
+private:
+    LedRing& _ring;
+    uint16_t _start;
+    uint16_t _length;
+    uint16_t _logicalLength;
+    bool _reverse;
+    bool _mirror;
+    uint32_t _scale;    // brightness + 1, applied as (value * _scale) >> 8
+
+    void write(uint16_t offset, uint16_t r, uint16_t g, uint16_t b);
+};
@@ -0,0 +1,52 @@
+#include "PowerLimiter.h"
+
+PowerLimiter::PowerLimiter(uint32_t budgetMa, const Coefficients& coeffs)
+    : _budgetMa(budgetMa), _coeffs(coeffs) {}
+
+uint32_t PowerLimiter::scaledMa(uint32_t fullMa, uint8_t brightness) {
+    // Matches LedRing, which drives each channel at value * brightness / 255
+    return (uint32_t)((uint64_t)fullMa * brightness / 255);
+}
+
+uint8_t PowerLimiter::limit(const uint16_t* frame, uint16_t count, uint8_t requested) {
+    // 32-bit sums can't overflow: at most 65535 pixels * 65535 per channel
+    uint32_t sumR = 0, sumG = 0, sumB = 0;
+    const uint16_t* p = frame;
+    for (uint16_t i = 0; i < count; i++, p += 3) {
+        sumR += p[0];
+        sumG += p[1];
+        sumB += p[2];
+    }
+
+    const uint32_t fullMa = (uint32_t)(((uint64_t)sumR * _coeffs.redMa +
+                                        (uint64_t)sumG * _coeffs.greenMa +
+                                        (uint64_t)sumB * _coeffs.blueMa) / 0xFFFF);
+    const uint32_t idleMa = (uint32_t)_coeffs.idleMa * count;
+
+    // Highest brightness whose draw fits in what's left after quiescent current
+    uint32_t target = 255;
+    if (fullMa > 0) {
+        const uint32_t available = _budgetMa > idleMa ? _budgetMa - idleMa : 0;
+        const uint64_t fits = (uint64_t)available * 255 / fullMa;
+        target = fits > 255 ? 255 : (uint32_t)fits;
+    }
+    _targetCap = (uint8_t)target;
+
+    // Drop immediately to protect the supply, recover gradually to avoid flicker
+    const uint16_t targetQ8 = (uint16_t)(target << 8);
+    if (targetQ8 <= _capQ8) {
+        _capQ8 = targetQ8;
+    } else {
+        uint16_t step = (targetQ8 - _capQ8) >> RELEASE_SHIFT;
+        _capQ8 += step > 0 ? step : 1;
+    }
+
+    const uint8_t cap = _capQ8 >> 8;
+    const uint8_t applied = requested < cap ? requested : cap;
+
+    _limiting = applied < requested;
+    if (_limiting) _limitedFrames++;
+    _requestedMa = scaledMa(fullMa, requested) + idleMa;
+    _estimatedMa = scaledMa(fullMa, applied) + idleMa;
+    return applied;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Estimates LED current from the frame buffer and caps brightness so the
+// strip stays within a configured budget. Integer-only, so it stays cheap
+// on long strips.
+class PowerLimiter {
+public:
+    struct Coefficients {
+        uint16_t redMa;     // mA drawn by one channel at full duty
+        uint16_t greenMa;
+        uint16_t blueMa;
+        uint16_t idleMa;    // quiescent mA per pixel
+    };
+
+    PowerLimiter(uint32_t budgetMa, const Coefficients& coeffs);
+
+    // `frame` holds `count` pixels as 16-bit R,G,B triplets.
+    // Returns the brightness to apply to this frame (never above `requested`)
+    uint8_t limit(const uint16_t* frame, uint16_t count, uint8_t requested);
+
+    void setBudget(uint32_t budgetMa) { _budgetMa = budgetMa; }
+    uint32_t budgetMa() const { return _budgetMa; }
+
+    // Estimated draw of the last frame after limiting
+    uint32_t estimatedMa() const { return _estimatedMa; }
+    // Draw the last frame would have had at the requested brightness
+    uint32_t requestedMa() const { return _requestedMa; }
+    uint8_t brightnessCap() const { return _capQ8 >> 8; }
+    bool isLimiting() const { return _limiting; }
+    // True while the cap is still recovering towards its target
+    bool isSettling() const { return (_capQ8 >> 8) < _targetCap; }
+    uint32_t limitedFrames() const { return _limitedFrames; }
+
+private:
+    // Cap rises by 1/2^RELEASE_SHIFT of the remaining distance per frame
+    static constexpr uint8_t RELEASE_SHIFT = 3;
+
+    uint32_t _budgetMa;
+    Coefficients _coeffs;
+
+    uint16_t _capQ8 = 0xFF00;   // smoothed brightness ceiling, 8.8 fixed point
+    uint8_t _targetCap = 255;
+    uint32_t _estimatedMa = 0;
+    uint32_t _requestedMa = 0;
+    bool _limiting = false;
+    uint32_t _limitedFrames = 0;
+
+    static uint32_t scaledMa(uint32_t fullMa, uint8_t brightness);
+};
@@ -0,0 +1,236 @@
+#include "PresenceRules.h"
+#include "ColorCodec.h"
+#include "Config.h"
+
+static const char* PREFS_NAMESPACE = "rules";
+static const char* PREFS_KEY = "table";
+
+const PresenceRule PresenceRules::FALLBACK = [] {
+    PresenceRule r;
+    r.color = 0x0000FF;  // Blue for anything unmatched
+    strlcpy(r.animation, "solid", sizeof(r.animation));
+    return r;
+}();
+
+namespace {
+
+PresenceRule makeRule(uint8_t presence, uint32_t color, uint32_t pixelMask, const char* animation,
+                      const char* intro = "", uint16_t introMs = 0) {
+    PresenceRule r;
+    r.presence = presence;
+    r.color = color;
+    r.pixelMask = pixelMask;
+    strlcpy(r.animation, animation, sizeof(r.animation));
+    strlcpy(r.intro, intro, sizeof(r.intro));
+    r.introMs = introMs;
+    return r;
+}
+
+uint8_t selector(Presence presence) { return static_cast<uint8_t>(presence); }
+
+// Parses an enum name (or "*" / missing for ANY) using the given to-string function
+template <typename Enum>
+bool parseSelector(JsonVariantConst value, size_t count, const char* (*toString)(Enum), uint8_t& out) {
+    const char* name = value | "*";
+    if (strcmp(name, "*") == 0) {
+        out = PresenceRule::ANY;
+        return true;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(name, toString(static_cast<Enum>(i))) == 0) {
+            out = static_cast<uint8_t>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+void PresenceRules::loadDefaults(PresenceRule* rules, uint8_t& count) {
+    // Traffic light: bottom = busy (strobe first), middle = away, top = available
+    constexpr uint32_t BOTTOM = 1u << 0;
+    constexpr uint32_t MIDDLE = 1u << 1;
+    constexpr uint32_t TOP = 1u << 2;
+    const uint16_t strobeMs = Config::STROBE_DURATION_MS;
+
+    count = 0;
+    rules[count++] = makeRule(selector(Presence::Available), 0x00FF00, TOP, "pixels");
+    rules[count++] = makeRule(selector(Presence::Away), 0xFF9600, MIDDLE, "pixels");
+    rules[count++] = makeRule(selector(Presence::BeRightBack), 0xFF9600, MIDDLE, "pixels");
+    rules[count++] = makeRule(selector(Presence::Busy), 0xFF0000, BOTTOM, "pixels", "strobe", strobeMs);
+    rules[count++] = makeRule(selector(Presence::DoNotDisturb), 0xFF0000, BOTTOM, "pixels", "strobe", strobeMs);
+    rules[count++] = makeRule(selector(Presence::InACall), 0xFF0000, BOTTOM, "pixels", "strobe", strobeMs);
+    rules[count++] = makeRule(selector(Presence::InAMeeting), 0xFF0000, BOTTOM, "pixels", "strobe", strobeMs);
+    rules[count++] = makeRule(selector(Presence::Presenting), 0xFF0000, BOTTOM, "pixels", "strobe", strobeMs);
+    rules[count++] = makeRule(selector(Presence::Offline), 0xFF0000, PresenceRule::ALL_PIXELS, "fade");
+    rules[count++] = FALLBACK;
+}
+
+void PresenceRules::begin() {
+    _prefs.begin(PREFS_NAMESPACE, false);
+    if (load()) {
+        Serial.printf("[Rules] Loaded %u rules from NVS\n", _count);
+    } else {
+        loadDefaults(_rules, _count);
+        Serial.printf("[Rules] Using %u default rules\n", _count);
+    }
+    compile();
+}
+
+void PresenceRules::resetDefaults() {
+    loadDefaults(_rules, _count);
+    _prefs.remove(PREFS_KEY);
+    compile();
+}
+
+void PresenceRules::compile() {
+    for (size_t pi = 0; pi < PRESENCE_COUNT; pi++) {
+        for (size_t ai = 0; ai < ACTIVITY_COUNT; ai++) {
+            uint8_t match = 0xFF;
+            for (uint8_t r = 0; r < _count; r++) {
+                const PresenceRule& rule = _rules[r];
+                if ((rule.presence == PresenceRule::ANY || rule.presence == pi) &&
+                    (rule.activity == PresenceRule::ANY || rule.activity == ai)) {
+                    match = r;
+                    break;
+                }
+            }
+            _lookup[pi][ai] = match;
+        }
+    }
+    _version++;
+}
+
+bool PresenceRules::load() {
+    Stored stored;
+    if (_prefs.getBytesLength(PREFS_KEY) != sizeof(stored)) {
+        return false;
+    }
+    _prefs.getBytes(PREFS_KEY, &stored, sizeof(stored));
+    if (stored.version != TABLE_VERSION || stored.count > MAX_RULES) {
+        Serial.println("[Rules] Stored table invalid, ignoring");
+        return false;
+    }
+    for (uint16_t i = 0; i < stored.count; i++) {
+        PresenceRule& r = stored.rules[i];
+        r.animation[PresenceRule::NAME_LEN - 1] = '\0';
+        r.intro[PresenceRule::NAME_LEN - 1] = '\0';
+    }
+    memcpy(_rules, stored.rules, sizeof(_rules));
+    _count = stored.count;
+    return true;
+}
+
+void PresenceRules::save() {
+    Stored stored = {};
+    stored.version = TABLE_VERSION;
+    stored.count = _count;
+    memcpy(stored.rules, _rules, sizeof(PresenceRule) * _count);
+    _prefs.putBytes(PREFS_KEY, &stored, sizeof(stored));
+}
+
+bool PresenceRules::fromJson(JsonVariantConst json, Error& error) {
+    JsonArrayConst arr = json.is<JsonArrayConst>() ? json.as<JsonArrayConst>()
+                                                   : json["rules"].as<JsonArrayConst>();
+    if (arr.isNull()) {
+        error.assign("Expected JSON array or {\"rules\": [...]}");
+        return false;
+    }
+    if (arr.size() == 0 || arr.size() > MAX_RULES) {
+        error.clear();
+        error.appendf("Need 1-%u rules", (unsigned)MAX_RULES);
+        return false;
+    }
+
+    PresenceRule parsed[MAX_RULES];
+    uint8_t count = 0;
+    for (JsonVariantConst v : arr) {
+        PresenceRule& r = parsed[count];
+
+        if (!parseSelector<Presence>(v["presence"], PRESENCE_COUNT, TeamsPresence::presenceToString, r.presence)) {
+            error.clear();
+            error.appendf("rule %u: unknown 'presence'", count);
+            return false;
+        }
+        if (!parseSelector<Activity>(v["activity"], ACTIVITY_COUNT, TeamsPresence::activityToString, r.activity)) {
+            error.clear();
+            error.appendf("rule %u: unknown 'activity'", count);
+            return false;
+        }
+
+        const char* animation = v["animation"] | "";
+        const char* intro = v["intro"] | "";
+        if (animation[0] == '\0' || strlen(animation) >= PresenceRule::NAME_LEN ||
+            strlen(intro) >= PresenceRule::NAME_LEN) {
+            error.clear();
+            error.appendf("rule %u: missing or too long 'animation'/'intro'", count);
+            return false;
+        }
+        strlcpy(r.animation, animation, sizeof(r.animation));
+        strlcpy(r.intro, intro, sizeof(r.intro));
+        JsonVariantConst introMs = v["introMs"];
+        const long ms = introMs | (long)Config::STROBE_DURATION_MS;
+        if ((!introMs.isNull() && !introMs.is<long>()) || ms < 0 || ms > UINT16_MAX) {
+            error.clear();
+            error.appendf("rule %u: 'introMs' must be 0-%u", count, (unsigned)UINT16_MAX);
+            return false;
+        }
+        r.introMs = intro[0] ? (uint16_t)ms : 0;
+
+        const ColorCodec::Error colorError = ColorCodec::parse(v["color"] | "#000000", r.color);
+        if (colorError != ColorCodec::Error::None) {
+            error.clear();
+            error.appendf("rule %u: %s", count, ColorCodec::errorString(colorError));
+            return false;
+        }
+
+        JsonArrayConst pixels = v["pixels"];
+        if (!pixels.isNull()) {
+            r.pixelMask = 0;
+            for (JsonVariantConst px : pixels) {
+                const int index = px | -1;
+                if (index < 0 || index > 31) {
+                    error.clear();
+                    error.appendf("rule %u: 'pixels' entries must be 0-31", count);
+                    return false;
+                }
+                r.pixelMask |= 1u << index;
+            }
+        }
+        count++;
+    }
+
+    memcpy(_rules, parsed, sizeof(_rules));
+    _count = count;
+    compile();
+    save();
+    Serial.printf("[Rules] Table replaced (%u rules)\n", _count);
+    return true;
+}
+
+void PresenceRules::toJson(JsonDocument& doc) const {
+    JsonArray arr = doc.createNestedArray("rules");
+    for (uint8_t i = 0; i < _count; i++) {
+        const PresenceRule& r = _rules[i];
+        JsonObject o = arr.createNestedObject();
+        o["presence"] = r.presence == PresenceRule::ANY
+            ? "*" : TeamsPresence::presenceToString(static_cast<Presence>(r.presence));
+        o["activity"] = r.activity == PresenceRule::ANY
+            ? "*" : TeamsPresence::activityToString(static_cast<Activity>(r.activity));
+        o["animation"] = r.animation;
+        char colorHex[8];
+        ColorCodec::formatHex(r.color, colorHex);
+        o["color"] = colorHex;
+        if (r.pixelMask != PresenceRule::ALL_PIXELS) {
+            JsonArray pixels = o.createNestedArray("pixels");
+            for (uint8_t px = 0; px < 32; px++) {
+                if (r.pixelMask & (1u << px)) pixels.add(px);
+            }
+        }
+        if (r.intro[0]) {
+            o["intro"] = r.intro;
+            o["introMs"] = r.introMs;
+        }
+    }
+}
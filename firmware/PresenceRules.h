@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <Preferences.h>
+#include "FixedString.h"
+#include "TeamsPresence.h"
+
+// One presence -> effect mapping. `presence`/`activity` hold the enum value
+// or ANY; the first rule matching a (presence, activity) pair wins.
+struct PresenceRule {
+    static constexpr uint8_t ANY = 0xFF;
+    static constexpr uint32_t ALL_PIXELS = 0xFFFFFFFF;
+    static constexpr size_t NAME_LEN = 16;
+
+    uint8_t presence = ANY;
+    uint8_t activity = ANY;
+    uint16_t introMs = 0;               // Intro phase length; 0 = none
+    uint32_t color = 0;
+    uint32_t pixelMask = ALL_PIXELS;    // Bit i lights pixel i (pixels past 31 follow bit 31)
+    char animation[NAME_LEN] = {0};     // "off" powers the ring down
+    char intro[NAME_LEN] = {0};         // Played for introMs before `animation`
+};
+
+// Presence -> effect rules table. Stored in NVS, editable over HTTP and
+// compiled into a flat [presence][activity] lookup so evaluation is O(1).
+class PresenceRules {
+public:
+    static constexpr size_t MAX_RULES = 16;
+
+    // Loads the stored table, falling back to the built-in defaults
+    void begin();
+
+    const PresenceRule& lookup(Presence presence, Activity activity) const {
+        const uint8_t idx = _lookup[static_cast<size_t>(presence)][static_cast<size_t>(activity)];
+        return idx < _count ? _rules[idx] : FALLBACK;
+    }
+
+    // Bumped whenever the table changes, so callers can re-apply the current presence
+    uint32_t version() const { return _version; }
+    size_t count() const { return _count; }
+
+    using Error = FixedString<95>;
+
+    // Replaces the table from {"rules": [...]} or a bare array and saves it;
+    // on failure the current table is kept and `error` says why
+    bool fromJson(JsonVariantConst json, Error& error);
+    void toJson(JsonDocument& doc) const;
+
+    void resetDefaults();
+
+private:
+    static constexpr uint16_t TABLE_VERSION = 1;
+    static const PresenceRule FALLBACK;
+
+    struct Stored {
+        uint16_t version;
+        uint16_t count;
+        PresenceRule rules[MAX_RULES];
+    };
+
+    Preferences _prefs;
+    PresenceRule _rules[MAX_RULES];
+    uint8_t _count = 0;
+    uint8_t _lookup[PRESENCE_COUNT][ACTIVITY_COUNT];
+    uint32_t _version = 0;
+
+    void compile();
+    bool load();
+    void save();
+    static void loadDefaults(PresenceRule* rules, uint8_t& count);
+};
@@ -0,0 +1,30 @@
+#include "SleepSchedule.h"
+
+SleepSchedule::SleepSchedule(uint8_t dayMask, uint16_t startMinute, uint16_t endMinute)
+    : _dayMask(dayMask & 0x7F), _start(startMinute % MINUTES_PER_DAY), _end(endMinute % MINUTES_PER_DAY) {}
+
+bool SleepSchedule::isWorking(uint8_t weekday, uint16_t minute) const {
+    if (_start == _end) {
+        return worksOn(weekday);    // Whole day
+    }
+    if (_start < _end) {
+        return worksOn(weekday) && minute >= _start && minute < _end;
+    }
+    // Overnight: the evening part belongs to today, the early-morning part to yesterday's shift
+    return (worksOn(weekday) && minute >= _start) || (worksOn(weekday + 6) && minute < _end);
+}
+
+uint32_t SleepSchedule::minutesUntilWork(uint8_t weekday, uint16_t minute) const {
+    if (isWorking(weekday, minute)) {
+        return 0;
+    }
+    // The next shift starts today or within a week
+    for (uint8_t day = 0; day <= 7; day++) {
+        if (!worksOn(weekday + day)) continue;
+        const uint32_t startsIn = (uint32_t)day * MINUTES_PER_DAY + _start;
+        if (startsIn > minute) {
+            return startsIn - minute;
+        }
+    }
+    return UINT32_MAX;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Working hours as a weekly pattern in local time: the same start and end
+// minute on each day in a weekday mask. Pure arithmetic on (weekday, minute),
+// so the caller owns the clock and time zone and it can be checked on a host.
+class SleepSchedule {
+public:
+    static constexpr uint16_t MINUTES_PER_DAY = 24 * 60;
+
+    // `dayMask` bit 0 is Sunday (as struct tm's tm_wday). An end before the
+    // start runs past midnight into the next day.
+    SleepSchedule(uint8_t dayMask, uint16_t startMinute, uint16_t endMinute);
+
+    // `weekday` 0-6 from Sunday, `minute` 0-1439 since local midnight
+    bool isWorking(uint8_t weekday, uint16_t minute) const;
+
+    // Minutes from (weekday, minute) until working hours next begin; 0 when
+    // inside them, UINT32_MAX when the mask is empty
+    uint32_t minutesUntilWork(uint8_t weekday, uint16_t minute) const;
+
+private:
+    uint8_t _dayMask;
+    uint16_t _start;
+    uint16_t _end;
+
+    bool worksOn(uint8_t weekday) const { return _dayMask & (1 << (weekday % 7)); }
+};
@@ -0,0 +1,134 @@
+#include "StatePersistence.h"
+#include "Trace.h"
+#include "IdleControl.h"
+
+static const char* PREFS_NAMESPACE = "appstate";
+static const char* KEY_SNAPSHOT = "snap";
+
+bool StatePersistence::begin() {
+    return _prefs.begin(PREFS_NAMESPACE, false);
+}
+
+uint32_t StatePersistence::crc32(const uint8_t* data, size_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+void StatePersistence::capture(const AppState& state, Payload& out) {
+    // Zero first so padding bytes compare and checksum consistently
+    memset(&out, 0, sizeof(out));
+    out.primaryColor = state.primaryColor;
+    out.secondaryColor = state.secondaryColor;
+    memcpy(out.pixelColors, state.pixelColors, sizeof(out.pixelColors));
+    out.speedMs = state.speedMs;
+    out.strobePeriodMs = state.strobePeriodMs;
+    out.powerOn = state.powerOn ? 1 : 0;
+    out.brightness = state.brightness;
+    out.tailLength = state.tailLength;
+    strncpy(out.animation, state.animation, ANIMATION_NAME_LEN - 1);
+}
+
+bool StatePersistence::load(AppState& state) {
+    Record rec;
+    if (_prefs.getBytesLength(KEY_SNAPSHOT) != sizeof(rec) ||
+        _prefs.getBytes(KEY_SNAPSHOT, &rec, sizeof(rec)) != sizeof(rec)) {
+        Serial.println("[State] No saved state");
+        return false;
+    }
+    if (rec.version != SNAPSHOT_VERSION || rec.payloadSize != sizeof(Payload)) {
+        Serial.printf("[State] Ignoring snapshot v%u (expected v%u)\n", rec.version, SNAPSHOT_VERSION);
+        return false;
+    }
+    if (crc32((const uint8_t*)&rec, offsetof(Record, crc)) != rec.crc) {
+        Serial.println("[State] Snapshot CRC mismatch, using defaults");
+        return false;
+    }
+
+    const Payload& p = rec.payload;
+    state.powerOn = p.powerOn != 0;
+    state.brightness = p.brightness;
+    state.primaryColor = p.primaryColor;
+    state.secondaryColor = p.secondaryColor;
+    state.setAnimation(p.animation);
+    state.speedMs = p.speedMs;
+    state.tailLength = p.tailLength;
+    state.strobePeriodMs = p.strobePeriodMs;
+    memcpy(state.pixelColors, p.pixelColors, sizeof(state.pixelColors));
+    state.pixelVersion++;
+
+    _sequence = rec.sequence;
+    capture(state, _saved);
+    Serial.printf("[State] Restored snapshot #%lu\n", (unsigned long)_sequence);
+    return true;
+}
+
+uint32_t StatePersistence::msUntilDue(uint32_t nowMs) const {
+    if (!_dirty) return IdleControl::FOREVER;
+    const uint32_t sinceLast = nowMs - _lastChangeMs;
+    const uint32_t sinceFirst = nowMs - _firstChangeMs;
+    const uint32_t debounce = sinceLast >= SAVE_DEBOUNCE_MS ? 0 : SAVE_DEBOUNCE_MS - sinceLast;
+    const uint32_t maxDelay = sinceFirst >= SAVE_MAX_DELAY_MS ? 0 : SAVE_MAX_DELAY_MS - sinceFirst;
+    return debounce < maxDelay ? debounce : maxDelay;
+}
+
+void StatePersistence::update(uint32_t nowMs, const AppState& state, uint32_t sequence) {
+    if (sequence != _checkedSequence) {
+        _checkedSequence = sequence;
+
+        Payload current;
+        capture(state, current);
+        const Payload& reference = _dirty ? _pending : _saved;
+        if (memcmp(&current, &reference, sizeof(Payload)) != 0) {
+            if (!_dirty) {
+                _dirty = true;
+                _firstChangeMs = nowMs;
+            }
+            _lastChangeMs = nowMs;
+            memcpy(&_pending, &current, sizeof(Payload));
+            _changes++;
+        }
+    }
+
+    if (!_dirty) return;
+    if (nowMs - _lastChangeMs >= SAVE_DEBOUNCE_MS || nowMs - _firstChangeMs >= SAVE_MAX_DELAY_MS) {
+        // A change that ends up identical to what's stored needs no write
+        if (memcmp(&_pending, &_saved, sizeof(Payload)) != 0) {
+            write();
+        }
+        _dirty = false;
+    }
+}
+
+void StatePersistence::flush(const AppState& state) {
+    capture(state, _pending);
+    if (memcmp(&_pending, &_saved, sizeof(Payload)) != 0) {
+        _changes++;
+        write();
+    }
+    _dirty = false;
+}
+
+void StatePersistence::write() {
+    TRACE_SCOPE("StatePersistence::write");
+    Record rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.version = SNAPSHOT_VERSION;
+    rec.payloadSize = sizeof(Payload);
+    rec.sequence = _sequence + 1;
+    memcpy(&rec.payload, &_pending, sizeof(Payload));
+    rec.crc = crc32((const uint8_t*)&rec, offsetof(Record, crc));
+
+    if (_prefs.putBytes(KEY_SNAPSHOT, &rec, sizeof(rec)) != sizeof(rec)) {
+        Serial.println("[State] Failed to save snapshot");
+        return;
+    }
+    _sequence = rec.sequence;
+    memcpy(&_saved, &_pending, sizeof(Payload));
+    _writes++;
+}
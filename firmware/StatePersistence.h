@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "AppState.h"
+
+// Saves AppState snapshots to NVS and restores them at boot.
+// Changes are detected by comparing snapshots, and writes are debounced so a
+// burst of updates (e.g. a brightness slider) costs a single flash write.
+class StatePersistence {
+public:
+    bool begin();
+
+    // Restores the last saved snapshot; returns false if none or invalid
+    bool load(AppState& state);
+
+    // Call every loop iteration with the store sequence `state` was read at;
+    // snapshots are only compared when the sequence moved. Writes once changes have settled.
+    void update(uint32_t nowMs, const AppState& state, uint32_t sequence);
+
+    // Milliseconds until update() has a pending write to make (IdleControl::FOREVER if none)
+    uint32_t msUntilDue(uint32_t nowMs) const;
+
+    // Writes immediately if a change is pending
+    void flush(const AppState& state);
+
+    uint32_t writeCount() const { return _writes; }             // this boot
+    uint32_t lifetimeWrites() const { return _sequence; }       // since first flash
+    uint32_t coalescedChanges() const { return _changes - _writes; }  // changes folded into another write
+
+private:
+    static constexpr uint16_t SNAPSHOT_VERSION = 1;
+    static constexpr uint32_t SAVE_DEBOUNCE_MS = 2000;      // quiet time before writing
+    static constexpr uint32_t SAVE_MAX_DELAY_MS = 10000;    // upper bound while changes keep coming
+    static constexpr size_t ANIMATION_NAME_LEN = AppState::ANIMATION_NAME_LEN;
+
+    struct Payload {
+        uint32_t primaryColor;
+        uint32_t secondaryColor;
+        uint32_t pixelColors[Config::NUM_PIXELS];
+        uint16_t speedMs;
+        uint16_t strobePeriodMs;
+        uint8_t powerOn;
+        uint8_t brightness;
+        uint8_t tailLength;
+        char animation[ANIMATION_NAME_LEN];
+    };
+
+    struct Record {
+        uint16_t version;
+        uint16_t payloadSize;
+        uint32_t sequence;
+        Payload payload;
+        uint32_t crc;
+    };
+
+    Preferences _prefs;
+    Payload _saved = {};
+    Payload _pending = {};
+    bool _dirty = false;
+    uint32_t _checkedSequence = 0;
+    uint32_t _firstChangeMs = 0;
+    uint32_t _lastChangeMs = 0;
+
+    uint32_t _sequence = 0;
+    uint32_t _writes = 0;
+    uint32_t _changes = 0;
+
+    static void capture(const AppState& state, Payload& out);
+    static uint32_t crc32(const uint8_t* data, size_t len);
+    void write();
+};
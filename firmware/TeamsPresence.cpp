@@ -1,47 +1,65 @@
 #include "TeamsPresence.h"
-#include <WiFiClientSecure.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
+#include "FixedString.h"
+#include "Metrics.h"
+#include "Trace.h"
+#include "WallClock.h"
 
 static const char* GRAPH_PRESENCE_ENDPOINT = "https://graph.microsoft.com/v1.0/me/presence";
+static const char* GRAPH_TEAM_PRESENCE_ENDPOINT =
+    "https://graph.microsoft.com/v1.0/communications/getPresencesByUserId";
+static const char* GRAPH_CALENDAR_VIEW_ENDPOINT = "https://graph.microsoft.com/v1.0/me/calendarView";
 
-TeamsPresence::TeamsPresence(MicrosoftAuth& auth)
+// Most ids one team request can carry; the host tests raise it to try batch sizes
+#ifndef TEAM_REQUEST_MAX_MEMBERS
+#define TEAM_REQUEST_MAX_MEMBERS Config::TEAM_MEMBER_COUNT
+#endif
+
+TeamsPresence::TeamsPresence(MicrosoftAuth& auth, HttpsSession& session)
     : _auth(auth)
-    , _presence(Presence::Unknown)
+    , _session(session)
 {
 }
 
+bool TeamsPresence::loadAuthHeader() {
+    const char* token = _auth.getAccessToken();
+    if (token[0] == '\0') {
+        return false;
+    }
+    _authHeader.assign("Bearer ");
+    _authHeader.append(token);
+    return true;
+}
+
 bool TeamsPresence::fetchPresence() {
-    String token = _auth.getAccessToken();
-    if (token.length() == 0) {
+    TRACE_SCOPE("TeamsPresence::fetchPresence");
+    if (!loadAuthHeader()) {
         Serial.println("[Presence] No valid access token");
         return false;
     }
     
-    WiFiClientSecure client;
-    client.setInsecure();  // TODO: Add proper CA cert for production
-    
     HTTPClient http;
-    http.begin(client, GRAPH_PRESENCE_ENDPOINT);
-    http.addHeader("Authorization", "Bearer " + token);
+    _session.begin(http, GRAPH_PRESENCE_ENDPOINT, true);
+    http.addHeader("Authorization", _authHeader.c_str());
     
     int httpCode = http.GET();
     
     // Handle 401 - try to refresh token and retry once
     if (httpCode == 401) {
+        Metrics::graphUnauthorized++;
         Serial.println("[Presence] Got 401, attempting token refresh...");
-        http.end();
+        _session.end(http);
         
         if (_auth.refreshAccessToken()) {
             // Retry with new token
-            String newToken = _auth.getAccessToken();
-            if (newToken.length() == 0) {
+            if (!loadAuthHeader()) {
                 Serial.println("[Presence] No token after refresh");
                 return false;
             }
             
-            http.begin(client, GRAPH_PRESENCE_ENDPOINT);
-            http.addHeader("Authorization", "Bearer " + newToken);
+            _session.begin(http, GRAPH_PRESENCE_ENDPOINT, true);
+            http.addHeader("Authorization", _authHeader.c_str());
             httpCode = http.GET();
         } else {
             Serial.println("[Presence] Token refresh failed");
@@ -51,43 +69,246 @@ bool TeamsPresence::fetchPresence() {
     
     if (httpCode != 200) {
         Serial.printf("[Presence] Request failed: %d\n", httpCode);
-        http.end();
+        _session.end(http);
         return false;
     }
     
-    String response = http.getString();
-    http.end();
-    
-    DynamicJsonDocument doc(1024);
-    DeserializationError error = deserializeJson(doc, response);
+    StaticJsonDocument<32> filter;
+    filter["availability"] = true;
+    filter["activity"] = true;
+    StaticJsonDocument<128> doc;
+    DeserializationError error = deserializeJson(doc, _session.body(http), DeserializationOption::Filter(filter));
+    _session.end(http);
     if (error) {
         Serial.printf("[Presence] JSON parse error: %s\n", error.c_str());
         return false;
     }
     
-    String availability = doc["availability"].as<String>();
-    _presence = parsePresence(availability);
+    const char* availability = doc["availability"] | "";
+    const char* activity = doc["activity"] | "";
+    _status.presence = parsePresence(availability);
+    _status.activity = parseActivity(activity);
     
-    Serial.printf("[Presence] Current status: %s\n", availability.c_str());
+    Serial.printf("[Presence] Current status: %s / %s\n", availability, activity);
     
     return true;
 }
 
-Presence TeamsPresence::parsePresence(const String& availability) {
-    if (availability == "Available") return Presence::Available;
-    if (availability == "Away") return Presence::Away;
-    if (availability == "BeRightBack") return Presence::BeRightBack;
-    if (availability == "Busy") return Presence::Busy;
-    if (availability == "DoNotDisturb") return Presence::DoNotDisturb;
-    if (availability == "InACall") return Presence::InACall;
-    if (availability == "InAMeeting") return Presence::InAMeeting;
-    if (availability == "Presenting") return Presence::Presenting;
-    if (availability == "Offline") return Presence::Offline;
-    return Presence::Unknown;
+bool TeamsPresence::fetchTeamPresence(const Config::TeamMember* members, size_t count, PresenceStatus* out) {
+    TRACE_SCOPE("TeamsPresence::fetchTeamPresence");
+    for (size_t i = 0; i < count; i++) {
+        out[i] = PresenceStatus();
+    }
+
+    if (!loadAuthHeader()) {
+        Serial.println("[Presence] No valid access token");
+        return false;
+    }
+
+    // {"ids":["<guid>",...]}: 40 bytes per quoted, comma-separated GUID
+    FixedString<16 + TEAM_REQUEST_MAX_MEMBERS * 40> body("{\"ids\":[");
+    for (size_t i = 0; i < count; i++) {
+        body.appendf("%s\"%s\"", i > 0 ? "," : "", members[i].userId);
+    }
+    if (!body.append("]}")) {
+        Serial.println("[Presence] Team request body too long");
+        return false;
+    }
+    const uint8_t* payload = reinterpret_cast<const uint8_t*>(body.c_str());
+
+    HTTPClient http;
+    _session.begin(http, GRAPH_TEAM_PRESENCE_ENDPOINT, true);
+    http.addHeader("Authorization", _authHeader.c_str());
+    http.addHeader("Content-Type", "application/json");
+
+    int httpCode = http.POST(payload, body.length());
+    if (httpCode == 401) {
+        Metrics::graphUnauthorized++;
+        Serial.println("[Presence] Got 401, attempting token refresh...");
+        _session.end(http);
+        if (!_auth.refreshAccessToken() || !loadAuthHeader()) {
+            Serial.println("[Presence] Token refresh failed");
+            return false;
+        }
+        _session.begin(http, GRAPH_TEAM_PRESENCE_ENDPOINT, true);
+        http.addHeader("Authorization", _authHeader.c_str());
+        http.addHeader("Content-Type", "application/json");
+        httpCode = http.POST(payload, body.length());
+    }
+
+    if (httpCode != 200) {
+        Serial.printf("[Presence] Team request failed: %d\n", httpCode);
+        _session.end(http);
+        return false;
+    }
+
+    // Parse {"value":[{...},{...}]} one element at a time, so memory stays
+    // flat no matter how many users are in the response
+    Stream& stream = _session.body(http);
+    if (!stream.find("\"value\"") || !stream.find("[")) {
+        Serial.println("[Presence] Team response has no value array");
+        _session.end(http);
+        return false;
+    }
+
+    StaticJsonDocument<64> filter;
+    filter["id"] = true;
+    filter["availability"] = true;
+    filter["activity"] = true;
+    StaticJsonDocument<192> doc;
+
+    size_t matched = 0;
+    do {
+        DeserializationError error = deserializeJson(doc, stream, DeserializationOption::Filter(filter));
+        if (error) {
+            Serial.printf("[Presence] Team JSON parse error: %s\n", error.c_str());
+            break;
+        }
+        const char* id = doc["id"] | "";
+        for (size_t i = 0; i < count; i++) {
+            if (strcasecmp(id, members[i].userId) == 0) {
+                out[i].presence = parsePresence(doc["availability"] | "");
+                out[i].activity = parseActivity(doc["activity"] | "");
+                matched++;
+                break;
+            }
+        }
+    } while (stream.findUntil(",", "]"));
+    _session.end(http);
+
+    Serial.printf("[Presence] Team presence: %u of %u users\n", (unsigned)matched, (unsigned)count);
+    return matched > 0;
+}
+
+bool TeamsPresence::fetchCalendar(uint32_t fromUnix, uint32_t toUnix, CalendarEvent* out, size_t max,
+                                  size_t& count) {
+    TRACE_SCOPE("TeamsPresence::fetchCalendar");
+    count = 0;
+    if (!loadAuthHeader()) {
+        Serial.println("[Calendar] No valid access token");
+        return false;
+    }
+
+    char from[21];
+    char to[21];
+    WallClock::format(fromUnix, from);
+    WallClock::format(toUnix, to);
+    FixedString<255> url;
+    url.appendf("%s?startDateTime=%s&endDateTime=%s&$select=start,end,showAs,isCancelled"
+                "&$orderby=start/dateTime&$top=%u",
+                GRAPH_CALENDAR_VIEW_ENDPOINT, from, to, (unsigned)max);
+
+    HTTPClient http;
+    _session.begin(http, url.c_str(), true);
+    http.addHeader("Authorization", _authHeader.c_str());
+    http.addHeader("Prefer", "outlook.timezone=\"UTC\"");
+
+    int httpCode = http.GET();
+    if (httpCode == 401) {
+        Metrics::graphUnauthorized++;
+        Serial.println("[Calendar] Got 401, attempting token refresh...");
+        _session.end(http);
+        if (!_auth.refreshAccessToken() || !loadAuthHeader()) {
+            Serial.println("[Calendar] Token refresh failed");
+            return false;
+        }
+        _session.begin(http, url.c_str(), true);
+        http.addHeader("Authorization", _authHeader.c_str());
+        http.addHeader("Prefer", "outlook.timezone=\"UTC\"");
+        httpCode = http.GET();
+    }
+
+    if (httpCode != 200) {
+        Serial.printf("[Calendar] Request failed: %d%s\n", httpCode,
+                      httpCode == 403 ? " (sign in again to grant Calendars.Read)" : "");
+        _session.end(http);
+        return false;
+    }
+
+    // Same element-at-a-time parse as the team presence response
+    Stream& stream = _session.body(http);
+    if (!stream.find("\"value\"") || !stream.find("[")) {
+        _session.end(http);
+        return true;    // No events
+    }
+
+    StaticJsonDocument<96> filter;
+    filter["start"]["dateTime"] = true;
+    filter["end"]["dateTime"] = true;
+    filter["showAs"] = true;
+    filter["isCancelled"] = true;
+    StaticJsonDocument<256> doc;
+
+    size_t parsed = 0;
+    do {
+        DeserializationError error = deserializeJson(doc, stream, DeserializationOption::Filter(filter));
+        if (error) {
+            // An empty array fails on its ']', which isn't worth a log line
+            if (parsed > 0 || error != DeserializationError::InvalidInput) {
+                Serial.printf("[Calendar] JSON parse error: %s\n", error.c_str());
+            }
+            break;
+        }
+        parsed++;
+        const char* showAs = doc["showAs"] | "";
+        if (doc["isCancelled"] | false || (strcmp(showAs, "busy") != 0 && strcmp(showAs, "oof") != 0)) {
+            continue;
+        }
+        CalendarEvent event;
+        if (!WallClock::parse(doc["start"]["dateTime"] | "", event.start) ||
+            !WallClock::parse(doc["end"]["dateTime"] | "", event.end)) {
+            continue;
+        }
+        if (count < max) {
+            out[count++] = event;
+        }
+    } while (stream.findUntil(",", "]"));
+    _session.end(http);
+
+    Serial.printf("[Calendar] %u busy event(s) ahead\n", (unsigned)count);
+    return true;
+}
+
+// One hash and a switch instead of a chain of string compares; the final
+// strcmp rejects unknown strings that happen to collide with a known one
+Presence TeamsPresence::parsePresence(const char* availability) {
+    Presence presence;
+    switch (fnv1a(availability)) {
+        case fnv1a("Available"): presence = Presence::Available; break;
+        case fnv1a("Away"): presence = Presence::Away; break;
+        case fnv1a("BeRightBack"): presence = Presence::BeRightBack; break;
+        case fnv1a("Busy"): presence = Presence::Busy; break;
+        case fnv1a("DoNotDisturb"): presence = Presence::DoNotDisturb; break;
+        case fnv1a("InACall"): presence = Presence::InACall; break;
+        case fnv1a("InAMeeting"): presence = Presence::InAMeeting; break;
+        case fnv1a("Presenting"): presence = Presence::Presenting; break;
+        case fnv1a("Offline"): presence = Presence::Offline; break;
+        default: return Presence::Unknown;
+    }
+    return strcmp(availability, presenceToString(presence)) == 0 ? presence : Presence::Unknown;
+}
+
+Activity TeamsPresence::parseActivity(const char* activity) {
+    Activity parsed;
+    switch (fnv1a(activity)) {
+        case fnv1a("InACall"): parsed = Activity::InACall; break;
+        case fnv1a("InAConferenceCall"): parsed = Activity::InAConferenceCall; break;
+        case fnv1a("InAMeeting"): parsed = Activity::InAMeeting; break;
+        case fnv1a("Presenting"): parsed = Activity::Presenting; break;
+        case fnv1a("OutOfOffice"): parsed = Activity::OutOfOffice; break;
+        case fnv1a("OffWork"): parsed = Activity::OffWork; break;
+        case fnv1a("Inactive"): parsed = Activity::Inactive; break;
+        default: return Activity::Other;
+    }
+    return strcmp(activity, activityToString(parsed)) == 0 ? parsed : Activity::Other;
 }
 
 const char* TeamsPresence::getPresenceString() const {
-    switch (_presence) {
+    return presenceToString(_status.presence);
+}
+
+const char* TeamsPresence::presenceToString(Presence presence) {
+    switch (presence) {
         case Presence::Available: return "Available";
         case Presence::Away: return "Away";
         case Presence::BeRightBack: return "BeRightBack";
@@ -101,30 +322,15 @@ const char* TeamsPresence::getPresenceString() const {
     }
 }
 
-PresenceEffect TeamsPresence::getEffect() const {
-    return mapPresenceToEffect(_presence);
-}
-
-PresenceEffect TeamsPresence::mapPresenceToEffect(Presence presence) {
-    switch (presence) {
-        case Presence::Available:
-            return {EffectType::Solid, 0x00FF00, TrafficLightState::Top};  // Green
-            
-        case Presence::Away:
-        case Presence::BeRightBack:
-            return {EffectType::Fade, 0xFF9600, TrafficLightState::Middle};  // Orange/Yellow
-            
-        case Presence::Busy:
-        case Presence::DoNotDisturb:
-        case Presence::InACall:
-        case Presence::InAMeeting:
-        case Presence::Presenting:
-            return {EffectType::StrobeThenSolid, 0xFF0000, TrafficLightState::Bottom};  // Red
-            
-        case Presence::Offline:
-            return {EffectType::Fade, 0xFF0000, TrafficLightState::All};
-            
-        default:
-            return {EffectType::Solid, 0x0000FF, TrafficLightState::All};  // Blue for unknown
+const char* TeamsPresence::activityToString(Activity activity) {
+    switch (activity) {
+        case Activity::InACall: return "InACall";
+        case Activity::InAConferenceCall: return "InAConferenceCall";
+        case Activity::InAMeeting: return "InAMeeting";
+        case Activity::Presenting: return "Presenting";
+        case Activity::OutOfOffice: return "OutOfOffice";
+        case Activity::OffWork: return "OffWork";
+        case Activity::Inactive: return "Inactive";
+        default: return "Other";
     }
 }
@@ -2,6 +2,9 @@
 
 #include <Arduino.h>
 #include "MicrosoftAuth.h"
+#include "CalendarSchedule.h"
+#include "HttpsSession.h"
+#include "Config.h"
 
 enum class Presence {
     Available,
@@ -16,44 +19,61 @@ enum class Presence {
     Unknown
 };
 
-enum class EffectType {
-    Solid,
-    Pixel,
-    StrobeThenPixel,
-    Fade,
-    StrobeThenSolid,
-    Off
+// Graph activities that refine an availability; the rest map to Other
+enum class Activity {
+    InACall,
+    InAConferenceCall,
+    InAMeeting,
+    Presenting,
+    OutOfOffice,
+    OffWork,
+    Inactive,
+    Other
 };
 
-enum class TrafficLightState {
-    Bottom,
-    Middle,
-    Top,
-    All
-};
+constexpr size_t PRESENCE_COUNT = static_cast<size_t>(Presence::Unknown) + 1;
+constexpr size_t ACTIVITY_COUNT = static_cast<size_t>(Activity::Other) + 1;
+
+struct PresenceStatus {
+    Presence presence = Presence::Unknown;
+    Activity activity = Activity::Other;
 
-struct PresenceEffect {
-    EffectType type;
-    uint32_t color;
-    TrafficLightState trafficLight;
+    bool operator==(const PresenceStatus& o) const { return presence == o.presence && activity == o.activity; }
+    bool operator!=(const PresenceStatus& o) const { return !(*this == o); }
 };
 
 class TeamsPresence {
 public:
-    TeamsPresence(MicrosoftAuth& auth);
+    TeamsPresence(MicrosoftAuth& auth, HttpsSession& session);
     
     bool fetchPresence();
+
+    // Fetches presence for all members in a single Graph request; `out[i]`
+    // receives members[i]'s presence (Unknown if absent from the response)
+    bool fetchTeamPresence(const Config::TeamMember* members, size_t count, PresenceStatus* out);
+
+    // Fetches the signed-in user's busy / out-of-office events overlapping
+    // [fromUnix, toUnix) (needs Calendars.Read); cancelled and free/tentative
+    // events are skipped. Fills up to `max` events, ordered by start.
+    bool fetchCalendar(uint32_t fromUnix, uint32_t toUnix, CalendarEvent* out, size_t max, size_t& count);
     
-    Presence getPresence() const { return _presence; }
+    Presence getPresence() const { return _status.presence; }
+    Activity getActivity() const { return _status.activity; }
+    const PresenceStatus& getStatus() const { return _status; }
     const char* getPresenceString() const;
     
-    PresenceEffect getEffect() const;
-    
-    static PresenceEffect mapPresenceToEffect(Presence presence);
+    static const char* presenceToString(Presence presence);
+    static const char* activityToString(Activity activity);
     
 private:
     MicrosoftAuth& _auth;
-    Presence _presence;
+    HttpsSession& _session;
+    PresenceStatus _status;
+    FixedString<AuthTokens::ACCESS_TOKEN_LEN + 7> _authHeader;   // "Bearer <token>"
+
+    // Fills _authHeader from the current access token; false when there is none
+    bool loadAuthHeader();
     
-    Presence parsePresence(const String& availability);
+    static Presence parsePresence(const char* availability);
+    static Activity parseActivity(const char* activity);
 };
@@ -0,0 +1,137 @@
+#include "Trace.h"
+#include "Config.h"
+
+#if TRACE_ENABLED
+
+#include <atomic>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+namespace Trace {
+
+namespace {
+
+enum Phase : uint8_t {
+    PHASE_BEGIN,
+    PHASE_END,
+    PHASE_ANCHOR    // `name` is unused; `cycles` pairs with `anchorUs` to align cores
+};
+
+struct Event {
+    const char* name;
+    uint32_t cycles;
+    uint32_t anchorUs;
+    uint8_t phase;
+    uint8_t core;
+};
+
+static_assert((Config::TRACE_BUFFER_EVENTS & (Config::TRACE_BUFFER_EVENTS - 1)) == 0,
+              "TRACE_BUFFER_EVENTS must be a power of two");
+
+// Re-anchor each core at least this often so cycle counts never wrap between anchors
+constexpr TickType_t ANCHOR_INTERVAL_TICKS = pdMS_TO_TICKS(1000);
+
+Event s_events[Config::TRACE_BUFFER_EVENTS];
+std::atomic<uint32_t> s_head{0};
+std::atomic<bool> s_paused{false};
+TickType_t s_lastAnchorTick[2] = {0, 0};
+bool s_anchored[2] = {false, false};
+uint32_t s_overheadCycles = 0;
+
+inline void push(const char* name, uint8_t phase, uint32_t cycles, uint32_t anchorUs, uint8_t core) {
+    Event& e = s_events[s_head.fetch_add(1, std::memory_order_relaxed) & (Config::TRACE_BUFFER_EVENTS - 1)];
+    e.name = name;
+    e.cycles = cycles;
+    e.anchorUs = anchorUs;
+    e.phase = phase;
+    e.core = core;
+}
+
+inline void record(const char* name, uint8_t phase) {
+    if (s_paused.load(std::memory_order_relaxed)) return;
+    const uint8_t core = (uint8_t)xPortGetCoreID();
+    const TickType_t tick = xTaskGetTickCount();
+    if (!s_anchored[core] || tick - s_lastAnchorTick[core] >= ANCHOR_INTERVAL_TICKS) {
+        s_anchored[core] = true;
+        s_lastAnchorTick[core] = tick;
+        push(nullptr, PHASE_ANCHOR, ESP.getCycleCount(), (uint32_t)esp_timer_get_time(), core);
+    }
+    push(name, phase, ESP.getCycleCount(), 0, core);
+}
+
+}
+
+void begin(const char* name) { record(name, PHASE_BEGIN); }
+void end(const char* name) { record(name, PHASE_END); }
+
+void calibrate() {
+    constexpr uint32_t ROUNDS = 64;
+    const uint32_t start = ESP.getCycleCount();
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        Scope scope("trace.calibrate");
+    }
+    s_overheadCycles = (ESP.getCycleCount() - start) / ROUNDS;
+    Serial.printf("[Trace] %lu cycles per scope\n", (unsigned long)s_overheadCycles);
+}
+
+uint32_t overheadCycles() { return s_overheadCycles; }
+
+void writeChromeJson(Print& out) {
+    s_paused.store(true);
+
+    const uint32_t head = s_head.load();
+    const uint32_t count = head < Config::TRACE_BUFFER_EVENTS ? head : Config::TRACE_BUFFER_EVENTS;
+    const uint32_t mhz = ESP.getCpuFreqMHz();
+
+    // Per-core anchor: (cycles, us) pair from the most recent anchor event seen
+    bool haveAnchor[2] = {false, false};
+    uint32_t anchorCycles[2] = {0, 0};
+    uint32_t anchorUs[2] = {0, 0};
+
+    out.print("{\"displayTimeUnit\":\"ms\",\"otherData\":{\"overheadCyclesPerScope\":");
+    out.print(s_overheadCycles);
+    out.print(",\"cpuMHz\":");
+    out.print(mhz);
+    out.print("},\"traceEvents\":[");
+
+    bool first = true;
+    char line[160];
+    for (uint32_t i = head - count; i != head; i++) {
+        const Event& e = s_events[i & (Config::TRACE_BUFFER_EVENTS - 1)];
+        const uint8_t core = e.core & 1;
+        if (e.phase == PHASE_ANCHOR) {
+            haveAnchor[core] = true;
+            anchorCycles[core] = e.cycles;
+            anchorUs[core] = e.anchorUs;
+            continue;
+        }
+        // Events before the first anchor in the window can't be placed on the timeline
+        if (!haveAnchor[core] || !e.name) continue;
+
+        const double ts = anchorUs[core] + (double)(int32_t)(e.cycles - anchorCycles[core]) / mhz;
+        snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+                 first ? "" : ",", e.name, e.phase == PHASE_BEGIN ? 'B' : 'E', ts, core);
+        out.print(line);
+        first = false;
+    }
+    out.print("]}");
+
+    s_paused.store(false);
+}
+
+}
+
+#else
+
+namespace Trace {
+
+void begin(const char* name) { (void)name; }
+void end(const char* name) { (void)name; }
+void calibrate() {}
+uint32_t overheadCycles() { return 0; }
+void writeChromeJson(Print& out) { out.print("{\"traceEvents\":[]}"); }
+
+}
+
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Ring-buffer trace recorder for hot-path profiling, dumped as Chrome
+// trace-event JSON (load in chrome://tracing or ui.perfetto.dev).
+//
+// Off by default: build with -DTRACE_ENABLED=1 to record. When disabled,
+// TRACE_SCOPE expands to nothing and no buffer is reserved.
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0
+#endif
+
+namespace Trace {
+
+constexpr bool enabled = TRACE_ENABLED != 0;
+
+void begin(const char* name);
+void end(const char* name);
+
+// Measures the cost of one begin/end pair; call once at startup
+void calibrate();
+uint32_t overheadCycles();
+
+// Writes the buffered events, oldest first. Recording pauses while dumping.
+void writeChromeJson(Print& out);
+
+class Scope {
+public:
+    explicit Scope(const char* name) : _name(name) { begin(name); }
+    ~Scope() { end(_name); }
+
+private:
+    const char* _name;
+};
+
+}
+
+#if TRACE_ENABLED
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(_traceScope, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#endif
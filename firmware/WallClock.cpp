@@ -0,0 +1,70 @@
+#include "WallClock.h"
+#include <time.h>
+#include "Config.h"
+
+namespace WallClock {
+
+// Anything earlier is the RTC counting from 1970 before the first sync
+static constexpr time_t SYNCED_AFTER = 1700000000;     // Nov 2023
+
+static bool s_started = false;
+
+void begin() {
+    if (s_started) return;
+    s_started = true;
+    // Sets the local zone too (for the sleep schedule); everything here stays UTC
+    configTzTime(Config::TIMEZONE, "pool.ntp.org", "time.google.com");
+    Serial.println("[Clock] SNTP started");
+}
+
+bool isSynced() {
+    return time(nullptr) > SYNCED_AFTER;
+}
+
+uint32_t now() {
+    const time_t t = time(nullptr);
+    return t > SYNCED_AFTER ? (uint32_t)t : 0;
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date (Howard Hinnant's days_from_civil)
+static int32_t daysFromCivil(int32_t y, uint32_t m, uint32_t d) {
+    y -= m <= 2;
+    const int32_t era = (y >= 0 ? y : y - 399) / 400;
+    const uint32_t yoe = (uint32_t)(y - era * 400);
+    const uint32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+void format(uint32_t seconds, char out[21]) {
+    const time_t t = seconds;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    strftime(out, 21, "%Y-%m-%dT%H:%M:%SZ", &tm);
+}
+
+static bool digits(const char* s, uint8_t count, uint32_t& out) {
+    out = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (s[i] < '0' || s[i] > '9') return false;
+        out = out * 10 + (s[i] - '0');
+    }
+    return true;
+}
+
+bool parse(const char* iso, uint32_t& out) {
+    uint32_t year, month, day, hour, minute, second;
+    if (!digits(iso, 4, year) || iso[4] != '-' || !digits(iso + 5, 2, month) || iso[7] != '-' ||
+        !digits(iso + 8, 2, day) || iso[10] != 'T' || !digits(iso + 11, 2, hour) || iso[13] != ':' ||
+        !digits(iso + 14, 2, minute) || iso[16] != ':' || !digits(iso + 17, 2, second)) {
+        return false;
+    }
+    if (year < 1970 || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return false;
+    }
+    const int32_t days = daysFromCivil((int32_t)year, month, day);
+    out = (uint32_t)days * 86400u + hour * 3600u + minute * 60u + second;
+    return true;
+}
+
+}
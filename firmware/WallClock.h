@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Arduino.h>
+
+// UTC wall clock from SNTP. millis() restarts at every boot, so anything that
+// has to line up with the outside world (calendar events, token expiry) uses
+// Unix seconds from here instead.
+namespace WallClock {
+
+// Starts SNTP; call once WiFi is up. Safe to call again after a reconnect.
+void begin();
+
+bool isSynced();
+
+// Unix seconds (UTC); 0 until the first SNTP sync
+uint32_t now();
+
+// "YYYY-MM-DDTHH:MM:SSZ" plus terminator
+void format(uint32_t seconds, char out[21]);
+
+// Parses the leading "YYYY-MM-DDTHH:MM:SS" of an ISO 8601 UTC time (fractions
+// and a trailing 'Z' are ignored); false when malformed
+bool parse(const char* iso, uint32_t& out);
+
+}
@@ -0,0 +1,123 @@
+#include "WifiConnector.h"
+#include "Config.h"
+#include "Metrics.h"
+
+static const char* PREFS_NAMESPACE = "wifi";
+static const char* KEY_CACHED_AP = "ap";
+
+volatile uint32_t WifiConnector::s_associatedUs = 0;
+volatile uint32_t WifiConnector::s_gotIpUs = 0;
+
+void WifiConnector::onEvent(arduino_event_id_t event) {
+    if (event == ARDUINO_EVENT_WIFI_STA_CONNECTED) {
+        s_associatedUs = micros() | 1;
+    } else if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        s_gotIpUs = micros() | 1;
+    }
+}
+
+uint32_t WifiConnector::ssidHash() const {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const char* p = _ssid; *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+    return hash;
+}
+
+void WifiConnector::begin(const char* ssid, const char* pass) {
+    _ssid = ssid;
+    _pass = pass;
+
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false);  // Reconnects are driven by NetworkTask with backoff
+    WiFi.onEvent(onEvent);
+
+    if (Config::WIFI_STATIC_IP[0] != 0) {
+        const auto ip = [](const uint8_t* a) { return IPAddress(a[0], a[1], a[2], a[3]); };
+        WiFi.config(ip(Config::WIFI_STATIC_IP), ip(Config::WIFI_GATEWAY), ip(Config::WIFI_SUBNET),
+                    ip(Config::WIFI_DNS));
+        Serial.println("[WiFi] Using static IP, no DHCP");
+    }
+
+    _prefs.begin(PREFS_NAMESPACE, false);
+    _cacheValid = _prefs.getBytes(KEY_CACHED_AP, &_cache, sizeof(_cache)) == sizeof(_cache) &&
+                  _cache.ssidHash == ssidHash() && _cache.channel != 0;
+}
+
+void WifiConnector::connect(uint32_t nowMs) {
+    _connectStartUs = micros();
+    startAttempt(nowMs, _cacheValid);
+}
+
+void WifiConnector::startAttempt(uint32_t nowMs, bool direct) {
+    _direct = direct;
+    _attemptStartMs = nowMs;
+    _attemptStartUs = micros();
+    s_associatedUs = 0;
+    s_gotIpUs = 0;
+
+    if (direct) {
+        const uint8_t* b = _cache.bssid;
+        Serial.printf("[WiFi] Connecting to '%s' via %02x:%02x:%02x:%02x:%02x:%02x on channel %u\n", _ssid, b[0],
+                      b[1], b[2], b[3], b[4], b[5], _cache.channel);
+        WiFi.begin(_ssid, _pass, _cache.channel, _cache.bssid);
+    } else {
+        Serial.printf("[WiFi] Scanning for '%s'\n", _ssid);
+        WiFi.begin(_ssid, _pass);
+    }
+}
+
+WifiConnector::Result WifiConnector::poll(uint32_t nowMs) {
+    if (WiFi.status() == WL_CONNECTED) {
+        onConnected();
+        return Result::Connected;
+    }
+
+    const uint32_t timeoutMs = _direct ? Config::WIFI_FAST_CONNECT_TIMEOUT_MS : Config::WIFI_CONNECT_TIMEOUT_MS;
+    if (nowMs - _attemptStartMs < timeoutMs) {
+        return Result::Pending;
+    }
+    if (_direct) {
+        // The AP moved channel or was replaced; scan now, and re-cache on success
+        Serial.println("[WiFi] Cached access point didn't answer, falling back to a scan");
+        Metrics::wifiDirectFallbacks++;
+        _cacheValid = false;
+        WiFi.disconnect();
+        startAttempt(nowMs, false);
+        return Result::Pending;
+    }
+    return Result::Failed;
+}
+
+void WifiConnector::onConnected() {
+    const uint32_t nowUs = micros();
+    const uint32_t associatedUs = s_associatedUs;
+    const uint32_t gotIpUs = s_gotIpUs ? s_gotIpUs : nowUs;
+    if (associatedUs) {
+        Metrics::wifiAssociateDuration.observe(associatedUs - _attemptStartUs);
+        Metrics::wifiIpDuration.observe(gotIpUs - associatedUs);
+    }
+    Metrics::wifiConnectDuration.observe(gotIpUs - _connectStartUs);
+    if (_direct) {
+        Metrics::wifiConnectsDirect++;
+    } else {
+        Metrics::wifiConnectsScanned++;
+    }
+    Serial.printf("[WiFi] Connected after %lu ms (%s, associated in %lu ms)\n",
+                  (unsigned long)((gotIpUs - _connectStartUs) / 1000), _direct ? "cached AP" : "scan",
+                  associatedUs ? (unsigned long)((associatedUs - _attemptStartUs) / 1000) : 0UL);
+
+    // Only written when the AP changed, so a normal reconnect costs no flash write
+    CachedAp ap{};
+    ap.ssidHash = ssidHash();
+    const uint8_t* bssid = WiFi.BSSID();
+    if (!bssid) return;
+    memcpy(ap.bssid, bssid, sizeof(ap.bssid));
+    ap.channel = (uint8_t)WiFi.channel();
+    if (!_cacheValid || memcmp(&ap, &_cache, sizeof(ap)) != 0) {
+        _cache = ap;
+        _cacheValid = true;
+        _prefs.putBytes(KEY_CACHED_AP, &_cache, sizeof(_cache));
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <Preferences.h>
+
+// Station connect for NetworkTask. The access point that last worked (BSSID and
+// channel) is kept in NVS, and each attempt first joins it directly, skipping
+// the scan of every channel; if that doesn't associate quickly the attempt
+// falls back to a normal scan. Records how long each phase took.
+class WifiConnector {
+public:
+    enum class Result : uint8_t {
+        Pending,
+        Connected,
+        Failed
+    };
+
+    // Call once from the network task before the first connect()
+    void begin(const char* ssid, const char* pass);
+
+    void connect(uint32_t nowMs);
+
+    // Advances the current attempt; Failed once both paths have timed out
+    Result poll(uint32_t nowMs);
+
+private:
+    // Cached access point, stored as one NVS blob
+    struct CachedAp {
+        uint32_t ssidHash;      // Ignores a cache left by a different network
+        uint8_t bssid[6];
+        uint8_t channel;
+        uint8_t reserved;
+    };
+
+    const char* _ssid = nullptr;
+    const char* _pass = nullptr;
+    Preferences _prefs;
+    CachedAp _cache{};
+    bool _cacheValid = false;
+
+    bool _direct = false;           // Current attempt targets the cached AP
+    uint32_t _attemptStartMs = 0;   // Current path (direct or scan)
+    uint32_t _attemptStartUs = 0;
+    uint32_t _connectStartUs = 0;   // Whole connect(), across both paths
+
+    void startAttempt(uint32_t nowMs, bool direct);
+    void onConnected();
+    uint32_t ssidHash() const;
+
+    // micros() stamps from the WiFi event task; 0 until the event arrives
+    static volatile uint32_t s_associatedUs;
+    static volatile uint32_t s_gotIpUs;
+    static void onEvent(arduino_event_id_t event);
+};
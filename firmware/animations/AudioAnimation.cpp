@@ -0,0 +1,33 @@
+#include "AudioAnimation.h"
+
+void AudioAnimation::onEnter(const AppState& state) {
+    (void)state;
+    _lastSequence = 0;
+    if (!_holding) {
+        _audio.acquire();
+        _holding = true;
+    }
+}
+
+void AudioAnimation::onExit() {
+    if (_holding) {
+        _audio.release();
+        _holding = false;
+    }
+}
+
+bool AudioAnimation::isDue(uint32_t nowMs, const AppState& state) const {
+    (void)nowMs;
+    (void)state;
+    return _audio.sequence() != _lastSequence;
+}
+
+uint32_t AudioAnimation::msUntilDue(uint32_t nowMs, const AppState& state) const {
+    // Each hop notifies the render loop
+    return isDue(nowMs, state) ? 0 : IdleControl::FOREVER;
+}
+
+void AudioAnimation::take(AudioFeatures& features) {
+    _audio.latest(features);
+    _lastSequence = features.sequence;
+}
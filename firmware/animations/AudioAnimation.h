@@ -0,0 +1,26 @@
+#pragma once
+
+#include "IAnimation.h"
+#include "../AudioInput.h"
+
+// Base for the microphone-driven animations: holds the audio input while
+// shown, and is due whenever the audio task published a new hop
+class AudioAnimation : public IAnimation {
+public:
+    explicit AudioAnimation(AudioInput& audio) : _audio(audio) {}
+
+    void onEnter(const AppState& state) override;
+    void onExit() override;
+    bool isDue(uint32_t nowMs, const AppState& state) const override;
+    uint32_t msUntilDue(uint32_t nowMs, const AppState& state) const override;
+
+protected:
+    AudioInput& _audio;
+    uint32_t _lastSequence = 0;
+
+    // Reads the latest features and marks them rendered
+    void take(AudioFeatures& features);
+
+private:
+    bool _holding = false;
+};
@@ -0,0 +1,59 @@
+#include "BeatPulseAnimation.h"
+
+void BeatPulseAnimation::onEnter(const AppState& state) {
+    AudioAnimation::onEnter(state);
+    AudioFeatures features;
+    _audio.latest(features);
+    _beatCount = features.beatCount;    // Don't flash for a beat from before we were shown
+    _fading = true;                     // One frame to clear the strip
+    _pulseLevel = 0;
+}
+
+uint32_t BeatPulseAnimation::fadeMs(const AppState& state) {
+    const uint32_t ms = (uint32_t)state.speedMs * 8;
+    return ms ? ms : 1;
+}
+
+bool BeatPulseAnimation::isDue(uint32_t nowMs, const AppState& state) const {
+    return msUntilDue(nowMs, state) == 0;
+}
+
+uint32_t BeatPulseAnimation::msUntilDue(uint32_t nowMs, const AppState& state) const {
+    // Hops without a new beat change nothing while the strip is dark
+    AudioFeatures features;
+    _audio.latest(features);
+    if (features.beatCount != _beatCount) return 0;
+    if (!_fading) return IdleControl::FOREVER;
+    // Fade at a fixed frame rate rather than every loop pass
+    const uint32_t elapsed = nowMs - _lastRenderMs;
+    return elapsed >= FADE_FRAME_MS ? 0 : FADE_FRAME_MS - elapsed;
+}
+
+void BeatPulseAnimation::render(uint32_t nowMs, const AppState& state, PixelSpan& span) {
+    AudioFeatures features;
+    take(features);
+    _lastRenderMs = nowMs;
+
+    if (features.beatCount != _beatCount) {
+        _beatCount = features.beatCount;
+        _pulseStartMs = nowMs;
+        // Even a weak beat gives a visible flash
+        _pulseLevel = (uint16_t)(0x4000 + (uint32_t)features.beatStrength * (0xFFFF - 0x4000) / 255);
+        _fading = true;
+    }
+
+    uint16_t level = 0;
+    const uint32_t elapsed = nowMs - _pulseStartMs;
+    const uint32_t fade = fadeMs(state);
+    if (_pulseLevel && elapsed < fade) {
+        // Quadratic falloff reads as a sharper attack than a linear one
+        const uint32_t remaining = ((fade - elapsed) << 16) / fade;     // 16.16 fraction left
+        level = (uint16_t)(((uint64_t)_pulseLevel * remaining * remaining) >> 32);
+    } else {
+        _fading = false;
+    }
+
+    for (uint16_t i = 0; i < span.numPixels(); i++) {
+        span.setPixelScaled(i, state.primaryColor, level);
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "AudioAnimation.h"
+
+// Flashes the whole strip in the primary color on each detected beat, scaled
+// by the beat's strength, and fades out over state.speedMs * 8
+class BeatPulseAnimation : public AudioAnimation {
+public:
+    using AudioAnimation::AudioAnimation;
+
+    const char* name() const override { return "beat"; }
+    IAnimation* clone() const override { return new BeatPulseAnimation(_audio); }
+    void onEnter(const AppState& state) override;
+    bool isDue(uint32_t nowMs, const AppState& state) const override;
+    uint32_t msUntilDue(uint32_t nowMs, const AppState& state) const override;
+    void render(uint32_t nowMs, const AppState& state, PixelSpan& span) override;
+
+private:
+    static constexpr uint32_t FADE_FRAME_MS = 10;
+
+    uint32_t _beatCount = 0;
+    uint32_t _pulseStartMs = 0;
+    uint32_t _lastRenderMs = 0;
+    uint16_t _pulseLevel = 0;
+    bool _fading = false;
+
+    static uint32_t fadeMs(const AppState& state);
+};
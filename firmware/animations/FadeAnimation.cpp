@@ -2,26 +2,36 @@
 
 void FadeAnimation::onEnter(const AppState& state) {
     (void)state;
-    _brightness = 0;
-    _increasing = true;
-    _lastStepMs = 0;
+    _lastStep = UINT32_MAX;
 }
 
-void FadeAnimation::update(uint32_t nowMs, const AppState& state, LedRing& ring) {
-    if (nowMs - _lastStepMs < state.speedMs) return;
-    _lastStepMs = nowMs;
+bool FadeAnimation::isDue(uint32_t nowMs, const AppState& state) const {
+    return nowMs / (state.speedMs ? state.speedMs : 1) != _lastStep;
+}
 
-    if (_increasing) {
-        if (_brightness < 255) _brightness += 5;
-        if (_brightness >= 255) { _brightness = 255; _increasing = false; }
-    } else {
-        if (_brightness > 0) _brightness -= 5;
-        if (_brightness == 0) _increasing = true;
-    }
+uint32_t FadeAnimation::msUntilDue(uint32_t nowMs, const AppState& state) const {
+    const uint32_t speed = state.speedMs ? state.speedMs : 1;
+    return nowMs / speed != _lastStep ? 0 : speed - nowMs % speed;
+}
+
+bool FadeAnimation::period(const AppState& state, uint16_t numPixels, uint32_t& stepMs, uint32_t& frames) const {
+    (void)numPixels;
+    stepMs = state.speedMs ? state.speedMs : 1;
+    frames = 2 * RAMP_STEPS;
+    return true;
+}
+
+void FadeAnimation::render(uint32_t nowMs, const AppState& state, PixelSpan& span) {
+    // Phase is derived from the clock alone, so devices sharing a timebase fade in step
+    const uint32_t step = nowMs / (state.speedMs ? state.speedMs : 1);
+    _lastStep = step;
+
+    const uint32_t pos = step % (2 * RAMP_STEPS);
+    const uint32_t ramp = pos <= RAMP_STEPS ? pos : 2 * RAMP_STEPS - pos;
+    const uint32_t scaled = ramp * STEP;
+    const uint16_t level = scaled > 0xFFFF ? 0xFFFF : (uint16_t)scaled;
 
-    uint32_t color = LedRing::scaleColor(state.primaryColor, _brightness / 255.0f);
-    for (uint16_t i = 0; i < ring.numPixels(); i++) {
-        ring.setPixelColor(i, color);
+    for (uint16_t i = 0; i < span.numPixels(); i++) {
+        span.setPixelScaled(i, state.primaryColor, level);
     }
-    ring.show();
 }
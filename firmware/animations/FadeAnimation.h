@@ -5,11 +5,18 @@
 class FadeAnimation : public IAnimation {
 public:
     const char* name() const override { return "fade"; }
+    IAnimation* clone() const override { return new FadeAnimation(*this); }
     void onEnter(const AppState& state) override;
-    void update(uint32_t nowMs, const AppState& state, LedRing& ring) override;
+    bool isDue(uint32_t nowMs, const AppState& state) const override;
+    uint32_t msUntilDue(uint32_t nowMs, const AppState& state) const override;
+    bool period(const AppState& state, uint16_t numPixels, uint32_t& stepMs, uint32_t& frames) const override;
+    void render(uint32_t nowMs, const AppState& state, PixelSpan& span) override;
 
 private:
-    uint32_t _lastStepMs = 0;
-    uint8_t _brightness = 0;
-    bool _increasing = true;
+    // Same cadence as the old 8-bit step of 5, at 16-bit resolution
+    static constexpr uint16_t STEP = 5 * 257;
+    // Steps from off to full; one fade cycle is twice this
+    static constexpr uint32_t RAMP_STEPS = (0xFFFF + STEP - 1) / STEP;
+
+    uint32_t _lastStep = UINT32_MAX;
 };
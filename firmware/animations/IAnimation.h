@@ -2,7 +2,8 @@
 
 #include <Arduino.h>
 #include "../AppState.h"
-#include "../LedRing.h"
+#include "../PixelSpan.h"
+#include "../IdleControl.h"
 
 class IAnimation {
 public:
@@ -10,12 +11,34 @@ public:
 
     virtual const char* name() const = 0;
 
+    // Returns an independent instance (own phase state) for a segment
+    virtual IAnimation* clone() const = 0;
+
     // Called when this animation becomes active
     virtual void onEnter(const AppState& state) { (void)state; }
 
     // Called when switching away from this animation
     virtual void onExit() {}
 
-    // Called every loop iteration; must be non-blocking
-    virtual void update(uint32_t nowMs, const AppState& state, LedRing& ring) = 0;
+    // True when render() would produce a different frame; must be cheap
+    virtual bool isDue(uint32_t nowMs, const AppState& state) const = 0;
+
+    // Milliseconds until isDue() turns true (0 if it already is), or
+    // IdleControl::FOREVER when only a state change can make it due
+    virtual uint32_t msUntilDue(uint32_t nowMs, const AppState& state) const = 0;
+
+    // Periodic animations: for this state and span length, render() depends only
+    // on nowMs / stepMs, repeating every `frames` steps. AnimationManager then
+    // replays cached frames instead of rendering. False when not periodic.
+    virtual bool period(const AppState& state, uint16_t numPixels, uint32_t& stepMs, uint32_t& frames) const {
+        (void)state;
+        (void)numPixels;
+        (void)stepMs;
+        (void)frames;
+        return false;
+    }
+
+    // Draws the current frame into `span`. Must be non-blocking and must not
+    // call show(); AnimationManager shows the ring once per pass.
+    virtual void render(uint32_t nowMs, const AppState& state, PixelSpan& span) = 0;
 };
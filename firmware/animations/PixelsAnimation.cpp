@@ -6,17 +6,22 @@ void PixelsAnimation::onEnter(const AppState& state) {
     _lastVersion = 0;
 }
 
-void PixelsAnimation::update(uint32_t nowMs, const AppState& state, LedRing& ring) {
+bool PixelsAnimation::isDue(uint32_t nowMs, const AppState& state) const {
     (void)nowMs;
+    return _lastVersion != state.pixelVersion;
+}
 
-    if (_lastVersion == state.pixelVersion) {
-        return;
-    }
+uint32_t PixelsAnimation::msUntilDue(uint32_t nowMs, const AppState& state) const {
+    (void)nowMs;
+    // New pixels arrive as commands, which wake the loop
+    return _lastVersion != state.pixelVersion ? 0 : IdleControl::FOREVER;
+}
 
-    const uint16_t n = ring.numPixels();
+void PixelsAnimation::render(uint32_t nowMs, const AppState& state, PixelSpan& span) {
+    (void)nowMs;
+    const uint16_t n = span.numPixels();
     for (uint16_t i = 0; i < n && i < Config::NUM_PIXELS; i++) {
-        ring.setPixelColor(i, state.pixelColors[i]);
+        span.setPixelColor(i, state.pixelColors[i]);
     }
-    ring.show();
     _lastVersion = state.pixelVersion;
 }
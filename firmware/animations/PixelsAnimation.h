@@ -5,8 +5,11 @@
 class PixelsAnimation : public IAnimation {
 public:
     const char* name() const override { return "pixels"; }
+    IAnimation* clone() const override { return new PixelsAnimation(*this); }
     void onEnter(const AppState& state) override;
-    void update(uint32_t nowMs, const AppState& state, LedRing& ring) override;
+    bool isDue(uint32_t nowMs, const AppState& state) const override;
+    uint32_t msUntilDue(uint32_t nowMs, const AppState& state) const override;
+    void render(uint32_t nowMs, const AppState& state, PixelSpan& span) override;
 
 private:
     uint32_t _lastVersion = 0;
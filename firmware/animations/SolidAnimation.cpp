@@ -5,16 +5,23 @@ void SolidAnimation::onEnter(const AppState& state) {
     _needsRefresh = true;
 }
 
-void SolidAnimation::update(uint32_t nowMs, const AppState& state, LedRing& ring) {
+bool SolidAnimation::isDue(uint32_t nowMs, const AppState& state) const {
     (void)nowMs;
-    
-    // Only refresh when entering or if state might have changed
-    // For efficiency, we set all pixels once and then just maintain
-    if (_needsRefresh) {
-        for (uint16_t i = 0; i < ring.numPixels(); i++) {
-            ring.setPixelColor(i, state.primaryColor);
-        }
-        ring.show();
-        _needsRefresh = false;
+    (void)state;
+    // Only refresh when entering; the frame is static after that
+    return _needsRefresh;
+}
+
+uint32_t SolidAnimation::msUntilDue(uint32_t nowMs, const AppState& state) const {
+    (void)nowMs;
+    (void)state;
+    return _needsRefresh ? 0 : IdleControl::FOREVER;
+}
+
+void SolidAnimation::render(uint32_t nowMs, const AppState& state, PixelSpan& span) {
+    (void)nowMs;
+    for (uint16_t i = 0; i < span.numPixels(); i++) {
+        span.setPixelColor(i, state.primaryColor);
     }
+    _needsRefresh = false;
 }
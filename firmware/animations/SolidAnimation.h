@@ -5,8 +5,11 @@
 class SolidAnimation : public IAnimation {
 public:
     const char* name() const override { return "solid"; }
+    IAnimation* clone() const override { return new SolidAnimation(*this); }
     void onEnter(const AppState& state) override;
-    void update(uint32_t nowMs, const AppState& state, LedRing& ring) override;
+    bool isDue(uint32_t nowMs, const AppState& state) const override;
+    uint32_t msUntilDue(uint32_t nowMs, const AppState& state) const override;
+    void render(uint32_t nowMs, const AppState& state, PixelSpan& span) override;
 
 private:
     bool _needsRefresh = true;
@@ -0,0 +1,23 @@
+#include "SpectrumAnimation.h"
+#include "../ColorCodec.h"
+
+void SpectrumAnimation::render(uint32_t nowMs, const AppState& state, PixelSpan& span) {
+    (void)nowMs;
+    (void)state;
+    AudioFeatures features;
+    take(features);
+
+    const uint16_t n = span.numPixels();
+    for (uint16_t i = 0; i < n; i++) {
+        // Pixels split the bands evenly; with more pixels than bands, neighbours share one
+        size_t first = (size_t)i * AudioFeatures::BANDS / n;
+        size_t last = (size_t)(i + 1) * AudioFeatures::BANDS / n;
+        if (last <= first) last = first + 1;
+        uint32_t sum = 0;
+        for (size_t b = first; b < last; b++) sum += features.bands[b];
+        const uint32_t energy = sum / (last - first);
+
+        const uint16_t hue = n > 1 ? (uint16_t)(i * 270u / (n - 1)) : 0;
+        span.setPixelScaled(i, ColorCodec::hsvToRgb(hue, 255, 255), (uint16_t)(energy * 257));
+    }
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "AudioAnimation.h"
+
+// One color per pixel, bass at pixel 0 through treble at the far end (red to
+// violet), each lit by the energy of the bands it covers
+class SpectrumAnimation : public AudioAnimation {
+public:
+    using AudioAnimation::AudioAnimation;
+
+    const char* name() const override { return "spectrum"; }
+    IAnimation* clone() const override { return new SpectrumAnimation(_audio); }
+    void render(uint32_t nowMs, const AppState& state, PixelSpan& span) override;
+};
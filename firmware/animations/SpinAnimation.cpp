@@ -2,17 +2,30 @@
 
 void SpinAnimation::onEnter(const AppState& state) {
     (void)state;
-    _position = 0;
-    _lastStepMs = 0;
+    _lastStep = UINT32_MAX;
 }
 
-void SpinAnimation::update(uint32_t nowMs, const AppState& state, LedRing& ring) {
-    if (nowMs - _lastStepMs < state.speedMs) return;
-    _lastStepMs = nowMs;
+bool SpinAnimation::isDue(uint32_t nowMs, const AppState& state) const {
+    return nowMs / (state.speedMs ? state.speedMs : 1) != _lastStep;
+}
+
+uint32_t SpinAnimation::msUntilDue(uint32_t nowMs, const AppState& state) const {
+    const uint32_t speed = state.speedMs ? state.speedMs : 1;
+    return nowMs / speed != _lastStep ? 0 : speed - nowMs % speed;
+}
+
+bool SpinAnimation::period(const AppState& state, uint16_t numPixels, uint32_t& stepMs, uint32_t& frames) const {
+    // The head goes once round the span
+    stepMs = state.speedMs ? state.speedMs : 1;
+    frames = numPixels;
+    return numPixels > 0;
+}
 
-    ring.clear();
-    ring.setPixelColor(_position, state.primaryColor);
-    ring.show();
+void SpinAnimation::render(uint32_t nowMs, const AppState& state, PixelSpan& span) {
+    const uint32_t step = nowMs / (state.speedMs ? state.speedMs : 1);
+    _lastStep = step;
 
-    _position = (_position + 1) % ring.numPixels();
+    span.clear();
+    if (span.numPixels() == 0) return;
+    span.setPixelColor(step % span.numPixels(), state.primaryColor);
 }
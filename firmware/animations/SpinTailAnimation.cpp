@@ -2,27 +2,40 @@
 
 void SpinTailAnimation::onEnter(const AppState& state) {
     (void)state;
-    _headPosition = 0;
-    _lastStepMs = 0;
+    _lastStep = UINT32_MAX;
 }
 
-void SpinTailAnimation::update(uint32_t nowMs, const AppState& state, LedRing& ring) {
-    if (nowMs - _lastStepMs < state.speedMs) return;
-    _lastStepMs = nowMs;
+bool SpinTailAnimation::isDue(uint32_t nowMs, const AppState& state) const {
+    return nowMs / (state.speedMs ? state.speedMs : 1) != _lastStep;
+}
+
+uint32_t SpinTailAnimation::msUntilDue(uint32_t nowMs, const AppState& state) const {
+    const uint32_t speed = state.speedMs ? state.speedMs : 1;
+    return nowMs / speed != _lastStep ? 0 : speed - nowMs % speed;
+}
 
-    uint16_t numPixels = ring.numPixels();
+bool SpinTailAnimation::period(const AppState& state, uint16_t numPixels, uint32_t& stepMs, uint32_t& frames) const {
+    // The head goes once round the span
+    stepMs = state.speedMs ? state.speedMs : 1;
+    frames = numPixels;
+    return numPixels > 0;
+}
+
+void SpinTailAnimation::render(uint32_t nowMs, const AppState& state, PixelSpan& span) {
+    const uint32_t step = nowMs / (state.speedMs ? state.speedMs : 1);
+    _lastStep = step;
+
+    span.clear();
+    uint16_t numPixels = span.numPixels();
+    if (numPixels == 0) return;
+    uint16_t headPosition = step % numPixels;
     uint8_t tailLen = state.tailLength;
     if (tailLen > numPixels) tailLen = numPixels;
 
-    ring.clear();
     for (uint8_t t = 0; t < tailLen; t++) {
-        int16_t idx = (int16_t)_headPosition - t;
+        int16_t idx = (int16_t)headPosition - t;
         if (idx < 0) idx += numPixels;
-        float factor = 1.0f - (float)t / tailLen;
-        uint32_t color = LedRing::scaleColor(state.primaryColor, factor);
-        ring.setPixelColor((uint16_t)idx, color);
+        uint16_t level = (uint16_t)(0xFFFFUL * (tailLen - t) / tailLen);
+        span.setPixelScaled((uint16_t)idx, state.primaryColor, level);
     }
-    ring.show();
-
-    _headPosition = (_headPosition + 1) % numPixels;
 }
@@ -5,10 +5,13 @@
 class SpinTailAnimation : public IAnimation {
 public:
     const char* name() const override { return "spinTail"; }
+    IAnimation* clone() const override { return new SpinTailAnimation(*this); }
     void onEnter(const AppState& state) override;
-    void update(uint32_t nowMs, const AppState& state, LedRing& ring) override;
+    bool isDue(uint32_t nowMs, const AppState& state) const override;
+    uint32_t msUntilDue(uint32_t nowMs, const AppState& state) const override;
+    bool period(const AppState& state, uint16_t numPixels, uint32_t& stepMs, uint32_t& frames) const override;
+    void render(uint32_t nowMs, const AppState& state, PixelSpan& span) override;
 
 private:
-    uint32_t _lastStepMs = 0;
-    uint16_t _headPosition = 0;
+    uint32_t _lastStep = UINT32_MAX;
 };
@@ -2,21 +2,41 @@
 
 void StrobeAnimation::onEnter(const AppState& state) {
     (void)state;
-    _on = false;
-    _lastToggleMs = 0;
+    _lastPhase = UINT32_MAX;
 }
 
-void StrobeAnimation::update(uint32_t nowMs, const AppState& state, LedRing& ring) {
-    uint16_t halfPeriod = state.strobePeriodMs / 2;
-    if (halfPeriod == 0) halfPeriod = 50;
+uint16_t StrobeAnimation::halfPeriodOf(const AppState& state) {
+    const uint16_t halfPeriod = state.strobePeriodMs / 2;
+    return halfPeriod ? halfPeriod : 50;
+}
+
+uint32_t StrobeAnimation::phaseAt(uint32_t nowMs, const AppState& state) {
+    return nowMs / halfPeriodOf(state);
+}
+
+bool StrobeAnimation::isDue(uint32_t nowMs, const AppState& state) const {
+    return phaseAt(nowMs, state) != _lastPhase;
+}
+
+uint32_t StrobeAnimation::msUntilDue(uint32_t nowMs, const AppState& state) const {
+    const uint16_t halfPeriod = halfPeriodOf(state);
+    return nowMs / halfPeriod != _lastPhase ? 0 : halfPeriod - nowMs % halfPeriod;
+}
+
+bool StrobeAnimation::period(const AppState& state, uint16_t numPixels, uint32_t& stepMs, uint32_t& frames) const {
+    (void)numPixels;
+    stepMs = halfPeriodOf(state);
+    frames = 2;     // On, off
+    return true;
+}
 
-    if (nowMs - _lastToggleMs < halfPeriod) return;
-    _lastToggleMs = nowMs;
+void StrobeAnimation::render(uint32_t nowMs, const AppState& state, PixelSpan& span) {
+    const uint32_t phase = phaseAt(nowMs, state);
+    _lastPhase = phase;
 
-    _on = !_on;
-    uint32_t color = _on ? state.primaryColor : 0;
-    for (uint16_t i = 0; i < ring.numPixels(); i++) {
-        ring.setPixelColor(i, color);
+    const bool on = (phase & 1) == 0;
+    uint32_t color = on ? state.primaryColor : 0;
+    for (uint16_t i = 0; i < span.numPixels(); i++) {
+        span.setPixelColor(i, color);
     }
-    ring.show();
 }
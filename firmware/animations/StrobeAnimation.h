@@ -5,10 +5,16 @@
 class StrobeAnimation : public IAnimation {
 public:
     const char* name() const override { return "strobe"; }
+    IAnimation* clone() const override { return new StrobeAnimation(*this); }
     void onEnter(const AppState& state) override;
-    void update(uint32_t nowMs, const AppState& state, LedRing& ring) override;
+    bool isDue(uint32_t nowMs, const AppState& state) const override;
+    uint32_t msUntilDue(uint32_t nowMs, const AppState& state) const override;
+    bool period(const AppState& state, uint16_t numPixels, uint32_t& stepMs, uint32_t& frames) const override;
+    void render(uint32_t nowMs, const AppState& state, PixelSpan& span) override;
 
 private:
-    uint32_t _lastToggleMs = 0;
-    bool _on = false;
+    uint32_t _lastPhase = UINT32_MAX;
+
+    static uint16_t halfPeriodOf(const AppState& state);
+    static uint32_t phaseAt(uint32_t nowMs, const AppState& state);
 };
@@ -0,0 +1,34 @@
+#include "VuMeterAnimation.h"
+
+void VuMeterAnimation::onEnter(const AppState& state) {
+    AudioAnimation::onEnter(state);
+    _peak = 0;
+}
+
+void VuMeterAnimation::render(uint32_t nowMs, const AppState& state, PixelSpan& span) {
+    (void)nowMs;
+    AudioFeatures features;
+    take(features);
+
+    const uint16_t n = span.numPixels();
+    if (n == 0) return;
+
+    // Level in 16-bit units across the whole strip: whole pixels, then a partial one
+    const uint32_t lit = (uint32_t)features.level * 257 * n;
+    _peak = _peak > PEAK_FALL_PER_HOP ? _peak - PEAK_FALL_PER_HOP : 0;
+    if (lit > _peak) _peak = lit;
+
+    span.clear();
+    for (uint16_t i = 0; i < n; i++) {
+        const uint32_t start = (uint32_t)i * 0xFFFF;
+        if (lit >= start + 0xFFFF) {
+            span.setPixelColor(i, state.primaryColor);
+        } else if (lit > start) {
+            span.setPixelScaled(i, state.primaryColor, (uint16_t)(lit - start));
+        }
+    }
+    const uint16_t peakPixel = (uint16_t)(_peak / 0xFFFF);
+    if (_peak > lit + 0xFFFF / 4 && peakPixel < n) {
+        span.setPixelColor(peakPixel, state.secondaryColor ? state.secondaryColor : 0xFFFFFF);
+    }
+}
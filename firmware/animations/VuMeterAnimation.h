@@ -0,0 +1,20 @@
+#pragma once
+
+#include "AudioAnimation.h"
+
+// Lights the strip from pixel 0 up in proportion to loudness, with the last
+// pixel partially lit; the peak is held in the secondary color and falls back slowly
+class VuMeterAnimation : public AudioAnimation {
+public:
+    using AudioAnimation::AudioAnimation;
+
+    const char* name() const override { return "vu"; }
+    IAnimation* clone() const override { return new VuMeterAnimation(_audio); }
+    void onEnter(const AppState& state) override;
+    void render(uint32_t nowMs, const AppState& state, PixelSpan& span) override;
+
+private:
+    static constexpr uint32_t PEAK_FALL_PER_HOP = 0x0400;     // Of 0xFFFF full scale
+
+    uint32_t _peak = 0;
+};
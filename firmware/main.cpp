@@ -1,15 +1,28 @@
 #include <Arduino.h>
-#include <WiFi.h>
 
 #include "Config.h"
-#include "AppState.h"
+#include "AppStateStore.h"
+#include "CommandQueue.h"
 #include "LedRing.h"
 #include "AnimationManager.h"
 #include "ButtonInput.h"
 #include "Commands.h"
 #include "HttpApi.h"
+#include "StatePersistence.h"
+#include "NetworkTask.h"
+#include "FleetSync.h"
+#include "MqttBridge.h"
+#include "BootTimings.h"
+#include "Metrics.h"
+#include "Trace.h"
 #include "MicrosoftAuth.h"
 #include "TeamsPresence.h"
+#include "PresenceRules.h"
+#include "FixedString.h"
+#include "IdleControl.h"
+#include "AudioInput.h"
+#include "DeepSleep.h"
+#include "Memory.h"
 
 #include "animations/FadeAnimation.h"
 #include "animations/SpinAnimation.h"
@@ -17,6 +30,9 @@
 #include "animations/StrobeAnimation.h"
 #include "animations/SolidAnimation.h"
 #include "animations/PixelsAnimation.h"
+#include "animations/VuMeterAnimation.h"
+#include "animations/SpectrumAnimation.h"
+#include "animations/BeatPulseAnimation.h"
 
 // ============ WiFi Configuration ============
 // TODO: Replace with your WiFi credentials
@@ -24,23 +40,36 @@ const char* WIFI_SSID = "Loading...";
 const char* WIFI_PASS = "wasthatyourstomach";
 
 // ============ Global Objects ============
-AppState appState;
+AppStateStore appStore;
+CommandQueue commandQueue;
+uint32_t renderedSequence = 0;   // Store sequence the last rendered frame was taken at
 LedRing ledRing(Config::LED_PIN, Config::NUM_PIXELS);
 AnimationManager animMgr;
+StatePersistence persistence;
 ButtonInput button(Config::BUTTON_PIN, true);  // active-low (pull-up)
-HttpApi* httpApi = nullptr;
 
 // Microsoft Graph / Teams presence
-MicrosoftAuth msAuth(Config::MS_CLIENT_ID, Config::MS_TENANT_ID);
-TeamsPresence teamsPresence(msAuth);
+HttpsSession graphSession;      // Shared TLS connection, used only by the network task
+MicrosoftAuth msAuth(Config::MS_CLIENT_ID, Config::MS_TENANT_ID, graphSession);
+TeamsPresence teamsPresence(msAuth, graphSession);
+NetworkTask netTask(msAuth, teamsPresence, graphSession, WIFI_SSID, WIFI_PASS);
+FleetSync fleet;
+MqttBridge mqtt(appStore, commandQueue);
+AudioInput audio;
 
-// Presence polling state
-unsigned long lastPresencePoll = 0;
-bool authInProgress = false;
-Presence lastPresence = Presence::Unknown;
-unsigned long strobeStartTime = 0;
-bool inStrobePhase = false;
-String strobeThen = "";
+// Presence effect state
+PresenceRules presenceRules;
+
+// Constructed statically, started once WiFi is up
+HttpApi httpApi(appStore, commandQueue, animMgr, ledRing, persistence, fleet, presenceRules);
+bool httpStarted = false;
+PresenceStatus lastPresence;
+PresenceStatus memberStatus[Config::TEAM_MEMBER_COUNT];
+uint32_t appliedRulesVersion = 0;
+unsigned long introStartTime = 0;
+unsigned long introDurationMs = 0;
+bool inIntroPhase = false;
+FixedString<AppState::ANIMATION_NAME_LEN - 1> introThen;
 
 // Animation instances
 FadeAnimation fadeAnim;
@@ -49,35 +78,37 @@ SpinTailAnimation spinTailAnim;
 StrobeAnimation strobeAnim;
 SolidAnimation solidAnim;
 PixelsAnimation pixelsAnim;
-
-void connectWiFi() {
-    Serial.print("Connecting to WiFi");
-    WiFi.begin(WIFI_SSID, WIFI_PASS);
-    
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 30) {
-        delay(500);
-        Serial.print(".");
-        attempts++;
-    }
-    
-    if (WiFi.status() == WL_CONNECTED) {
-        Serial.println(" Connected!");
-        Serial.print("IP Address: ");
-        Serial.println(WiFi.localIP());
-    } else {
-        Serial.println(" Failed to connect. HTTP API will not be available.");
-    }
-}
+VuMeterAnimation vuAnim(audio);
+SpectrumAnimation spectrumAnim(audio);
+BeatPulseAnimation beatAnim(audio);
 
 void setup() {
     Serial.begin(115200);
-    delay(1000);
     Serial.println("\n=== Teams Ring Starting ===");
 
+    // A timer wake that is still off-hours goes back to sleep before WiFi or the ring start
+    DeepSleep::begin();
+    if (const uint32_t sleepSeconds = DeepSleep::due(millis())) {
+        DeepSleep::enter(sleepSeconds);
+    }
+
+    // Every arena is reserved here; the loop, HTTP and network code draw from them instead of the heap
+    Memory::begin();
+
+    // Restore the last saved state before anything slow, so the first frame is already correct
+    IdleControl::begin();
+    commandQueue.begin();
+    persistence.begin();
+    AppState restored;
+    if (persistence.load(restored)) {
+        appStore.update([&restored](AppState& s) { s = restored; });
+    }
+    const AppState initial = appStore.snapshot(renderedSequence);
+    presenceRules.begin();
+
     // Initialize LED ring
     ledRing.begin();
-    ledRing.setBrightness(appState.brightness);
+    ledRing.setBrightness(initial.brightness);
     ledRing.clear();
     ledRing.show();
     Serial.println("LED ring initialized");
@@ -89,53 +120,110 @@ void setup() {
     animMgr.addAnimation(&strobeAnim);
     animMgr.addAnimation(&solidAnim);
     animMgr.addAnimation(&pixelsAnim);
-    animMgr.setActive(appState.currentAnimationName, appState);
+    if (Config::AUDIO_ENABLED) {
+        audio.start();
+        animMgr.addAnimation(&vuAnim);
+        animMgr.addAnimation(&spectrumAnim);
+        animMgr.addAnimation(&beatAnim);
+    }
+    animMgr.setActive(initial.animation, initial);
     Serial.println("Animations registered");
 
     // Initialize button
     button.begin();
     Serial.println("Button initialized");
 
-    // Connect to WiFi and start HTTP API
-    connectWiFi();
-    if (WiFi.status() == WL_CONNECTED) {
-        httpApi = new HttpApi(appState, animMgr, ledRing);
-        httpApi->begin();
-        Serial.println("HTTP API started on port 80");
-        
-        // Initialize Microsoft auth
-        msAuth.begin();
-        
-        // Check if we have a valid token, otherwise start device flow
-        if (!msAuth.hasValidToken()) {
-            Serial.println("No valid token found, starting device flow...");
-            if (msAuth.startDeviceFlow()) {
-                authInProgress = true;
-            }
-        } else {
-            Serial.println("Valid token found, will poll presence");
-        }
+    Trace::calibrate();
+
+    // WiFi, auth and presence come up in the background; the loop starts rendering immediately
+    netTask.start();
+    if (Config::MQTT_ENABLED) {
+        mqtt.start();
     }
 
     Serial.println("=== Setup Complete ===\n");
 }
 
-void loop() {
-    uint32_t nowMs = millis();
+// Team mode: each member owns a pixel range that shows their rule's color
+void applyMemberPresence(const NetworkTask::MemberPresence& update) {
+    memberStatus[update.member] = update.status;
+    appliedRulesVersion = presenceRules.version();
+    const Config::TeamMember& member = Config::TEAM_MEMBERS[update.member];
+    const PresenceRule& rule = presenceRules.lookup(update.status.presence, update.status.activity);
+    Serial.printf("Team member %u -> %s\n", update.member,
+                  TeamsPresence::presenceToString(update.status.presence));
+
+    Commands::fillPixels(commandQueue, member.firstPixel, member.pixelCount, rule.color);
+    Commands::setAnimation(commandQueue, "pixels");
+}
+
+void applyPresence(const PresenceStatus& status, uint32_t nowMs) {
+    Serial.printf("Presence changed: %s -> %s (%s)\n",
+                  TeamsPresence::presenceToString(lastPresence.presence),
+                  TeamsPresence::presenceToString(status.presence),
+                  TeamsPresence::activityToString(status.activity));
+    lastPresence = status;
+    appliedRulesVersion = presenceRules.version();
+
+    const PresenceRule& rule = presenceRules.lookup(status.presence, status.activity);
+
+    const bool off = strcmp(rule.animation, "off") == 0;
+    const bool intro = !off && rule.intro[0] != '\0' && rule.introMs > 0;
+
+    // Queued together, so they land in the same frame's single store update
+    Commands::setColor(commandQueue, rule.color);
+    Commands::maskPixels(commandQueue, rule.pixelMask, rule.color);
+    Commands::setPower(commandQueue, !off);
+    if (!off) {
+        Commands::setAnimation(commandQueue, intro ? rule.intro : rule.animation);
+    }
+
+    inIntroPhase = intro;
+    if (intro) {
+        Serial.printf("Starting %s -> %s\n", rule.intro, rule.animation);
+        introStartTime = nowMs;
+        introDurationMs = rule.introMs;
+        introThen.assign(rule.animation);
+    }
+}
+
+void applyFleetCommand(const FleetCommand& cmd) {
+    Serial.printf("[Fleet] Command fields=0x%02X\n", cmd.fields);
+    if (cmd.fields & FleetCommand::BRIGHTNESS) {
+        Commands::setBrightness(commandQueue, cmd.brightness);
+    }
+    if (cmd.fields & FleetCommand::COLOR) {
+        Commands::setColor(commandQueue, cmd.color);
+    }
+    if (cmd.fields & FleetCommand::SPEED) {
+        Commands::setSpeed(commandQueue, cmd.speedMs);
+    }
+    if (cmd.fields & FleetCommand::ANIMATION) {
+        Commands::setAnimation(commandQueue, cmd.animation);
+    }
+    if (cmd.fields & FleetCommand::POWER) {
+        Commands::setPower(commandQueue, cmd.powerOn);
+    }
+}
+
+void handleButton(uint32_t nowMs) {
+    Metrics::SubsystemTimer timer(Metrics::Subsystem::Button);
 
-    // Handle button input
     ButtonEvent evt = button.update(nowMs);
+    if (evt != ButtonEvent::None) {
+        DeepSleep::stayAwake(nowMs);
+    }
     switch (evt) {
         case ButtonEvent::Click1:
             Serial.println("Button: Single click -> Next animation");
-            Commands::nextAnimation(appState, animMgr);
+            Commands::nextAnimation(commandQueue, appStore, animMgr);
             break;
         case ButtonEvent::Click2:
             Serial.println("Button: Double click -> Toggle strobe");
-            if (String(animMgr.currentName()) == "strobe") {
-                Commands::setAnimation(appState, animMgr, "fade");
+            if (strcmp(appStore.snapshot().animation, "strobe") == 0) {
+                Commands::setAnimation(commandQueue, "fade");
             } else {
-                Commands::setAnimation(appState, animMgr, "strobe");
+                Commands::setAnimation(commandQueue, "strobe");
             }
             break;
         case ButtonEvent::Click3:
@@ -145,132 +233,153 @@ void loop() {
                 static uint8_t colorIdx = 0;
                 const uint32_t colors[] = {0x0000FF, 0x00FF00, 0xFF0000, 0xFF00FF, 0x00FFFF, 0xFFFF00, 0xFFFFFF};
                 colorIdx = (colorIdx + 1) % 7;
-                Commands::setColor(appState, colors[colorIdx]);
+                Commands::setColor(commandQueue, colors[colorIdx]);
             }
             break;
         case ButtonEvent::Hold:
             Serial.println("Button: Hold -> Toggle power");
-            Commands::togglePower(appState, ledRing);
+            Commands::togglePower(commandQueue);
             break;
         default:
             break;
     }
+}
 
-    // Handle HTTP requests
-    if (httpApi) {
-        httpApi->poll();
+// How long the loop can block before something needs it. Commands, presence
+// updates and button edges wake it early; HTTP and fleet UDP can only be polled,
+// so the wait never exceeds LOOP_POLL_MS.
+uint32_t msUntilNextWork(uint32_t nowMs, const AppState& state) {
+    uint32_t wait = Config::LOOP_POLL_MS;
+    auto consider = [&wait](uint32_t ms) {
+        if (ms < wait) wait = ms;
+    };
+    if (state.powerOn) {
+        consider(animMgr.msUntilDue(Config::FLEET_ENABLED ? fleet.nowMs() : nowMs, state));
+    }
+    consider(ledRing.msUntilRefresh(nowMs));
+    consider(button.msUntilDue(nowMs));
+    consider(persistence.msUntilDue(nowMs));
+    if (inIntroPhase) {
+        const uint32_t elapsed = nowMs - introStartTime;
+        consider(elapsed >= introDurationMs ? 0 : introDurationMs - elapsed);
     }
+    return wait;
+}
+
+void loop() {
+    TRACE_SCOPE("loop");
+    const uint32_t loopStartUs = micros();
+    uint32_t nowMs = millis();
+
+    handleButton(nowMs);
+
+    {
+        Metrics::SubsystemTimer timer(Metrics::Subsystem::Http);
+        TRACE_SCOPE("loop.http");
 
-    // Handle Microsoft auth device flow polling
-    if (authInProgress) {
-        if (msAuth.pollForToken()) {
-            authInProgress = false;
-            Serial.println("Authentication complete! Starting presence polling.");
-            // Immediately poll presence after auth
-            lastPresencePoll = 0;
+        // Start the HTTP API once WiFi is up; handlers run on this task alongside rendering
+        if (!httpStarted && netTask.isConnected()) {
+            httpApi.begin();
+            httpStarted = true;
+            Serial.println("HTTP API started on port 80");
+        }
+
+        // Handle HTTP requests
+        if (httpStarted) {
+            httpApi.poll();
+        }
+    }
+
+    if (Config::FLEET_ENABLED) {
+        if (!fleet.isStarted() && netTask.isConnected()) {
+            fleet.begin();
+        }
+        fleet.poll(nowMs);
+        FleetCommand cmd;
+        if (fleet.takeCommand(cmd)) {
+            applyFleetCommand(cmd);
         }
     }
-    
-    // Poll Teams presence at configured interval
-    if (!authInProgress && WiFi.status() == WL_CONNECTED) {
-        if (nowMs - lastPresencePoll >= Config::PRESENCE_POLL_INTERVAL_MS || lastPresencePoll == 0) {
-            lastPresencePoll = nowMs;
-            
-            if (teamsPresence.fetchPresence()) {
-                Presence currentPresence = teamsPresence.getPresence();
-                
-                // Only update if presence changed
-                if (currentPresence != lastPresence) {
-                    Serial.printf("Presence changed: %s -> %s\n", 
-                                  lastPresence == Presence::Unknown ? "Unknown" : teamsPresence.getPresenceString(),
-                                  teamsPresence.getPresenceString());
-                    lastPresence = currentPresence;
-                    
-                    PresenceEffect effect = teamsPresence.getEffect();
-                    
-                    // Apply the effect
-                    appState.primaryColor = effect.color;
-                    
-                    // Clear all pixels first
-                    for (int i = 0; i < Config::NUM_PIXELS; i++) {
-                        appState.pixelColors[i] = 0x000000;
-                    }
-
-                    // Light only the relevant LED(s)
-                    switch (effect.trafficLight) {
-                        case TrafficLightState::Bottom:
-                            appState.pixelColors[0] = effect.color;
-                            effect.type = EffectType::StrobeThenPixel;
-                            break;
-                        case TrafficLightState::Middle:
-                            appState.pixelColors[1] = effect.color;
-                            effect.type = EffectType::Pixel;
-                            break;
-                        case TrafficLightState::Top:
-                            appState.pixelColors[2] = effect.color;
-                            effect.type = EffectType::Pixel;
-                            break;
-                        case TrafficLightState::All:
-                            for (int i = 0; i < Config::NUM_PIXELS; i++) {
-                                appState.pixelColors[i] = effect.color;
-                            }
-                            break;
-                    }
-
-                    switch (effect.type) {
-                        case EffectType::Solid:
-                            Commands::setAnimation(appState, animMgr, "solid");
-                            break;
-                        case EffectType::Pixel:
-                            Commands::setAnimation(appState, animMgr, "pixels");
-                            break;
-                        case EffectType::StrobeThenPixel:
-                            Serial.println("Starting strobe -> pixels");
-                            Commands::setAnimation(appState, animMgr, "strobe");
-                            strobeStartTime = nowMs;
-                            inStrobePhase = true;
-                            strobeThen = "pixels";
-                            break;
-                        case EffectType::Fade:
-                            Commands::setAnimation(appState, animMgr, "fade");
-                            break;
-                        case EffectType::StrobeThenSolid:
-                            Serial.println("Starting strobe -> solid");
-                            Commands::setAnimation(appState, animMgr, "strobe");
-                            strobeStartTime = nowMs;
-                            inStrobePhase = true;
-                            strobeThen = "solid";
-                            break;
-                        case EffectType::Off:
-                            appState.powerOn = false;
-                            ledRing.clear();
-                            ledRing.show();
-                            break;
-                    }
-
-                    // Ensure power is on for non-off effects
-                    if (effect.type != EffectType::Off) {
-                        appState.powerOn = true;
-                    }
-                }
-            } else if (!msAuth.hasValidToken()) {
-                // Token expired or invalid, restart auth flow
-                Serial.println("Token invalid, restarting device flow...");
-                if (msAuth.startDeviceFlow()) {
-                    authInProgress = true;
-                }
+
+    {
+        Metrics::SubsystemTimer timer(Metrics::Subsystem::Presence);
+        TRACE_SCOPE("loop.presence");
+
+        // Apply presence changes fetched by the network task, and re-apply
+        // the current one when the rules table was edited
+        PresenceStatus presence;
+        if (netTask.takePresence(presence) && presence != lastPresence) {
+            applyPresence(presence, nowMs);
+        } else if (!Config::TEAM_MODE && appliedRulesVersion != 0 &&
+                   appliedRulesVersion != presenceRules.version()) {
+            applyPresence(lastPresence, nowMs);
+        }
+        NetworkTask::MemberPresence member;
+        while (netTask.takeMemberPresence(member)) {
+            applyMemberPresence(member);
+        }
+        if (Config::TEAM_MODE && appliedRulesVersion != 0 && appliedRulesVersion != presenceRules.version()) {
+            for (size_t i = 0; i < Config::TEAM_MEMBER_COUNT; i++) {
+                applyMemberPresence({static_cast<uint8_t>(i), memberStatus[i]});
             }
         }
+
+        // Handle intro -> main animation transition
+        if (inIntroPhase && (nowMs - introStartTime >= introDurationMs)) {
+            Commands::setAnimation(commandQueue, introThen.c_str());
+            inIntroPhase = false;
+        }
+    }
+
+    uint32_t sequence;
+    AppState state;
+    {
+        Metrics::SubsystemTimer timer(Metrics::Subsystem::Render);
+        TRACE_SCOPE("loop.render");
+
+        // Apply this frame's queued commands as one state change, then render
+        // from one consistent snapshot, reacting only to the fields that changed
+        commandQueue.drain(appStore);
+        state = appStore.snapshot(sequence);
+        const uint32_t changed = appStore.changesSince(renderedSequence);
+        renderedSequence = sequence;
+        if (changed & AppStateStore::ANIMATION) {
+            animMgr.setActive(state.animation, state);
+        }
+        if (changed & AppStateStore::BRIGHTNESS) {
+            ledRing.setBrightness(state.brightness);
+        }
+        if ((changed & AppStateStore::POWER) && !state.powerOn) {
+            ledRing.clear();
+            ledRing.show();
+        }
+        if (changed & (AppStateStore::POWER | AppStateStore::BRIGHTNESS |
+                       AppStateStore::PRIMARY_COLOR | AppStateStore::SECONDARY_COLOR)) {
+            animMgr.invalidate();
+        }
+
+        // Update animation (only if powered on). Animations run on fleet time,
+        // which is the local clock unless fleet mode is synced to a leader.
+        if (state.powerOn) {
+            animMgr.update(Config::FLEET_ENABLED ? fleet.nowMs() : nowMs, state, sequence, ledRing);
+        }
+        ledRing.refresh(nowMs);
     }
-    
-    // Handle strobe -> solid transition
-    if (inStrobePhase && (nowMs - strobeStartTime >= Config::STROBE_DURATION_MS)) {
-        Commands::setAnimation(appState, animMgr, strobeThen);
-        inStrobePhase = false;
+    BootTimings::markFirstFrame(nowMs);
+
+    persistence.update(nowMs, state, sequence);
+
+    if (const uint32_t sleepSeconds = DeepSleep::due(nowMs)) {
+        persistence.flush(state);
+        ledRing.clear();
+        ledRing.show();
+        DeepSleep::enter(sleepSeconds);
     }
 
-    // Update animation (only if powered on)
-    if (appState.powerOn) {
-        animMgr.update(nowMs, appState, ledRing);
+    Metrics::loopDuration.observe(micros() - loopStartUs);
+
+    {
+        TRACE_SCOPE("loop.idle");
+        IdleControl::wait(msUntilNextWork(millis(), state));
     }
 }
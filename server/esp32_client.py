@@ -1,8 +1,48 @@
 """HTTP client for ESP32 LED ring control."""
 
-from typing import Any, Dict, Optional
+from typing import Any, Dict, Optional, Sequence, Tuple
 import requests
 
+Rgb = Tuple[int, int, int]
+
+
+def _pack(pixels: Sequence[Rgb]) -> bytes:
+    return bytes(c for p in pixels for c in p)
+
+
+def encode_rle(pixels: Sequence[Rgb]) -> bytes:
+    """Encode as [n] pixel runs, each standing for n+1 copies of the pixel."""
+    out = bytearray()
+    i = 0
+    while i < len(pixels):
+        run = 1
+        while run < 256 and i + run < len(pixels) and pixels[i + run] == pixels[i]:
+            run += 1
+        out.append(run - 1)
+        out.extend(pixels[i])
+        i += run
+    return bytes(out)
+
+
+def encode_delta(previous: Sequence[Rgb], pixels: Sequence[Rgb]) -> bytes:
+    """Encode as [skip][n] records holding only the pixels that differ from `previous`."""
+    out = bytearray()
+    i = 0
+    while i < len(pixels):
+        skip = 0
+        while i < len(pixels) and skip < 255 and pixels[i] == previous[i]:
+            skip += 1
+            i += 1
+        start = i
+        while i < len(pixels) and i - start < 255 and pixels[i] != previous[i]:
+            i += 1
+        if i == start and i == len(pixels):
+            break  # Only unchanged pixels left
+        out.append(skip)
+        out.append(i - start)
+        out.extend(_pack(pixels[start:i]))
+    return bytes(out)
+
 
 class Esp32Client:
     """Typed wrapper around ESP32 HTTP API endpoints."""
@@ -105,3 +145,31 @@ class Esp32Client:
                 pixel_data.append(p)
         
         self._post("/pixels", pixel_data)
+
+    def set_frame(self, data: bytes, length: int, offset: int = 0,
+                  fmt: str = "rgb", encoding: str = "raw") -> int:
+        """
+        Upload a binary frame and switch to the "pixels" animation.
+
+        Args:
+            data: Pixel bytes, already encoded (see encode_rle / encode_delta)
+            length: Number of pixels the frame covers, starting at `offset`
+            fmt: "rgb" (3 bytes per pixel) or "rgbw" (4, white is mixed into RGB)
+            encoding: "raw", "rle" or "delta"
+
+        Returns:
+            The number of pixels the device wrote
+        """
+        resp = self.session.post(
+            f"{self.host}/frame",
+            params={"offset": offset, "length": length, "format": fmt, "encoding": encoding},
+            data=data,
+            headers={"Content-Type": "application/octet-stream"},
+            timeout=self.timeout,
+        )
+        resp.raise_for_status()
+        return resp.json()["pixels"]
+
+    def set_frame_pixels(self, pixels: Sequence[Rgb], offset: int = 0) -> int:
+        """Upload (r, g, b) tuples as a raw RGB frame."""
+        return self.set_frame(_pack(pixels), len(pixels), offset)
@@ -0,0 +1,87 @@
+"""Multicast command sender for ESP32 rings running in fleet mode."""
+
+import random
+import socket
+import struct
+from typing import Optional
+
+# Must match firmware/FleetSync.cpp
+MAGIC = 0x53465254
+VERSION = 1
+PACKET_COMMAND = 4
+
+FIELD_POWER = 1 << 0
+FIELD_BRIGHTNESS = 1 << 1
+FIELD_COLOR = 1 << 2
+FIELD_ANIMATION = 1 << 3
+FIELD_SPEED = 1 << 4
+
+# <magic, version, type, fields, powerOn, seq, color, speedMs, brightness, animation[16]>
+COMMAND_FORMAT = "<IBBBBIIHB16s"
+
+
+class FleetClient:
+    """Sends one multicast packet that every device in the fleet applies."""
+
+    def __init__(self, group: str = "239.42.0.1", port: int = 4210, ttl: int = 1, repeats: int = 3):
+        """
+        Initialize the fleet client.
+
+        Args:
+            group: Multicast group (Config::FLEET_GROUP in firmware)
+            port: UDP port (Config::FLEET_PORT in firmware)
+            ttl: Multicast TTL; 1 keeps packets on the local subnet
+            repeats: Copies sent per command; devices drop duplicates by sequence number
+        """
+        self.group = group
+        self.port = port
+        self.repeats = repeats
+        self.seq = random.randint(1, 0xFFFFFFFF)
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+        self.sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, ttl)
+
+    def send(self,
+             power: Optional[bool] = None,
+             brightness: Optional[int] = None,
+             color: Optional[str] = None,
+             animation: Optional[str] = None,
+             speed_ms: Optional[int] = None) -> int:
+        """
+        Send a command to all devices. Only the given fields are changed.
+
+        Args:
+            power: Turn the rings on or off
+            brightness: Brightness (0-255)
+            color: Primary color in hex format (e.g., "#FF0000")
+            animation: Animation name (fade, spin, spinTail, strobe, solid, pixels)
+            speed_ms: Animation step interval in milliseconds
+
+        Returns:
+            The sequence number of the command
+        """
+        fields = 0
+        if power is not None:
+            fields |= FIELD_POWER
+        if brightness is not None:
+            fields |= FIELD_BRIGHTNESS
+        if color is not None:
+            fields |= FIELD_COLOR
+        if animation is not None:
+            fields |= FIELD_ANIMATION
+        if speed_ms is not None:
+            fields |= FIELD_SPEED
+
+        self.seq = (self.seq + 1) & 0xFFFFFFFF
+        packet = struct.pack(
+            COMMAND_FORMAT,
+            MAGIC, VERSION, PACKET_COMMAND, fields,
+            1 if power else 0,
+            self.seq,
+            int(color.lstrip('#'), 16) if color else 0,
+            speed_ms or 0,
+            brightness or 0,
+            (animation or "").encode("ascii")[:15],
+        )
+        for _ in range(self.repeats):
+            self.sock.sendto(packet, (self.group, self.port))
+        return self.seq
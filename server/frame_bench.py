@@ -0,0 +1,63 @@
+"""Measures sustained /frame upload rate for each encoding.
+
+Usage: python -m server.frame_bench --host http://<esp32 ip> --pixels 24
+"""
+
+import argparse
+import colorsys
+import time
+from typing import List
+
+from .esp32_client import Esp32Client, Rgb, _pack, encode_delta, encode_rle
+
+
+def _rainbow(count: int, step: int) -> List[Rgb]:
+    pixels = []
+    for i in range(count):
+        r, g, b = colorsys.hsv_to_rgb(((i + step) % count) / count, 1.0, 0.5)
+        pixels.append((int(r * 255), int(g * 255), int(b * 255)))
+    return pixels
+
+
+def _spinner(count: int, step: int) -> List[Rgb]:
+    pixels = [(0, 0, 0)] * count
+    pixels[step % count] = (255, 255, 255)
+    return pixels
+
+
+def _run(client: Esp32Client, name: str, count: int, frames: int, pattern, encoder) -> None:
+    previous = pattern(count, -1)
+    client.set_frame_pixels(previous)
+    sent = 0
+    start = time.perf_counter()
+    for step in range(frames):
+        pixels = pattern(count, step)
+        data, encoding = encoder(previous, pixels)
+        client.set_frame(data, count, encoding=encoding)
+        sent += len(data)
+        previous = pixels
+    elapsed = time.perf_counter() - start
+    print(f"{name:16} {frames / elapsed:6.1f} fps  {sent / frames:7.1f} bytes/frame")
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Measure /frame upload rate")
+    parser.add_argument("--host", required=True, help="Device base URL")
+    parser.add_argument("--pixels", type=int, default=24)
+    parser.add_argument("--frames", type=int, default=200)
+    args = parser.parse_args()
+
+    client = Esp32Client(args.host, timeout=3.0)
+    raw = lambda prev, px: (_pack(px), "raw")
+    rle = lambda prev, px: (encode_rle(px), "rle")
+    delta = lambda prev, px: (encode_delta(prev, px), "delta")
+
+    _run(client, "rainbow raw", args.pixels, args.frames, _rainbow, raw)
+    _run(client, "rainbow rle", args.pixels, args.frames, _rainbow, rle)
+    _run(client, "spinner raw", args.pixels, args.frames, _spinner, raw)
+    _run(client, "spinner rle", args.pixels, args.frames, _spinner, rle)
+    _run(client, "spinner delta", args.pixels, args.frames, _spinner, delta)
+
+
+if __name__ == "__main__":
+    main()
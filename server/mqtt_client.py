@@ -0,0 +1,163 @@
+"""MQTT client for ESP32 LED rings, plus a latency/throughput comparison with the HTTP API.
+
+Run the comparison against a ring and a local broker (e.g. mosquitto):
+    python -m server.mqtt_client --broker localhost --device 1A2B3C --http http://192.168.1.50
+"""
+
+import argparse
+import json
+import statistics
+import threading
+import time
+from typing import Any, Callable, Dict, Optional
+
+import paho.mqtt.client as mqtt
+
+from .esp32_client import Esp32Client
+
+
+class MqttClient:
+    """Typed wrapper around the firmware's MQTT topics (see firmware/MqttBridge.h)."""
+
+    def __init__(self, broker: str, device_id: str, port: int = 1883, prefix: str = "teamsring",
+                 username: Optional[str] = None, password: Optional[str] = None):
+        """
+        Connect to the broker and subscribe to the device's retained state.
+
+        Args:
+            broker: Broker host name or IP
+            device_id: Six hex digits from the device's MAC (shown in its boot log), or "all"
+            port: Broker port
+            prefix: Topic prefix (Config::MQTT_TOPIC_PREFIX in firmware)
+            username: Broker user, if the broker requires one
+            password: Broker password
+        """
+        self.base = f"{prefix}/{device_id}"
+        self.state: Dict[str, Any] = {}
+        self.online = False
+        self._cond = threading.Condition()
+
+        self.client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2)
+        if username:
+            self.client.username_pw_set(username, password)
+        self.client.on_connect = self._on_connect
+        self.client.on_message = self._on_message
+        self.client.connect(broker, port, keepalive=30)
+        self.client.loop_start()
+
+    def close(self) -> None:
+        """Disconnect from the broker."""
+        self.client.loop_stop()
+        self.client.disconnect()
+
+    def _on_connect(self, client, userdata, flags, reason_code, properties) -> None:
+        client.subscribe(f"{self.base}/state", qos=0)
+        client.subscribe(f"{self.base}/status", qos=0)
+
+    def _on_message(self, client, userdata, msg) -> None:
+        with self._cond:
+            if msg.topic.endswith("/status"):
+                self.online = msg.payload == b"online"
+            else:
+                self.state = json.loads(msg.payload)
+            self._cond.notify_all()
+
+    def _set(self, field: str, value: Any) -> None:
+        """Publish one field at QoS 0 (fire and forget)."""
+        self.client.publish(f"{self.base}/set/{field}", str(value), qos=0)
+
+    def set_many(self, **fields: Any) -> None:
+        """Change several fields in one message, e.g. set_many(power=True, brightness=64)."""
+        self.client.publish(f"{self.base}/set", json.dumps(fields), qos=0)
+
+    def wait_for_state(self, predicate: Callable[[Dict[str, Any]], bool], timeout: float = 3.0) -> bool:
+        """Block until the retained state satisfies `predicate`; False on timeout."""
+        with self._cond:
+            return self._cond.wait_for(lambda: bool(self.state) and predicate(self.state), timeout)
+
+    def set_power(self, on: bool) -> None:
+        """Turn the LED ring on or off."""
+        self._set("power", "on" if on else "off")
+
+    def toggle_power(self) -> None:
+        """Toggle the LED ring's power."""
+        self._set("power", "toggle")
+
+    def set_brightness(self, value: int) -> None:
+        """Set brightness (0-255)."""
+        self._set("brightness", value)
+
+    def set_color(self, rgb_hex: str) -> None:
+        """Set the primary color (e.g., "#FF0000")."""
+        self._set("color", rgb_hex)
+
+    def set_animation(self, name: str) -> None:
+        """Set the active animation."""
+        self._set("animation", name)
+
+    def set_speed(self, ms: int) -> None:
+        """Set animation step interval in milliseconds."""
+        self._set("speed", ms)
+
+    def set_strobe_period(self, ms: int) -> None:
+        """Set strobe on+off cycle period in milliseconds."""
+        self._set("strobe", ms)
+
+    def set_tail_length(self, length: int) -> None:
+        """Set tail length for spinTail animation (1-12)."""
+        self._set("tail", length)
+
+
+def _measure(name: str, set_brightness: Callable[[int], None], observer: MqttClient, rounds: int) -> None:
+    """Time command -> applied state (seen on the retained state topic), then burst throughput."""
+    latencies = []
+    for i in range(rounds):
+        value = 10 + (i % 2) * 100 + i % 50
+        start = time.perf_counter()
+        set_brightness(value)
+        if observer.wait_for_state(lambda s: s.get("brightness") == value):
+            latencies.append((time.perf_counter() - start) * 1000)
+        time.sleep(0.1)  # Let the device's state publish throttle expire
+
+    burst = rounds * 5
+    start = time.perf_counter()
+    for i in range(burst):
+        set_brightness(i % 200)
+    sent_s = time.perf_counter() - start
+    final = (burst - 1) % 200
+    applied = observer.wait_for_state(lambda s: s.get("brightness") == final, timeout=10)
+    total_s = time.perf_counter() - start
+
+    if latencies:
+        print(f"{name:5} latency ms: median {statistics.median(latencies):6.1f}  "
+              f"p95 {sorted(latencies)[int(len(latencies) * 0.95) - 1]:6.1f}  "
+              f"({len(latencies)}/{rounds} observed)")
+    else:
+        print(f"{name:5} latency: no state updates observed")
+    print(f"{name:5} burst: {burst} commands sent in {sent_s * 1000:.0f} ms "
+          f"({burst / sent_s:.0f}/s), last applied after {total_s * 1000:.0f} ms"
+          f"{'' if applied else ' (never observed)'}")
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Compare MQTT and HTTP command latency")
+    parser.add_argument("--broker", required=True)
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--device", required=True, help="Device id (six hex digits)")
+    parser.add_argument("--http", help="Device base URL; skips the HTTP run when omitted")
+    parser.add_argument("--rounds", type=int, default=50)
+    args = parser.parse_args()
+
+    mqtt_client = MqttClient(args.broker, args.device, port=args.port)
+    if not mqtt_client.wait_for_state(lambda s: True, timeout=5):
+        raise SystemExit("No retained state from the device; is MQTT enabled and connected?")
+
+    _measure("mqtt", mqtt_client.set_brightness, mqtt_client, args.rounds)
+    if args.http:
+        http_client = Esp32Client(args.http, timeout=3.0)
+        _measure("http", http_client.set_brightness, mqtt_client, args.rounds)
+    mqtt_client.close()
+
+
+if __name__ == "__main__":
+    main()
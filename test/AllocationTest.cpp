@@ -0,0 +1,318 @@
+// The render loop must not touch the heap once it is running: commands,
+// drain, snapshot, animation update and show, for every built-in animation
+// and with a segment on top. Global operator new is replaced to count calls.
+//
+// The scratch arenas are checked too: Arena::reallocate's move and copy, and
+// Scope rewinding. With ArduinoJson, a rules request the way HttpApi handles
+// it and a network step's token refresh and presence poll run under their
+// scopes. Those paths still allocate (String bodies and arguments, HTTPClient),
+// so for them the check is that the JSON documents stay out of the heap, not
+// that nothing is allocated.
+#include "HostTest.h"
+#include "AnimationManager.h"
+#include "AppStateStore.h"
+#include "CommandQueue.h"
+#include "Commands.h"
+#include "LedRing.h"
+#include "Memory.h"
+#include "animations/FadeAnimation.h"
+#include "animations/PixelsAnimation.h"
+#include "animations/SolidAnimation.h"
+#include "animations/SpinAnimation.h"
+#include "animations/SpinTailAnimation.h"
+#include "animations/StrobeAnimation.h"
+#include <atomic>
+#include <new>
+#if ALLOCATION_TEST_JSON
+#include "HttpsSession.h"
+#include "MicrosoftAuth.h"
+#include "PresenceRules.h"
+#include "TeamsPresence.h"
+#include <HTTPClient.h>
+#endif
+
+static std::atomic<uint64_t> allocations{0};
+static std::atomic<size_t> largestAllocation{0};
+
+static void countAllocation(size_t size) {
+    allocations++;
+    if (size > largestAllocation) largestAllocation = size;
+}
+
+void* operator new(size_t size) {
+    countAllocation(size);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    countAllocation(size);
+    return malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+// GCC takes the new in inlined standard containers for its own, not these
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+#pragma GCC diagnostic pop
+
+static constexpr uint32_t LOOP_MS = 20;
+static constexpr int WARMUP_LOOPS = 50;
+static constexpr int MEASURED_LOOPS = 500;
+
+static AppStateStore store;
+static CommandQueue queue;
+static LedRing ring(0, Config::NUM_PIXELS);
+static AnimationManager animMgr;
+static uint32_t renderedSequence = 0;
+
+// The render half of main.cpp's loop(), with the commands an HTTP client or
+// the button would send in between
+static void loopOnce(int i) {
+    const uint32_t nowMs = millis();
+    Commands::setBrightness(queue, (uint8_t)(64 + i % 128));
+    if (i % 7 == 0) Commands::setColor(queue, 0x102030u * (uint32_t)(i % 5));
+    if (i % 11 == 0) Commands::setColor(queue, (uint16_t)(i % Config::NUM_PIXELS), 0x00FF00);
+
+    queue.drain(store);
+    uint32_t sequence;
+    const AppState state = store.snapshot(sequence);
+    const uint32_t changed = store.changesSince(renderedSequence);
+    renderedSequence = sequence;
+    if (changed & AppStateStore::ANIMATION) animMgr.setActive(state.animation, state);
+    if (changed & AppStateStore::BRIGHTNESS) ring.setBrightness(state.brightness);
+    if (changed & (AppStateStore::POWER | AppStateStore::BRIGHTNESS | AppStateStore::PRIMARY_COLOR |
+                   AppStateStore::SECONDARY_COLOR)) {
+        animMgr.invalidate();
+    }
+    if (state.powerOn) animMgr.update(nowMs, state, sequence, ring);
+    ring.refresh(nowMs);
+    HostClock::advanceMs(LOOP_MS);
+}
+
+static uint64_t allocationsWhileRunning(const char* animation) {
+    Commands::setAnimation(queue, animation);
+    for (int i = 0; i < WARMUP_LOOPS; i++) loopOnce(i);
+
+    const uint64_t before = allocations;
+    const uint32_t shows = Adafruit_NeoPixel::latest->showCount;
+    for (int i = 0; i < MEASURED_LOOPS; i++) loopOnce(i);
+    const uint64_t n = allocations - before;
+    // The loop really rendered: every brightness change shows a frame
+    CHECK(Adafruit_NeoPixel::latest->showCount - shows >= MEASURED_LOOPS / 2);
+    return n;
+}
+
+// Arena::reallocate grows the latest block in place and moves any other,
+// copying what it held; a Scope gives everything back. No heap either way.
+static void testArenaScopes() {
+    static Memory::Arena arena("test", 256, false);
+    CHECK(arena.begin());
+    const uint64_t before = allocations;
+    {
+        Memory::Scope scope(arena);
+        char* first = static_cast<char*>(arena.allocate(16));
+        strcpy(first, "first block");
+        char* second = static_cast<char*>(arena.allocate(16));
+        strcpy(second, "second");
+
+        // Latest block: grows where it is
+        CHECK(arena.reallocate(second, 64) == second);
+        CHECK(strcmp(second, "second") == 0);
+
+        // Not the latest: moves to the end, with its bytes
+        char* moved = static_cast<char*>(arena.reallocate(first, 32));
+        CHECK(moved != nullptr && moved != first);
+        CHECK(strcmp(moved, "first block") == 0);
+        CHECK(arena.used() >= 16 + 64 + 32);
+
+        // Too big: fails without touching what's there
+        const uint32_t failures = arena.failures();
+        CHECK(arena.reallocate(moved, 1024) == nullptr);
+        CHECK_EQ(arena.failures(), failures + 1);
+        CHECK(strcmp(moved, "first block") == 0);
+
+        {
+            Memory::Scope inner(arena);
+            const size_t mark = arena.used();
+            CHECK(arena.allocate(8) != nullptr);
+            CHECK(arena.used() > mark);
+        }
+        CHECK(strcmp(moved, "first block") == 0);
+    }
+    CHECK_EQ(arena.used(), 0);
+    CHECK(arena.highWater() >= 16 + 64 + 32);
+    CHECK_EQ(allocations - before, 0);
+}
+
+#if ALLOCATION_TEST_JSON
+static constexpr int REQUESTS = 20;
+
+static const char* RULES_BODY =
+    "{\"rules\":["
+    "{\"presence\":\"Busy\",\"activity\":\"InACall\",\"color\":\"#FF0000\",\"animation\":\"solid\",\"intro\":\"strobe\",\"introMs\":2000},"
+    "{\"presence\":\"Busy\",\"color\":\"#FF4000\",\"animation\":\"fade\"},"
+    "{\"presence\":\"Away\",\"color\":\"#FFB000\",\"pixels\":[0,1,2,3],\"animation\":\"solid\"},"
+    "{\"color\":\"#00FF00\",\"animation\":\"solid\"}]}";
+
+// What handleSetRules and then handleGetRules do inside HttpApi::route's Scope:
+// parse the body into an arena document and apply it, then build the reply in
+// another. Each request gives the arena back.
+static void testHttpHandlerScope() {
+    static PresenceRules rules;
+    rules.begin();
+    Memory::Arena& arena = Memory::httpScratch;
+    const size_t mark = arena.used();
+    const uint32_t failures = arena.failures();
+    const uint64_t before = allocations;
+    largestAllocation = 0;
+
+    std::string firstReply;
+    for (int i = 0; i < REQUESTS; i++) {
+        {
+            Memory::Scope scratch(arena);
+            const String body(RULES_BODY);      // As WebServer hands it over
+            Memory::HttpJsonDocument request(4096);
+            CHECK(deserializeJson(request, body) == DeserializationError::Ok);
+            PresenceRules::Error error;
+            CHECK(rules.fromJson(request.as<JsonVariantConst>(), error));
+        }
+        CHECK_EQ(arena.used(), mark);
+        {
+            Memory::Scope scratch(arena);
+            Memory::HttpJsonDocument reply(4096);
+            rules.toJson(reply);
+            char out[1024];
+            CHECK(serializeJson(reply, out, sizeof(out)) < sizeof(out) - 1);
+            if (i == 0) firstReply = out;
+            CHECK(firstReply == out);
+        }
+        CHECK_EQ(arena.used(), mark);
+    }
+
+    // A document that isn't the arena's latest block moves when resized, and
+    // keeps reading the same (shrinkToFit relocates its strings)
+    {
+        Memory::Scope scratch(arena);
+        Memory::HttpJsonDocument request(2048);
+        CHECK(deserializeJson(request, RULES_BODY) == DeserializationError::Ok);
+        Memory::HttpJsonDocument reply(2048);
+        rules.toJson(reply);
+        const size_t used = arena.used();
+        const size_t requestBytes = request.memoryUsage();
+        request.shrinkToFit();
+        CHECK(arena.used() > used);
+        CHECK_EQ(request.memoryUsage(), requestBytes);
+        CHECK(strcmp(request["rules"][2]["color"] | "", "#FFB000") == 0);
+        CHECK(strcmp(request["rules"][0]["intro"] | "", "strobe") == 0);
+    }
+    CHECK_EQ(arena.used(), mark);
+    CHECK_EQ(arena.failures(), failures);
+    CHECK(firstReply.find("\"InACall\"") != std::string::npos);
+    // Documents are 4 KB each; nothing that size reached the heap
+    CHECK(largestAllocation < 1024);
+    printf("rules set + get: %.1f heap allocations per pair (String body, the NVS stand-in), largest %zu bytes; "
+           "httpScratch high water %zu bytes\n",
+           (double)(allocations - before) / REQUESTS, (size_t)largestAllocation, arena.highWater());
+}
+
+static HostHttp::Response graph(const HostHttp::Request& request) {
+    HostHttp::Response response;
+    if (request.url.find("login.microsoftonline.com") != std::string::npos) {
+        response.body = "{\"token_type\":\"Bearer\",\"expires_in\":3599,\"access_token\":\"access\","
+                        "\"refresh_token\":\"refresh\",\"id_token\":\"" + std::string(1500, 'j') + "\"}";
+    } else {
+        response.body = "{\"@odata.context\":\"https://graph.microsoft.com/v1.0/$metadata#users('x')/presence\","
+                        "\"id\":\"x\",\"availability\":\"Busy\",\"activity\":\"InACall\"}";
+    }
+    return response;
+}
+
+// A network step's JSON: NetworkTask::step opens the Scope, then the token
+// refresh parses into a 6 KB arena document and the presence poll into a
+// stack one
+static void testNetworkStepScope() {
+    static HttpsSession session;
+    static MicrosoftAuth auth("client-id", "tenant-id", session);
+    static TeamsPresence presence(auth, session);
+    HostHttp::server = graph;
+    Preferences prefs;
+    prefs.begin("msauth");
+    prefs.putString("refresh", "refresh");
+    auth.begin();
+
+    Memory::Arena& arena = Memory::netScratch;
+    const size_t mark = arena.used();
+    const uint32_t failures = arena.failures();
+    const uint64_t before = allocations;
+    largestAllocation = 0;
+    for (int i = 0; i < REQUESTS; i++) {
+        HostHttp::requests.clear();     // The stand-in's log, not the firmware's
+        Memory::Scope scratch(arena);
+        CHECK(auth.refreshAccessToken());
+        CHECK(presence.fetchPresence());
+        session.endBurst();
+        CHECK(arena.used() > mark);
+    }
+    CHECK_EQ(arena.used(), mark);
+    CHECK_EQ(arena.failures(), failures);
+    CHECK(presence.getStatus().activity == Activity::InACall);
+    // The 6 KB token document came from the arena
+    CHECK(arena.highWater() >= 6144);
+    CHECK(largestAllocation < 6144);
+    printf("network step: %.1f heap allocations per step (HTTPClient, String), largest %zu bytes; "
+           "netScratch high water %zu bytes\n",
+           (double)(allocations - before) / REQUESTS, (size_t)largestAllocation, arena.highWater());
+}
+#endif
+
+int main() {
+    static FadeAnimation fade;
+    static SpinAnimation spin;
+    static SpinTailAnimation spinTail;
+    static StrobeAnimation strobe;
+    static SolidAnimation solid;
+    static PixelsAnimation pixels;
+
+    Memory::begin();
+    queue.begin();
+    ring.begin();
+    animMgr.addAnimation(&fade);
+    animMgr.addAnimation(&spin);
+    animMgr.addAnimation(&spinTail);
+    animMgr.addAnimation(&strobe);
+    animMgr.addAnimation(&solid);
+    animMgr.addAnimation(&pixels);
+    animMgr.setActive(store.snapshot(renderedSequence).animation, store.snapshot());
+    // Setup allocates (the manager's tables), which shows the counter is live
+    CHECK(allocations > 0);
+
+    for (size_t i = 0; i < animMgr.animationCount(); i++) {
+        const char* name = animMgr.animationName(i);
+        const uint64_t n = allocationsWhileRunning(name);
+        printf("%-10s %llu allocations in %d loops\n", name, (unsigned long long)n, MEASURED_LOOPS);
+        CHECK_EQ(n, 0);
+    }
+
+    // Segments get their own animation instance when set up, and none after that
+    Segment* segment = animMgr.upsertSegment("edge", store.snapshot());
+    CHECK(segment != nullptr);
+    segment->start = 0;
+    segment->length = Config::NUM_PIXELS > 1 ? Config::NUM_PIXELS / 2 : 1;
+    CHECK(animMgr.setSegmentAnimation(*segment, "spin"));
+    const uint64_t withSegment = allocationsWhileRunning("fade");
+    printf("fade with a spin segment: %llu allocations in %d loops\n", (unsigned long long)withSegment,
+           MEASURED_LOOPS);
+    CHECK_EQ(withSegment, 0);
+
+    testArenaScopes();
+#if ALLOCATION_TEST_JSON
+    testHttpHandlerScope();
+    testNetworkStepScope();
+#endif
+
+    return HostTest::report("AllocationTest");
+}
@@ -0,0 +1,226 @@
+// AudioDsp fed from WAV files, the way it would be run over recordings.
+// The built-in cases synthesize tones, a kick pattern and silence, write them
+// out as 16-bit WAV and read them back through the same reader. Any WAV paths
+// given on the command line are analysed too, and their features printed:
+//
+//   AudioDspTest recording.wav ...
+#include "HostTest.h"
+#include "AudioDsp.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+static constexpr uint32_t SAMPLE_RATE = 16000;     // Config::AUDIO_SAMPLE_RATE
+
+struct Wav {
+    uint32_t sampleRate = 0;
+    std::vector<int16_t> samples;   // Mono; stereo files are mixed down
+};
+
+static void put16(FILE* f, uint16_t v) { fwrite(&v, 2, 1, f); }
+static void put32(FILE* f, uint32_t v) { fwrite(&v, 4, 1, f); }
+
+static bool writeWav(const std::string& path, const Wav& wav) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    const uint32_t dataBytes = (uint32_t)wav.samples.size() * 2;
+    fwrite("RIFF", 1, 4, f);
+    put32(f, 36 + dataBytes);
+    fwrite("WAVEfmt ", 1, 8, f);
+    put32(f, 16);
+    put16(f, 1);                    // PCM
+    put16(f, 1);                    // Mono
+    put32(f, wav.sampleRate);
+    put32(f, wav.sampleRate * 2);
+    put16(f, 2);
+    put16(f, 16);
+    fwrite("data", 1, 4, f);
+    put32(f, dataBytes);
+    fwrite(wav.samples.data(), 2, wav.samples.size(), f);
+    return fclose(f) == 0;
+}
+
+// 16-bit PCM, mono or stereo; other chunks are skipped
+static bool readWav(const std::string& path, Wav& wav) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    char id[4];
+    uint32_t size;
+    bool ok = fread(id, 1, 4, f) == 4 && memcmp(id, "RIFF", 4) == 0 && fread(&size, 4, 1, f) == 1 &&
+              fread(id, 1, 4, f) == 4 && memcmp(id, "WAVE", 4) == 0;
+    uint16_t channels = 0, bits = 0;
+    while (ok && fread(id, 1, 4, f) == 4 && fread(&size, 4, 1, f) == 1) {
+        if (memcmp(id, "fmt ", 4) == 0) {
+            uint16_t format;
+            ok = fread(&format, 2, 1, f) == 1 && fread(&channels, 2, 1, f) == 1 &&
+                 fread(&wav.sampleRate, 4, 1, f) == 1 && fseek(f, 6, SEEK_CUR) == 0 && fread(&bits, 2, 1, f) == 1 &&
+                 format == 1 && bits == 16 && (channels == 1 || channels == 2) && fseek(f, size - 16, SEEK_CUR) == 0;
+        } else if (memcmp(id, "data", 4) == 0 && channels) {
+            std::vector<int16_t> raw(size / 2);
+            ok = fread(raw.data(), 2, raw.size(), f) == raw.size();
+            wav.samples.clear();
+            for (size_t i = 0; i + channels <= raw.size(); i += channels) {
+                wav.samples.push_back(channels == 1 ? raw[i] : (int16_t)((raw[i] + raw[i + 1]) / 2));
+            }
+            fclose(f);
+            return ok;
+        } else {
+            ok = fseek(f, size + (size & 1), SEEK_CUR) == 0;
+        }
+    }
+    fclose(f);
+    return false;
+}
+
+struct Analysis {
+    std::vector<AudioFeatures> hops;
+    std::vector<size_t> beatHops;
+    double bandMean[AudioFeatures::BANDS] = {0};
+    double levelMean = 0;
+};
+
+static Analysis analyse(const Wav& wav) {
+    Analysis a;
+    AudioDsp dsp(wav.sampleRate);
+    for (size_t i = 0; i + AudioDsp::HOP <= wav.samples.size(); i += AudioDsp::HOP) {
+        AudioFeatures f;
+        dsp.process(&wav.samples[i], f);
+        if (f.beat) a.beatHops.push_back(a.hops.size());
+        a.hops.push_back(f);
+    }
+    // Averages skip the first second, while the gain settles
+    const size_t skip = std::min(a.hops.size(), (size_t)(wav.sampleRate / AudioDsp::HOP));
+    for (size_t h = skip; h < a.hops.size(); h++) {
+        for (size_t b = 0; b < AudioFeatures::BANDS; b++) a.bandMean[b] += a.hops[h].bands[b];
+        a.levelMean += a.hops[h].level;
+    }
+    const size_t n = a.hops.size() - skip;
+    if (n) {
+        for (double& m : a.bandMean) m /= n;
+        a.levelMean /= n;
+    }
+    return a;
+}
+
+static size_t loudestBand(const Analysis& a) {
+    size_t best = 0;
+    for (size_t b = 1; b < AudioFeatures::BANDS; b++) {
+        if (a.bandMean[b] > a.bandMean[best]) best = b;
+    }
+    return best;
+}
+
+static double hopMs(const Wav& wav) { return 1000.0 * AudioDsp::HOP / wav.sampleRate; }
+
+static void print(const char* name, const Wav& wav, const Analysis& a) {
+    printf("%s: %.1f s, level %.0f, %zu beats", name, (double)wav.samples.size() / wav.sampleRate, a.levelMean,
+           a.beatHops.size());
+    if (a.beatHops.size() > 1) {
+        const double spanMs = (a.beatHops.back() - a.beatHops.front()) * hopMs(wav);
+        printf(" (%.0f BPM)", 60000.0 * (a.beatHops.size() - 1) / spanMs);
+    }
+    printf("\n  bands:");
+    for (double m : a.bandMean) printf(" %3.0f", m);
+    printf("\n");
+}
+
+// Writes `wav` next to the test binary and reads it back, as a recording would be
+static Wav roundTrip(const char* name, const Wav& wav) {
+    const std::string path = std::string(name) + ".wav";
+    Wav read;
+    CHECK(writeWav(path, wav));
+    CHECK(readWav(path, read));
+    CHECK_EQ(read.sampleRate, wav.sampleRate);
+    CHECK_EQ(read.samples.size(), wav.samples.size());
+    return read;
+}
+
+static Wav synth(double seconds, const std::function<double(double)>& fn) {
+    Wav wav;
+    wav.sampleRate = SAMPLE_RATE;
+    const size_t n = (size_t)(seconds * SAMPLE_RATE);
+    for (size_t i = 0; i < n; i++) {
+        const double v = fn((double)i / SAMPLE_RATE);
+        wav.samples.push_back((int16_t)std::lround(std::max(-1.0, std::min(1.0, v)) * 32767));
+    }
+    return wav;
+}
+
+static void testTonesLandInRisingBands() {
+    const double freqs[] = {80, 250, 1000, 3000, 7000};
+    size_t previous = 0;
+    for (size_t i = 0; i < sizeof(freqs) / sizeof(freqs[0]); i++) {
+        const double f = freqs[i];
+        char name[32];
+        snprintf(name, sizeof(name), "tone_%.0fhz", f);
+        const Wav wav = roundTrip(name, synth(3, [f](double t) { return 0.3 * sin(2 * M_PI * f * t); }));
+        const Analysis a = analyse(wav);
+        print(name, wav, a);
+        const size_t band = loudestBand(a);
+        if (i > 0) CHECK(band > previous);
+        previous = band;
+        // A steady tone is loud, and never a beat after the onset
+        CHECK(a.levelMean > 100);
+        CHECK(a.beatHops.size() <= 1);
+    }
+}
+
+static void testKicksAreBeats() {
+    // 120 BPM kick (decaying 55 Hz thump) over quiet noise, 12 s
+    std::mt19937 rng(43);
+    std::normal_distribution<double> noise(0, 0.01);
+    const double periodS = 0.5;
+    const Wav wav = roundTrip("kicks_120bpm", synth(12, [&](double t) {
+        const double since = fmod(t, periodS);
+        const double kick = 0.8 * exp(-since * 18) * sin(2 * M_PI * 55 * since);
+        return kick + noise(rng);
+    }));
+    const Analysis a = analyse(wav);
+    print("kicks_120bpm", wav, a);
+
+    // One beat per kick; the detector needs a little history first
+    const size_t kicks = (size_t)(12 / periodS);
+    CHECK(a.beatHops.size() >= kicks - 3 && a.beatHops.size() <= kicks);
+    // Beats land on kicks: every interval is a whole number of periods
+    const double periodHops = periodS * 1000 / hopMs(wav);
+    for (size_t i = 1; i < a.beatHops.size(); i++) {
+        const double periods = (a.beatHops[i] - a.beatHops[i - 1]) / periodHops;
+        CHECK(std::fabs(periods - std::round(periods)) < 0.1);
+    }
+    // Bass dominates
+    CHECK(loudestBand(a) < AudioFeatures::BANDS / 4);
+    CHECK_EQ(a.hops.back().beatCount, a.beatHops.size());
+}
+
+static void testSilenceIsDark() {
+    std::mt19937 rng(7);
+    std::normal_distribution<double> hiss(0, 0.0003);     // About -70 dBFS
+    const Wav wav = roundTrip("silence", synth(5, [&](double) { return hiss(rng); }));
+    const Analysis a = analyse(wav);
+    print("silence", wav, a);
+    // Not gained up into visible noise
+    CHECK(a.levelMean < 5);
+    for (double m : a.bandMean) CHECK(m < 5);
+    CHECK_EQ(a.beatHops.size(), 0);
+}
+
+int main(int argc, char** argv) {
+    testTonesLandInRisingBands();
+    testKicksAreBeats();
+    testSilenceIsDark();
+
+    for (int i = 1; i < argc; i++) {
+        Wav wav;
+        if (!readWav(argv[i], wav)) {
+            fprintf(stderr, "%s: not a 16-bit PCM WAV file\n", argv[i]);
+            HostTest::failures++;
+            continue;
+        }
+        print(argv[i], wav, analyse(wav));
+    }
+    return HostTest::report("AudioDspTest");
+}
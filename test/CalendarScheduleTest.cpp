@@ -0,0 +1,136 @@
+// CalendarSchedule on a virtual Unix clock, driven the way NetworkTask::pollCalendar
+// drives it: a loop tick that checks for a transition, and a refetch every few
+// minutes that replaces the events. Every meeting edge must be reported exactly
+// once, including the ones crossed while a fetch was in flight.
+#include "HostTest.h"
+#include "CalendarSchedule.h"
+#include <vector>
+
+static constexpr uint32_t T0 = 1760000000;      // Any UTC second works
+
+static CalendarEvent block(uint32_t start, uint32_t end) {
+    CalendarEvent e;
+    e.start = T0 + start;
+    e.end = T0 + end;
+    return e;
+}
+
+struct Transition {
+    uint32_t at;
+    bool busy;
+};
+
+static void testEdgeCrossedDuringFetch() {
+    CalendarSchedule calendar;
+    const CalendarEvent meeting = block(1000, 2000);
+    bool busy;
+    calendar.setEvents(&meeting, 1, T0 + 900);
+    CHECK(!calendar.takeTransition(T0 + 999, busy));
+
+    // The refetch is stamped after the start; the start is still reported
+    calendar.setEvents(&meeting, 1, T0 + 1003);
+    CHECK(calendar.takeTransition(T0 + 1003, busy));
+    CHECK(busy);
+    CHECK(!calendar.takeTransition(T0 + 1004, busy));
+
+    // Same for the end: the block has gone from the refetch, and so has the busy state
+    calendar.setEvents(&meeting, 1, T0 + 2001);
+    CHECK_EQ(calendar.count(), 0);
+    CHECK(calendar.takeTransition(T0 + 2001, busy));
+    CHECK(!busy);
+}
+
+static void testMeetingAddedAfterItStarted() {
+    CalendarSchedule calendar;
+    bool busy;
+    calendar.setEvents(nullptr, 0, T0);
+    CHECK(!calendar.takeTransition(T0 + 1500, busy));
+
+    const CalendarEvent adHoc = block(1400, 1600);
+    calendar.setEvents(&adHoc, 1, T0 + 1500);
+    CHECK(calendar.takeTransition(T0 + 1500, busy));
+    CHECK(busy);
+    CHECK(calendar.takeTransition(T0 + 1600, busy));
+    CHECK(!busy);
+}
+
+static void testRefetchMidMeetingIsQuiet() {
+    CalendarSchedule calendar;
+    const CalendarEvent meeting = block(0, 3600);
+    bool busy;
+    calendar.setEvents(&meeting, 1, T0);
+    CHECK(calendar.takeTransition(T0, busy));
+    for (uint32_t t = 300; t < 3600; t += 300) {
+        calendar.setEvents(&meeting, 1, T0 + t);
+        CHECK(!calendar.takeTransition(T0 + t, busy));
+    }
+}
+
+static void testCancelledMeetingEnds() {
+    CalendarSchedule calendar;
+    const CalendarEvent meeting = block(0, 3600);
+    bool busy;
+    calendar.setEvents(&meeting, 1, T0);
+    CHECK(calendar.takeTransition(T0 + 10, busy));
+    calendar.setEvents(nullptr, 0, T0 + 600);
+    CHECK(calendar.takeTransition(T0 + 600, busy));
+    CHECK(!busy);
+}
+
+// A working day: a 7 s loop, a refetch every 300 s that takes 4 s to come back
+// and is stamped when it does, and meetings whose edges land on either side of
+// refetches. Back-to-back blocks are one busy stretch.
+static void testWorkingDay() {
+    const std::vector<CalendarEvent> day = {
+        block(1200, 3000),          // Ends the second a refetch lands
+        block(3600, 5400),
+        block(5400, 7200),          // Back to back with the one before
+        block(9004, 9300),          // Starts the second a refetch lands
+        block(12000, 12030),        // Shorter than a refetch interval
+        block(20000, 27000),
+    };
+    // The fetch only returns what has not ended yet, as calendarView does
+    auto fetch = [&](uint32_t nowUnix, std::vector<CalendarEvent>& out) {
+        out.clear();
+        for (const CalendarEvent& e : day) {
+            if (e.end > nowUnix) out.push_back(e);
+        }
+    };
+    const std::vector<uint32_t> edges = {1200, 3000, 3600, 7200, 9004, 9300, 12000, 12030, 20000, 27000};
+
+    CalendarSchedule calendar;
+    std::vector<Transition> seen;
+    std::vector<CalendarEvent> events;
+    constexpr uint32_t LOOP_S = 7;
+    constexpr uint32_t REFRESH_S = 300;
+    constexpr uint32_t FETCH_S = 4;
+    uint32_t lastFetch = 0;
+    for (uint32_t t = 0; t < 30000; t += LOOP_S) {
+        uint32_t nowUnix = T0 + t;
+        if (t == 0 || t - lastFetch >= REFRESH_S) {
+            lastFetch = t;
+            nowUnix += FETCH_S;
+            fetch(nowUnix, events);
+            calendar.setEvents(events.data(), events.size(), nowUnix);
+        }
+        bool busy;
+        if (calendar.takeTransition(nowUnix, busy)) seen.push_back({nowUnix - T0, busy});
+    }
+
+    CHECK_EQ(seen.size(), edges.size());
+    for (size_t i = 0; i < seen.size() && i < edges.size(); i++) {
+        // Reported within one loop (and one fetch) of the edge, alternating busy/free
+        CHECK(seen[i].at >= edges[i] && seen[i].at <= edges[i] + LOOP_S + FETCH_S);
+        CHECK_EQ(seen[i].busy, i % 2 == 0);
+    }
+    printf("working day: %zu edges, %zu transitions\n", edges.size(), seen.size());
+}
+
+int main() {
+    testEdgeCrossedDuringFetch();
+    testMeetingAddedAfterItStarted();
+    testRefetchMidMeetingIsQuiet();
+    testCancelledMeetingEnds();
+    testWorkingDay();
+    return HostTest::report("CalendarScheduleTest");
+}
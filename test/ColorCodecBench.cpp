@@ -0,0 +1,120 @@
+// ColorCodec against the parsers it replaced, on the same inputs:
+// - the original HttpApi::parseColor (String copy, substring, strtoul);
+// - the const char* + strtoul version that followed it;
+// - snprintf("#%06X") for formatting.
+// Checks that every path agrees on well-formed hex, then prints ns per color.
+// Timings are wall-clock on the host, so they aren't asserted on.
+#include "HostTest.h"
+#include "ColorCodec.h"
+#include <chrono>
+#include <random>
+#include <vector>
+
+// From HttpApi.cpp before ColorCodec
+static uint32_t legacyParseColorString(const String& str) {
+    String s = str;
+    if (s.startsWith("#")) s = s.substring(1);
+    return (uint32_t)strtoul(s.c_str(), nullptr, 16);
+}
+
+static uint32_t legacyParseColor(const char* str) {
+    if (str[0] == '#') str++;
+    return (uint32_t)strtoul(str, nullptr, 16);
+}
+
+static constexpr size_t COLORS = 4096;
+static constexpr int ROUNDS = 200;
+
+static volatile uint32_t sink;
+
+template <typename Fn>
+static double nsPerColor(Fn fn) {
+    fn();   // Warm up
+    const auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < ROUNDS; r++) fn();
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / ((double)ROUNDS * COLORS);
+}
+
+int main() {
+    std::mt19937 rng(40);
+    std::vector<uint32_t> colors(COLORS);
+    std::vector<std::string> hex(COLORS);
+    std::vector<String> hexStrings;
+    std::vector<const char*> hexPtrs(COLORS);
+    for (size_t i = 0; i < COLORS; i++) {
+        colors[i] = rng() & 0xFFFFFF;
+        char buf[8];
+        snprintf(buf, sizeof(buf), i % 2 ? "#%06X" : "#%06x", (unsigned)colors[i]);
+        hex[i] = buf;
+        hexStrings.emplace_back(buf);
+    }
+    for (size_t i = 0; i < COLORS; i++) hexPtrs[i] = hex[i].c_str();
+
+    // Same answers on well-formed input
+    std::vector<uint32_t> batch(COLORS);
+    ColorCodec::Error error;
+    CHECK_EQ(ColorCodec::parseBatch(hexPtrs.data(), COLORS, batch.data(), error), COLORS);
+    for (size_t i = 0; i < COLORS; i++) {
+        uint32_t parsed = 0;
+        CHECK(ColorCodec::parse(hexPtrs[i], parsed) == ColorCodec::Error::None);
+        CHECK_EQ(parsed, colors[i]);
+        CHECK_EQ(batch[i], colors[i]);
+        CHECK_EQ(legacyParseColor(hexPtrs[i]), colors[i]);
+        CHECK_EQ(legacyParseColorString(hexStrings[i]), colors[i]);
+        char formatted[8];
+        ColorCodec::formatHex(colors[i], formatted);
+        char expected[8];
+        snprintf(expected, sizeof(expected), "#%06X", (unsigned)colors[i]);
+        CHECK(strcmp(formatted, expected) == 0);
+    }
+    // Where they differ: the old parsers turned garbage into a color
+    uint32_t parsed;
+    CHECK_EQ(legacyParseColor("#12345G"), 0x12345);
+    CHECK(ColorCodec::parse("#12345G", parsed) == ColorCodec::Error::BadHex);
+
+    const double stringPath = nsPerColor([&] {
+        for (const String& s : hexStrings) sink = legacyParseColorString(s);
+    });
+    const double strtoulPath = nsPerColor([&] {
+        for (const char* s : hexPtrs) sink = legacyParseColor(s);
+    });
+    const double codecParse = nsPerColor([&] {
+        uint32_t c;
+        for (const char* s : hexPtrs) {
+            ColorCodec::parse(s, c);
+            sink = c;
+        }
+    });
+    const double codecBatch = nsPerColor([&] {
+        ColorCodec::Error e;
+        ColorCodec::parseBatch(hexPtrs.data(), COLORS, batch.data(), e);
+        sink = batch[COLORS - 1];
+    });
+    char out[8];
+    const double snprintfFormat = nsPerColor([&] {
+        for (uint32_t c : colors) {
+            snprintf(out, sizeof(out), "#%06X", (unsigned)c);
+            sink = out[1];
+        }
+    });
+    const double codecFormat = nsPerColor([&] {
+        for (uint32_t c : colors) {
+            ColorCodec::formatHex(c, out);
+            sink = out[1];
+        }
+    });
+
+    printf("parse, ns per color (%zu colors x %d rounds)\n", COLORS, ROUNDS);
+    printf("  String copy + substring + strtoul  %7.1f\n", stringPath);
+    printf("  strtoul                            %7.1f\n", strtoulPath);
+    printf("  ColorCodec::parse                  %7.1f  (%.1fx the String path)\n", codecParse,
+           stringPath / codecParse);
+    printf("  ColorCodec::parseBatch             %7.1f  (%.1fx the String path)\n", codecBatch,
+           stringPath / codecBatch);
+    printf("format, ns per color\n");
+    printf("  snprintf(\"#%%06X\")                  %7.1f\n", snprintfFormat);
+    printf("  ColorCodec::formatHex              %7.1f  (%.1fx)\n", codecFormat, snprintfFormat / codecFormat);
+
+    return HostTest::report("ColorCodecBench");
+}
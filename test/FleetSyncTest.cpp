@@ -0,0 +1,191 @@
+// Multi-instance fleet simulator: several FleetSync nodes with their own
+// offset and drifting clocks on an in-memory multicast network with jittery
+// latency. Measures how closely followers track the leader's clock and how
+// far apart a multicast command lands across the fleet.
+#include "HostTest.h"
+#include "FleetSync.h"
+#include "Config.h"
+#include <esp_timer.h>
+#include <cmath>
+#include <memory>
+#include <random>
+
+static constexpr int NODES = 5;
+static constexpr uint32_t STEP_US = 200;            // Each node polls this often
+static constexpr uint32_t MIN_LATENCY_US = 500;
+static constexpr uint32_t MAX_LATENCY_US = 3000;
+
+struct Node {
+    FleetSync sync;
+    int64_t clockOffsetUs = 0;      // Local clock minus true time
+    double driftPpm = 0;
+    bool running = true;
+
+    uint64_t localUs(uint64_t trueUs) const {
+        return (uint64_t)((int64_t)trueUs + clockOffsetUs + (int64_t)(trueUs * driftPpm / 1e6));
+    }
+    // Fleet time at true time `trueUs`, in microseconds
+    int64_t fleetUs(uint64_t trueUs) const { return (int64_t)localUs(trueUs) + offsetUs(); }
+    int64_t offsetUs() const { return sync.isLeader() ? 0 : sync.offsetUs(); }
+};
+
+static std::mt19937 rng(1234);
+static std::vector<std::unique_ptr<Node>> nodes;
+static uint64_t trueUs = 0;
+
+// Runs `fn` with the global clock set to `node`'s local clock
+template <typename Fn>
+static auto onNode(Node& node, Fn fn) {
+    HostClock::nowUs = node.localUs(trueUs);
+    return fn();
+}
+
+static void run(uint32_t ms, const std::function<void()>& eachStep = nullptr) {
+    const uint64_t end = trueUs + (uint64_t)ms * 1000;
+    while (trueUs < end) {
+        trueUs += STEP_US;
+        HostNetwork::nowUs = trueUs;
+        for (auto& n : nodes) {
+            if (n->running) onNode(*n, [&] { n->sync.poll(millis()); });
+        }
+        if (eachStep) eachStep();
+    }
+}
+
+static Node& leaderOf(Node& node) {
+    for (auto& n : nodes) {
+        if (n->sync.nodeId() == node.sync.leaderId()) return *n;
+    }
+    return node;
+}
+
+static uint32_t lowestRunningId() {
+    uint32_t id = UINT32_MAX;
+    for (auto& n : nodes) {
+        if (n->running && n->sync.nodeId() < id) id = n->sync.nodeId();
+    }
+    return id;
+}
+
+static void checkAgreedLeader() {
+    const uint32_t expected = lowestRunningId();
+    for (auto& n : nodes) {
+        if (!n->running) continue;
+        CHECK_EQ(n->sync.leaderId(), expected);
+        CHECK(onNode(*n, [&] { return n->sync.isSynced(); }));
+    }
+}
+
+// Worst follower-vs-leader clock difference over `ms` of running
+static int64_t measureSyncError(uint32_t ms) {
+    int64_t worst = 0;
+    uint32_t steps = 0;
+    run(ms, [&] {
+        if (++steps % 50 != 0) return;      // Every 10 ms
+        for (auto& n : nodes) {
+            if (!n->running || n->sync.isLeader()) continue;
+            const int64_t error = std::llabs(n->fleetUs(trueUs) - leaderOf(*n).fleetUs(trueUs));
+            worst = std::max(worst, error);
+        }
+    });
+    return worst;
+}
+
+// Same layout as server/fleet_client.py's COMMAND_FORMAT
+struct __attribute__((packed)) CommandPacket {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint8_t fields;
+    uint8_t powerOn;
+    uint32_t seq;
+    uint32_t color;
+    uint16_t speedMs;
+    uint8_t brightness;
+    char animation[16];
+};
+
+static void testCommandFanOut(WiFiUDP& director) {
+    CommandPacket p = {0x53465254, 1, 4, FleetCommand::COLOR | FleetCommand::ANIMATION, 0, 77, 0xFF0000, 0, 0, "strobe"};
+    const uint64_t sentUs = trueUs;
+    // The client repeats each command; nodes apply it once
+    for (int i = 0; i < 3; i++) {
+        director.beginMulticastPacket();
+        director.write(reinterpret_cast<const uint8_t*>(&p), sizeof(p));
+        director.endPacket();
+    }
+
+    std::vector<uint64_t> appliedUs(nodes.size(), 0);
+    std::vector<int> applied(nodes.size(), 0);
+    run(50, [&] {
+        for (size_t i = 0; i < nodes.size(); i++) {
+            FleetCommand cmd;
+            if (nodes[i]->sync.takeCommand(cmd)) {
+                applied[i]++;
+                appliedUs[i] = trueUs;
+                CHECK_EQ(cmd.color, 0xFF0000);
+                CHECK(strcmp(cmd.animation, "strobe") == 0);
+            }
+        }
+    });
+
+    uint64_t first = UINT64_MAX, last = 0;
+    uint32_t fleetFirst = UINT32_MAX, fleetLast = 0;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        CHECK_EQ(applied[i], 1);
+        first = std::min(first, appliedUs[i]);
+        last = std::max(last, appliedUs[i]);
+        fleetFirst = std::min(fleetFirst, nodes[i]->sync.lastCommandFleetMs());
+        fleetLast = std::max(fleetLast, nodes[i]->sync.lastCommandFleetMs());
+    }
+    printf("command fan-out: first applied after %.2f ms, last after %.2f ms, spread %.2f ms; "
+           "fleet-time spread %u ms\n",
+           (first - sentUs) / 1000.0, (last - sentUs) / 1000.0, (last - first) / 1000.0,
+           (unsigned)(fleetLast - fleetFirst));
+    CHECK(last - sentUs <= MAX_LATENCY_US + STEP_US);
+    // Nodes apply it within one latency spread, and agree on when that was to within the sync error
+    CHECK(fleetLast - fleetFirst <= 5);
+}
+
+int main() {
+    std::uniform_int_distribution<uint32_t> latency(MIN_LATENCY_US, MAX_LATENCY_US);
+    HostNetwork::latencyUs = [&] { return latency(rng); };
+
+    std::uniform_int_distribution<int64_t> offset(-10000000, 10000000);
+    std::uniform_real_distribution<double> drift(-40, 40);
+    for (int i = 0; i < NODES; i++) {
+        auto n = std::make_unique<Node>();
+        n->clockOffsetUs = offset(rng);
+        n->driftPpm = drift(rng);
+        ESP.efuseMac = 0x1000 + (uint64_t)(NODES - i) * 0x111;
+        onNode(*n, [&] { return n->sync.begin(); });
+        nodes.push_back(std::move(n));
+    }
+    WiFiUDP director;
+    director.beginMulticast(IPAddress(Config::FLEET_GROUP[0], Config::FLEET_GROUP[1], Config::FLEET_GROUP[2],
+                                      Config::FLEET_GROUP[3]),
+                            Config::FLEET_PORT);
+
+    // Elect a leader and sync to it
+    run(15000);
+    checkAgreedLeader();
+    const int64_t syncError = measureSyncError(20000);
+    printf("sync error: worst %.3f ms over 20 s (%d nodes, %u-%u us latency, up to 40 ppm drift)\n",
+           syncError / 1000.0, NODES, MIN_LATENCY_US, MAX_LATENCY_US);
+    // Asymmetric latency bounds the NTP-style estimate at half the spread
+    CHECK(syncError <= (MAX_LATENCY_US - MIN_LATENCY_US) / 2 + 2 * STEP_US + 400);
+
+    testCommandFanOut(director);
+
+    // Leader goes away: the rest fall back and re-elect the next lowest id
+    for (auto& n : nodes) {
+        if (n->sync.nodeId() == lowestRunningId()) n->running = false;
+    }
+    run(15000);
+    checkAgreedLeader();
+    const int64_t afterFailover = measureSyncError(10000);
+    printf("sync error after leader failover: worst %.3f ms\n", afterFailover / 1000.0);
+    CHECK(afterFailover <= (MAX_LATENCY_US - MIN_LATENCY_US) / 2 + 2 * STEP_US + 400);
+
+    return HostTest::report("FleetSyncTest");
+}
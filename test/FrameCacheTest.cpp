@@ -0,0 +1,160 @@
+// Cached frames must look exactly like rendering every time. Each periodic
+// animation runs through AnimationManager (which replays its FrameCache) next
+// to a second instance rendered directly, and the two frames are compared at
+// every tick: while the cache fills, once it replays, and after a state change
+// with its version bump. A period too big for the arena falls back to
+// rendering, with the same output.
+#include "HostTest.h"
+#include "AnimationManager.h"
+#include "FrameCache.h"
+#include "LedRing.h"
+#include "Memory.h"
+#include "Metrics.h"
+#include "PixelSpan.h"
+#include "animations/FadeAnimation.h"
+#include "animations/SpinAnimation.h"
+#include "animations/SpinTailAnimation.h"
+#include "animations/StrobeAnimation.h"
+
+static constexpr uint16_t PIXELS = 24;
+static constexpr uint16_t TOO_MANY_PIXELS = 120;   // A spin period of these is ~86 KB
+static constexpr uint32_t TICK_MS = 7;             // Lands at every offset within a step
+
+// Frames that differ between the manager's ring and `reference` rendered
+// directly, over `ms` of ticks from `fromMs`
+static uint32_t mismatches(AnimationManager& mgr, IAnimation& reference, LedRing& cached, LedRing& direct,
+                           const AppState& state, uint32_t version, uint32_t fromMs, uint32_t ms) {
+    uint32_t differing = 0;
+    for (uint32_t now = fromMs; now < fromMs + ms; now += TICK_MS) {
+        mgr.update(now, state, version, cached);
+        PixelSpan span(direct, 0, direct.numPixels());
+        reference.render(now, state, span);
+        if (memcmp(cached.frameData(), direct.frameData(), (size_t)direct.numPixels() * 3 * sizeof(uint16_t)) != 0) {
+            differing++;
+        }
+    }
+    return differing;
+}
+
+static uint32_t periodMs(const IAnimation& anim, const AppState& state, uint16_t pixels) {
+    uint32_t stepMs = 0, frames = 0;
+    CHECK(anim.period(state, pixels, stepMs, frames));
+    return stepMs * frames;
+}
+
+static void testCachedMatchesRendered(LedRing& cached, LedRing& direct) {
+    static FadeAnimation fade, fadeRef;
+    static StrobeAnimation strobe, strobeRef;
+    static SpinAnimation spin, spinRef;
+    static SpinTailAnimation spinTail, spinTailRef;
+    const struct {
+        IAnimation* animation;
+        IAnimation* reference;
+    } cases[] = {{&fade, &fadeRef}, {&strobe, &strobeRef}, {&spin, &spinRef}, {&spinTail, &spinTailRef}};
+
+    AnimationManager mgr;
+    for (const auto& c : cases) mgr.addAnimation(c.animation);
+
+    uint32_t version = 1;
+    uint32_t now = 0;
+    for (const auto& c : cases) {
+        AppState state;
+        state.primaryColor = 0x3080FF;
+        mgr.setActive(c.animation->name(), state);
+        c.reference->onEnter(state);
+
+        // Fills over the first period, replays over the next two
+        uint32_t fills = Metrics::frameCacheFills;
+        uint32_t hits = Metrics::frameCacheHits;
+        uint32_t period = periodMs(*c.reference, state, PIXELS);
+        CHECK_EQ(mismatches(mgr, *c.reference, cached, direct, state, version, now, 3 * period), 0);
+        now += 3 * period;
+        CHECK(Metrics::frameCacheFills > fills);
+        CHECK(Metrics::frameCacheHits > hits);
+
+        // The version is the cache's only key: the same change without a bump keeps
+        // replaying the old frames, which shows the comparison above would catch it
+        AppState changed = state;
+        changed.primaryColor = 0xFF2000;
+        CHECK(mismatches(mgr, *c.reference, cached, direct, changed, version, now, period) > 0);
+        now += period;
+
+        // With the bump the cache starts over, at the new step length and tail too
+        changed.speedMs = 20;
+        changed.strobePeriodMs = 60;
+        changed.tailLength = 3;
+        version++;
+        fills = Metrics::frameCacheFills;
+        hits = Metrics::frameCacheHits;
+        period = periodMs(*c.reference, changed, PIXELS);
+        CHECK_EQ(mismatches(mgr, *c.reference, cached, direct, changed, version, now, 3 * period), 0);
+        now += 3 * period;
+        CHECK(Metrics::frameCacheFills > fills);
+        CHECK(Metrics::frameCacheHits > hits);
+        printf("%-9s matches rendering before and after a version bump (%u ms period after)\n",
+               c.animation->name(), (unsigned)period);
+        version++;
+    }
+}
+
+static void testOverBudgetFallsBack(LedRing& cached, LedRing& direct) {
+    static SpinAnimation spin, spinRef;
+    AnimationManager mgr;
+    mgr.addAnimation(&spin);
+    AppState state;
+    mgr.setActive(spin.name(), state);
+    spinRef.onEnter(state);
+
+    const uint32_t fills = Metrics::frameCacheFills;
+    const uint32_t hits = Metrics::frameCacheHits;
+    const uint32_t failures = Memory::frameCache.failures();
+    const uint32_t period = periodMs(spinRef, state, TOO_MANY_PIXELS);
+    CHECK_EQ(mismatches(mgr, spinRef, cached, direct, state, 1, 0, 2 * period), 0);
+    CHECK_EQ(Metrics::frameCacheFills, fills);
+    CHECK_EQ(Metrics::frameCacheHits, hits);
+    // Turned away up front, not counted as an arena failure
+    CHECK_EQ(Memory::frameCache.failures(), failures);
+}
+
+static void testInactiveCache() {
+    FrameCache cache;
+    uint16_t frame[PIXELS * 3] = {1, 2, 3};
+    CHECK(!cache.active());
+    CHECK(cache.frame(0) == nullptr);
+    cache.store(5, frame);     // Ignored, not a divide by zero
+    CHECK(cache.frame(5) == nullptr);
+
+    // Periods that don't fit, including ones whose byte count would wrap a 32-bit size_t
+    CHECK(!cache.begin(PIXELS, 10, 0));
+    CHECK(!cache.begin(300, 10, 0x80000000u));
+    CHECK(!cache.begin(UINT16_MAX, 10, UINT32_MAX));
+    CHECK(!cache.active());
+    CHECK(cache.frame(3) == nullptr);
+
+    CHECK(cache.begin(PIXELS, 10, 4));
+    CHECK(cache.active());
+    CHECK(cache.frame(1) == nullptr);
+    cache.store(1, frame);
+    CHECK(cache.frame(5) != nullptr);     // Same slot one period on
+    CHECK_EQ(cache.frame(5)[2], 3);
+    cache.reset();
+    CHECK(cache.frame(1) == nullptr);
+}
+
+int main() {
+    // Room for the rings here; the firmware sizes this arena for its one strip
+    Memory::frames = Memory::Arena("frames", 4 * TOO_MANY_PIXELS * 3 * (sizeof(uint16_t) + sizeof(uint8_t)) + 64,
+                                   false);
+    Memory::begin();
+    LedRing cached(0, PIXELS), direct(1, PIXELS);
+    LedRing bigCached(2, TOO_MANY_PIXELS), bigDirect(3, TOO_MANY_PIXELS);
+    cached.begin();
+    direct.begin();
+    bigCached.begin();
+    bigDirect.begin();
+
+    testCachedMatchesRendered(cached, direct);
+    testOverBudgetFallsBack(bigCached, bigDirect);
+    testInactiveCache();
+    return HostTest::report("FrameCacheTest");
+}
@@ -0,0 +1,337 @@
+// FrameDecoder on /frame payloads built here: raw, rle and delta round trips,
+// RGBW mixed into RGB, every split point of a payload across two writes,
+// truncated and overlong payloads, and writes confined to offset..offset+length.
+// Ends with decode rates for a 300-pixel frame; they are wall-clock on the
+// host, so they aren't asserted on.
+#include "HostTest.h"
+#include "FrameDecoder.h"
+#include <chrono>
+#include <random>
+#include <vector>
+
+using Bytes = std::vector<uint8_t>;
+using Frame = std::vector<uint32_t>;
+
+static constexpr uint16_t STRIP = 300;
+static constexpr uint32_t UNTOUCHED = 0xDEADBE;
+
+static void appendPixel(Bytes& out, uint32_t color) {
+    out.push_back((uint8_t)(color >> 16));
+    out.push_back((uint8_t)(color >> 8));
+    out.push_back((uint8_t)color);
+}
+
+static Bytes encodeRaw(const Frame& frame) {
+    Bytes out;
+    for (uint32_t c : frame) appendPixel(out, c);
+    return out;
+}
+
+static Bytes encodeRle(const Frame& frame) {
+    Bytes out;
+    for (size_t i = 0; i < frame.size();) {
+        size_t run = 1;
+        while (i + run < frame.size() && run < 256 && frame[i + run] == frame[i]) run++;
+        out.push_back((uint8_t)(run - 1));
+        appendPixel(out, frame[i]);
+        i += run;
+    }
+    return out;
+}
+
+// Records of [skip] [n] pixel x n for the pixels that differ from `before`
+static Bytes encodeDelta(const Frame& before, const Frame& after) {
+    Bytes out;
+    size_t i = 0;
+    while (true) {
+        size_t skip = 0;
+        while (i + skip < after.size() && skip < 255 && after[i + skip] == before[i + skip]) skip++;
+        if (i + skip == after.size()) break;
+        size_t n = 0;
+        while (i + skip + n < after.size() && n < 255 && after[i + skip + n] != before[i + skip + n]) n++;
+        out.push_back((uint8_t)skip);
+        out.push_back((uint8_t)n);
+        for (size_t k = 0; k < n; k++) appendPixel(out, after[i + skip + k]);
+        i += skip + n;
+    }
+    return out;
+}
+
+// Runs of 1-40 random colors, so rle has something to do
+static Frame randomFrame(std::mt19937& rng) {
+    Frame frame;
+    while (frame.size() < STRIP) {
+        const uint32_t color = rng() & 0xFFFFFF;
+        const size_t run = 1 + rng() % 40;
+        for (size_t k = 0; k < run && frame.size() < STRIP; k++) frame.push_back(color);
+    }
+    return frame;
+}
+
+// Feeds `payload` in `chunk`-byte writes; the result of the last write or finish()
+static bool decode(FrameDecoder& decoder, const Bytes& payload, size_t chunk) {
+    for (size_t pos = 0; pos < payload.size(); pos += chunk) {
+        const size_t n = std::min(chunk, payload.size() - pos);
+        if (!decoder.write(payload.data() + pos, n)) return false;
+    }
+    return decoder.finish();
+}
+
+static bool errorIs(const FrameDecoder& decoder, const char* expected) {
+    return decoder.error() && strcmp(decoder.error(), expected) == 0;
+}
+
+static void testRoundTrips() {
+    std::mt19937 rng(41);
+    const size_t chunks[] = {1, 2, 3, 4, 5, 7, 64, 1436, 4096};
+    for (int round = 0; round < 20; round++) {
+        const Frame before = randomFrame(rng);
+        const Frame after = randomFrame(rng);
+        Frame partial = before;
+        size_t changed = 0;
+        for (size_t i = 0; i < STRIP; i++) {
+            if (rng() % 8 == 0) partial[i] = rng() & 0xFFFFFF;
+            if (partial[i] != before[i]) changed++;
+        }
+
+        for (size_t chunk : chunks) {
+            FrameDecoder decoder;
+            Frame out(STRIP, UNTOUCHED);
+
+            decoder.begin(out.data(), 0, STRIP, 3, FrameDecoder::Encoding::Raw);
+            CHECK(decode(decoder, encodeRaw(after), chunk));
+            CHECK(out == after);
+            CHECK_EQ(decoder.pixelsWritten(), STRIP);
+
+            out.assign(STRIP, UNTOUCHED);
+            decoder.begin(out.data(), 0, STRIP, 3, FrameDecoder::Encoding::Rle);
+            CHECK(decode(decoder, encodeRle(after), chunk));
+            CHECK(out == after);
+            CHECK_EQ(decoder.firstWritten(), 0);
+            CHECK_EQ(decoder.lastWritten(), STRIP - 1);
+
+            // Delta starts from what's shown and only touches what changed
+            out = before;
+            decoder.begin(out.data(), 0, STRIP, 3, FrameDecoder::Encoding::Delta);
+            CHECK(decode(decoder, encodeDelta(before, partial), chunk));
+            CHECK(out == partial);
+            CHECK_EQ(decoder.pixelsWritten(), changed);
+        }
+    }
+
+    // A delta with nothing changed is empty and writes nothing
+    FrameDecoder decoder;
+    Frame out(STRIP, 0x123456);
+    decoder.begin(out.data(), 0, STRIP, 3, FrameDecoder::Encoding::Delta);
+    CHECK(decode(decoder, encodeDelta(out, out), 1));
+    CHECK_EQ(decoder.pixelsWritten(), 0);
+    CHECK(decoder.lastWritten() < decoder.firstWritten());
+}
+
+static void testRgbwSaturates() {
+    const Bytes rgbw = {
+        200, 10, 0, 100,    // Each channel plus white, clamped
+        0, 0, 0, 255,       // White alone is full white
+        1, 2, 3, 0,         // No white, unchanged
+        255, 255, 255, 255,
+    };
+    Frame out(4, UNTOUCHED);
+    FrameDecoder decoder;
+    decoder.begin(out.data(), 0, 4, 4, FrameDecoder::Encoding::Raw);
+    CHECK(decode(decoder, rgbw, 3));
+    CHECK_EQ(out[0], 0xFF6E64);
+    CHECK_EQ(out[1], 0xFFFFFF);
+    CHECK_EQ(out[2], 0x010203);
+    CHECK_EQ(out[3], 0xFFFFFF);
+
+    // RLE of RGBW: one run of 3
+    const Bytes rle = {2, 16, 32, 48, 240};
+    out.assign(4, UNTOUCHED);
+    decoder.begin(out.data(), 0, 3, 4, FrameDecoder::Encoding::Rle);
+    CHECK(decode(decoder, rle, 1));
+    CHECK_EQ(out[0], 0xFFFFFF);
+    CHECK_EQ(out[2], 0xFFFFFF);
+    CHECK_EQ(out[3], UNTOUCHED);
+}
+
+// Every way to cut a payload in two, including inside a run count, a delta
+// skip/count pair and a pixel, decodes the same as one write
+static void testEverySplitPoint() {
+    const Frame before = {0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000};
+    const Frame after = {0x000000, 0x112233, 0x112233, 0x000000, 0x445566, 0x778899};
+    const struct {
+        FrameDecoder::Encoding encoding;
+        Bytes payload;
+    } cases[] = {
+        {FrameDecoder::Encoding::Raw, encodeRaw(after)},
+        {FrameDecoder::Encoding::Rle, encodeRle(after)},
+        {FrameDecoder::Encoding::Delta, encodeDelta(before, after)},
+    };
+    for (const auto& c : cases) {
+        for (size_t split = 0; split <= c.payload.size(); split++) {
+            Frame out = before;
+            FrameDecoder decoder;
+            decoder.begin(out.data(), 0, (uint16_t)out.size(), 3, c.encoding);
+            CHECK(decoder.write(c.payload.data(), split));
+            CHECK(decoder.write(c.payload.data() + split, c.payload.size() - split));
+            CHECK(decoder.finish());
+            CHECK(out == after);
+        }
+    }
+}
+
+static void testTruncatedAndOverlong() {
+    Frame out(8, UNTOUCHED);
+    FrameDecoder decoder;
+    auto run = [&](FrameDecoder::Encoding encoding, uint16_t length, const Bytes& payload) {
+        out.assign(8, UNTOUCHED);
+        decoder.begin(out.data(), 0, length, 3, encoding);
+        return decode(decoder, payload, 1);
+    };
+
+    // Raw: short, mid-pixel, long
+    CHECK(!run(FrameDecoder::Encoding::Raw, 2, {1, 2, 3}));
+    CHECK(errorIs(decoder, "Payload has fewer pixels than 'length'"));
+    CHECK(!run(FrameDecoder::Encoding::Raw, 2, {1, 2, 3, 4, 5}));
+    CHECK(errorIs(decoder, "Payload ends mid-pixel"));
+    CHECK(!run(FrameDecoder::Encoding::Raw, 2, {1, 2, 3, 4, 5, 6, 7, 8, 9}));
+    CHECK(errorIs(decoder, "Payload has more pixels than 'length'"));
+    CHECK(!run(FrameDecoder::Encoding::Raw, 2, {}));
+    CHECK(errorIs(decoder, "Payload has fewer pixels than 'length'"));
+
+    // Rle: a count with no pixel, a run past the end, runs short of it
+    CHECK(!run(FrameDecoder::Encoding::Rle, 4, {3}));
+    CHECK(errorIs(decoder, "Payload ends mid-run"));
+    CHECK(!run(FrameDecoder::Encoding::Rle, 4, {4, 9, 9, 9}));
+    CHECK(errorIs(decoder, "Payload has more pixels than 'length'"));
+    CHECK(out[0] == UNTOUCHED);    // A run that doesn't fit writes nothing
+    CHECK(!run(FrameDecoder::Encoding::Rle, 4, {2, 9, 9, 9}));
+    CHECK(errorIs(decoder, "Payload has fewer pixels than 'length'"));
+
+    // Delta: half a header, a record short of its count, a skip or count past the end
+    CHECK(!run(FrameDecoder::Encoding::Delta, 4, {1}));
+    CHECK(errorIs(decoder, "Payload ends mid-header"));
+    CHECK(!run(FrameDecoder::Encoding::Delta, 4, {0, 2, 9, 9, 9}));
+    CHECK(errorIs(decoder, "Payload ends mid-run"));
+    CHECK(!run(FrameDecoder::Encoding::Delta, 4, {5, 0}));
+    CHECK(errorIs(decoder, "Delta skip runs past 'length'"));
+    CHECK(!run(FrameDecoder::Encoding::Delta, 4, {3, 2, 9, 9, 9, 8, 8, 8}));
+    CHECK(errorIs(decoder, "Payload has more pixels than 'length'"));
+    // Skipping to exactly the end is fine
+    CHECK(run(FrameDecoder::Encoding::Delta, 4, {4, 0}));
+
+    // Once failed, later writes are refused and touch nothing
+    out.assign(8, UNTOUCHED);
+    decoder.begin(out.data(), 0, 1, 3, FrameDecoder::Encoding::Raw);
+    const Bytes two = {1, 1, 1, 2, 2, 2};
+    CHECK(!decoder.write(two.data(), two.size()));
+    const Bytes more = {3, 3, 3};
+    CHECK(!decoder.write(more.data(), more.size()));
+    CHECK(!decoder.finish());
+    CHECK(errorIs(decoder, "Payload has more pixels than 'length'"));
+    CHECK_EQ(out[0], 0x010101);
+    CHECK_EQ(out[1], UNTOUCHED);
+}
+
+// Only offset..offset+length-1 is ever written, whatever the encoding
+static void testOffsetAndLength() {
+    const uint16_t offset = 100, length = 50;
+    std::mt19937 rng(42);
+    const Frame full = randomFrame(rng);
+    const Frame window(full.begin() + offset, full.begin() + offset + length);
+    const Frame zeros(length, 0);
+
+    const struct {
+        FrameDecoder::Encoding encoding;
+        Bytes payload;
+    } cases[] = {
+        {FrameDecoder::Encoding::Raw, encodeRaw(window)},
+        {FrameDecoder::Encoding::Rle, encodeRle(window)},
+        {FrameDecoder::Encoding::Delta, encodeDelta(zeros, window)},
+    };
+    for (const auto& c : cases) {
+        Frame out(STRIP, UNTOUCHED);
+        if (c.encoding == FrameDecoder::Encoding::Delta) {
+            std::fill(out.begin() + offset, out.begin() + offset + length, 0);
+        }
+        FrameDecoder decoder;
+        decoder.begin(out.data(), offset, length, 3, c.encoding);
+        CHECK(decode(decoder, c.payload, 7));
+        for (uint16_t i = 0; i < STRIP; i++) {
+            if (i < offset || i >= offset + length) CHECK_EQ(out[i], UNTOUCHED);
+            else CHECK_EQ(out[i], full[i]);
+        }
+        CHECK(decoder.firstWritten() >= offset);
+        CHECK(decoder.lastWritten() <= offset + length - 1);
+    }
+
+    // The last pixel of the strip on its own, and one more than fits after it
+    Frame out(STRIP, UNTOUCHED);
+    FrameDecoder decoder;
+    decoder.begin(out.data(), STRIP - 1, 1, 3, FrameDecoder::Encoding::Raw);
+    CHECK(decode(decoder, {0xAB, 0xCD, 0xEF}, 3));
+    CHECK_EQ(out[STRIP - 1], 0xABCDEF);
+    CHECK_EQ(decoder.firstWritten(), STRIP - 1);
+    decoder.begin(out.data(), STRIP - 1, 1, 3, FrameDecoder::Encoding::Rle);
+    CHECK(!decode(decoder, {1, 0, 0, 0}, 4));
+    CHECK_EQ(out[STRIP - 1], 0xABCDEF);
+
+    CHECK(!decode(decoder, {}, 1));     // Still failed until begin()
+}
+
+static void testParseEncoding() {
+    FrameDecoder::Encoding e;
+    CHECK(FrameDecoder::parseEncoding("", e) && e == FrameDecoder::Encoding::Raw);
+    CHECK(FrameDecoder::parseEncoding("raw", e) && e == FrameDecoder::Encoding::Raw);
+    CHECK(FrameDecoder::parseEncoding("rle", e) && e == FrameDecoder::Encoding::Rle);
+    CHECK(FrameDecoder::parseEncoding("delta", e) && e == FrameDecoder::Encoding::Delta);
+    CHECK(!FrameDecoder::parseEncoding("RLE", e));
+    CHECK(!FrameDecoder::parseEncoding("zip", e));
+}
+
+static constexpr int ROUNDS = 20000;
+
+// Frames per second decoding `payload` into a 300-pixel strip, in chunks the
+// size of the web server's receive buffer
+static double framesPerSecond(FrameDecoder::Encoding encoding, const Bytes& payload, Frame& out) {
+    FrameDecoder decoder;
+    auto once = [&] {
+        decoder.begin(out.data(), 0, STRIP, 3, encoding);
+        return decode(decoder, payload, 1436);
+    };
+    CHECK(once());  // Warm up
+    const auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < ROUNDS; r++) once();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return ROUNDS / elapsed.count();
+}
+
+static void printDecodeRates() {
+    std::mt19937 rng(43);
+    const Frame before = randomFrame(rng);
+    const Frame after = randomFrame(rng);
+    Frame partial = before;
+    for (size_t i = 0; i < STRIP; i += 10) partial[i] = ~before[i] & 0xFFFFFF;
+
+    Frame out(STRIP);
+    const Bytes raw = encodeRaw(after);
+    const Bytes rle = encodeRle(after);
+    const Bytes delta = encodeDelta(before, partial);
+    printf("decode, %u pixels (host wall clock):\n", (unsigned)STRIP);
+    printf("  raw    %4zu bytes  %9.0f frames/s\n", raw.size(), framesPerSecond(FrameDecoder::Encoding::Raw, raw, out));
+    printf("  rle    %4zu bytes  %9.0f frames/s\n", rle.size(), framesPerSecond(FrameDecoder::Encoding::Rle, rle, out));
+    out = before;
+    printf("  delta  %4zu bytes  %9.0f frames/s  (every 10th pixel changed)\n", delta.size(),
+           framesPerSecond(FrameDecoder::Encoding::Delta, delta, out));
+}
+
+int main() {
+    testRoundTrips();
+    testRgbwSaturates();
+    testEverySplitPoint();
+    testTruncatedAndOverlong();
+    testOffsetAndLength();
+    testParseEncoding();
+    printDecodeRates();
+    return HostTest::report("FrameDecoderTest");
+}
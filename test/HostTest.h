@@ -0,0 +1,41 @@
+#pragma once
+
+// Minimal checks for the host tests: failures are counted and reported, and
+// main() returns non-zero if there were any
+#include <cstdio>
+#include <cstdlib>
+
+namespace HostTest {
+
+inline int failures = 0;
+
+inline void fail(const char* file, int line, const char* expr, long long a, long long b, bool showValues) {
+    if (showValues) {
+        fprintf(stderr, "%s:%d: CHECK_EQ(%s) failed: %lld != %lld\n", file, line, expr, a, b);
+    } else {
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expr);
+    }
+    failures++;
+}
+
+inline int report(const char* name) {
+    if (failures == 0) {
+        printf("%s: all checks passed\n", name);
+        return EXIT_SUCCESS;
+    }
+    printf("%s: %d check(s) failed\n", name, failures);
+    return EXIT_FAILURE;
+}
+
+}
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) HostTest::fail(__FILE__, __LINE__, #cond, 0, 0, false); \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                                   \
+    do {                                                                                                 \
+        const long long a_ = (long long)(a), b_ = (long long)(b);                                        \
+        if (a_ != b_) HostTest::fail(__FILE__, __LINE__, #a ", " #b, a_, b_, true);                      \
+    } while (0)
@@ -0,0 +1,203 @@
+// HttpsSession against the HTTPClient stand-in: bodies read back intact
+// whatever their framing, requests in one poll share the connection, and
+// endBurst() gives the connection's heap back between polls. Ends with ten
+// minutes of 15 s polls with the connection kept open (as before) and closed
+// after each poll, printing the heap each leaves idle.
+#include "HostTest.h"
+#include "HttpsSession.h"
+#include "Config.h"
+#include "Metrics.h"
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+
+static const char* GRAPH_URL = "https://graph.microsoft.com/v1.0/me/presence";
+static const char* LOGIN_URL = "https://login.microsoftonline.com/tenant/oauth2/v2.0/token";
+static constexpr uint32_t HANDSHAKE_MS = 400;
+static constexpr uint32_t REQUEST_MS = 80;
+
+static HostHttp::Response next;
+
+static HostHttp::Response server(const HostHttp::Request& request) {
+    HostClock::advanceMs(request.reused ? REQUEST_MS : HANDSHAKE_MS + REQUEST_MS);
+    return next;
+}
+
+static std::string body(size_t n) {
+    std::string s;
+    for (size_t i = 0; i < n; i++) s += (char)('a' + i % 26);
+    return s;
+}
+
+static std::string get(HttpsSession& session, const char* url, bool keepAlive, size_t readBytes = SIZE_MAX) {
+    HTTPClient http;
+    session.begin(http, url, keepAlive);
+    CHECK_EQ(http.GET(), 200);
+    Stream& in = session.body(http);
+    std::string s;
+    for (int c; s.size() < readBytes && (c = in.read()) >= 0;) s += (char)c;
+    session.end(http);
+    return s;
+}
+
+static void testBodiesAndReuseWithinAPoll() {
+    HttpsSession session;
+    const uint32_t connects = Metrics::tlsConnects;
+    const uint32_t reuses = Metrics::tlsReuses;
+    const size_t sizes[] = {0, 1, 63, 64, 65, 700};
+    for (size_t n : sizes) {
+        for (bool chunked : {false, true}) {
+            next = HostHttp::Response();
+            next.body = body(n);
+            next.chunked = chunked;
+            next.chunkSize = 64;
+            CHECK(get(session, GRAPH_URL, true) == next.body);
+        }
+    }
+    // One handshake for the whole poll; the rest went over it
+    CHECK_EQ(Metrics::tlsConnects, connects + 1);
+    CHECK_EQ(Metrics::tlsReuses, reuses + 2 * 6 - 1);
+
+    // A body left half read is drained, so the next response still parses
+    next.body = body(500);
+    next.chunked = true;
+    CHECK(get(session, GRAPH_URL, true, 10) == body(10));
+    next.body = "{\"availability\":\"Busy\"}";
+    next.chunked = false;
+    CHECK(get(session, GRAPH_URL, true) == next.body);
+    CHECK(HostHttp::requests.back().reused);
+    session.endBurst();
+}
+
+static void testEndBurstGivesTheHeapBack() {
+    HttpsSession session;
+    const uint32_t freeIdle = ESP.getFreeHeap();
+    next = HostHttp::Response();
+    next.body = body(100);
+    get(session, GRAPH_URL, true);
+    CHECK_EQ(Metrics::tlsHeldBytes, HostTls::connectionBytes);
+    CHECK_EQ(Metrics::tlsConnectionBytes, HostTls::connectionBytes);
+    CHECK_EQ(ESP.getFreeHeap(), freeIdle - HostTls::connectionBytes);
+
+    session.endBurst();
+    CHECK_EQ(Metrics::tlsHeldBytes, 0);
+    CHECK_EQ(ESP.getFreeHeap(), freeIdle);
+
+    // The next poll opens a new connection
+    get(session, GRAPH_URL, true);
+    CHECK(!HostHttp::requests.back().reused);
+    session.endBurst();
+}
+
+static void testCloseAndHostChanges() {
+    HttpsSession session;
+    const uint32_t freeIdle = ESP.getFreeHeap();
+    next = HostHttp::Response();
+    next.body = body(100);
+
+    // Sign-in requests close after themselves
+    get(session, LOGIN_URL, false);
+    CHECK_EQ(Metrics::tlsHeldBytes, 0);
+    CHECK_EQ(ESP.getFreeHeap(), freeIdle);
+
+    // The server closing is noticed, and nothing is held afterwards
+    next.close = true;
+    get(session, GRAPH_URL, true);
+    CHECK_EQ(Metrics::tlsHeldBytes, 0);
+    CHECK_EQ(ESP.getFreeHeap(), freeIdle);
+    next.close = false;
+
+    // A different host replaces the connection; there is never a second one
+    get(session, GRAPH_URL, true);
+    get(session, LOGIN_URL, true);
+    CHECK(!HostHttp::requests.back().reused);
+    CHECK_EQ(ESP.getFreeHeap(), freeIdle - HostTls::connectionBytes);
+    session.close();
+    CHECK_EQ(Metrics::tlsHeldBytes, 0);
+    CHECK_EQ(ESP.getFreeHeap(), freeIdle);
+}
+
+struct Gauges {
+    uint32_t handshakes;
+    double heldBytes;           // Time-averaged
+    double heldPercent;         // Share of the time a connection was open
+    uint32_t largestFreeIdle;   // Largest free block between polls, at its lowest
+    uint32_t peakPerRequest;    // Most heap a poll took at once, over the idle baseline
+    uint32_t largestFreeLow;    // /metrics' lowest largest free block during a request
+};
+
+// Ten minutes of presence polls; `closeAfterPoll` is endBurst() with the default config
+static Gauges pollFor10Minutes(bool closeAfterPoll) {
+    HttpsSession session;
+    next = HostHttp::Response();
+    next.body = "{\"availability\":\"Available\",\"activity\":\"Available\"}";
+    next.chunked = true;
+    const uint32_t connects = Metrics::tlsConnects;
+    const uint32_t startMs = millis();
+    const uint32_t endMs = startMs + 10 * 60 * 1000;
+    double heldSum = 0;
+    uint32_t samples = 0;
+    uint32_t openSamples = 0;
+    uint32_t largestFree = UINT32_MAX;
+    uint32_t peak = 0;
+    const uint32_t freeIdle = ESP.getFreeHeap();
+    Metrics::tlsLargestFreeBlockLow = 0;
+    uint32_t nextPollMs = startMs;
+    while (millis() < endMs) {
+        if ((int32_t)(millis() - nextPollMs) >= 0) {
+            nextPollMs += Config::PRESENCE_POLL_INTERVAL_MS;
+            const uint32_t pollStart = millis();
+            ESP.minFreeHeap = ESP.freeHeap;
+            get(session, GRAPH_URL, true);
+            if (closeAfterPoll) session.endBurst();
+            if (freeIdle - ESP.minFreeHeap > peak) peak = freeIdle - ESP.minFreeHeap;
+            // The request itself holds a connection either way
+            const uint32_t pollSamples = (millis() - pollStart + 99) / 100;
+            samples += pollSamples;
+            openSamples += pollSamples;
+            heldSum += (double)HostTls::connectionBytes * pollSamples;
+        }
+        HostClock::advanceMs(100);
+        samples++;
+        heldSum += Metrics::tlsHeldBytes;
+        if (Metrics::tlsHeldBytes) openSamples++;
+        if (ESP.getMaxAllocHeap() < largestFree) largestFree = ESP.getMaxAllocHeap();
+    }
+    // Kept open, the connection never goes idle long enough to be dropped at this interval
+    CHECK(Config::PRESENCE_POLL_INTERVAL_MS < Config::TLS_KEEP_ALIVE_IDLE_MS);
+    session.close();
+    return {Metrics::tlsConnects - connects, heldSum / samples, 100.0 * openSamples / samples, largestFree, peak,
+            Metrics::tlsLargestFreeBlockLow};
+}
+
+static void testHeapHeldBetweenPolls() {
+    const Gauges before = pollFor10Minutes(false);
+    const Gauges after = pollFor10Minutes(true);
+    printf("10 min of polls every %lu ms, %u byte connection:\n", (unsigned long)Config::PRESENCE_POLL_INTERVAL_MS,
+           HostTls::connectionBytes);
+    printf("                        handshakes  held (avg)  connection open  largest free block between polls"
+           "  peak per request\n");
+    printf("  kept open (before)    %10u  %8.0f B  %14.1f%%  %32u B  %14u B\n", before.handshakes, before.heldBytes,
+           before.heldPercent, before.largestFreeIdle, before.peakPerRequest);
+    printf("  closed per poll       %10u  %8.0f B  %14.1f%%  %32u B  %14u B\n", after.handshakes, after.heldBytes,
+           after.heldPercent, after.largestFreeIdle, after.peakPerRequest);
+
+    CHECK_EQ(before.handshakes, 1);
+    CHECK_EQ(after.handshakes, 10 * 60 * 1000 / Config::PRESENCE_POLL_INTERVAL_MS);
+    CHECK(before.heldPercent > 99);
+    CHECK(after.heldPercent < 10);
+    CHECK_EQ(after.largestFreeIdle, before.largestFreeIdle + HostTls::connectionBytes);
+    // Only the idle hold goes away: each poll still needs the whole connection while it runs
+    CHECK_EQ(before.peakPerRequest, HostTls::connectionBytes);
+    CHECK_EQ(after.peakPerRequest, before.peakPerRequest);
+    CHECK(after.largestFreeLow != 0);
+    CHECK_EQ(after.largestFreeLow, before.largestFreeLow);
+}
+
+int main() {
+    HostHttp::server = server;
+    testBodiesAndReuseWithinAPoll();
+    testEndBurstGivesTheHeapBack();
+    testCloseAndHostChanges();
+    testHeapHeldBetweenPolls();
+    return HostTest::report("HttpsSessionTest");
+}
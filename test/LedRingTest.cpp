@@ -0,0 +1,188 @@
+// Temporal dithering: the average of what LedRing sends over many frames must
+// match the 16-bit frame scaled by brightness, and exact inputs must come out
+// exact, with nothing left to dither.
+#include "HostTest.h"
+#include "LedRing.h"
+#include "IdleControl.h"
+#include "Config.h"
+#include "Memory.h"
+
+static constexpr int FRAMES = 1024;
+// Brightness is applied in 8.8 fixed point, so the average may sit up to 1/256
+// of a level below the exact value, plus one frame's worth of leftover residue
+static constexpr double TOLERANCE = 1.0 / 256 + 1.0 / FRAMES;
+
+static LedRing& ring() {
+    static LedRing* r = [] {
+        Memory::frames.begin();
+        auto* created = new LedRing(0, 1);
+        created->begin();
+        return created;
+    }();
+    return *r;
+}
+
+static Adafruit_NeoPixel& strip() { return *Adafruit_NeoPixel::latest; }
+
+// Average of the red channel over FRAMES shows
+static double averageRed() {
+    long sum = 0;
+    for (int i = 0; i < FRAMES; i++) {
+        ring().show();
+        sum += strip().sent(0, 0);
+    }
+    return (double)sum / FRAMES;
+}
+
+static void settle() {
+    // Drop any residue left by the previous case
+    ring().setBrightness(0);
+    ring().show();
+}
+
+static void testFullScaleIsExact() {
+    for (int c = 0; c <= 255; c++) {
+        settle();
+        ring().setBrightness(255);
+        ring().setPixelRgb(0, c, c, c);
+        for (int i = 0; i < 4; i++) {
+            ring().show();
+            CHECK_EQ(strip().sent(0, 0), c);
+        }
+        // Nothing fractional, so there is nothing to re-send
+        CHECK_EQ(ring().msUntilRefresh(millis()) == UINT32_MAX, true);
+    }
+}
+
+static void testBrightnessZeroIsDark() {
+    ring().setPixelRgb(0, 255, 255, 255);
+    ring().setBrightness(0);
+    for (int i = 0; i < 16; i++) {
+        ring().show();
+        CHECK_EQ(strip().sent(0, 0), 0);
+        CHECK_EQ(strip().sent(0, 2), 0);
+    }
+    CHECK_EQ(ring().msUntilRefresh(millis()) == UINT32_MAX, true);
+}
+
+static void testAverageMatchesScaledValue() {
+    const uint8_t brightnesses[] = {1, 7, 64, 128, 200, 254, 255};
+    for (uint8_t b : brightnesses) {
+        for (int c = 0; c <= 255; c += 5) {
+            settle();
+            ring().setBrightness(b);
+            ring().setPixelRgb(0, c, 0, 0);
+            const double expected = c * b / 255.0;
+            const double avg = averageRed();
+            if (avg < expected - TOLERANCE || avg > expected + TOLERANCE) {
+                fprintf(stderr, "c=%d b=%d: average %.4f, expected %.4f\n", c, b, avg, expected);
+                HostTest::failures++;
+            }
+        }
+    }
+    // Half brightness of a full channel is exactly 128 (128/255 of 255), every frame
+    settle();
+    ring().setBrightness(128);
+    ring().setPixelRgb(0, 255, 0, 0);
+    CHECK(averageRed() == 128.0);
+}
+
+static void testSubLsbLevelsStillShow() {
+    // A fade's lowest steps are below one 8-bit level; dithering keeps them
+    // distinct instead of collapsing them all to 0 or 1
+    ring().setBrightness(255);
+    double previous = -1;
+    for (uint16_t level = 0; level <= 512; level += 64) {
+        settle();
+        ring().setBrightness(255);
+        ring().setPixelScaled(0, 0xFF0000, level);
+        const uint32_t value16 = (255u * 257 * (level + 1)) >> 16;
+        const double expected = value16 * 255.0 / 65535;
+        const double avg = averageRed();
+        CHECK(avg > previous);
+        CHECK(avg >= expected - TOLERANCE && avg <= expected + TOLERANCE);
+        previous = avg;
+    }
+}
+
+// What main.cpp's loop would do with only the ring to look after: refresh, then
+// sleep until the ring's next deadline or the LOOP_POLL_MS poll
+struct IdleStats {
+    uint32_t wakes = 0;
+    uint64_t idleUs = 0;
+    uint64_t idleUsDownclocked = 0;
+};
+
+static IdleStats runLoop(uint32_t ms) {
+    IdleStats stats;
+    const uint32_t end = millis() + ms;
+    while ((int32_t)(end - millis()) > 0) {
+        ring().refresh(millis());
+        const uint32_t wait = std::min(Config::LOOP_POLL_MS, ring().msUntilRefresh(millis()));
+        const uint64_t startUs = HostClock::nowUs;
+        IdleControl::wait(wait);
+        const uint64_t slept = HostClock::nowUs - startUs;
+        stats.wakes++;
+        stats.idleUs += slept;
+        if (getCpuFrequencyMhz() == Config::CPU_IDLE_MHZ) stats.idleUsDownclocked += slept;
+    }
+    return stats;
+}
+
+static void testStaticFrameStopsRefreshing() {
+    // A sub-LSB static color: worth dithering, but only for a while
+    settle();
+    ring().setBrightness(255);
+    ring().setPixelScaled(0, 0xFF0000, 300);    // About 1.2 levels of red
+    ring().show();
+    CHECK(ring().msUntilRefresh(millis()) <= Config::DITHER_REFRESH_MS);
+
+    const IdleStats dithering = runLoop(Config::DITHER_SETTLE_MS);
+    // Settled: one rounded frame went out and nothing is left to refresh
+    ring().refresh(millis());
+    CHECK_EQ(ring().msUntilRefresh(millis()) == IdleControl::FOREVER, true);
+    CHECK_EQ(strip().sent(0, 0), 1);
+
+    const uint32_t shows = ring().showCount();
+    const IdleStats idle = runLoop(10000);
+    CHECK_EQ(ring().showCount(), shows);
+    CHECK_EQ(idle.wakes, 10000 / Config::LOOP_POLL_MS);
+    // Every wait is long enough to drop to the idle clock
+    CHECK_EQ(idle.idleUsDownclocked, idle.idleUs);
+
+    printf("static frame: %.0f wakes/s and %.0f%% of idle time downclocked while dithering, "
+           "then %.0f wakes/s and %.0f%% once settled\n",
+           dithering.wakes * 1000.0 / Config::DITHER_SETTLE_MS, 100.0 * dithering.idleUsDownclocked / dithering.idleUs,
+           idle.wakes / 10.0, 100.0 * idle.idleUsDownclocked / idle.idleUs);
+
+    // A new frame starts dithering again
+    ring().show();
+    CHECK(ring().msUntilRefresh(millis()) <= Config::DITHER_REFRESH_MS);
+}
+
+static void testFadeKeepsDithering() {
+    // Frames that keep changing never settle, however long the fade runs
+    settle();
+    ring().setBrightness(255);
+    uint32_t sendsInLastSecond = 0;
+    for (uint32_t t = 0; t < 3 * Config::DITHER_SETTLE_MS; t += Config::LOOP_POLL_MS) {
+        ring().setPixelScaled(0, 0xFF0000, (uint16_t)(256 + t % 512));
+        ring().show();
+        const uint32_t before = ring().showCount();
+        runLoop(Config::LOOP_POLL_MS);
+        if (t >= 2 * Config::DITHER_SETTLE_MS) sendsInLastSecond += ring().showCount() - before;
+    }
+    // Still refreshing at close to the dither rate two settle periods in
+    CHECK(sendsInLastSecond >= Config::DITHER_SETTLE_MS / Config::DITHER_REFRESH_MS * 3 / 4);
+}
+
+int main() {
+    IdleControl::begin();
+    testFullScaleIsExact();
+    testBrightnessZeroIsDark();
+    testAverageMatchesScaledValue();
+    testSubLsbLevelsStillShow();
+    testStaticFrameStopsRefreshing();
+    testFadeKeepsDithering();
+    return HostTest::report("LedRingTest");
+}
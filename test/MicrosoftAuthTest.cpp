@@ -0,0 +1,107 @@
+// Token refresh failures against a local sign-in stand-in. Only a 400
+// invalid_grant means the refresh token is dead; timeouts, 5xx and throttling
+// must keep the tokens (in memory and in NVS) so the refresh can be retried.
+#include "HostTest.h"
+#include "MicrosoftAuth.h"
+#include "HttpsSession.h"
+#include "Memory.h"
+#include "Metrics.h"
+#include <HTTPClient.h>
+
+static HostHttp::Response next;
+static uint32_t tokensIssued = 0;
+
+static HostHttp::Response login(const HostHttp::Request& request) {
+    CHECK(request.url.find("/oauth2/v2.0/token") != std::string::npos);
+    if (next.status != 200) return next;
+    const unsigned n = ++tokensIssued;
+    char body[160];
+    snprintf(body, sizeof(body),
+             "{\"token_type\":\"Bearer\",\"expires_in\":3599,\"access_token\":\"access-%u\","
+             "\"refresh_token\":\"refresh-%u\"}",
+             n, n);
+    HostHttp::Response response;
+    response.body = body;
+    return response;
+}
+
+static HostHttp::Response failure(int status, const char* body = "") {
+    HostHttp::Response response;
+    response.status = status;
+    response.body = body;
+    return response;
+}
+
+static HttpsSession session;
+static MicrosoftAuth auth("client-id", "tenant-id", session);
+
+// One network step's refresh: NetworkTask rewinds the JSON arena after each step
+static bool refresh() {
+    Memory::Scope scratch(Memory::netScratch);
+    return auth.refreshAccessToken();
+}
+
+static void signIn() {
+    HostNvs::reset();
+    Preferences prefs;
+    prefs.begin("msauth");
+    prefs.putString("refresh", "refresh-0");
+    auth.begin();
+    next = HostHttp::Response();
+}
+
+static bool refreshTokenSaved() {
+    const auto ns = HostNvs::store.find("msauth");
+    return ns != HostNvs::store.end() && ns->second.count("refresh") != 0;
+}
+
+// A failure that must leave the device signed in, and a later retry that works
+static void checkKeepsTokens(const char* what, const HostHttp::Response& response) {
+    signIn();
+    CHECK(refresh());
+    const uint32_t failures = Metrics::tokenRefreshFailures;
+
+    next = response;
+    CHECK(!refresh());
+    CHECK_EQ(Metrics::tokenRefreshFailures, failures + 1);
+    CHECK(auth.isSignedIn());
+    CHECK(refreshTokenSaved());
+
+    next = HostHttp::Response();
+    const uint32_t issued = tokensIssued;
+    CHECK(refresh());
+    CHECK_EQ(tokensIssued, issued + 1);
+    CHECK(strcmp(auth.getAccessToken(), ("access-" + std::to_string(tokensIssued)).c_str()) == 0);
+    printf("%-28s kept the tokens, retry succeeded\n", what);
+}
+
+static void testTransientFailuresKeepTokens() {
+    checkKeepsTokens("read timeout", failure(HTTPC_ERROR_READ_TIMEOUT));
+    checkKeepsTokens("connection refused", failure(HTTPC_ERROR_CONNECTION_REFUSED));
+    checkKeepsTokens("500", failure(500, "<html>Internal Server Error</html>"));
+    checkKeepsTokens("503", failure(503, "{\"error\":\"temporarily_unavailable\"}"));
+    checkKeepsTokens("429", failure(429, "{\"error\":\"too_many_requests\"}"));
+    // A 400 that isn't about the grant, e.g. a malformed request during an outage
+    checkKeepsTokens("400 invalid_request", failure(400, "{\"error\":\"invalid_request\"}"));
+    checkKeepsTokens("400 without a JSON body", failure(400, "Bad Request"));
+}
+
+static void testInvalidGrantSignsOut() {
+    signIn();
+    CHECK(refresh());
+    next = failure(400, "{\"error\":\"invalid_grant\",\"error_description\":\"AADSTS70008: The provided "
+                        "authorization code or refresh token has expired due to inactivity.\","
+                        "\"error_codes\":[70008],\"timestamp\":\"2026-10-18 09:00:00Z\"}");
+    CHECK(!refresh());
+    CHECK(!auth.isSignedIn());
+    CHECK(!refreshTokenSaved());
+    CHECK(strcmp(auth.getAccessToken(), "") == 0);
+}
+
+int main() {
+    Memory::begin();
+    HostHttp::server = login;
+    testTransientFailuresKeepTokens();
+    testInvalidGrantSignsOut();
+    return HostTest::report("MicrosoftAuthTest");
+}
@@ -0,0 +1,324 @@
+// MqttBridge against an in-memory broker (stubs/PubSubClient.h), stepped on
+// the virtual clock the way its task steps it: the subscriptions, set topics
+// becoming queued commands, the retained state and status topics, the last
+// will, and reconnect backoff. Ends with the command-to-applied latency over
+// MQTT next to the HTTP path, with the render loop idle.
+#include "HostTest.h"
+#include "MqttBridge.h"
+#include "AppStateStore.h"
+#include "CommandQueue.h"
+#include "Commands.h"
+#include "Config.h"
+#include "IdleControl.h"
+#include "Metrics.h"
+#include <PubSubClient.h>
+#include <WiFi.h>
+
+static AppStateStore store;
+static CommandQueue queue;
+static MqttBridge bridge(store, queue);
+
+static std::string topic(const char* suffix) {
+    return std::string(bridge.baseTopic()) + suffix;
+}
+
+// The bridge's task for `ms`, with the render loop draining after every step
+static void run(uint32_t ms) {
+    const uint32_t endMs = millis() + ms;
+    while ((int32_t)(millis() - endMs) < 0) {
+        bridge.step(millis());
+        queue.drain(store);
+        HostClock::advanceMs(MqttBridge::STEP_INTERVAL_MS);
+    }
+}
+
+static size_t statePublishes() {
+    size_t n = 0;
+    for (const HostMqtt::Message& m : HostMqtt::published) {
+        if (m.topic == topic("/state")) n++;
+    }
+    return n;
+}
+
+static const HostMqtt::Message& lastState() {
+    static const HostMqtt::Message none{};
+    for (auto it = HostMqtt::published.rbegin(); it != HostMqtt::published.rend(); ++it) {
+        if (it->topic == topic("/state")) return *it;
+    }
+    return none;
+}
+
+static bool contains(const std::string& s, const char* part) {
+    return s.find(part) != std::string::npos;
+}
+
+static void testConnectSubscribesAndAnnounces() {
+    // Nothing happens before WiFi is up
+    run(100);
+    CHECK(HostMqtt::connectAttemptsMs.empty());
+    CHECK(!bridge.isConnected());
+
+    WiFi.linkStatus = WL_CONNECTED;
+    const uint32_t connects = Metrics::mqttConnects;
+    run(MqttBridge::STEP_INTERVAL_MS);
+    CHECK(bridge.isConnected());
+    CHECK_EQ(Metrics::mqttConnects, connects + 1);
+    CHECK(strcmp(bridge.baseTopic(), "teamsring/A1B2C3") == 0);
+
+    CHECK_EQ(HostMqtt::subscriptions.size(), 2);
+    CHECK(HostMqtt::subscriptions[0] == topic("/set/#"));
+    CHECK(HostMqtt::subscriptions[1] == "teamsring/all/set/#");
+    CHECK(HostMqtt::retained[topic("/status")] == "online");
+
+    // A fresh session publishes the retained state at once
+    run(MqttBridge::STEP_INTERVAL_MS);
+    CHECK_EQ(statePublishes(), 1);
+    CHECK(lastState().retained);
+    CHECK(contains(HostMqtt::retained[topic("/state")], "\"brightness\":"));
+}
+
+static void testSetTopicsBecomeCommands() {
+    const uint32_t received = Metrics::mqttMessagesReceived;
+
+    HostMqtt::publish(topic("/set/brightness"), "40");
+    HostMqtt::publish(topic("/set/color"), "#FF8000");
+    HostMqtt::publish(topic("/set/animation"), "spin");
+    HostMqtt::publish(topic("/set/speed"), "250");
+    HostMqtt::publish(topic("/set/tail"), "4");
+    HostMqtt::publish(topic("/set/strobe"), "120");
+    HostMqtt::publish(topic("/set/power"), "off");
+    run(MqttBridge::STEP_INTERVAL_MS);
+    AppState s = store.snapshot();
+    CHECK_EQ(s.brightness, 40);
+    CHECK_EQ(s.primaryColor, 0xFF8000);
+    CHECK(strcmp(s.animation, "spin") == 0);
+    CHECK_EQ(s.speedMs, 250);
+    CHECK_EQ(s.tailLength, 4);
+    CHECK_EQ(s.strobePeriodMs, 120);
+    CHECK(!s.powerOn);
+
+    HostMqtt::publish(topic("/set/power"), "toggle");
+    run(MqttBridge::STEP_INTERVAL_MS);
+    CHECK(store.snapshot().powerOn);
+
+    // A bare .../set takes several fields at once
+    HostMqtt::publish(topic("/set"), "{\"brightness\":12,\"power\":false,\"color\":\"#0000FF\"}");
+    run(MqttBridge::STEP_INTERVAL_MS);
+    s = store.snapshot();
+    CHECK_EQ(s.brightness, 12);
+    CHECK(!s.powerOn);
+    CHECK_EQ(s.primaryColor, 0x0000FF);
+
+    // Fleet-wide topics reach every ring
+    HostMqtt::publish("teamsring/all/set/power", "on");
+    HostMqtt::publish("teamsring/all/set", "{\"brightness\":200}");
+    run(MqttBridge::STEP_INTERVAL_MS);
+    CHECK(store.snapshot().powerOn);
+    CHECK_EQ(store.snapshot().brightness, 200);
+    CHECK_EQ(Metrics::mqttMessagesReceived, received + 11);
+
+    // Bad values and unknown fields queue nothing; other rings' topics never arrive
+    const uint32_t applied = Metrics::commandsApplied;
+    HostMqtt::publish(topic("/set/brightness"), "300");
+    HostMqtt::publish(topic("/set/brightness"), "bright");
+    HostMqtt::publish(topic("/set/color"), "#GG0000");
+    HostMqtt::publish(topic("/set/tail"), "0");
+    HostMqtt::publish(topic("/set/volume"), "11");
+    HostMqtt::publish(topic("/set"), "[1,2]");
+    HostMqtt::publish("teamsring/FFFFFF/set/brightness", "1");
+    run(MqttBridge::STEP_INTERVAL_MS);
+    CHECK_EQ(Metrics::commandsApplied, applied);
+    CHECK_EQ(store.snapshot().brightness, 200);
+    CHECK_EQ(Metrics::mqttMessagesReceived, received + 11 + 6);
+
+    // A slider's burst lands in one drain and one state change
+    const uint32_t coalesced = Metrics::commandsCoalesced;
+    for (int b = 1; b <= 20; b++) HostMqtt::publish(topic("/set/brightness"), std::to_string(b));
+    run(MqttBridge::STEP_INTERVAL_MS);
+    CHECK_EQ(store.snapshot().brightness, 20);
+    CHECK_EQ(Metrics::commandsCoalesced, coalesced + 19);
+}
+
+static void testStatePublishedOnChange() {
+    run(1000);
+    const size_t before = statePublishes();
+
+    // Nothing changed, nothing sent
+    run(1000);
+    CHECK_EQ(statePublishes(), before);
+
+    store.update([](AppState& s) { s.brightness = 77; });
+    run(MqttBridge::STEP_INTERVAL_MS);
+    CHECK_EQ(statePublishes(), before + 1);
+    CHECK(lastState().retained);
+    CHECK(contains(lastState().payload, "\"brightness\":77"));
+    CHECK(HostMqtt::retained[topic("/state")] == lastState().payload);
+
+    // Changes every step for 100 ms: at most one publish per PUBLISH_INTERVAL_MS,
+    // and the retained state ends on the last value
+    for (int b = 0; b < 20; b++) {
+        store.update([b](AppState& s) { s.brightness = (uint8_t)(100 + b); });
+        run(MqttBridge::STEP_INTERVAL_MS);
+    }
+    run(MqttBridge::PUBLISH_INTERVAL_MS);
+    const size_t burst = statePublishes() - (before + 1);
+    CHECK(burst >= 2);
+    CHECK(burst <= 100 / MqttBridge::PUBLISH_INTERVAL_MS + 1);
+    CHECK(contains(HostMqtt::retained[topic("/state")], "\"brightness\":119"));
+}
+
+static void testLastWillAndResubscribe() {
+    const size_t states = statePublishes();
+    HostMqtt::dropConnection();
+    CHECK(HostMqtt::retained[topic("/status")] == "offline");
+
+    // The next step notices and reconnects at once, since the last attempt was long ago
+    run(MqttBridge::STEP_INTERVAL_MS);
+    CHECK(bridge.isConnected());
+    CHECK(HostMqtt::retained[topic("/status")] == "online");
+    CHECK_EQ(HostMqtt::subscriptions.size(), 2);
+    run(MqttBridge::PUBLISH_INTERVAL_MS);
+    CHECK_EQ(statePublishes(), states + 1);
+
+    HostMqtt::publish(topic("/set/brightness"), "33");
+    run(MqttBridge::STEP_INTERVAL_MS);
+    CHECK_EQ(store.snapshot().brightness, 33);
+}
+
+static std::vector<uint32_t> attemptGaps() {
+    std::vector<uint32_t> gaps;
+    for (size_t i = 1; i < HostMqtt::connectAttemptsMs.size(); i++) {
+        gaps.push_back(HostMqtt::connectAttemptsMs[i] - HostMqtt::connectAttemptsMs[i - 1]);
+    }
+    return gaps;
+}
+
+static void testReconnectBackoff() {
+    HostMqtt::brokerUp = false;
+    HostMqtt::dropConnection();
+    HostMqtt::connectAttemptsMs.clear();
+    run(120 * 1000);
+    CHECK(!bridge.isConnected());
+
+    // Doubling from RETRY_MIN_MS, capped at RETRY_MAX_MS
+    const std::vector<uint32_t> expected = {1000, 2000, 4000, 8000, 16000, 30000, 30000};
+    std::vector<uint32_t> gaps = attemptGaps();
+    CHECK_EQ(gaps.size(), expected.size());
+    for (size_t i = 0; i < gaps.size() && i < expected.size(); i++) CHECK_EQ(gaps[i], expected[i]);
+    CHECK_EQ(expected.front(), MqttBridge::RETRY_MIN_MS);
+    CHECK_EQ(expected.back(), MqttBridge::RETRY_MAX_MS);
+
+    // The broker comes back: connected at the next attempt, within RETRY_MAX_MS
+    HostMqtt::brokerUp = true;
+    run(MqttBridge::RETRY_MAX_MS);
+    CHECK(bridge.isConnected());
+    CHECK(HostMqtt::retained[topic("/status")] == "online");
+
+    // A connection that worked resets the backoff
+    HostMqtt::brokerUp = false;
+    HostMqtt::dropConnection();
+    HostMqtt::connectAttemptsMs.clear();
+    run(3500);
+    gaps = attemptGaps();
+    CHECK_EQ(gaps.size(), 2);
+    if (gaps.size() == 2) {
+        CHECK_EQ(gaps[0], 1000);
+        CHECK_EQ(gaps[1], 2000);
+    }
+
+    // Without WiFi it stops trying
+    WiFi.linkStatus = WL_DISCONNECTED;
+    const size_t attempts = HostMqtt::connectAttemptsMs.size();
+    run(60 * 1000);
+    CHECK_EQ(HostMqtt::connectAttemptsMs.size(), attempts);
+    WiFi.linkStatus = WL_CONNECTED;
+    HostMqtt::brokerUp = true;
+    run(MqttBridge::RETRY_MAX_MS);
+    CHECK(bridge.isConnected());
+}
+
+struct Latency {
+    uint32_t meanMs10;  // Tenths of a ms
+    uint32_t maxMs;
+};
+
+// Brightness commands arriving at every ms offset across two loop polls, with
+// the loop idle (nothing animating, so it waits up to LOOP_POLL_MS). Over MQTT
+// the bridge's next step queues the command, which wakes the loop at once;
+// over HTTP the request waits for the loop's next server poll, and its
+// handler's command is drained in the same pass. Network time is left out.
+static Latency measureLatency(bool viaMqtt) {
+    constexpr uint32_t SAMPLES = 2 * Config::LOOP_POLL_MS;
+    uint32_t totalMs = 0;
+    uint32_t maxMs = 0;
+    for (uint32_t offset = 0; offset < SAMPLES; offset++) {
+        IdleControl::wait(0);           // Forget earlier wakes
+        const uint8_t value = (uint8_t)(offset % 2 ? 1 : 2);
+        const uint32_t startMs = millis();
+        const uint32_t arriveMs = startMs + offset;
+        uint32_t nextStepMs = startMs;
+        uint32_t nextPassMs = startMs;
+        bool arrived = false;
+        bool pendingHttp = false;
+        for (;;) {
+            const uint32_t now = millis();
+            if (!arrived && now == arriveMs) {
+                arrived = true;
+                if (viaMqtt) {
+                    HostMqtt::publish(topic("/set/brightness"), std::to_string(value));
+                } else {
+                    pendingHttp = true;
+                }
+            }
+            if (now == nextStepMs) {
+                bridge.step(now);
+                nextStepMs += MqttBridge::STEP_INTERVAL_MS;
+            }
+            // A loop pass: when its wait runs out, or at once when woken
+            if (IdleControl::wait(0) || now == nextPassMs) {
+                if (pendingHttp) {
+                    Commands::setBrightness(queue, value);
+                    pendingHttp = false;
+                }
+                queue.drain(store);
+                nextPassMs = now + Config::LOOP_POLL_MS;
+                if (arrived && store.snapshot().brightness == value) {
+                    totalMs += now - arriveMs;
+                    maxMs = std::max(maxMs, (uint32_t)(now - arriveMs));
+                    break;
+                }
+            }
+            HostClock::advanceMs(1);
+        }
+        HostClock::advanceMs(1 + offset % MqttBridge::STEP_INTERVAL_MS);   // Vary the step phase too
+    }
+    return {totalMs * 10 / SAMPLES, maxMs};
+}
+
+static void printLatency() {
+    const Latency mqtt = measureLatency(true);
+    const Latency http = measureLatency(false);
+    printf("command to applied, loop idle (on-device part, network excluded):\n");
+    printf("  MQTT  mean %u.%u ms  max %2u ms  (bridge steps every %u ms, commands wake the loop)\n",
+           mqtt.meanMs10 / 10, mqtt.meanMs10 % 10, mqtt.maxMs, MqttBridge::STEP_INTERVAL_MS);
+    printf("  HTTP  mean %u.%u ms  max %2u ms  (server polled every %u ms)\n", http.meanMs10 / 10,
+           http.meanMs10 % 10, http.maxMs, Config::LOOP_POLL_MS);
+    CHECK(mqtt.maxMs <= MqttBridge::STEP_INTERVAL_MS);
+    CHECK(http.maxMs <= Config::LOOP_POLL_MS);
+    CHECK(mqtt.meanMs10 < http.meanMs10);
+}
+
+int main() {
+    IdleControl::begin();
+    queue.begin();
+    HostMqtt::reset();
+    bridge.begin();
+
+    testConnectSubscribesAndAnnounces();
+    testSetTopicsBecomeCommands();
+    testStatePublishedOnChange();
+    testLastWillAndResubscribe();
+    testReconnectBackoff();
+    printLatency();
+    return HostTest::report("MqttBridgeTest");
+}
@@ -0,0 +1,143 @@
+// SleepSchedule's evaluator: office hours, an overnight shift, whole days and
+// an empty mask at their boundaries, then every minute of the week checked
+// against a minute-by-minute walk. Ends with the week the device would spend
+// awake with the configured schedule, and the average current that gives.
+#include "HostTest.h"
+#include "SleepSchedule.h"
+#include "Config.h"
+
+enum Day : uint8_t { Sun, Mon, Tue, Wed, Thu, Fri, Sat };
+static constexpr uint8_t WEEKDAYS = 0b0111110;
+static constexpr uint32_t MINUTES_PER_WEEK = 7 * SleepSchedule::MINUTES_PER_DAY;
+
+static constexpr uint16_t at(uint16_t hour, uint16_t minute = 0) { return hour * 60 + minute; }
+
+static void testOfficeHours() {
+    const SleepSchedule s(WEEKDAYS, at(8), at(18));
+    CHECK(!s.isWorking(Mon, at(7, 59)));
+    CHECK(s.isWorking(Mon, at(8)));
+    CHECK(s.isWorking(Fri, at(17, 59)));
+    CHECK(!s.isWorking(Fri, at(18)));
+    CHECK(!s.isWorking(Sat, at(12)));
+    CHECK(!s.isWorking(Sun, at(12)));
+
+    CHECK_EQ(s.minutesUntilWork(Mon, at(12)), 0);
+    CHECK_EQ(s.minutesUntilWork(Mon, at(7)), 60);
+    CHECK_EQ(s.minutesUntilWork(Tue, at(0)), at(8));
+    CHECK_EQ(s.minutesUntilWork(Mon, at(18)), at(14));                 // Tuesday 08:00
+    // Friday evening sleeps through the weekend
+    CHECK_EQ(s.minutesUntilWork(Fri, at(18)), 2 * 24 * 60 + at(14));
+    CHECK_EQ(s.minutesUntilWork(Sun, at(23, 59)), at(8) + 1);
+}
+
+static void testOvernightShift() {
+    // 22:00-06:00, starting Monday to Friday evenings
+    const SleepSchedule s(WEEKDAYS, at(22), at(6));
+    CHECK(s.isWorking(Mon, at(22)));
+    CHECK(s.isWorking(Tue, at(5, 59)));             // Monday's shift
+    CHECK(!s.isWorking(Tue, at(6)));
+    CHECK(!s.isWorking(Mon, at(3)));                // Sunday has no shift
+    CHECK(s.isWorking(Sat, at(3)));                 // Friday's shift runs into Saturday
+    CHECK(!s.isWorking(Sat, at(22)));
+
+    CHECK_EQ(s.minutesUntilWork(Sat, at(6)), 2 * 24 * 60 + at(16));    // Monday 22:00
+    CHECK_EQ(s.minutesUntilWork(Tue, at(6)), at(16));
+    CHECK_EQ(s.minutesUntilWork(Sat, at(4)), 0);
+}
+
+static void testWholeDaysAndEmptyMask() {
+    const SleepSchedule weekend((1 << Sat) | (1 << Sun), at(9), at(9));
+    CHECK(weekend.isWorking(Sat, 0));
+    CHECK(weekend.isWorking(Sun, at(23, 59)));
+    CHECK(!weekend.isWorking(Mon, 0));
+    // Whole days start at their `start` minute for the countdown
+    CHECK_EQ(weekend.minutesUntilWork(Fri, at(23)), 60 + at(9));
+
+    const SleepSchedule never(0, at(8), at(18));
+    for (uint8_t day = Sun; day <= Sat; day++) {
+        CHECK(!never.isWorking(day, at(12)));
+        CHECK_EQ(never.minutesUntilWork(day, at(12)), UINT32_MAX);
+    }
+
+    // Out-of-range minutes wrap, so 24:00 is midnight
+    const SleepSchedule wrapped(WEEKDAYS, at(24), at(8));
+    CHECK(wrapped.isWorking(Mon, at(7)));
+    CHECK(!wrapped.isWorking(Mon, at(8)));
+}
+
+// Minutes until isWorking() first holds, walking forward one minute at a time
+static uint32_t walk(const SleepSchedule& s, uint32_t weekMinute) {
+    for (uint32_t m = 0; m <= MINUTES_PER_WEEK; m++) {
+        const uint32_t t = (weekMinute + m) % MINUTES_PER_WEEK;
+        if (s.isWorking((uint8_t)(t / SleepSchedule::MINUTES_PER_DAY), (uint16_t)(t % SleepSchedule::MINUTES_PER_DAY))) {
+            return m;
+        }
+    }
+    return UINT32_MAX;
+}
+
+static void testEveryMinuteAgreesWithWalk() {
+    const SleepSchedule schedules[] = {
+        SleepSchedule(WEEKDAYS, at(8), at(18)),
+        SleepSchedule(WEEKDAYS, at(22), at(6)),
+        SleepSchedule((1 << Wed), at(13, 30), at(13, 45)),
+        SleepSchedule((1 << Sun) | (1 << Sat), at(23, 59), at(0, 1)),
+        SleepSchedule(0x7F, at(0), at(23, 59)),
+        SleepSchedule((1 << Fri), at(0), at(0)),
+    };
+    uint32_t mismatches = 0;
+    for (const SleepSchedule& s : schedules) {
+        for (uint32_t t = 0; t < MINUTES_PER_WEEK; t++) {
+            const uint8_t day = (uint8_t)(t / SleepSchedule::MINUTES_PER_DAY);
+            const uint16_t minute = (uint16_t)(t % SleepSchedule::MINUTES_PER_DAY);
+            if (s.minutesUntilWork(day, minute) != walk(s, t)) mismatches++;
+        }
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+// The configured schedule over a week, with DeepSleep's policy: wake
+// SLEEP_WAKE_EARLY_S before work, sleep in legs of at most SLEEP_MAX_S, and
+// spend BOOT_S awake on each timer wake that finds it still off-hours
+static void printConfiguredWeek() {
+    constexpr double AWAKE_MA = 100;        // WiFi + TLS polling
+    constexpr double ASLEEP_MA = 0.02;      // Chip in deep sleep, strip supply switched off
+    constexpr double BOOT_S = 0.3;          // Timer wake, schedule check, back to sleep
+    const SleepSchedule s(Config::WORK_DAYS, Config::WORK_START_MINUTE, Config::WORK_END_MINUTE);
+
+    uint32_t workMinutes = 0;
+    uint32_t stretches = 0;
+    uint32_t legs = 0;
+    for (uint32_t t = 0; t < MINUTES_PER_WEEK; t++) {
+        const uint8_t day = (uint8_t)(t / SleepSchedule::MINUTES_PER_DAY);
+        const uint16_t minute = (uint16_t)(t % SleepSchedule::MINUTES_PER_DAY);
+        const uint32_t before = (t + MINUTES_PER_WEEK - 1) % MINUTES_PER_WEEK;     // The week wraps
+        if (s.isWorking(day, minute)) {
+            workMinutes++;
+        } else if (s.isWorking((uint8_t)(before / SleepSchedule::MINUTES_PER_DAY),
+                               (uint16_t)(before % SleepSchedule::MINUTES_PER_DAY))) {
+            // Start of an off-hours stretch: count the sleep legs to the next start
+            const uint32_t sleepS = s.minutesUntilWork(day, minute) * 60 - Config::SLEEP_WAKE_EARLY_S;
+            stretches++;
+            legs += (sleepS + Config::SLEEP_MAX_S - 1) / Config::SLEEP_MAX_S;
+        }
+    }
+    const double weekS = MINUTES_PER_WEEK * 60.0;
+    // The last leg of each stretch wakes into the early margin and stays up
+    const double awakeS = workMinutes * 60.0 + (double)stretches * Config::SLEEP_WAKE_EARLY_S +
+                          (double)(legs - stretches) * BOOT_S;
+    const double averageMa = (awakeS * AWAKE_MA + (weekS - awakeS) * ASLEEP_MA) / weekS;
+    printf("configured week: %.1f h working, %u sleep legs, awake %.1f%%, average %.1f mA (always on: %.0f mA)\n",
+           workMinutes / 60.0, legs, 100 * awakeS / weekS, averageMa, AWAKE_MA);
+    CHECK_EQ(stretches, 5);
+    CHECK(averageMa < AWAKE_MA / 3);
+}
+
+int main() {
+    testOfficeHours();
+    testOvernightShift();
+    testWholeDaysAndEmptyMask();
+    testEveryMinuteAgreesWithWalk();
+    printConfiguredWeek();
+    return HostTest::report("SleepScheduleTest");
+}
@@ -0,0 +1,169 @@
+// Cross-task stress of AppStateStore and CommandQueue: writers, readers and
+// producers on real threads. Checks that snapshots never tear and that every
+// accepted command lands in order. Build with -DHOST_TESTS_TSAN=ON to run it
+// under ThreadSanitizer, which also reports any unsynchronized access.
+#include "HostTest.h"
+#include "AppStateStore.h"
+#include "CommandQueue.h"
+#include "IdleControl.h"
+#include "Metrics.h"
+#include <thread>
+#include <vector>
+
+// Every thread yields after each step so they interleave even on one core
+static void step() {
+    std::this_thread::yield();
+}
+
+static constexpr uint32_t WRITES_PER_WRITER = 10000;
+static constexpr uint32_t PUSHES_PER_PRODUCER = 10000;
+
+// Every field a writer sets is derived from one value, so a torn read shows as a mismatch
+static void writeConsistent(AppState& s, uint32_t k) {
+    s.primaryColor = k;
+    s.secondaryColor = ~k;
+    s.speedMs = (uint16_t)k;
+    for (auto& c : s.pixelColors) c = k;
+}
+
+static bool isConsistent(const AppState& s) {
+    if (s.secondaryColor != ~s.primaryColor || s.speedMs != (uint16_t)s.primaryColor) return false;
+    for (auto c : s.pixelColors) {
+        if (c != s.primaryColor) return false;
+    }
+    return true;
+}
+
+static void testSnapshotsNeverTear() {
+    AppStateStore store;
+    store.update([](AppState& s) { writeConsistent(s, 0); });
+    std::atomic<int> writersLeft{2};
+    std::atomic<uint32_t> torn{0};
+    std::atomic<uint32_t> missedChanges{0};
+    std::atomic<uint32_t> snapshots{0};
+
+    std::vector<std::thread> threads;
+    for (uint32_t w = 0; w < 2; w++) {
+        threads.emplace_back([&, w] {
+            for (uint32_t i = 1; i <= WRITES_PER_WRITER; i++) {
+                store.update([&](AppState& s) { writeConsistent(s, w << 24 | i); });
+                step();
+            }
+            writersLeft--;
+        });
+    }
+    for (int r = 0; r < 2; r++) {
+        threads.emplace_back([&] {
+            uint32_t lastSeq = 0;
+            AppState last = store.snapshot(lastSeq);
+            while (writersLeft > 0) {
+                uint32_t seq;
+                const AppState s = store.snapshot(seq);
+                snapshots++;
+                if (!isConsistent(s) || (seq & 1) || (int32_t)(seq - lastSeq) < 0) torn++;
+                // A newer color must show up in the change bits since the older snapshot
+                if (s.primaryColor != last.primaryColor && !(store.changesSince(lastSeq) & AppStateStore::PRIMARY_COLOR)) {
+                    missedChanges++;
+                }
+                last = s;
+                lastSeq = seq;
+                step();
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    printf("store: %u snapshots during %u writes\n", (unsigned)snapshots, 2 * WRITES_PER_WRITER);
+    CHECK_EQ(torn, 0);
+    CHECK_EQ(missedChanges, 0);
+    CHECK(isConsistent(store.snapshot()));
+}
+
+static void testCommandsLandInOrder() {
+    static CommandQueue queue;
+    AppStateStore store;
+    queue.begin();
+
+    // Producer p owns pixel p and posts increasing values; the frame producer owns the last pixel
+    constexpr uint16_t PRODUCERS = Config::NUM_PIXELS - 1;
+    static_assert(PRODUCERS >= 1, "needs a pixel per producer plus one for frames");
+    std::atomic<int> producersLeft{PRODUCERS + 1};
+    uint32_t accepted[PRODUCERS] = {0};
+    uint32_t lastAccepted[PRODUCERS] = {0};
+    std::atomic<uint32_t> lastFrame{0};
+    std::atomic<uint32_t> wentBackwards{0};
+    const uint32_t droppedBefore = Metrics::commandsDropped;
+
+    std::vector<std::thread> threads;
+    for (uint16_t p = 0; p < PRODUCERS; p++) {
+        threads.emplace_back([&, p] {
+            for (uint32_t i = 1; i <= PUSHES_PER_PRODUCER; i++) {
+                Command cmd;
+                cmd.type = Command::Type::SetPixel;
+                cmd.position = p;
+                cmd.value = i;
+                if (queue.push(cmd)) {
+                    accepted[p]++;
+                    lastAccepted[p] = i;
+                }
+                step();
+            }
+            producersLeft--;
+        });
+    }
+    threads.emplace_back([&] {
+        uint32_t frame[Config::NUM_PIXELS] = {0};
+        for (uint32_t i = 1; i <= PUSHES_PER_PRODUCER; i++) {
+            frame[PRODUCERS] = i;
+            if (queue.postFrame(frame, PRODUCERS, 1)) lastFrame = i;
+            step();
+        }
+        producersLeft--;
+    });
+    // A reader on another core: each producer's pixel only ever moves forward
+    threads.emplace_back([&] {
+        uint32_t seen[Config::NUM_PIXELS] = {0};
+        while (producersLeft > 0) {
+            const AppState s = store.snapshot();
+            for (uint16_t i = 0; i < Config::NUM_PIXELS; i++) {
+                if (s.pixelColors[i] < seen[i]) wentBackwards++;
+                seen[i] = s.pixelColors[i];
+            }
+            step();
+        }
+    });
+
+    // This thread is the render loop, slow enough that the queue sometimes fills
+    uint32_t drains = 0;
+    for (uint32_t loops = 0; producersLeft > 0; loops++) {
+        if (loops % 16 == 0) {
+            queue.drain(store);
+            drains++;
+        }
+        step();
+    }
+    for (auto& t : threads) t.join();
+    queue.drain(store);
+
+    const AppState s = store.snapshot();
+    uint32_t totalAccepted = 0;
+    for (uint16_t p = 0; p < PRODUCERS; p++) {
+        CHECK_EQ(s.pixelColors[p], lastAccepted[p]);
+        totalAccepted += accepted[p];
+    }
+    // Frames merge in the staging buffer, so the last accepted one wins; a dropped one stages nothing
+    CHECK_EQ(s.pixelColors[PRODUCERS], lastFrame.load());
+    CHECK_EQ(wentBackwards, 0);
+    CHECK(Metrics::commandsApplied >= totalAccepted);
+    CHECK(Metrics::commandsDropped - droppedBefore >= PRODUCERS * PUSHES_PER_PRODUCER - totalAccepted);
+    printf("queue: %u of %u pixel commands accepted, %u dropped in total, %u drains\n", (unsigned)totalAccepted,
+           (unsigned)(PRODUCERS * PUSHES_PER_PRODUCER), (unsigned)(Metrics::commandsDropped - droppedBefore),
+           (unsigned)drains);
+}
+
+int main() {
+    IdleControl::begin();
+    testSnapshotsNeverTear();
+    testCommandsLandInOrder();
+    return HostTest::report("StateStressTest");
+}
@@ -0,0 +1,204 @@
+// Team presence against a local Graph stand-in: one getPresencesByUserId
+// request for 1-50 users, answered the way Graph does (chunked, one object per
+// user, ids in any case, unknown ids left out), parsed one element at a time.
+#include "HostTest.h"
+#include "TeamsPresence.h"
+#include "MicrosoftAuth.h"
+#include "HttpsSession.h"
+#include "Memory.h"
+#include "Metrics.h"
+#include <HTTPClient.h>
+#include <map>
+#include <vector>
+
+static constexpr size_t MAX_USERS = 50;
+
+struct GraphStatus {
+    const char* availability;
+    const char* activity;
+    PresenceStatus expected;
+};
+
+static const GraphStatus STATUSES[] = {
+    {"Available", "Available", {Presence::Available, Activity::Other}},
+    {"Busy", "InAMeeting", {Presence::Busy, Activity::InAMeeting}},
+    {"Busy", "InACall", {Presence::Busy, Activity::InACall}},
+    {"DoNotDisturb", "Presenting", {Presence::DoNotDisturb, Activity::Presenting}},
+    {"Away", "Away", {Presence::Away, Activity::Other}},
+    {"BeRightBack", "BeRightBack", {Presence::BeRightBack, Activity::Other}},
+    {"Offline", "OffWork", {Presence::Offline, Activity::OffWork}},
+};
+static constexpr size_t STATUS_COUNT = sizeof(STATUSES) / sizeof(STATUSES[0]);
+
+// The tenant: user id -> index into STATUSES
+static std::map<std::string, size_t> directory;
+static std::vector<std::string> userIds;
+
+static std::string userId(size_t i) {
+    char id[37];
+    snprintf(id, sizeof(id), "%08zx-1b2c-4d5e-8f90-a1b2c3d4e5f6", 0xc0ffee00 + i);
+    return id;
+}
+
+static bool rejectNextGraphRequest = false;
+static uint32_t tokensIssued = 0;
+
+// Quoted strings in the "ids" array of a getPresencesByUserId body
+static std::vector<std::string> requestedIds(const std::string& body) {
+    std::vector<std::string> ids;
+    size_t pos = body.find('[');
+    const size_t end = body.find(']');
+    while ((pos = body.find('"', pos)) != std::string::npos && pos < end) {
+        const size_t close = body.find('"', pos + 1);
+        ids.push_back(body.substr(pos + 1, close - pos - 1));
+        pos = close + 1;
+    }
+    return ids;
+}
+
+static std::vector<HostHttp::Request> graphRequests() {
+    std::vector<HostHttp::Request> out;
+    for (const auto& r : HostHttp::requests) {
+        if (r.url.find("graph.microsoft.com") != std::string::npos) out.push_back(r);
+    }
+    return out;
+}
+
+static std::string upper(std::string s) {
+    for (char& c : s) c = (char)toupper((unsigned char)c);
+    return s;
+}
+
+static HostHttp::Response graph(const HostHttp::Request& request) {
+    HostHttp::Response response;
+    if (request.url.find("login.microsoftonline.com") != std::string::npos) {
+        const unsigned n = ++tokensIssued;
+        char body[160];
+        snprintf(body, sizeof(body),
+                 "{\"token_type\":\"Bearer\",\"expires_in\":3599,\"access_token\":\"access-%u\","
+                 "\"refresh_token\":\"refresh-%u\"}",
+                 n, n);
+        response.body = body;
+        return response;
+    }
+
+    const auto auth = request.headers.find("Authorization");
+    const std::string expected = "Bearer access-" + std::to_string(tokensIssued);
+    if (rejectNextGraphRequest || auth == request.headers.end() || auth->second != expected) {
+        rejectNextGraphRequest = false;
+        response.status = 401;
+        response.body = "{\"error\":{\"code\":\"InvalidAuthenticationToken\"}}";
+        return response;
+    }
+    CHECK(request.url.find("/communications/getPresencesByUserId") != std::string::npos);
+
+    response.body = "{\"@odata.context\":\"https://graph.microsoft.com/v1.0/$metadata#Collection(presence)\","
+                    "\"value\":[";
+    bool first = true;
+    for (const std::string& id : requestedIds(request.body)) {
+        const auto user = directory.find(id);
+        if (user == directory.end()) continue;
+        const GraphStatus& s = STATUSES[user->second];
+        // Graph echoes ids in its own case; every other one comes back upper case here
+        const std::string echoed = user->second % 2 ? upper(id) : id;
+        response.body += first ? "" : ",";
+        response.body += "{\"@odata.type\":\"#microsoft.graph.presence\",\"id\":\"" + echoed +
+                         "\",\"availability\":\"" + s.availability + "\",\"activity\":\"" + s.activity +
+                         "\",\"statusMessage\":null}";
+        first = false;
+    }
+    response.body += "]}";
+    response.chunked = true;
+    response.chunkSize = 100;
+    return response;
+}
+
+static HttpsSession session;
+static MicrosoftAuth auth("client-id", "tenant-id", session);
+static TeamsPresence presence(auth, session);
+
+static void signIn() {
+    HostNvs::reset();
+    Preferences prefs;
+    prefs.begin("msauth");
+    prefs.putString("refresh", "refresh-0");
+    auth.begin();
+}
+
+// Team of `count`, with every `missingEvery`th user unknown to the tenant
+static std::vector<Config::TeamMember> team(size_t count, size_t missingEvery = 0) {
+    std::vector<Config::TeamMember> members;
+    for (size_t i = 0; i < count; i++) {
+        if (!missingEvery || (i + 1) % missingEvery != 0) directory[userIds[i]] = i % STATUS_COUNT;
+        else directory.erase(userIds[i]);
+        members.push_back({userIds[i].c_str(), (uint16_t)i, 1});
+    }
+    return members;
+}
+
+static void testBatchSizes() {
+    const size_t sizes[] = {1, 2, 7, 16, 33, 50};
+    for (size_t n : sizes) {
+        const auto members = team(n);
+        PresenceStatus out[MAX_USERS];
+        HostHttp::requests.clear();
+        CHECK(presence.fetchTeamPresence(members.data(), n, out));
+        session.endBurst();
+
+        // One request for the whole team (after signing in, the first time)
+        CHECK_EQ(graphRequests().size(), 1);
+        const HostHttp::Request request = graphRequests().back();
+        CHECK_EQ(requestedIds(request.body).size(), n);
+        for (size_t i = 0; i < n; i++) {
+            CHECK(out[i] == STATUSES[i % STATUS_COUNT].expected);
+        }
+        printf("%2zu users: %4zu byte request, %5zu byte response, %s connection\n", n, request.body.size(),
+               graph(request).body.size(), request.reused ? "reused" : "new");
+    }
+}
+
+static void testUnknownUsersStayUnknown() {
+    const auto members = team(20, 3);
+    PresenceStatus out[MAX_USERS];
+    CHECK(presence.fetchTeamPresence(members.data(), members.size(), out));
+    for (size_t i = 0; i < members.size(); i++) {
+        if ((i + 1) % 3 == 0) CHECK(out[i] == PresenceStatus());
+        else CHECK(out[i] == STATUSES[i % STATUS_COUNT].expected);
+    }
+
+    // Nobody known: an empty value array is a failed poll, not a team of Unknowns
+    const auto nobody = team(4, 1);
+    CHECK(!presence.fetchTeamPresence(nobody.data(), nobody.size(), out));
+}
+
+static void testUnauthorizedRefreshesAndRetries() {
+    const auto members = team(5);
+    PresenceStatus out[MAX_USERS];
+    const uint32_t issued = tokensIssued;
+    const uint32_t unauthorized = Metrics::graphUnauthorized;
+    rejectNextGraphRequest = true;
+    HostHttp::requests.clear();
+    CHECK(presence.fetchTeamPresence(members.data(), members.size(), out));
+    CHECK_EQ(Metrics::graphUnauthorized, unauthorized + 1);
+    CHECK_EQ(tokensIssued, issued + 1);
+    // Graph, sign-in, Graph again with the new token
+    CHECK_EQ(HostHttp::requests.size(), 3);
+    CHECK(out[4] == STATUSES[4].expected);
+}
+
+int main() {
+    Memory::begin();
+    for (size_t i = 0; i < MAX_USERS; i++) userIds.push_back(userId(i));
+    HostHttp::server = graph;
+    signIn();
+
+    testBatchSizes();
+    // Sign-in, then one handshake per poll: no connection is held between polls
+    CHECK_EQ(Metrics::tlsConnects, 1 + 6);
+    CHECK_EQ(Metrics::tlsHeldBytes, 0);
+    testUnknownUsersStayUnknown();
+    testUnauthorizedRefreshesAndRetries();
+    printf("TLS: %u connections, %u reuses\n", (unsigned)Metrics::tlsConnects, (unsigned)Metrics::tlsReuses);
+
+    return HostTest::report("TeamsPresenceTest");
+}
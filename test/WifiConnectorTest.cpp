@@ -0,0 +1,146 @@
+// WifiConnector against a simulated radio on the virtual clock (stubs/WiFi.h)
+// and the in-memory NVS: first boot scans and caches the AP, a reboot joins it
+// directly, a moved AP falls back to a scan and is re-cached, and a missing AP
+// fails after both timeouts. Prints how long each connect phase took.
+#include "HostTest.h"
+#include "WifiConnector.h"
+#include "Config.h"
+#include "Metrics.h"
+
+static const char* SSID = "office";
+static const char* PASS = "hunter22";
+static constexpr uint32_t POLL_MS = 10;
+
+struct Outcome {
+    WifiConnector::Result result;
+    uint32_t totalMs;
+    uint32_t nvsWrites;
+    uint32_t scans;
+};
+
+// One boot's connect: a fresh connector over whatever NVS holds, polled until it settles
+static Outcome connectOnce(const char* name) {
+    WifiConnector connector;
+    connector.begin(SSID, PASS);
+    const uint32_t writes = HostNvs::writes;
+    const uint32_t scans = HostWifi::scans;
+    const uint32_t startMs = millis();
+    connector.connect(startMs);
+
+    WifiConnector::Result result;
+    do {
+        HostClock::advanceMs(POLL_MS);
+        result = connector.poll(millis());
+    } while (result == WifiConnector::Result::Pending);
+
+    Outcome out{result, (uint32_t)(millis() - startMs), HostNvs::writes - writes, HostWifi::scans - scans};
+    if (result == WifiConnector::Result::Connected) {
+        printf("%-22s connected in %5u ms: associate %4u ms, IP %3u ms, %u scan(s), %u NVS write(s)\n", name,
+               out.totalMs, HostWifi::associatedMs - HostWifi::beganMs, HostWifi::gotIpMs - HostWifi::associatedMs,
+               out.scans, out.nvsWrites);
+    } else {
+        printf("%-22s failed after %5u ms, %u scan(s)\n", name, out.totalMs, out.scans);
+    }
+    WiFi.disconnect();
+    return out;
+}
+
+static HostWifi::AccessPoint ap(uint8_t last, int32_t channel) {
+    return {SSID, {0x24, 0x0a, 0xc4, 0x12, 0x34, last}, channel};
+}
+
+static void testFirstBootScansAndCaches() {
+    HostNvs::reset();
+    HostWifi::reset();
+    HostWifi::aps = {{"neighbour", {2, 0, 0, 0, 0, 1}, 1}, ap(0x56, 6)};
+    const uint32_t scanned = Metrics::wifiConnectsScanned;
+
+    const Outcome out = connectOnce("first boot (scan)");
+    CHECK(out.result == WifiConnector::Result::Connected);
+    CHECK_EQ(out.scans, 1);
+    CHECK_EQ(out.nvsWrites, 1);
+    CHECK_EQ(Metrics::wifiConnectsScanned, scanned + 1);
+    CHECK(HostNvs::store["wifi"].count("ap") == 1);
+}
+
+static void testRebootJoinsDirectly() {
+    const uint32_t direct = Metrics::wifiConnectsDirect;
+    const uint32_t connects = Metrics::wifiConnectDuration.count();
+    const uint32_t scannedMs = HostWifi::scanMs + HostWifi::directJoinMs + HostWifi::dhcpMs;
+    const Outcome out = connectOnce("reboot (cached AP)");
+    CHECK(out.result == WifiConnector::Result::Connected);
+    CHECK_EQ(out.scans, 0);
+    // Same AP, so nothing reaches flash
+    CHECK_EQ(out.nvsWrites, 0);
+    CHECK_EQ(Metrics::wifiConnectsDirect, direct + 1);
+    CHECK_EQ(Metrics::wifiConnectDuration.count(), connects + 1);
+    CHECK(out.totalMs <= HostWifi::directJoinMs + HostWifi::dhcpMs + POLL_MS);
+    printf("  the cached AP skips the %u ms scan, %u ms instead of %u\n", HostWifi::scanMs, out.totalMs, scannedMs);
+}
+
+static void testMovedApFallsBackAndRecaches() {
+    // The router picked a new channel overnight
+    HostWifi::aps = {ap(0x56, 11)};
+    const uint32_t fallbacks = Metrics::wifiDirectFallbacks;
+
+    const Outcome out = connectOnce("AP moved (fallback)");
+    CHECK(out.result == WifiConnector::Result::Connected);
+    CHECK_EQ(out.scans, 1);
+    CHECK_EQ(out.nvsWrites, 1);
+    CHECK_EQ(Metrics::wifiDirectFallbacks, fallbacks + 1);
+    CHECK(out.totalMs >= Config::WIFI_FAST_CONNECT_TIMEOUT_MS + HostWifi::scanMs);
+    CHECK_EQ(WiFi.channel(), 0);
+
+    // Next boot joins the new channel directly again
+    const Outcome next = connectOnce("after re-cache");
+    CHECK(next.result == WifiConnector::Result::Connected);
+    CHECK_EQ(next.scans, 0);
+    CHECK_EQ(next.nvsWrites, 0);
+}
+
+static void testReplacedApIsRecached() {
+    // Same SSID, new hardware on the same channel
+    HostWifi::aps = {ap(0x99, 11)};
+    const Outcome out = connectOnce("AP replaced");
+    CHECK(out.result == WifiConnector::Result::Connected);
+    CHECK_EQ(out.scans, 1);
+    CHECK_EQ(out.nvsWrites, 1);
+}
+
+static void testMissingApFailsAfterBothTimeouts() {
+    HostWifi::aps.clear();
+    const Outcome out = connectOnce("AP gone");
+    CHECK(out.result == WifiConnector::Result::Failed);
+    CHECK_EQ(out.scans, 1);
+    CHECK_EQ(out.nvsWrites, 0);
+    CHECK(out.totalMs >= Config::WIFI_FAST_CONNECT_TIMEOUT_MS + Config::WIFI_CONNECT_TIMEOUT_MS);
+    CHECK(out.totalMs <= Config::WIFI_FAST_CONNECT_TIMEOUT_MS + Config::WIFI_CONNECT_TIMEOUT_MS + 2 * POLL_MS);
+}
+
+static void testOtherNetworksCacheIsIgnored() {
+    // The cache left by another SSID must not send the first attempt to its AP
+    HostNvs::reset();
+    HostWifi::aps = {{"home", {0x24, 0x0a, 0xc4, 0x12, 0x34, 0x77}, 6}, ap(0x56, 6)};
+    WifiConnector home;
+    home.begin("home", PASS);
+    home.connect(millis());
+    while (home.poll(millis()) == WifiConnector::Result::Pending) HostClock::advanceMs(POLL_MS);
+    WiFi.disconnect();
+    CHECK(HostNvs::store["wifi"].count("ap") == 1);
+
+    const Outcome out = connectOnce("cache from other SSID");
+    CHECK(out.result == WifiConnector::Result::Connected);
+    CHECK_EQ(out.scans, 1);
+    CHECK_EQ(out.nvsWrites, 1);
+}
+
+int main() {
+    testFirstBootScansAndCaches();
+    testRebootJoinsDirectly();
+    testMovedApFallsBackAndRecaches();
+    testReplacedApIsRecached();
+    testMissingApFailsAfterBothTimeouts();
+    testOtherNetworksCacheIsIgnored();
+    CHECK(!WiFi.autoReconnect);
+    return HostTest::report("WifiConnectorTest");
+}
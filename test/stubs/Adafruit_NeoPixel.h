@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+#define NEO_GRB 0x52
+#define NEO_KHZ800 0x0000
+
+// Keeps the last values written, and a copy of each frame sent by show()
+class Adafruit_NeoPixel {
+public:
+    Adafruit_NeoPixel(uint16_t n, int16_t pin, uint16_t type) : _pixels(n * 3, 0), _sent(n * 3, 0) {
+        latest = this;
+    }
+
+    // The most recently constructed strip, for tests that can't reach it otherwise
+    static inline Adafruit_NeoPixel* latest = nullptr;
+
+    void begin() {}
+    void show() {
+        _sent = _pixels;
+        showCount++;
+    }
+    bool canShow() { return true; }
+    void clear() { std::fill(_pixels.begin(), _pixels.end(), 0); }
+    void setBrightness(uint8_t) {}
+    void setPixelColor(uint16_t i, uint8_t r, uint8_t g, uint8_t b) {
+        if (i >= numPixels()) return;
+        _pixels[i * 3] = r;
+        _pixels[i * 3 + 1] = g;
+        _pixels[i * 3 + 2] = b;
+    }
+    void setPixelColor(uint16_t i, uint32_t c) { setPixelColor(i, c >> 16, c >> 8, c); }
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) { return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b; }
+    uint16_t numPixels() const { return (uint16_t)(_pixels.size() / 3); }
+
+    // Channel `c` (0 = R) of pixel `i` as last sent to the strip
+    uint8_t sent(uint16_t i, uint8_t c) const { return _sent[i * 3 + c]; }
+    uint32_t showCount = 0;
+
+private:
+    std::vector<uint8_t> _pixels;
+    std::vector<uint8_t> _sent;
+};
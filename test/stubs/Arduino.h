@@ -0,0 +1,233 @@
+#pragma once
+
+// Host stand-in for the parts of the Arduino core the firmware uses. Time is a
+// virtual clock that only moves when a test (or delay()) moves it.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdarg>
+#include <string>
+#include <algorithm>
+#include <strings.h>
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define INPUT_PULLUP 1
+#define INPUT_PULLDOWN 2
+#define CHANGE 3
+#define LOW 0
+#define HIGH 1
+
+typedef bool boolean;
+
+namespace HostClock {
+extern uint64_t nowUs;
+inline void advanceMs(uint32_t ms) { nowUs += (uint64_t)ms * 1000; }
+inline void advanceUs(uint32_t us) { nowUs += us; }
+inline void setMs(uint32_t ms) { nowUs = (uint64_t)ms * 1000; }
+}
+
+inline unsigned long millis() { return (unsigned long)(uint32_t)(HostClock::nowUs / 1000); }
+inline unsigned long micros() { return (unsigned long)(uint32_t)HostClock::nowUs; }
+inline void delay(unsigned long ms) { HostClock::advanceMs(ms); }
+inline void yield() {}
+
+inline size_t strlcpy(char* dst, const char* src, size_t size) {
+    const size_t len = strlen(src);
+    if (size) {
+        const size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return HIGH; }
+inline int digitalPinToInterrupt(int pin) { return pin; }
+inline void attachInterruptArg(uint8_t, void (*)(void*), void*, int) {}
+
+class String {
+public:
+    String(const char* s = "") : _s(s ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+    String(int v) : _s(std::to_string(v)) {}
+    String(unsigned v) : _s(std::to_string(v)) {}
+    String(long v) : _s(std::to_string(v)) {}
+    String(unsigned long v) : _s(std::to_string(v)) {}
+
+    const char* c_str() const { return _s.c_str(); }
+    unsigned length() const { return _s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    bool reserve(unsigned n) { _s.reserve(n); return true; }
+    String& operator+=(const String& o) { _s += o._s; return *this; }
+    String& operator+=(const char* o) { _s += o; return *this; }
+    String& operator+=(char c) { _s += c; return *this; }
+    friend String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+    bool operator==(const char* o) const { return _s == o; }
+    bool operator==(const String& o) const { return _s == o._s; }
+    bool operator!=(const char* o) const { return _s != o; }
+    bool operator!=(const String& o) const { return _s != o._s; }
+    bool equalsIgnoreCase(const String& o) const { return strcasecmp(_s.c_str(), o.c_str()) == 0; }
+    bool startsWith(const char* p) const { return _s.rfind(p, 0) == 0; }
+    int indexOf(const char* p) const { const size_t i = _s.find(p); return i == std::string::npos ? -1 : (int)i; }
+    String substring(unsigned from) const { return String(_s.substr(from)); }
+    String substring(unsigned from, unsigned to) const { return String(_s.substr(from, to - from)); }
+    long toInt() const { return atol(_s.c_str()); }
+    char operator[](unsigned i) const { return _s[i]; }
+
+private:
+    std::string _s;
+};
+
+class Print {
+public:
+    virtual ~Print() = default;
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* data, size_t len) {
+        size_t n = 0;
+        while (len--) n += write(*data++);
+        return n;
+    }
+    size_t write(const char* s) { return write(reinterpret_cast<const uint8_t*>(s), strlen(s)); }
+    virtual void flush() {}
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t println(const char* s = "") { return print(s) + write("\r\n"); }
+    size_t println(const String& s) { return println(s.c_str()); }
+
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        char buf[512];
+        va_list args;
+        va_start(args, fmt);
+        const int len = vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+        if (len <= 0) return 0;
+        return write(reinterpret_cast<const uint8_t*>(buf), std::min((size_t)len, sizeof(buf) - 1));
+    }
+};
+
+// Same timed-read semantics as the Arduino core: reads give up after the
+// timeout, which passes on the virtual clock
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long ms) { _timeout = ms; }
+    unsigned long getTimeout() const { return _timeout; }
+
+    size_t readBytes(char* buf, size_t len) { return readBytes(reinterpret_cast<uint8_t*>(buf), len); }
+    size_t readBytes(uint8_t* buf, size_t len) {
+        size_t n = 0;
+        while (n < len) {
+            const int c = timedRead();
+            if (c < 0) break;
+            buf[n++] = (uint8_t)c;
+        }
+        return n;
+    }
+
+    bool find(const char* target) { return findUntil(target, nullptr); }
+
+    bool findUntil(const char* target, const char* terminator) {
+        const size_t targetLen = strlen(target);
+        const size_t termLen = terminator ? strlen(terminator) : 0;
+        size_t matched = 0;
+        size_t termMatched = 0;
+        for (;;) {
+            const int c = timedRead();
+            if (c < 0) return false;
+            matched = advanceMatch(target, matched, (char)c);
+            if (matched == targetLen) return true;
+            if (termLen) {
+                termMatched = advanceMatch(terminator, termMatched, (char)c);
+                if (termMatched == termLen) return false;
+            }
+        }
+    }
+
+protected:
+    unsigned long _timeout = 1000;
+
+    int timedRead() {
+        const unsigned long start = millis();
+        do {
+            const int c = read();
+            if (c >= 0) return c;
+            HostClock::advanceMs(1);
+        } while (millis() - start < _timeout);
+        return -1;
+    }
+
+private:
+    // Length of the longest prefix of `s` that ends the input so far
+    static size_t advanceMatch(const char* s, size_t matched, char c) {
+        while (true) {
+            if (s[matched] == c) return matched + 1;
+            if (matched == 0) return 0;
+            // Fall back to the longest shorter prefix that is also a suffix
+            size_t k = matched - 1;
+            while (k > 0 && strncmp(s, s + matched - k, k) != 0) k--;
+            matched = k;
+        }
+    }
+};
+
+// Discards output unless a test turns echo on
+class HardwareSerial : public Stream {
+public:
+    bool echo = false;
+
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override {
+        if (echo) fputc(c, stdout);
+        return 1;
+    }
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+};
+extern HardwareSerial Serial;
+
+namespace HostCpu {
+inline uint32_t mhz = 240;     // Set by setCpuFrequencyMhz()
+}
+
+// Heap figures are whatever the test sets
+struct EspClass {
+    uint32_t freeHeap = 200000;
+    uint32_t minFreeHeap = 200000;
+    uint32_t maxAllocHeap = 100000;
+    uint64_t efuseMac = 0x0000A1B2C3D4E5F6ULL;
+
+    uint32_t getFreeHeap() { return freeHeap; }
+    uint32_t getMinFreeHeap() { return minFreeHeap; }
+    uint32_t getMaxAllocHeap() { return maxAllocHeap; }
+    uint32_t getCycleCount() { return (uint32_t)(HostClock::nowUs * 240); }
+    uint32_t getCpuFreqMHz() { return HostCpu::mhz; }
+    uint64_t getEfuseMac() { return efuseMac; }
+    uint32_t getPsramSize() { return 0; }
+};
+extern EspClass ESP;
+
+inline bool psramFound() { return false; }
+inline void* ps_malloc(size_t n) { return malloc(n); }
+inline bool setCpuFrequencyMhz(uint32_t mhz) {
+    HostCpu::mhz = mhz;
+    return true;
+}
+inline uint32_t getCpuFrequencyMhz() { return HostCpu::mhz; }
+inline void configTime(long, int, const char*, const char* = nullptr, const char* = nullptr) {}
+inline void configTzTime(const char*, const char*, const char* = nullptr, const char* = nullptr) {}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <functional>
+#include <map>
+#include <vector>
+
+#define HTTP_CODE_OK 200
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+// Requests go to HostHttp::server, which a test installs as its stand-in for
+// the remote service. The response body is framed the way the server would put
+// it on an HTTP/1.1 connection and read back through the client's stream.
+namespace HostHttp {
+struct Request {
+    std::string method;
+    std::string url;
+    std::string body;
+    std::map<std::string, std::string> headers;
+    bool http10 = false;
+    bool reused = false;        // Went over an already open connection
+};
+
+struct Response {
+    int status = 200;           // Negative for a transport error, as HTTPClient returns
+    std::string body;
+    bool chunked = false;
+    size_t chunkSize = 64;      // Bytes per chunk when chunked
+    bool close = false;         // Connection: close
+};
+
+inline std::function<Response(const Request&)> server;
+inline std::vector<Request> requests;
+
+inline void reset() {
+    server = nullptr;
+    requests.clear();
+}
+}
+
+class HTTPClient {
+public:
+    bool begin(WiFiClient& client, const String& url) {
+        _client = &client;
+        _url = url.c_str();
+        _requestHeaders.clear();
+        _responseHeaders.clear();
+        _size = -1;
+        return true;
+    }
+    void setReuse(bool reuse) { _reuse = reuse; }
+    void useHTTP10(bool http10) { _http10 = http10; }
+    void setTimeout(uint16_t) {}
+    void setConnectTimeout(int32_t) {}
+    void collectHeaders(const char* keys[], size_t count) { _collect.assign(keys, keys + count); }
+    void addHeader(const String& name, const String& value) { _requestHeaders[name.c_str()] = value.c_str(); }
+
+    int GET() { return send("GET", ""); }
+    int POST(const uint8_t* payload, size_t size) {
+        return send("POST", std::string(reinterpret_cast<const char*>(payload), size));
+    }
+    int POST(const String& payload) { return send("POST", payload.c_str()); }
+
+    WiFiClient& getStream() { return *_client; }
+    int getSize() { return _size; }
+    String header(const char* name) {
+        const auto it = _responseHeaders.find(name);
+        return it == _responseHeaders.end() ? String() : String(it->second);
+    }
+    String getString() {
+        std::string s;
+        while (_client->available()) s += (char)_client->read();
+        return String(s);
+    }
+    int writeToStream(Stream* out) {
+        int n = 0;
+        while (_client->available()) n += out->write((uint8_t)_client->read());
+        return n;
+    }
+
+    // Like the core's: leftover bytes are discarded, and the connection is kept
+    // only when reuse is on and the response allows it
+    void end() {
+        if (!_client) return;
+        if (_client->connected()) {
+            while (_client->available() > 0) _client->read();
+            if (!(_reuse && _canReuse)) _client->stop();
+        }
+    }
+
+private:
+    WiFiClient* _client = nullptr;
+    std::string _url;
+    std::map<std::string, std::string> _requestHeaders;
+    std::vector<std::string> _collect;
+    std::map<std::string, std::string> _responseHeaders;
+    bool _reuse = true;
+    bool _http10 = false;
+    bool _canReuse = false;
+    int _size = -1;
+
+    int send(const char* method, const std::string& body) {
+        if (!HostHttp::server) {
+            _client->stop();
+            return HTTPC_ERROR_CONNECTION_REFUSED;
+        }
+        const bool reused = _client->connected();
+        _client->connectIfClosed();
+        HostHttp::Request request{method, _url, body, _requestHeaders, _http10, reused};
+        HostHttp::requests.push_back(request);
+        const HostHttp::Response response = HostHttp::server(request);
+        if (response.status < 0) {
+            // A transport error: nothing comes back and the connection is gone
+            _client->stop();
+            return response.status;
+        }
+
+        _responseHeaders.clear();
+        const bool chunked = response.chunked && !_http10;
+        if (chunked) {
+            remember("Transfer-Encoding", "chunked");
+            _size = -1;
+            std::string framed;
+            char line[16];
+            for (size_t i = 0; i < response.body.size(); i += response.chunkSize) {
+                const std::string chunk = response.body.substr(i, response.chunkSize);
+                snprintf(line, sizeof(line), "%zx\r\n", chunk.size());
+                framed += line + chunk + "\r\n";
+            }
+            framed += "0\r\n\r\n";
+            _client->deliver(framed);
+        } else {
+            _size = (int)response.body.size();
+            _client->deliver(response.body);
+        }
+        _canReuse = !_http10 && !response.close;
+        return response.status;
+    }
+
+    void remember(const char* name, const char* value) {
+        for (const auto& key : _collect) {
+            if (strcasecmp(key.c_str(), name) == 0) _responseHeaders[key] = value;
+        }
+    }
+};
@@ -0,0 +1,8 @@
+#include <Arduino.h>
+#include <WiFi.h>
+
+// Globals the Arduino core would provide
+uint64_t HostClock::nowUs = 0;
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Arduino.h>
+
+class IPAddress {
+public:
+    IPAddress() = default;
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : _addr((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+    explicit IPAddress(uint32_t addr) : _addr(addr) {}
+
+    operator uint32_t() const { return _addr; }
+    bool operator==(const IPAddress& o) const { return _addr == o._addr; }
+    bool operator!=(const IPAddress& o) const { return _addr != o._addr; }
+    uint8_t operator[](int i) const { return (uint8_t)(_addr >> (i * 8)); }
+
+    bool fromString(const char* s) {
+        unsigned a, b, c, d;
+        if (sscanf(s, "%u.%u.%u.%u", &a, &b, &c, &d) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+            return false;
+        }
+        *this = IPAddress(a, b, c, d);
+        return true;
+    }
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+        return String(buf);
+    }
+
+private:
+    uint32_t _addr = 0;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// NVS stand-in: namespaces of key -> bytes, kept for the life of the process so
+// a test can "reboot" by constructing the firmware objects again
+namespace HostNvs {
+using Namespace = std::map<std::string, std::vector<uint8_t>>;
+inline std::map<std::string, Namespace> store;
+inline uint32_t writes = 0;     // put*() calls, to check what reaches flash
+inline void reset() {
+    store.clear();
+    writes = 0;
+}
+}
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false) {
+        _ns = &HostNvs::store[name];
+        return true;
+    }
+    void end() { _ns = nullptr; }
+
+    size_t getBytesLength(const char* key) {
+        const auto* v = find(key);
+        return v ? v->size() : 0;
+    }
+    size_t getBytes(const char* key, void* buf, size_t len) {
+        const auto* v = find(key);
+        if (!v || v->size() > len) return 0;
+        memcpy(buf, v->data(), v->size());
+        return v->size();
+    }
+    size_t putBytes(const char* key, const void* buf, size_t len) {
+        const auto* p = static_cast<const uint8_t*>(buf);
+        return put(key, std::vector<uint8_t>(p, p + len));
+    }
+
+    size_t getString(const char* key, char* buf, size_t len) {
+        const auto* v = find(key);
+        if (!v || v->size() + 1 > len) {
+            if (len) buf[0] = '\0';
+            return 0;
+        }
+        memcpy(buf, v->data(), v->size());
+        buf[v->size()] = '\0';
+        return v->size() + 1;
+    }
+    String getString(const char* key, const String& defaultValue = String()) {
+        const auto* v = find(key);
+        return v ? String(std::string(v->begin(), v->end())) : defaultValue;
+    }
+    size_t putString(const char* key, const char* value) {
+        return put(key, std::vector<uint8_t>(value, value + strlen(value)));
+    }
+    size_t putString(const char* key, const String& value) { return putString(key, value.c_str()); }
+
+    unsigned long getULong(const char* key, unsigned long defaultValue = 0) { return get(key, defaultValue); }
+    size_t putULong(const char* key, unsigned long value) { return putValue(key, (uint32_t)value); }
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0) { return get(key, defaultValue); }
+    size_t putUInt(const char* key, uint32_t value) { return putValue(key, value); }
+    uint8_t getUChar(const char* key, uint8_t defaultValue = 0) { return get(key, defaultValue); }
+    size_t putUChar(const char* key, uint8_t value) { return putValue(key, value); }
+    bool getBool(const char* key, bool defaultValue = false) { return get<uint8_t>(key, defaultValue); }
+    size_t putBool(const char* key, bool value) { return putValue(key, (uint8_t)value); }
+
+    bool remove(const char* key) { return _ns && _ns->erase(key) > 0; }
+    bool clear() {
+        if (_ns) _ns->clear();
+        return _ns != nullptr;
+    }
+
+private:
+    HostNvs::Namespace* _ns = nullptr;
+
+    const std::vector<uint8_t>* find(const char* key) const {
+        if (!_ns) return nullptr;
+        const auto it = _ns->find(key);
+        return it == _ns->end() ? nullptr : &it->second;
+    }
+    size_t put(const char* key, std::vector<uint8_t> value) {
+        if (!_ns) return 0;
+        HostNvs::writes++;
+        const size_t n = value.size();
+        (*_ns)[key] = std::move(value);
+        return n;
+    }
+    template <typename T>
+    T get(const char* key, T defaultValue) {
+        const auto* v = find(key);
+        if (!v || v->size() != sizeof(T)) return defaultValue;
+        T value;
+        memcpy(&value, v->data(), sizeof(T));
+        return value;
+    }
+    template <typename T>
+    size_t putValue(const char* key, T value) {
+        return putBytes(key, &value, sizeof(T));
+    }
+};
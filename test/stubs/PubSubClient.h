@@ -0,0 +1,186 @@
+#pragma once
+
+#include <Arduino.h>
+#include "WiFiClient.h"
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+
+class PubSubClient;
+
+// An in-memory broker for one client. The test publishes to the device with
+// HostMqtt::publish(), which reaches the client's callback on its next loop()
+// if a subscription matches, and reads what the device published back from
+// `published` and `retained`. dropConnection() cuts the link without a
+// DISCONNECT, so the broker publishes the client's last will.
+namespace HostMqtt {
+
+struct Message {
+    std::string topic;
+    std::string payload;
+    bool retained;
+    uint32_t atMs;
+};
+
+inline bool brokerUp = true;
+inline uint32_t connectMs = 20;             // CONNECT to CONNACK, on the virtual clock
+
+inline std::vector<uint32_t> connectAttemptsMs;
+inline std::vector<std::string> subscriptions;
+inline std::vector<Message> published;                  // Everything the device published
+inline std::map<std::string, std::string> retained;     // Topic -> last retained payload
+inline PubSubClient* client = nullptr;                  // The connected client
+
+// MQTT topic filter match with `+` and a trailing `#`
+inline bool matches(const std::string& filter, const std::string& topic) {
+    size_t f = 0, t = 0;
+    while (f < filter.size()) {
+        if (filter[f] == '#') return true;
+        if (filter[f] == '+') {
+            while (t < topic.size() && topic[t] != '/') t++;
+            f++;
+            continue;
+        }
+        // `a/#` also matches `a` itself
+        if (t == topic.size()) return filter.compare(f, std::string::npos, "/#") == 0;
+        if (filter[f] != topic[t]) return false;
+        f++;
+        t++;
+    }
+    return t == topic.size();
+}
+
+inline void store(const std::string& topic, const std::string& payload, bool retain) {
+    published.push_back({topic, payload, retain, (uint32_t)millis()});
+    if (!retain) return;
+    if (payload.empty()) {
+        retained.erase(topic);
+    } else {
+        retained[topic] = payload;
+    }
+}
+
+// Sends `payload` on `topic` from another client
+inline void publish(const std::string& topic, const std::string& payload);
+// The TCP link dies without a DISCONNECT
+inline void dropConnection();
+
+inline void reset() {
+    brokerUp = true;
+    connectAttemptsMs.clear();
+    subscriptions.clear();
+    published.clear();
+    retained.clear();
+}
+
+}
+
+class PubSubClient {
+public:
+    PubSubClient() {}
+    explicit PubSubClient(WiFiClient&) {}
+    ~PubSubClient() {
+        if (HostMqtt::client == this) HostMqtt::client = nullptr;
+    }
+
+    PubSubClient& setServer(const char*, uint16_t) { return *this; }
+    PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE) {
+        _callback = callback;
+        return *this;
+    }
+    PubSubClient& setKeepAlive(uint16_t) { return *this; }
+    PubSubClient& setSocketTimeout(uint16_t) { return *this; }
+    bool setBufferSize(uint16_t size) {
+        _bufferSize = size;
+        return true;
+    }
+
+    bool connect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos,
+                 bool willRetain, const char* willMessage, bool cleanSession = true) {
+        HostMqtt::connectAttemptsMs.push_back(millis());
+        if (!HostMqtt::brokerUp) {
+            _state = MQTT_CONNECT_FAILED;
+            return false;
+        }
+        HostClock::advanceMs(HostMqtt::connectMs);
+        _connected = true;
+        _state = MQTT_CONNECTED;
+        _will = {willTopic ? willTopic : "", willMessage ? willMessage : "", willRetain, 0};
+        _inbox.clear();
+        HostMqtt::subscriptions.clear();
+        HostMqtt::client = this;
+        return true;
+    }
+    void disconnect() {
+        _connected = false;
+        _state = MQTT_DISCONNECTED;
+    }
+    bool connected() { return _connected; }
+    int state() { return _state; }
+
+    bool publish(const char* topic, const char* payload, bool retained) {
+        return publish(topic, reinterpret_cast<const uint8_t*>(payload), strlen(payload), retained);
+    }
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained) {
+        // Fixed header, topic length and topic have to fit the buffer with the payload
+        if (!_connected || 5 + 2 + strlen(topic) + length > _bufferSize) return false;
+        HostMqtt::store(topic, std::string(reinterpret_cast<const char*>(payload), length), retained);
+        return true;
+    }
+    bool subscribe(const char* topic, uint8_t = 0) {
+        if (!_connected) return false;
+        HostMqtt::subscriptions.push_back(topic);
+        return true;
+    }
+
+    // Hands queued messages to the callback
+    bool loop() {
+        if (!_connected) return false;
+        std::vector<HostMqtt::Message> inbox;
+        inbox.swap(_inbox);
+        for (HostMqtt::Message& m : inbox) {
+            if (_callback) {
+                _callback(&m.topic[0], reinterpret_cast<uint8_t*>(&m.payload[0]), (unsigned)m.payload.size());
+            }
+        }
+        return true;
+    }
+
+private:
+    friend void HostMqtt::publish(const std::string&, const std::string&);
+    friend void HostMqtt::dropConnection();
+
+    std::function<void(char*, uint8_t*, unsigned int)> _callback;
+    uint16_t _bufferSize = 256;
+    bool _connected = false;
+    int _state = MQTT_DISCONNECTED;
+    HostMqtt::Message _will;
+    std::vector<HostMqtt::Message> _inbox;
+};
+
+inline void HostMqtt::publish(const std::string& topic, const std::string& payload) {
+    if (!client || !client->_connected) return;
+    for (const std::string& filter : subscriptions) {
+        if (matches(filter, topic)) {
+            client->_inbox.push_back({topic, payload, false, (uint32_t)millis()});
+            return;
+        }
+    }
+}
+
+inline void HostMqtt::dropConnection() {
+    if (!client || !client->_connected) return;
+    client->_connected = false;
+    client->_state = MQTT_CONNECTION_LOST;
+    if (!client->_will.topic.empty()) {
+        store(client->_will.topic, client->_will.payload, client->_will.retained);
+    }
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <Arduino.h>
+#include "IPAddress.h"
+#include "WiFiClient.h"
+#include <vector>
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+    ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+    ARDUINO_EVENT_MAX = 44
+} arduino_event_id_t;
+
+typedef void (*WiFiEventCb)(arduino_event_id_t event);
+
+#define WIFI_STA 1
+
+// The radio environment a test sets up. WiFi.begin() joins an access point on
+// the virtual clock: a direct join (channel and BSSID given) associates after
+// directJoinMs if that AP is really there, a scan finds the SSID after scanMs
+// plus directJoinMs, and DHCP takes dhcpMs more (none with WiFi.config()).
+// Progress is applied whenever WiFi.status() is read.
+namespace HostWifi {
+
+struct AccessPoint {
+    const char* ssid;
+    uint8_t bssid[6];
+    int32_t channel;
+};
+
+inline std::vector<AccessPoint> aps;
+inline uint32_t scanMs = 2500;          // All channels, active scan
+inline uint32_t directJoinMs = 150;
+inline uint32_t dhcpMs = 600;
+
+// What the last attempt did, in virtual ms; 0 when it hasn't happened
+inline uint32_t beganMs = 0;
+inline uint32_t associatedMs = 0;
+inline uint32_t gotIpMs = 0;
+inline uint32_t scans = 0;
+
+inline void reset() {
+    aps.clear();
+    beganMs = associatedMs = gotIpMs = 0;
+    scans = 0;
+}
+
+}
+
+class WiFiClass {
+public:
+    wl_status_t linkStatus = WL_DISCONNECTED;
+    IPAddress ip;
+    int8_t rssi = -60;
+
+    wl_status_t status() {
+        advance();
+        return linkStatus;
+    }
+    bool mode(int) { return true; }
+    bool setAutoReconnect(bool on) {
+        autoReconnect = on;
+        return true;
+    }
+    int onEvent(WiFiEventCb cb, arduino_event_id_t = ARDUINO_EVENT_MAX) {
+        _handlers.push_back(cb);
+        return (int)_handlers.size();
+    }
+    bool config(IPAddress local, IPAddress, IPAddress, IPAddress = IPAddress()) {
+        _staticIp = local;
+        _useStaticIp = local != IPAddress();
+        return true;
+    }
+
+    wl_status_t begin(const char* ssid, const char* = nullptr, int32_t channel = 0, const uint8_t* bssid = nullptr,
+                      bool = true) {
+        disconnect();
+        const uint32_t now = millis();
+        HostWifi::beganMs = now;
+        HostWifi::associatedMs = HostWifi::gotIpMs = 0;
+        _target = nullptr;
+        for (const auto& ap : HostWifi::aps) {
+            if (strcmp(ap.ssid, ssid) != 0) continue;
+            if (bssid && (memcmp(ap.bssid, bssid, 6) != 0 || ap.channel != channel)) continue;
+            _target = &ap;
+            break;
+        }
+        if (!bssid) HostWifi::scans++;
+        _associateAtMs = now + (bssid ? 0 : HostWifi::scanMs) + HostWifi::directJoinMs;
+        _attempting = true;
+        return linkStatus;
+    }
+    bool disconnect(bool = false, bool = false) {
+        _attempting = false;
+        _associated = false;
+        _target = nullptr;
+        linkStatus = WL_DISCONNECTED;
+        return true;
+    }
+
+    IPAddress localIP() { return ip; }
+    int8_t RSSI() { return rssi; }
+    uint8_t* BSSID() { return _associated ? _bssid : nullptr; }
+    int32_t channel() { return _associated ? _channel : 0; }
+
+    bool autoReconnect = true;
+
+private:
+    std::vector<WiFiEventCb> _handlers;
+    IPAddress _staticIp;
+    bool _useStaticIp = false;
+    const HostWifi::AccessPoint* _target = nullptr;
+    bool _attempting = false;
+    bool _associated = false;
+    uint32_t _associateAtMs = 0;
+    uint8_t _bssid[6] = {0};
+    int32_t _channel = 0;
+
+    void fire(arduino_event_id_t event) {
+        for (WiFiEventCb cb : _handlers) cb(event);
+    }
+
+    void advance() {
+        if (!_attempting || !_target) return;
+        const uint32_t now = millis();
+        if (!_associated && (int32_t)(now - _associateAtMs) >= 0) {
+            _associated = true;
+            memcpy(_bssid, _target->bssid, sizeof(_bssid));
+            _channel = _target->channel;
+            HostWifi::associatedMs = now;
+            fire(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+        }
+        const uint32_t ipAfterMs = _useStaticIp ? 0 : HostWifi::dhcpMs;
+        if (_associated && linkStatus != WL_CONNECTED && now - HostWifi::associatedMs >= ipAfterMs) {
+            ip = _useStaticIp ? _staticIp : IPAddress(192, 168, 1, 50);
+            linkStatus = WL_CONNECTED;
+            HostWifi::gotIpMs = now;
+            fire(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+        }
+    }
+};
+extern WiFiClass WiFi;
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Arduino.h>
+#include <string>
+
+// In-memory socket: whatever the peer queued with deliver() is read back, and
+// writes are discarded. HTTPClient's stand-in is the only peer.
+class WiFiClient : public Stream {
+public:
+    uint32_t connects = 0;      // Connections opened, i.e. handshakes on a TLS client
+
+    bool connected() { return _open; }
+    virtual ~WiFiClient() = default;
+
+    void stop() {
+        if (_open) closed();
+        _open = false;
+        _rx.clear();
+        _pos = 0;
+    }
+    // Opens the connection if it isn't already
+    void connectIfClosed() {
+        if (_open) return;
+        _open = true;
+        connects++;
+        opened();
+    }
+    void deliver(const std::string& bytes) {
+        _rx.erase(0, _pos);
+        _pos = 0;
+        _rx += bytes;
+    }
+
+    int available() override { return (int)(_rx.size() - _pos); }
+    int read() override { return _pos < _rx.size() ? (uint8_t)_rx[_pos++] : -1; }
+    int peek() override { return _pos < _rx.size() ? (uint8_t)_rx[_pos] : -1; }
+    size_t write(uint8_t) override { return 1; }
+    using Print::write;
+
+protected:
+    virtual void opened() {}
+    virtual void closed() {}
+
+private:
+    bool _open = false;
+    std::string _rx;
+    size_t _pos = 0;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "WiFiClient.h"
+
+// What an open TLS connection costs: its mbedTLS record buffers and session,
+// taken from ESP's heap figures while the connection is open
+namespace HostTls {
+inline uint32_t connectionBytes = 40 * 1024;
+}
+
+class WiFiClientSecure : public WiFiClient {
+public:
+    void setInsecure() {}
+    void setCACert(const char*) {}
+
+protected:
+    void opened() override {
+        ESP.freeHeap -= HostTls::connectionBytes;
+        ESP.maxAllocHeap -= HostTls::connectionBytes;
+        if (ESP.freeHeap < ESP.minFreeHeap) ESP.minFreeHeap = ESP.freeHeap;
+    }
+    void closed() override {
+        ESP.freeHeap += HostTls::connectionBytes;
+        ESP.maxAllocHeap += HostTls::connectionBytes;
+    }
+};
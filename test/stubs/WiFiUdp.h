@@ -0,0 +1,122 @@
+#pragma once
+
+#include <WiFi.h>
+#include <functional>
+#include <vector>
+
+class WiFiUDP;
+
+// In-memory UDP network for simulations with several devices in one process.
+// Each WiFiUDP is a host at the address in `nextIp` when it was constructed.
+// Packets are delivered `latencyUs()` after they were sent, on the network's own
+// clock (`nowUs`), which the simulation keeps separately from each device's clock.
+namespace HostNetwork {
+
+struct Packet {
+    IPAddress from;
+    uint16_t fromPort;
+    uint64_t deliverUs;
+    std::vector<uint8_t> data;
+};
+
+inline uint64_t nowUs = 0;
+inline IPAddress nextIp(10, 0, 0, 1);
+inline std::function<uint32_t()> latencyUs = [] { return 1000u; };
+inline std::vector<WiFiUDP*> sockets;
+
+}
+
+class WiFiUDP {
+public:
+    WiFiUDP() : _ip(HostNetwork::nextIp) {
+        HostNetwork::nextIp = IPAddress((uint32_t)HostNetwork::nextIp + (1u << 24));
+        HostNetwork::sockets.push_back(this);
+    }
+    ~WiFiUDP() {
+        auto& s = HostNetwork::sockets;
+        s.erase(std::remove(s.begin(), s.end(), this), s.end());
+    }
+    WiFiUDP(const WiFiUDP&) = delete;
+    WiFiUDP& operator=(const WiFiUDP&) = delete;
+
+    uint8_t begin(uint16_t port) {
+        _port = port;
+        return 1;
+    }
+    uint8_t beginMulticast(IPAddress group, uint16_t port) {
+        _group = group;
+        _port = port;
+        return 1;
+    }
+    void stop() { _port = 0; }
+
+    int beginPacket(IPAddress ip, uint16_t port) {
+        _out.clear();
+        _outMulticast = false;
+        _outIp = ip;
+        _outPort = port;
+        return 1;
+    }
+    int beginMulticastPacket() {
+        _out.clear();
+        _outMulticast = true;
+        _outIp = _group;
+        _outPort = _port;
+        return 1;
+    }
+    size_t write(const uint8_t* data, size_t len) {
+        const size_t start = _out.size();
+        _out.resize(start + len);
+        memcpy(_out.data() + start, data, len);
+        return len;
+    }
+    int endPacket() {
+        for (WiFiUDP* s : HostNetwork::sockets) {
+            const bool to = _outMulticast ? (s->_group == _outIp && s->_port == _outPort)
+                                          : (s->_ip == _outIp && s->_port == _outPort);
+            if (to && s->_port != 0) {
+                s->_inbox.push_back({_ip, _port, HostNetwork::nowUs + HostNetwork::latencyUs(), _out});
+            }
+        }
+        return 1;
+    }
+
+    // Next packet that has arrived by now, earliest first
+    int parsePacket() {
+        _current.data.clear();
+        _readPos = 0;
+        auto best = _inbox.end();
+        for (auto it = _inbox.begin(); it != _inbox.end(); ++it) {
+            if (it->deliverUs <= HostNetwork::nowUs && (best == _inbox.end() || it->deliverUs < best->deliverUs)) {
+                best = it;
+            }
+        }
+        if (best == _inbox.end()) return 0;
+        _current = *best;
+        _inbox.erase(best);
+        return (int)_current.data.size();
+    }
+    int read(uint8_t* buf, size_t len) {
+        const size_t n = std::min(len, _current.data.size() - _readPos);
+        memcpy(buf, _current.data.data() + _readPos, n);
+        _readPos += n;
+        return (int)n;
+    }
+    IPAddress remoteIP() const { return _current.from; }
+    uint16_t remotePort() const { return _current.fromPort; }
+    IPAddress localIP() const { return _ip; }
+
+private:
+    IPAddress _ip;
+    IPAddress _group;
+    uint16_t _port = 0;
+
+    std::vector<uint8_t> _out;
+    bool _outMulticast = false;
+    IPAddress _outIp;
+    uint16_t _outPort = 0;
+
+    std::vector<HostNetwork::Packet> _inbox;
+    HostNetwork::Packet _current;
+    size_t _readPos = 0;
+};
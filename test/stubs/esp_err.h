@@ -0,0 +1,15 @@
+#pragma once
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL (-1)
+#define ESP_ERR_NOT_SUPPORTED 0x106
+
+inline const char* esp_err_to_name(esp_err_t err) {
+    switch (err) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        default: return "ESP_FAIL";
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "esp_err.h"
+
+// As on the stock Arduino core: power management isn't compiled in
+typedef struct {
+    int max_freq_mhz;
+    int min_freq_mhz;
+    bool light_sleep_enable;
+} esp_pm_config_esp32s3_t;
+
+inline esp_err_t esp_pm_configure(const void*) { return ESP_ERR_NOT_SUPPORTED; }
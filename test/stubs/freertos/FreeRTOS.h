@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+// Host stand-in for the FreeRTOS types and critical sections. Tasks are plain
+// threads, so critical sections are real locks and ThreadSanitizer sees them.
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFFu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+struct portMUX_TYPE {
+    std::mutex lock;
+};
+#define portMUX_INITIALIZER_UNLOCKED {}
+
+inline void portENTER_CRITICAL(portMUX_TYPE* mux) { mux->lock.lock(); }
+inline void portEXIT_CRITICAL(portMUX_TYPE* mux) { mux->lock.unlock(); }
+inline void portENTER_CRITICAL_ISR(portMUX_TYPE* mux) { mux->lock.lock(); }
+inline void portEXIT_CRITICAL_ISR(portMUX_TYPE* mux) { mux->lock.unlock(); }
+#define portYIELD_FROM_ISR(woken) (void)(woken)
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "FreeRTOS.h"
+#include <cstring>
+#include <vector>
+
+// Fixed-depth queue of fixed-size items, safe from any thread. Storage is
+// allocated once at creation, like FreeRTOS's. Only non-blocking sends and
+// receives are modelled; a timeout is treated as 0.
+struct HostQueue {
+    std::mutex lock;
+    std::vector<uint8_t> storage;
+    size_t depth;
+    size_t itemSize;
+    size_t head = 0;    // Next item to receive
+    size_t count = 0;
+
+    uint8_t* slot(size_t i) { return &storage[((head + i) % depth) * itemSize]; }
+};
+typedef HostQueue* QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t depth, UBaseType_t itemSize) {
+    return new HostQueue{{}, std::vector<uint8_t>((size_t)depth * itemSize), depth, itemSize};
+}
+
+inline void vQueueDelete(QueueHandle_t q) { delete q; }
+
+inline BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t) {
+    std::lock_guard<std::mutex> guard(q->lock);
+    if (q->count >= q->depth) return pdFALSE;
+    memcpy(q->slot(q->count++), item, q->itemSize);
+    return pdTRUE;
+}
+
+inline BaseType_t xQueueOverwrite(QueueHandle_t q, const void* item) {
+    std::lock_guard<std::mutex> guard(q->lock);
+    q->head = 0;
+    q->count = 1;
+    memcpy(q->slot(0), item, q->itemSize);
+    return pdTRUE;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t) {
+    std::lock_guard<std::mutex> guard(q->lock);
+    if (q->count == 0) return pdFALSE;
+    memcpy(item, q->slot(0), q->itemSize);
+    q->head = (q->head + 1) % q->depth;
+    q->count--;
+    return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+    std::lock_guard<std::mutex> guard(q->lock);
+    return (UBaseType_t)q->count;
+}
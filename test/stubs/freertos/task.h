@@ -0,0 +1,41 @@
+#pragma once
+
+#include "FreeRTOS.h"
+#include <Arduino.h>
+#include <atomic>
+
+// Each thread is a task with a notification count. A take that finds nothing
+// pending lets its timeout pass on the virtual clock instead of blocking.
+struct HostTask {
+    std::atomic<uint32_t> notifications{0};
+};
+typedef HostTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+    static thread_local HostTask self;
+    return &self;
+}
+
+inline void xTaskNotifyGive(TaskHandle_t task) { task->notifications.fetch_add(1); }
+inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) {
+    task->notifications.fetch_add(1);
+    if (woken) *woken = pdTRUE;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    auto& pending = xTaskGetCurrentTaskHandle()->notifications;
+    const uint32_t taken = clearOnExit ? pending.exchange(0) : (pending.load() ? pending.fetch_sub(1) : 0);
+    if (taken == 0 && ticks != portMAX_DELAY) HostClock::advanceMs(ticks * portTICK_PERIOD_MS);
+    return taken;
+}
+
+inline void vTaskDelay(TickType_t ticks) { HostClock::advanceMs(ticks * portTICK_PERIOD_MS); }
+// Tests drive task bodies themselves, so a created task never runs
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t* handle,
+                                          BaseType_t) {
+    if (handle) *handle = nullptr;
+    return pdPASS;
+}
+inline TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+inline BaseType_t xPortGetCoreID() { return 0; }
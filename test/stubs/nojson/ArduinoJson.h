@@ -0,0 +1,9 @@
+#pragma once
+
+// Used only when the real ArduinoJson isn't available: declares what Memory.h
+// needs, so tests that never parse JSON can still build
+template <typename TAllocator>
+class BasicJsonDocument {
+public:
+    explicit BasicJsonDocument(size_t) {}
+};